@@ -24,7 +24,9 @@ Cpu65XX(Memory& memory) :
     m_downCycles (0),
     m_cycles     (0),
     m_queuedInstruction (0),
-    m_illegalInstructions ()
+    m_illegalInstructions (),
+    m_stallCycles (0),
+    m_tracing (true)
 {
     m_instructions = new Instruction[256];
     buildMemoryOperationFuncs();
@@ -1628,15 +1630,21 @@ void
 Cpu65XX::
 tick()
 {
+    if (m_stallCycles) {
+        m_stallCycles--;
+        m_cycles++;
+        return;
+    }
+
     // Handle NMIs
     // --        ---1--  ??  /NMI  NMI         B=0 [S]=PC,[S]=P,I=1,PC=[FFFA]
     if (m_NMI) {
         // Main NMI work.
         m_status.setBreakFlag(false);
         pushStackWord(PC());
-        pushStackWord(statusRegister().value());
+        pushStackByte(statusRegister().value());
         m_status.setIRQDisable(true);
-        setPC(0xFFFA);
+        setPC(wordAt(NMI_ADDRESS));
         // Clean up processor state.
         m_downCycles = 0;
         m_queuedInstruction = NULL;
@@ -1651,9 +1659,9 @@ tick()
         // Main IRQ work.
         m_status.setBreakFlag(false);
         pushStackWord(PC());
-        pushStackWord(statusRegister().value());
+        pushStackByte(statusRegister().value());
         m_status.setIRQDisable(true);
-        setPC(0xFFFE);
+        setPC(wordAt(IRQ_ADDRESS));
         // Clean up processor state.
         m_downCycles = 0;
         m_queuedInstruction = NULL;
@@ -1682,7 +1690,9 @@ tick()
     // Fetch and queue the next instruction.
     m_queuedInstruction = &(m_instructions[m_memory.read(PC())]);
 
-    m_lastInstructionDebugOut = debugOutput();
+    if (m_tracing) {
+        m_lastInstructionDebugOut = debugOutput();
+    }
 
     // Determine how long to wait until we execute it.
     m_downCycles = m_queuedInstruction->cycles();
@@ -1695,6 +1705,23 @@ lastInstructionDebugOut() const
     return m_lastInstructionDebugOut;
 }
 
+void
+Cpu65XX::
+setTracing(bool enabled)
+{
+    m_tracing = enabled;
+    if (!m_tracing) {
+        m_lastInstructionDebugOut.clear();
+    }
+}
+
+bool
+Cpu65XX::
+tracing() const
+{
+    return m_tracing;
+}
+
 void
 Cpu65XX::
 signalNMI() 
@@ -1702,6 +1729,13 @@ signalNMI()
     m_NMI = true;
 }
 
+void
+Cpu65XX::
+stall(unsigned int cycles)
+{
+    m_stallCycles += cycles;
+}
+
 // Cpu65XX accessors
 const u8_byte &
 Cpu65XX::
@@ -2095,7 +2129,12 @@ Cpu65XX::
 resetImpl()
 {
     //TODO...
-    m_PC = RESET_ADDRESS;
+    m_PC = wordAt(RESET_ADDRESS);
+    // Nothing under way, an instruction or a DMA stall, carries over to
+    // the new program.
+    m_queuedInstruction = NULL;
+    m_downCycles  = 0;
+    m_stallCycles = 0;
 }
 
 void
@@ -2103,7 +2142,10 @@ Cpu65XX::
 powerOnImpl()
 {
     //TODO...
-    m_PC = RESET_ADDRESS;
+    m_PC = wordAt(RESET_ADDRESS);
+    m_queuedInstruction = NULL;
+    m_downCycles  = 0;
+    m_stallCycles = 0;
 }
 
 void
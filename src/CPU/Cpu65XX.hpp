@@ -24,7 +24,10 @@ class Cpu65XX : public PoweredDevice, public ClockedDevice
 
         ~Cpu65XX();
 
+        // Interrupt vectors: each holds the address to jump to.
+        static const u16_word NMI_ADDRESS        = 0xFFFA;
         static const u16_word RESET_ADDRESS      = 0xFFFC;
+        static const u16_word IRQ_ADDRESS        = 0xFFFE;
 
         static const unsigned int mainMemorySize = 64 * 1024;
         static const unsigned int clockDivisor   = 12;
@@ -91,6 +94,9 @@ class Cpu65XX : public PoweredDevice, public ClockedDevice
 
         void tick();
         void signalNMI();
+        // Halts the CPU for cycles, e.g. while DMA has the bus. Interrupts
+        // wait until it's over.
+        void stall(unsigned int cycles);
 
         // accessors
         const u8_byte&           A()  const;
@@ -114,6 +120,12 @@ class Cpu65XX : public PoweredDevice, public ClockedDevice
         std::string debugOutput();
         const std::string& lastInstructionDebugOut() const;
 
+        // Tracing fills lastInstructionDebugOut() before every instruction.
+        // It is slow, and disassembling an operand reads it, which can upset
+        // registers with read side effects, so headless runs turn it off.
+        void setTracing(bool enabled);
+        bool tracing() const;
+
         // Get the debug output immediately after the last instruction executed.
         const std::string& getDebugOutput() const;
 
@@ -209,7 +221,10 @@ class Cpu65XX : public PoweredDevice, public ClockedDevice
         // Cycles to wait until executing the current instruction.
         unsigned int      m_downCycles; 
         unsigned int      m_cycles;
+        // Cycles the CPU is halted for, before anything else happens.
+        unsigned int      m_stallCycles;
 
+        bool              m_tracing;
         std::string       m_lastInstructionDebugOut;
 };
 
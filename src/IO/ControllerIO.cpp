@@ -96,15 +96,23 @@ u8_byte
 ControllerIO::JoypadInputRegister::
 read()
 {
-    assert(m_controller != nullptr && "JoypadInputRegister's m_controller member is nullptr!");
+    // Only the low bits are driven; the rest is open bus, which is usually
+    // the high byte of the $4016/$4017 address.
+    const u8_byte OPEN_BUS = 0x40;
+    if (m_controller == nullptr) {
+        return OPEN_BUS;
+    }
     u8_byte data = m_controller->read();
     m_controller->signalClock();
-    return data;
+    return OPEN_BUS | (data & 0x01);
 }
 
 NESJoypad::
 NESJoypad() :
-    NESController ()
+    NESController (),
+    m_buttons (0x00),
+    m_shift (0x00),
+    m_strobe (false)
 {
 }
 
@@ -114,62 +122,54 @@ NESJoypad::
 
 void 
 NESJoypad::
-pressed(Button button)
+setPressed(Button button, bool pressed)
 {
     assert(button != ButtonsCount && "Invalid button value passed: ButtonsCount");
-    m_pressed[button] = true;
+    u8_byte mask = 0x01 << button;
+    m_buttons = pressed ? (m_buttons | mask) : (m_buttons & ~mask);
 }
 
 void
 NESJoypad::
-signalClock()
+setButtons(u8_byte buttons)
 {
-    u8_byte pressedStatus = 0x00;
-    int shiftAmount = 7;
-    // Build the status byte.
-    for (bool &is_pressed: m_pressed) { 
-        pressedStatus = is_pressed << shiftAmount;
-        // Clear the pressed status.
-        is_pressed = false; 
-        --shiftAmount;
-    }
-
-    m_shift.write(pressedStatus);
+    m_buttons = buttons;
 }
 
 u8_byte
 NESJoypad::
-read()
+buttons() const
 {
-    return m_shift.read();
+    return m_buttons;
 }
 
-NESJoypad::ShiftRegister::
-ShiftRegister() :
-    Register(Register::StateData("joypad_shift", 0x00, 0x00, 0x00, 0x00)),
-    m_goodbits (0x00)
-{}
+void
+NESJoypad::
+setStrobe(bool high)
+{
+    // The buttons are latched continuously while the strobe is high, so the
+    // state when it goes low is the one that gets read out.
+    m_strobe = high;
+    m_shift  = m_buttons;
+}
 
-u8_byte
-NESJoypad::ShiftRegister::
-read()
+void
+NESJoypad::
+signalClock()
 {
-    // The shift register starts returning 1s 
-    // if all the data has been read.
-    if (m_goodbits == 0) {
-        return 0x01;
+    if (m_strobe) {
+        return;
     }
-
-    u8_byte data = rawRead();
-    rawWrite(data >> 1);
-    m_goodbits = m_goodbits >> 1;
-    return data & 0x01;
+    // Ones are shifted in behind the buttons, so reads past the 8th return 1.
+    m_shift = (m_shift >> 1) | 0x80;
 }
 
-void
-NESJoypad::ShiftRegister::
-write(u8_byte data, u8_byte mask)
+u8_byte
+NESJoypad::
+read()
 {
-    m_goodbits = 0xFF;
-    Register::write(data, mask);
+    if (m_strobe) {
+        return m_buttons & 0x01;
+    }
+    return m_shift & 0x01;
 }
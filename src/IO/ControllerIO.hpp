@@ -10,10 +10,14 @@ class Controller;
 class NESController
 {
 public:
+    virtual ~NESController() {}
+
     // TODO: Handle input from local host computer.
 
     virtual u8_byte read() = 0;
     virtual void signalClock() = 0;
+    // Bit 0 of writes to $4016, which controllers use to latch their state.
+    virtual void setStrobe(bool high) {}
 
     /* TODO: Do we need a pin-level emulation? Probably not...
     // Out pins
@@ -81,7 +85,10 @@ private:
         void setController2(NESController * controller) { m_controller2 = controller; }
 
         virtual void write(u8_byte data, u8_byte mask = 0xFF) {
-            //TODO: Handle output data to controllers and expansion port.
+            bool strobe = (data & STROBE_MASK) != 0;
+            if (m_controller1 != nullptr) { m_controller1->setStrobe(strobe); }
+            if (m_controller2 != nullptr) { m_controller2->setStrobe(strobe); }
+            //TODO: Handle output data to expansion port.
         }
 
     private:
@@ -99,6 +106,8 @@ private:
     JoypadOutputRegister    m_joypadOutputRegister; 
 };
 
+// The standard controller: an 8 bit shift register loaded with the button
+// states while the strobe is high, then read out one button per read.
 class NESJoypad : public NESController 
 {
 public:
@@ -119,27 +128,19 @@ public:
         ButtonsCount // ALWAYS last element of enum.
     };
 
-    void pressed(Button button);
-
-    virtual void signalClock();
+    void    setPressed(Button button, bool pressed);
+    // Bit n holds the state of Button n.
+    void    setButtons(u8_byte buttons);
+    u8_byte buttons() const;
 
+    virtual void    setStrobe(bool high);
+    virtual void    signalClock();
     virtual u8_byte read();
 
 private:
-    class ShiftRegister : public Register
-    {
-    public:
-        ShiftRegister();
-
-        virtual u8_byte read();
-        virtual void    write(u8_byte data, u8_byte mask = 0xFF);
-
-    private:
-        u8_byte m_goodbits;
-    };
-
-    ShiftRegister m_shift;
-    bool m_pressed[ButtonsCount];
+    u8_byte m_buttons;
+    u8_byte m_shift;
+    bool    m_strobe;
 };
 
 #endif //CONTROLLER_IO_H
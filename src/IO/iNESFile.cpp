@@ -84,7 +84,17 @@ headerInfo() const
     return output.str();
 }
 
-const std::string& 
+bool
+iNESFile::
+isGood() const
+{
+    // Loaded, has the right banner and is long enough for the ROM it claims to hold.
+    return m_fileData != nullptr &&
+           isiNESFile() &&
+           m_fileSize >= HEADER_SIZE + (trainerPresent() * TRAINER_SIZE) + PRGROMDataSize() + CHRROMDataSize();
+}
+
+const std::string&
 iNESFile::
 filename() const
 {
@@ -0,0 +1,157 @@
+#include "BackgroundCache.hpp"
+
+#include "TileCache.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+
+const unsigned int BackgroundCache::LINES;
+const unsigned int BackgroundCache::WIDTH;
+
+// Nametable layout.
+const unsigned int NAMETABLE_COLUMNS    = 32;
+const u16_word     ATTRIBUTE_OFFSET     = 0x3C0;
+const unsigned int ATTRIBUTE_COLUMNS    = 8;
+// Tile rows each attribute row colours.
+const unsigned int ATTRIBUTE_ROW_HEIGHT = 4;
+
+static void
+setBit(std::uint64_t* bits, unsigned int bit)
+{
+    bits[bit / 64] |= std::uint64_t(1) << (bit % 64);
+}
+
+void
+BackgroundCache::Footprint::
+clear()
+{
+    std::fill(m_rows, m_rows + 2, 0);
+    std::fill(m_tiles, m_tiles + TILES / 64, 0);
+    m_table = 0;
+}
+
+void
+BackgroundCache::Footprint::
+addRow(unsigned int nametable, unsigned int row)
+{
+    setBit(m_rows, nametable * NAMETABLE_ROWS + row);
+}
+
+void
+BackgroundCache::Footprint::
+addTile(u8_byte tile)
+{
+    setBit(m_tiles, tile);
+}
+
+BackgroundCache::
+BackgroundCache() :
+    m_haveMemory (false)
+{
+    bypass();
+    finish();
+}
+
+void
+BackgroundCache::
+begin(const RenderState& memory)
+{
+    std::fill(m_dirtyRows, m_dirtyRows + 2, 0);
+    std::fill(&m_dirtyTiles[0][0], &m_dirtyTiles[0][0] + 2 * TILES / 64, 0);
+
+    if (m_haveMemory) {
+        for (unsigned int nametable = 0; nametable < NAMETABLES; ++nametable) {
+            u16_word base = NAMETABLE_ADDRESS + nametable * NAMETABLE_SIZE;
+            for (unsigned int row = 0; row < NAMETABLE_ROWS; ++row) {
+                u16_word tiles      = base + row * NAMETABLE_COLUMNS;
+                u16_word attributes = base + ATTRIBUTE_OFFSET + (row / ATTRIBUTE_ROW_HEIGHT) * ATTRIBUTE_COLUMNS;
+                if (std::memcmp(m_memory + tiles, memory.m_vram + tiles, NAMETABLE_COLUMNS) != 0 ||
+                    std::memcmp(m_memory + attributes, memory.m_vram + attributes, ATTRIBUTE_COLUMNS) != 0) {
+                    setBit(m_dirtyRows, nametable * NAMETABLE_ROWS + row);
+                }
+            }
+        }
+        for (unsigned int table = 0; table < 2; ++table) {
+            for (unsigned int tile = 0; tile < TILES; ++tile) {
+                u16_word address = table * TileCache::TABLE_BYTES + tile * TileCache::TILE_BYTES;
+                if (std::memcmp(m_memory + address, memory.m_vram + address, TileCache::TILE_BYTES) != 0) {
+                    setBit(m_dirtyTiles[table], tile);
+                }
+            }
+        }
+    }
+    else {
+        for (unsigned int line = 0; line < LINES; ++line) {
+            m_lines[line].m_valid = false;
+        }
+    }
+
+    std::memcpy(m_memory, memory.m_vram, MEMORY_SIZE);
+    m_haveMemory = true;
+}
+
+void
+BackgroundCache::
+bypass()
+{
+    m_haveMemory = false;
+    for (unsigned int line = 0; line < LINES; ++line) {
+        m_lines[line].m_valid = false;
+        m_lines[line].m_used  = UNUSED;
+    }
+}
+
+const u8_byte*
+BackgroundCache::
+lookup(unsigned int line, const Key& key)
+{
+    assert(line < LINES && "BackgroundCache::lookup: no such line!");
+    Line &cached = m_lines[line];
+    if (!cached.m_valid || !m_haveMemory || !(cached.m_key == key)) {
+        return nullptr;
+    }
+
+    const Footprint &footprint = cached.m_footprint;
+    bool dirty = (footprint.m_rows[0] & m_dirtyRows[0]) || (footprint.m_rows[1] & m_dirtyRows[1]);
+    for (unsigned int i = 0; i < TILES / 64 && !dirty; ++i) {
+        dirty = footprint.m_tiles[i] & m_dirtyTiles[footprint.m_table][i];
+    }
+    if (dirty) {
+        return nullptr;
+    }
+
+    cached.m_used = REUSED;
+    return cached.m_pixels;
+}
+
+u8_byte*
+BackgroundCache::
+store(unsigned int line, const Key& key, Footprint*& footprint)
+{
+    assert(line < LINES && "BackgroundCache::store: no such line!");
+    Line &cached = m_lines[line];
+    cached.m_valid = m_haveMemory;
+    cached.m_used  = DRAWN;
+    cached.m_key   = key;
+    cached.m_footprint.clear();
+    footprint = &cached.m_footprint;
+    return cached.m_pixels;
+}
+
+void
+BackgroundCache::
+finish()
+{
+    m_stats.m_linesDrawn  = 0;
+    m_stats.m_linesReused = 0;
+    for (unsigned int line = 0; line < LINES; ++line) {
+        if (m_lines[line].m_used == DRAWN) {
+            ++m_stats.m_linesDrawn;
+        }
+        else if (m_lines[line].m_used == REUSED) {
+            ++m_stats.m_linesReused;
+        }
+        m_lines[line].m_used = UNUSED;
+    }
+}
@@ -0,0 +1,119 @@
+#ifndef PPU_BACKGROUND_CACHE_H
+#define PPU_BACKGROUND_CACHE_H
+
+#include "RenderLog.hpp"
+#include "utility/DataTypes.hpp"
+
+#include <cstdint>
+
+/*
+BackgroundCache
+
+The background line buffers of the last frame, kept so a static background
+isn't drawn again every frame. Each line remembers the registers it was
+drawn with and its footprint: the nametable rows (tile and attribute bytes)
+and the tiles it read. At the start of a frame the nametables and pattern
+tables are compared with the copy the cache was drawn from, and a line is
+only drawn again if its registers differ or its footprint touches something
+that changed. A reused line is exactly what drawing it would give.
+
+The copy can only describe one moment, so frames that write VRAM or switch
+CHR banks while they're drawn bypass the cache (and empty it).
+
+begin() and finish() bracket a frame. In between, lookup() and store() may
+be called from several threads at once for different lines.
+*/
+
+class BackgroundCache
+{
+public:
+    static const unsigned int LINES          = 240;
+    static const unsigned int WIDTH          = 256;
+    static const unsigned int NAMETABLES     = 4;
+    // Tile rows a line can read: a scroll set past row 29 reads the
+    // attribute table as two more.
+    static const unsigned int NAMETABLE_ROWS = 32;
+    static const unsigned int TILES          = 256;
+
+    // Everything besides memory a background line depends on.
+    struct Key
+    {
+        u8_byte  m_control;
+        u8_byte  m_mask;
+        u16_word m_address;     // v at the start of the line.
+        u8_byte  m_fineX;
+
+        bool operator==(const Key& other) const {
+            return m_control == other.m_control && m_mask == other.m_mask &&
+                   m_address == other.m_address && m_fineX == other.m_fineX;
+        }
+    };
+
+    // What a line read, filled in while it's drawn.
+    struct Footprint
+    {
+        void clear();
+        void addRow(unsigned int nametable, unsigned int row);
+        void addTile(u8_byte tile);
+
+        std::uint64_t m_rows[2];    // Bit nametable * NAMETABLE_ROWS + row.
+        std::uint64_t m_tiles[TILES / 64];
+        unsigned int  m_table;      // Pattern table half the tiles came from.
+    };
+
+    struct Statistics
+    {
+        unsigned int m_linesDrawn;
+        unsigned int m_linesReused;
+
+        // Of the lines with the background on, the share drawn again.
+        double drawnFraction() const {
+            unsigned int lines = m_linesDrawn + m_linesReused;
+            return lines ? double(m_linesDrawn) / lines : 0.0;
+        }
+    };
+
+    BackgroundCache();
+
+    // Notes what changed since the cached lines were drawn. memory is the
+    // frame's, and stays put until finish().
+    void begin(const RenderState& memory);
+    // This frame doesn't use the cache; forget everything.
+    void bypass();
+
+    // The cached line, or null if it has to be drawn again.
+    const u8_byte* lookup(unsigned int line, const Key& key);
+    // Somewhere to draw line, and its footprint to fill in while doing so.
+    u8_byte* store(unsigned int line, const Key& key, Footprint*& footprint);
+
+    void finish();
+    // The last finished frame's.
+    const Statistics& statistics() const { return m_stats; }
+
+private:
+    static const u16_word NAMETABLE_ADDRESS = 0x2000;
+    static const u16_word NAMETABLE_SIZE    = 0x400;
+    static const unsigned int MEMORY_SIZE   = NAMETABLE_ADDRESS + NAMETABLES * NAMETABLE_SIZE;
+
+    struct Line
+    {
+        bool      m_valid;
+        // Set by lookup() and store() for the statistics.
+        u8_byte   m_used;
+        Key       m_key;
+        Footprint m_footprint;
+        u8_byte   m_pixels[WIDTH];
+    };
+
+    enum Use { UNUSED, REUSED, DRAWN };
+
+    bool          m_haveMemory;
+    // Pattern tables and nametables as the valid lines saw them.
+    u8_byte       m_memory[MEMORY_SIZE];
+    std::uint64_t m_dirtyRows[2];
+    std::uint64_t m_dirtyTiles[2][TILES / 64];
+    Line          m_lines[LINES];
+    Statistics    m_stats;
+};
+
+#endif //PPU_BACKGROUND_CACHE_H
@@ -0,0 +1,165 @@
+#include "DotRenderer.hpp"
+
+#include "Loopy.hpp"
+#include "SpriteLine.hpp"
+
+#include <algorithm>
+#include <cassert>
+
+const unsigned int DotRenderer::WIDTH;
+
+const unsigned int TILE_SIDE    = 8;
+const unsigned int TILE_BYTES   = 16;
+const u16_word     TABLE_OFFSET = 0x1000;
+
+// Dots of each eight the fetches finish on, counting from 1.
+const unsigned int NAMETABLE_FETCH = 2;
+const unsigned int ATTRIBUTE_FETCH = 4;
+const unsigned int LOW_FETCH       = 6;
+const unsigned int HIGH_FETCH      = 0;
+
+DotRenderer::
+DotRenderer(const RenderRegisters& registers, const RenderState& memory,
+            const u8_byte* sprites, const u8_byte* colors, const u8_byte* grayColors,
+            unsigned int firstPixel, u8_byte* row) :
+    m_registers (registers),
+    m_memory (memory),
+    m_sprites (sprites),
+    m_firstPixel (firstPixel),
+    m_row (row),
+    m_dot (1),
+    m_patternLow (0),
+    m_patternHigh (0),
+    m_attributeLow (0),
+    m_attributeHigh (0),
+    m_tile (0),
+    m_palette (0),
+    m_low (0),
+    m_high (0)
+{
+    m_colors[0] = colors;
+    m_colors[1] = grayColors;
+
+    // Dots 321-336 of the line before: the first two tiles, each ending
+    // with a step of coarse X.
+    if (renderingEnabled()) {
+        for (unsigned int tile = 0; tile < 2; ++tile) {
+            for (unsigned int step = 1; step <= TILE_SIDE; ++step) {
+                fetch(step % TILE_SIDE);
+            }
+            m_patternLow    <<= TILE_SIDE;
+            m_patternHigh   <<= TILE_SIDE;
+            m_attributeLow  <<= TILE_SIDE;
+            m_attributeHigh <<= TILE_SIDE;
+            reload();
+        }
+    }
+}
+
+bool
+DotRenderer::
+renderingEnabled() const
+{
+    return m_registers.m_mask & (RenderRegisters::SHOW_BACKGROUND_MASK | RenderRegisters::SHOW_SPRITES_MASK);
+}
+
+void
+DotRenderer::
+run(unsigned int dot)
+{
+    assert(dot <= WIDTH + 1 && "DotRenderer::run: past the end of the line!");
+    for (; m_dot < dot; ++m_dot) {
+        // The tile fetched over the last eight dots goes in behind the one
+        // being drawn.
+        if (m_dot % TILE_SIDE == 1 && m_dot > TILE_SIDE) {
+            reload();
+        }
+        unsigned int x = m_dot - 1;
+        if (x >= m_firstPixel) {
+            drawPixel(x);
+        }
+        if (renderingEnabled()) {
+            fetch(m_dot % TILE_SIDE);
+            m_patternLow    <<= 1;
+            m_patternHigh   <<= 1;
+            m_attributeLow  <<= 1;
+            m_attributeHigh <<= 1;
+        }
+    }
+}
+
+void
+DotRenderer::
+fetch(unsigned int step)
+{
+    u16_word v = m_registers.m_vramAddress;
+    switch (step) {
+        case NAMETABLE_FETCH:
+            m_tile = m_memory.m_vram[Loopy::tileAddress(v)];
+            break;
+        case ATTRIBUTE_FETCH:
+            m_palette = (m_memory.m_vram[Loopy::attributeAddress(v)] >> Loopy::attributeShift(v)) & 0x03;
+            break;
+        case LOW_FETCH:
+        case HIGH_FETCH:
+        {
+            bool     second  = m_registers.m_control & RenderRegisters::BACKGROUND_PATTERN_TABLE_MASK;
+            u16_word table   = second ? TABLE_OFFSET : 0;
+            u16_word address = table + m_tile * TILE_BYTES + Loopy::fineY(v);
+            if (step == LOW_FETCH) {
+                m_low = m_memory.m_vram[address];
+            }
+            else {
+                m_high = m_memory.m_vram[address + TILE_SIDE];
+                // Fine Y steps at dot 256 are left to the caller, with the
+                // horizontal copy.
+                m_registers.m_vramAddress = Loopy::incrementX(v);
+            }
+        }
+        break;
+    }
+}
+
+void
+DotRenderer::
+reload()
+{
+    m_patternLow    = (m_patternLow  & 0xFF00) | m_low;
+    m_patternHigh   = (m_patternHigh & 0xFF00) | m_high;
+    m_attributeLow  = (m_attributeLow  & 0xFF00) | ((m_palette & 0x01) ? 0xFF : 0x00);
+    m_attributeHigh = (m_attributeHigh & 0xFF00) | ((m_palette & 0x02) ? 0xFF : 0x00);
+}
+
+void
+DotRenderer::
+drawPixel(unsigned int x)
+{
+    u8_byte mask = m_registers.m_mask;
+    bool    left = x < TILE_SIDE;
+    bool    showBackground = (mask & RenderRegisters::SHOW_BACKGROUND_MASK) &&
+                             (!left || (mask & RenderRegisters::SHOW_LEFTMOST_BACKGROUND_MASK));
+    bool    showSprites    = (mask & RenderRegisters::SHOW_SPRITES_MASK) &&
+                             (!left || (mask & RenderRegisters::SHOW_LEFTMOST_SPRITES_MASK));
+
+    u8_byte background = 0;
+    if (showBackground) {
+        unsigned int bit   = 15 - m_registers.m_fineX;
+        u8_byte      color = ((m_patternLow >> bit) & 0x01) | (((m_patternHigh >> bit) & 0x01) << 1);
+        if (color != 0) {
+            u8_byte palette = ((m_attributeLow >> bit) & 0x01) | (((m_attributeHigh >> bit) & 0x01) << 1);
+            background = (palette << 2) | color;
+        }
+    }
+
+    u8_byte sprite = 0;
+    if (showSprites) {
+        sprite = m_sprites[x];
+    }
+
+    // As SpriteLine::composite does it.
+    u8_byte entry = background;
+    if (sprite != 0 && !((sprite & SpriteLine::BEHIND_BACKGROUND) && background != 0)) {
+        entry = sprite & SpriteLine::ENTRY_MASK;
+    }
+    m_row[x] = m_colors[(mask & RenderRegisters::GRAYSCALE_MASK) ? 1 : 0][entry];
+}
@@ -0,0 +1,70 @@
+#ifndef PPU_DOT_RENDERER_H
+#define PPU_DOT_RENDERER_H
+
+#include "RenderLog.hpp"
+#include "utility/DataTypes.hpp"
+
+/*
+DotRenderer
+
+One scanline's background drawn dot by dot the way the PPU fetches it: two
+tiles ahead in 16 bit shift registers, a nametable, attribute and two
+pattern fetches every eight dots, coarse X stepped along in v after each
+tile and fine X picking the bit out of the shifters. Sprites come ready
+drawn in a line buffer, since they're all fetched before the line starts.
+
+FrameRenderer only uses this for lines where a register write or a bank
+switch lands while the line is being drawn; between run() calls it changes
+registers() and memory the way the log says, and the rest of the line
+picks that up exactly when the PPU would have. Lines with nothing going on
+draw the same either way, only much more slowly here.
+*/
+
+class DotRenderer
+{
+public:
+    static const unsigned int WIDTH = 256;
+
+    // Starts line with registers as they were at its start (the fetches for
+    // its first two tiles, made at the end of the line before, happen
+    // straight away). memory is read as the line goes, so it may change
+    // between run()s. sprites is a sprite line buffer drawn with the
+    // leftmost pixels showing, colors and grayColors the resolved palette.
+    // Pixels before firstPixel are left alone in row.
+    DotRenderer(const RenderRegisters& registers, const RenderState& memory,
+                const u8_byte* sprites, const u8_byte* colors, const u8_byte* grayColors,
+                unsigned int firstPixel, u8_byte* row);
+
+    // Runs every dot before dot (at most the line's last, 256).
+    void run(unsigned int dot);
+
+    RenderRegisters& registers() { return m_registers; }
+
+private:
+    bool renderingEnabled() const;
+    void fetch(unsigned int step);
+    void reload();
+    void drawPixel(unsigned int x);
+
+    RenderRegisters    m_registers;
+    const RenderState &m_memory;
+    const u8_byte     *m_sprites;
+    const u8_byte     *m_colors[2];
+    unsigned int       m_firstPixel;
+    u8_byte           *m_row;
+    unsigned int       m_dot;           // The next dot to run.
+
+    // Shifters, the tile on screen in the top byte and the next below.
+    u16_word m_patternLow;
+    u16_word m_patternHigh;
+    u16_word m_attributeLow;
+    u16_word m_attributeHigh;
+
+    // The tile being fetched.
+    u8_byte  m_tile;
+    u8_byte  m_palette;
+    u8_byte  m_low;
+    u8_byte  m_high;
+};
+
+#endif //PPU_DOT_RENDERER_H
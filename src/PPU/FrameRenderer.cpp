@@ -0,0 +1,442 @@
+#include "FrameRenderer.hpp"
+
+#include "DotRenderer.hpp"
+#include "Loopy.hpp"
+#include "PPU.hpp"
+#include "SpriteLine.hpp"
+
+#include <algorithm>
+#include <cassert>
+
+const unsigned int FrameRenderer::STRIPS_PER_THREAD;
+
+// First dot of a line whose changes no longer apply to all of it.
+static unsigned int
+firstPixelDot(unsigned int line)
+{
+    return line * PPU::ticksPerScanline + 1;
+}
+
+// First dot of a line whose changes come after v has moved to the next.
+static unsigned int
+lineEndDot(unsigned int line)
+{
+    return line * PPU::ticksPerScanline + Loopy::HORIZONTAL_COPY_DOT;
+}
+
+FrameRenderer::
+FrameRenderer() :
+    m_state (),
+    m_tiles (),
+    m_patterns (),
+    m_palette (),
+    m_background (),
+    m_scanlines (),
+    m_pool (nullptr),
+    m_dotsOnly (false),
+    m_dotLines (0)
+{
+}
+
+void
+FrameRenderer::
+setThreadPool(ThreadPool* pool)
+{
+    m_pool = pool;
+}
+
+void
+FrameRenderer::
+setDotsOnly(bool dotsOnly)
+{
+    m_dotsOnly = dotsOnly;
+}
+
+void
+FrameRenderer::
+render(const RenderJob& job, IndexedFrame& frame)
+{
+    lookupPatterns(job.m_start);
+    m_palette.resolve(job.m_start);
+
+    bool stable = captureScanlines(job);
+    if (stable) {
+        m_background.begin(job.m_start);
+    }
+    else {
+        m_background.bypass();
+    }
+
+    if (m_pool && m_pool->size() > 1 && stable) {
+        renderStrips(job, frame);
+    }
+    else {
+        renderSerial(job, frame);
+    }
+    m_background.finish();
+}
+
+void
+FrameRenderer::
+renderSerial(const RenderJob& job, IndexedFrame& frame)
+{
+    m_state = job.m_start;
+    RenderRegisters state = registers(m_state);
+    m_dotLines = 0;
+
+    unsigned int event = 0;
+    for (unsigned int line = 0; line < PPU::height; ++line) {
+        // Anything logged before the line's first pixel applies to all of it.
+        for (; event < job.m_events.size() && job.m_events[event].m_dot < firstPixelDot(line); ++event) {
+            if (!applyRegister(state, job.m_events[event])) {
+                applyMemory(job.m_events[event], job);
+            }
+        }
+
+        unsigned int changes = event;
+        bool         dots    = m_dotsOnly;
+        for (; event < job.m_events.size() && job.m_events[event].m_dot < lineEndDot(line); ++event) {
+            dots = dots || changesMidLine(job.m_events[event], line);
+        }
+
+        renderScanline(state, m_state, m_patterns, m_palette, m_background, line, frame);
+        if (dots) {
+            renderDots(state, m_state, m_patterns, m_palette, job, changes, event, line, frame);
+            ++m_dotLines;
+        }
+        else {
+            // Memory changes during the line show from the next.
+            for (unsigned int i = changes; i < event; ++i) {
+                if (!applyRegister(state, job.m_events[i])) {
+                    applyMemory(job.m_events[i], job);
+                }
+            }
+        }
+        endLine(state);
+    }
+}
+
+void
+FrameRenderer::
+renderStrips(const RenderJob& job, IndexedFrame& frame)
+{
+    unsigned int strips     = std::min(PPU::height, m_pool->size() * STRIPS_PER_THREAD);
+    unsigned int stripLines = (PPU::height + strips - 1) / strips;
+
+    m_pool->run(strips, [&](unsigned int strip) {
+            unsigned int first = strip * stripLines;
+            unsigned int last  = std::min(PPU::height, first + stripLines);
+            for (unsigned int line = first; line < last; ++line) {
+                const ScanlineState &scanline = m_scanlines[line];
+                renderScanline(scanline.m_registers, job.m_start, m_patterns, m_palette, m_background, line, frame);
+                if (scanline.m_changes != scanline.m_changesEnd) {
+                    RenderRegisters registers = scanline.m_registers;
+                    renderDots(registers, job.m_start, m_patterns, m_palette, job,
+                               scanline.m_changes, scanline.m_changesEnd, line, frame);
+                }
+            }
+    });
+}
+
+bool
+FrameRenderer::
+captureScanlines(const RenderJob& job)
+{
+    m_scanlines.resize(PPU::height);
+    m_dotLines = 0;
+
+    RenderRegisters state = registers(job.m_start);
+    unsigned int event = 0;
+    for (unsigned int line = 0; line < PPU::height; ++line) {
+        for (; event < job.m_events.size() && job.m_events[event].m_dot < firstPixelDot(line); ++event) {
+            if (!applyRegister(state, job.m_events[event])) {
+                return false;
+            }
+        }
+
+        ScanlineState &scanline = m_scanlines[line];
+        scanline.m_registers = state;
+        scanline.m_changes   = event;
+        bool dots = m_dotsOnly;
+        for (; event < job.m_events.size() && job.m_events[event].m_dot < lineEndDot(line); ++event) {
+            if (!applyRegister(state, job.m_events[event])) {
+                return false;
+            }
+            dots = dots || changesMidLine(job.m_events[event], line);
+        }
+        scanline.m_changesEnd = dots ? event : scanline.m_changes;
+        m_dotLines += dots;
+        endLine(state);
+    }
+    // Whatever is left can't affect anything we draw.
+    return true;
+}
+
+RenderRegisters
+FrameRenderer::
+registers(const RenderState& state)
+{
+    RenderRegisters registers;
+    registers.m_control     = state.m_control;
+    registers.m_mask        = state.m_mask;
+    registers.m_vramAddress = state.m_vramAddress;
+    registers.m_tempAddress = state.m_tempAddress;
+    registers.m_fineX       = state.m_fineX;
+    return registers;
+}
+
+bool
+FrameRenderer::
+applyRegister(RenderRegisters& registers, const RenderEvent& event)
+{
+    switch (event.m_type) {
+        case RenderEvent::ControlWrite:
+            registers.m_control     = event.m_value;
+            registers.m_tempAddress = event.m_address;
+            return true;
+        case RenderEvent::MaskWrite:
+            registers.m_mask = event.m_value;
+            return true;
+        case RenderEvent::TempAddressWrite:
+            registers.m_tempAddress = event.m_address;
+            registers.m_fineX       = event.m_value;
+            return true;
+        case RenderEvent::AddressWrite:
+            registers.m_vramAddress = event.m_address;
+            registers.m_tempAddress = event.m_address;
+            return true;
+    }
+    return false;
+}
+
+void
+FrameRenderer::
+endLine(RenderRegisters& registers)
+{
+    if (registers.m_mask & (RenderRegisters::SHOW_BACKGROUND_MASK | RenderRegisters::SHOW_SPRITES_MASK)) {
+        registers.m_vramAddress = Loopy::copyHorizontal(Loopy::incrementY(registers.m_vramAddress),
+                                                        registers.m_tempAddress);
+    }
+}
+
+bool
+FrameRenderer::
+changesMidLine(const RenderEvent& event, unsigned int line) const
+{
+    // Pixel x is drawn on dot x + 1, so a change on the line's last dot
+    // shows nowhere.
+    if (event.m_dot < firstPixelDot(line) || event.m_dot >= firstPixelDot(line) + PPU::width - 1) {
+        return false;
+    }
+    return event.m_type != RenderEvent::VideoWrite && event.m_type != RenderEvent::OAMWrite;
+}
+
+void
+FrameRenderer::
+applyMemory(const RenderEvent& event, const RenderJob& job)
+{
+    switch (event.m_type) {
+        case RenderEvent::VideoWrite:
+        {
+            u16_word address = event.m_address % RenderState::VRAM_SIZE;
+            if (address >= RenderState::PALETTE_ADDRESS) {
+                // Palette RAM repeats every 32 bytes up to the end of VRAM.
+                unsigned int entry = address % ResolvedPalette::ENTRIES;
+                address = RenderState::PALETTE_ADDRESS + entry;
+                m_palette.write(entry, event.m_value);
+            }
+            m_state.m_vram[address] = event.m_value;
+            if (address < RenderState::PATTERN_TABLES_SIZE) {
+                // CHR RAM: only the tile written needs decoding again.
+                unsigned int half = address / TileCache::TABLE_BYTES;
+                unsigned int tile = (address % TileCache::TABLE_BYTES) / TileCache::TILE_BYTES;
+                m_patterns.m_tables[half] =
+                    m_tiles.update(m_patterns.m_tables[half],
+                                   m_state.m_vram + half * TileCache::TABLE_BYTES,
+                                   tile, m_patterns.m_tables[half ^ 1]);
+            }
+        }
+        break;
+        case RenderEvent::OAMWrite:
+            m_state.m_oam[event.m_address % RenderState::OAM_SIZE] = event.m_value;
+            break;
+        case RenderEvent::PatternSwitch:
+        {
+            unsigned int offset = event.m_address * RenderState::PATTERN_TABLES_SIZE;
+            assert(offset + RenderState::PATTERN_TABLES_SIZE <= job.m_patterns.size());
+            std::copy(job.m_patterns.begin() + offset,
+                      job.m_patterns.begin() + offset + RenderState::PATTERN_TABLES_SIZE,
+                      m_state.m_vram);
+            lookupPatterns(m_state);
+        }
+        break;
+    }
+}
+
+void
+FrameRenderer::
+lookupPatterns(const RenderState& memory)
+{
+    m_patterns.m_tables[0] = m_tiles.lookup(memory.m_vram);
+    m_patterns.m_tables[1] = m_tiles.lookup(memory.m_vram + TileCache::TABLE_BYTES, m_patterns.m_tables[0]);
+}
+
+void
+FrameRenderer::ResolvedPalette::
+resolve(const RenderState& memory)
+{
+    for (unsigned int entry = 0; entry < ENTRIES; ++entry) {
+        write(entry, memory.m_vram[RenderState::PALETTE_ADDRESS + entry]);
+    }
+}
+
+void
+FrameRenderer::ResolvedPalette::
+write(unsigned int entry, u8_byte value)
+{
+    m_colors[0][entry] = value & IndexedFrame::INDEX_MASK;
+    // Grayscale keeps the luminance and picks the gray column.
+    m_colors[1][entry] = value & 0x30;
+}
+
+void
+FrameRenderer::
+renderScanline(const RenderRegisters& registers, const RenderState& memory,
+               const PatternTables& patterns, const ResolvedPalette& palette,
+               BackgroundCache& background, unsigned int line, IndexedFrame& frame)
+{
+    // Each layer goes into its own line buffer of palette entries, then the
+    // two are merged and looked up in one go.
+    u8_byte blank[PPU::width];
+    u8_byte sprites[PPU::width];
+    u8_byte entries[PPU::width];
+
+    const u8_byte *backgroundLine = blank;
+    if (registers.m_mask & RenderRegisters::SHOW_BACKGROUND_MASK) {
+        BackgroundCache::Key key;
+        key.m_control = registers.m_control & RenderRegisters::BACKGROUND_PATTERN_TABLE_MASK;
+        key.m_mask    = registers.m_mask & RenderRegisters::SHOW_LEFTMOST_BACKGROUND_MASK;
+        key.m_address = registers.m_vramAddress & Loopy::ADDRESS_MASK;
+        key.m_fineX   = registers.m_fineX;
+
+        backgroundLine = background.lookup(line, key);
+        if (!backgroundLine) {
+            BackgroundCache::Footprint *footprint;
+            u8_byte *pixels = background.store(line, key, footprint);
+            renderBackground(registers, memory, patterns, pixels, *footprint);
+            backgroundLine = pixels;
+        }
+    }
+    else {
+        std::fill(blank, blank + PPU::width, 0);
+    }
+    if (registers.m_mask & RenderRegisters::SHOW_SPRITES_MASK) {
+        renderSprites(registers, memory, patterns, line,
+                      registers.m_mask & RenderRegisters::SHOW_LEFTMOST_SPRITES_MASK, sprites);
+    }
+    else {
+        std::fill(sprites, sprites + PPU::width, 0);
+    }
+    // Sprite 0 hits are the PPU's business; here they only decide colours.
+    SpriteLine::composite(backgroundLine, sprites, entries);
+
+    const u8_byte *colors = palette.m_colors[(registers.m_mask & RenderRegisters::GRAYSCALE_MASK) ? 1 : 0];
+    u8_byte *row = frame.row(line);
+    for (unsigned int x = 0; x < PPU::width; ++x) {
+        row[x] = colors[entries[x]];
+    }
+    frame.m_emphasis[line] = registers.m_mask >> IndexedFrame::EMPHASIS_SHIFT;
+}
+
+void
+FrameRenderer::
+renderBackground(const RenderRegisters& registers, const RenderState& memory,
+                 const PatternTables& patterns, u8_byte* pixels,
+                 BackgroundCache::Footprint& footprint)
+{
+    footprint.m_table = (registers.m_control & RenderRegisters::BACKGROUND_PATTERN_TABLE_MASK) ? 1 : 0;
+    const TileCache::DecodedTable *table = patterns.m_tables[footprint.m_table];
+
+    // v is the line's first tile; it moves right a tile at a time, into the
+    // next nametable across.
+    u16_word     v     = registers.m_vramAddress;
+    unsigned int fineY = Loopy::fineY(v);
+
+    // One tile (or the part of it on screen) per step.
+    unsigned int x  = 0;
+    unsigned int px = registers.m_fineX;
+    while (x < PPU::width) {
+        u8_byte tile      = memory.m_vram[Loopy::tileAddress(v)];
+        u8_byte attribute = memory.m_vram[Loopy::attributeAddress(v)];
+        u8_byte palette   = ((attribute >> Loopy::attributeShift(v)) & 0x03) << 2;
+
+        footprint.addRow(Loopy::nametable(v), Loopy::coarseY(v));
+        footprint.addTile(tile);
+
+        const u8_byte *row = table->row(tile, fineY);
+        for (; px < TileCache::TILE_SIDE && x < PPU::width; ++px, ++x) {
+            pixels[x] = palette | row[px];
+        }
+        px = 0;
+        v  = Loopy::incrementX(v);
+    }
+
+    if (!(registers.m_mask & RenderRegisters::SHOW_LEFTMOST_BACKGROUND_MASK)) {
+        std::fill(pixels, pixels + TileCache::TILE_SIDE, 0);
+    }
+}
+
+void
+FrameRenderer::
+renderSprites(const RenderRegisters& registers, const RenderState& memory,
+              const PatternTables& patterns, unsigned int line, bool showLeftmost,
+              u8_byte* pixels)
+{
+    SpriteLine sprites;
+    sprites.evaluate(memory.m_oam, line, registers.m_control);
+    sprites.fetch(patterns.m_tables);
+    sprites.draw(showLeftmost, pixels);
+}
+
+void
+FrameRenderer::
+renderDots(RenderRegisters& registers, const RenderState& memory, const PatternTables& patterns,
+           const ResolvedPalette& palette, const RenderJob& job,
+           unsigned int changes, unsigned int changesEnd, unsigned int line, IndexedFrame& frame)
+{
+    // Sprites are all fetched before the line starts, so only whether
+    // they show can change.
+    u8_byte sprites[PPU::width];
+    renderSprites(registers, memory, patterns, line, true, sprites);
+
+    unsigned int firstDot   = firstPixelDot(line) - 1;
+    unsigned int firstPixel = 0;
+    if (!m_dotsOnly) {
+        for (unsigned int i = changes; i < changesEnd; ++i) {
+            if (changesMidLine(job.m_events[i], line)) {
+                firstPixel = job.m_events[i].m_dot - firstDot;
+                break;
+            }
+        }
+    }
+
+    DotRenderer dots(registers, memory, sprites, palette.m_colors[0], palette.m_colors[1],
+                     firstPixel, frame.row(line));
+    // Emphasis is one value for the whole line: the mask's as the last pixel
+    // is drawn.
+    u8_byte mask = registers.m_mask;
+    for (unsigned int i = changes; i < changesEnd; ++i) {
+        // A change on dot d shows from the pixel drawn on the next.
+        const RenderEvent &event = job.m_events[i];
+        dots.run(std::min(event.m_dot - firstDot + 1, PPU::width + 1));
+        if (!applyRegister(dots.registers(), event)) {
+            applyMemory(event, job);
+        }
+        if (event.m_dot - firstDot < PPU::width) {
+            mask = dots.registers().m_mask;
+        }
+    }
+    dots.run(PPU::width + 1);
+    registers = dots.registers();
+    frame.m_emphasis[line] = mask >> IndexedFrame::EMPHASIS_SHIFT;
+}
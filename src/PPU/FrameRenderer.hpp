@@ -0,0 +1,140 @@
+#ifndef PPU_FRAME_RENDERER_H
+#define PPU_FRAME_RENDERER_H
+
+#include "BackgroundCache.hpp"
+#include "IndexedFrame.hpp"
+#include "RenderLog.hpp"
+#include "TileCache.hpp"
+#include "utility/ThreadPool.hpp"
+
+#include <vector>
+
+/*
+FrameRenderer
+
+Turns a RenderJob into pixels by replaying its log against a private copy of
+the render state. It never looks at the live PPU, so it can run on any thread
+while the PPU carries on with the next frame.
+
+Rendering is per scanline: changes logged before a line's first visible dot
+apply to that whole line. Where each line starts in the nametables follows
+v the way the PPU moves it (see Loopy.hpp): down a line and back to the
+left at dot 257, so t written during a line shows from the next.
+
+Lines with a register write or a CHR bank switch landing while they're
+drawn are redrawn from that pixel on dot by dot (see DotRenderer), which
+gets raster effects right; every other line takes the fast path, a tile
+row at a time. Other memory writes during a line apply from the next.
+
+With a thread pool, the visible lines are split into strips rendered in
+parallel. That needs each line's registers and mid-line changes up front,
+which one cheap pass over the log provides, and memory that stays put for
+the whole picture. Jobs that write VRAM, OAM or switch CHR banks mid-frame
+are rendered serially.
+Strips write disjoint rows, so the result doesn't depend on scheduling.
+
+Tiles come from a TileCache, kept up to date as the log writes CHR RAM or
+switches banks; strips only ever read it. Each line is drawn into background
+and sprite line buffers which are then composited (see SpriteLine). The
+background buffers are kept between frames, and only lines whose nametable
+bytes, tiles or registers changed are drawn again (see BackgroundCache).
+*/
+
+class FrameRenderer
+{
+public:
+    FrameRenderer();
+
+    // Spread the work over pool (not owned), or run serially if null.
+    void setThreadPool(ThreadPool* pool);
+
+    // Draws the job into frame.
+    void render(const RenderJob& job, IndexedFrame& frame);
+
+    // One scanline: the registers it starts with, and the events (indices
+    // into the job's log) that change them while it's drawn.
+    struct ScanlineState
+    {
+        RenderRegisters m_registers;
+        unsigned int    m_changes;
+        unsigned int    m_changesEnd;
+    };
+
+    // The decoded pattern tables at $0000 and $1000.
+    struct PatternTables
+    {
+        const TileCache::DecodedTable *m_tables[2];
+    };
+
+    // Palette RAM resolved to colour indices, as is and with grayscale, so
+    // a composited line buffer entry is one load away from its pixel. Kept
+    // up to date as palette writes are replayed.
+    struct ResolvedPalette
+    {
+        static const unsigned int ENTRIES = 32;
+
+        void resolve(const RenderState& memory);
+        void write(unsigned int entry, u8_byte value);
+
+        u8_byte m_colors[2][ENTRIES];
+    };
+
+    static const unsigned int STRIPS_PER_THREAD = 4;
+
+    // Every line dot by dot, for checking the two paths against each other.
+    void setDotsOnly(bool dotsOnly);
+    // Lines of the last frame that were (partly) drawn dot by dot.
+    unsigned int dotLines() const { return m_dotLines; }
+
+    const TileCache& tileCache() const { return m_tiles; }
+    const BackgroundCache::Statistics& backgroundStatistics() const { return m_background.statistics(); }
+
+private:
+    void renderSerial(const RenderJob& job, IndexedFrame& frame);
+    void renderStrips(const RenderJob& job, IndexedFrame& frame);
+    // Fills m_scanlines; false if memory changes while the picture is drawn.
+    bool captureScanlines(const RenderJob& job);
+
+    static RenderRegisters registers(const RenderState& state);
+    // False if the event isn't a register change.
+    static bool            applyRegister(RenderRegisters& registers, const RenderEvent& event);
+    // Dots 256 and 257: v down a line and back to the left edge.
+    static void            endLine(RenderRegisters& registers);
+    void                   applyMemory(const RenderEvent& event, const RenderJob& job);
+    void                   lookupPatterns(const RenderState& memory);
+    // Does the event change how line is drawn, part way through it?
+    bool                   changesMidLine(const RenderEvent& event, unsigned int line) const;
+
+    // Safe to call from several threads at once for different lines.
+    static void renderScanline(const RenderRegisters& registers, const RenderState& memory,
+                               const PatternTables& patterns, const ResolvedPalette& palette,
+                               BackgroundCache& background, unsigned int line, IndexedFrame& frame);
+    // Fill a line buffer of palette entries (see SpriteLine.hpp).
+    static void renderBackground(const RenderRegisters& registers, const RenderState& memory,
+                                 const PatternTables& patterns, u8_byte* pixels,
+                                 BackgroundCache::Footprint& footprint);
+    static void renderSprites(const RenderRegisters& registers, const RenderState& memory,
+                              const PatternTables& patterns, unsigned int line, bool showLeftmost,
+                              u8_byte* pixels);
+    // Draws line again dot by dot from the first of the changes on,
+    // replaying them, and leaves registers as the line does. The line's
+    // emphasis is the mask's as its last pixel is drawn. Only the
+    // serial path has memory changes here; otherwise it's as thread safe
+    // as renderScanline().
+    void renderDots(RenderRegisters& registers, const RenderState& memory, const PatternTables& patterns,
+                    const ResolvedPalette& palette, const RenderJob& job,
+                    unsigned int changes, unsigned int changesEnd, unsigned int line, IndexedFrame& frame);
+
+    // Memory for serial rendering, updated as the log is replayed.
+    RenderState                m_state;
+    TileCache                  m_tiles;
+    PatternTables              m_patterns;
+    ResolvedPalette            m_palette;
+    BackgroundCache            m_background;
+    std::vector<ScanlineState> m_scanlines;
+    ThreadPool                *m_pool;
+    bool                       m_dotsOnly;
+    unsigned int               m_dotLines;
+};
+
+#endif //PPU_FRAME_RENDERER_H
@@ -0,0 +1,118 @@
+#ifndef PPU_LOOPY_H
+#define PPU_LOOPY_H
+
+#include "utility/DataTypes.hpp"
+
+/*
+Loopy
+
+The PPU's scroll registers, as laid out in loopy's "The skinny on NES
+scrolling": the 15 bit VRAM address v, the temporary address t the CPU's
+$2000/$2005/$2006 writes build up, and the fine X scroll x.
+
+    yyy NN YYYYY XXXXX
+    ||| || ||||| +++++-- coarse X scroll
+    ||| || +++++-------- coarse Y scroll
+    ||| ++-------------- nametable select
+    +++----------------- fine Y scroll
+
+While rendering, v walks the nametables: coarse X goes up every tile and
+fine Y every line, each carrying into the nametable select. At dot 257 of
+every line the horizontal bits are copied back from t, and on the
+pre-render line all of them are.
+
+Shared by the PPU, which needs the scroll for sprite 0 hit, and the
+renderer, which replays it from the log.
+*/
+
+namespace Loopy
+{
+
+const u16_word COARSE_X_MASK   = 0x001F;
+const u16_word COARSE_Y_MASK   = 0x03E0;
+const u16_word NAMETABLE_MASK  = 0x0C00;
+const u16_word NAMETABLE_X     = 0x0400;
+const u16_word NAMETABLE_Y     = 0x0800;
+const u16_word FINE_Y_MASK     = 0x7000;
+const u16_word HORIZONTAL_MASK = NAMETABLE_X | COARSE_X_MASK;
+const u16_word ADDRESS_MASK    = 0x7FFF;
+
+// Dots within a line: fine Y goes up at the end of the visible part, then
+// the horizontal copy. The pre-render line's vertical copy is done by this.
+const unsigned int INCREMENT_Y_DOT     = 256;
+const unsigned int HORIZONTAL_COPY_DOT = 257;
+const unsigned int VERTICAL_COPY_DOT   = 304;
+
+inline unsigned int coarseX(u16_word v) { return v & COARSE_X_MASK; }
+inline unsigned int coarseY(u16_word v) { return (v & COARSE_Y_MASK) >> 5; }
+inline unsigned int nametable(u16_word v) { return (v & NAMETABLE_MASK) >> 10; }
+inline unsigned int fineY(u16_word v) { return (v & FINE_Y_MASK) >> 12; }
+
+// Where the tile under v is named, and the attribute byte colouring it.
+inline u16_word tileAddress(u16_word v) { return 0x2000 | (v & 0x0FFF); }
+inline u16_word attributeAddress(u16_word v) {
+    return 0x23C0 | (v & NAMETABLE_MASK) | ((v >> 4) & 0x38) | ((v >> 2) & 0x07);
+}
+// Each attribute byte covers 4x4 tiles, two bits per 2x2 quadrant.
+inline unsigned int attributeShift(u16_word v) { return ((v >> 4) & 0x04) | (v & 0x02); }
+
+// n tiles to the right, into the next nametable across every 32.
+inline u16_word addCoarseX(u16_word v, unsigned int n) {
+    unsigned int x = coarseX(v) + n;
+    u16_word flip = ((x >> 5) & 0x01) ? NAMETABLE_X : 0;
+    return ((v & ~COARSE_X_MASK) ^ flip) | (x & COARSE_X_MASK);
+}
+inline u16_word incrementX(u16_word v) { return addCoarseX(v, 1); }
+
+// Down a line. Coarse Y wraps at 30 into the nametable below, but at 32
+// (without switching) when a write has set it past the attributes' start.
+inline u16_word incrementY(u16_word v) {
+    if ((v & FINE_Y_MASK) != FINE_Y_MASK) {
+        return v + 0x1000;
+    }
+    v &= ~FINE_Y_MASK;
+    unsigned int y = coarseY(v);
+    if (y == 29) {
+        y = 0;
+        v ^= NAMETABLE_Y;
+    }
+    else if (y == 31) {
+        y = 0;
+    }
+    else {
+        ++y;
+    }
+    return (v & ~COARSE_Y_MASK) | (y << 5);
+}
+
+inline u16_word copyHorizontal(u16_word v, u16_word t) {
+    return (v & ~HORIZONTAL_MASK) | (t & HORIZONTAL_MASK);
+}
+
+// What the CPU's writes do to t (and x).
+inline u16_word writeControl(u16_word t, u8_byte data) {
+    return (t & ~NAMETABLE_MASK) | ((data & 0x03) << 10);
+}
+inline u16_word writeScrollX(u16_word t, u8_byte data) {
+    return (t & ~COARSE_X_MASK) | (data >> 3);
+}
+inline u8_byte  fineX(u8_byte scrollX) { return scrollX & 0x07; }
+inline u16_word writeScrollY(u16_word t, u8_byte data) {
+    return (t & ~(FINE_Y_MASK | COARSE_Y_MASK)) | ((data & 0x07) << 12) | ((data & 0xF8) << 2);
+}
+inline u16_word writeAddressHigh(u16_word t, u8_byte data) {
+    return (t & 0x00FF) | ((data & 0x3F) << 8);
+}
+inline u16_word writeAddressLow(u16_word t, u8_byte data) {
+    return (t & 0xFF00) | data;
+}
+
+// t for a scroll position and base nametable, as a game writing $2000 and
+// $2005 would leave it.
+inline u16_word scroll(unsigned int nametable, u8_byte scrollX, u8_byte scrollY) {
+    return writeScrollY(writeScrollX(writeControl(0, nametable), scrollX), scrollY);
+}
+
+}
+
+#endif //PPU_LOOPY_H
@@ -0,0 +1,347 @@
+#include "NtscFilter.hpp"
+
+#include "utility/KernelDispatch.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstring>
+
+const unsigned int NtscFilter::MIN_SCALE;
+const unsigned int NtscFilter::MAX_SCALE;
+const unsigned int NtscFilter::PHASES;
+
+static const unsigned int SAMPLES_PER_PIXEL = 8;
+static const unsigned int SAMPLES_PER_CYCLE = 12;
+static const unsigned int COLORS            = 64;
+static const unsigned int ENTRIES           = COLORS * 8;
+// Past the picture's edges nothing is sent: this entry adds nothing.
+static const unsigned int BLANK             = ENTRIES;
+// Output blocks a pixel reaches: the one before, its own and the one after.
+static const unsigned int BLOCKS            = 3;
+static const unsigned int BEFORE            = 0;
+static const unsigned int SELF              = 1;
+static const unsigned int AFTER             = 2;
+static const unsigned int CHANNELS          = 4;
+// Sums are in 1/16ths of an output level.
+static const unsigned int FIXED_SHIFT       = 4;
+
+// Voltages, low then high for each of the 4 levels, and what emphasis
+// leaves of them.
+static const float LEVELS[2][4]  = { { 0.228f, 0.312f, 0.552f, 0.880f },
+                                     { 0.616f, 0.840f, 1.100f, 1.100f } };
+static const float BLACK         = 0.312f;
+static const float WHITE         = 1.100f;
+static const float ATTENUATION   = 0.746f;
+// Where the decoder's I axis sits against the samples, in samples.
+static const float HUE           = 4.0f;
+static const float PI            = 3.14159265f;
+
+// The signal for a palette entry (emphasis in bits 6-8) at a subcarrier
+// phase, 0 at black and 1 at white.
+static float
+signal(unsigned int entry, unsigned int phase)
+{
+    unsigned int color    = entry & 0x0F;
+    unsigned int level    = (entry >> 4) & 0x03;
+    unsigned int emphasis = entry >> 6;
+    if (color > 13) {
+        level = 1;
+    }
+    float low  = LEVELS[0][level];
+    float high = LEVELS[1][level];
+    if (color == 0) {
+        low = high;
+    }
+    if (color > 12) {
+        high = low;
+    }
+
+    // Each colour is high for half the cycle, starting where its hue says.
+    auto inPhase = [phase](unsigned int hue) { return (hue + phase) % SAMPLES_PER_CYCLE < SAMPLES_PER_CYCLE / 2; };
+    float value = inPhase(color) ? high : low;
+    if (((emphasis & IndexedFrame::EMPHASIZE_RED)   && inPhase(0)) ||
+        ((emphasis & IndexedFrame::EMPHASIZE_GREEN) && inPhase(4)) ||
+        ((emphasis & IndexedFrame::EMPHASIZE_BLUE)  && inPhase(8))) {
+        value *= ATTENUATION;
+    }
+    return (value - BLACK) / (WHITE - BLACK);
+}
+
+// A block is an output pixel's 4 channels for each of scale pixels, padded
+// out to a whole number of vectors.
+static unsigned int
+blockTaps(unsigned int scale)
+{
+    return scale == 2 ? 2 : 4;
+}
+
+NtscFilter::
+NtscFilter(unsigned int scale, PixelConvert::Format format) :
+    m_scale (scale),
+    m_format (format),
+    m_pool (nullptr),
+    m_table ()
+{
+    assert(scale >= MIN_SCALE && scale <= MAX_SCALE && "NtscFilter: no such scale!");
+    assert((format == PixelConvert::RGBA8888 || format == PixelConvert::BGRA8888) &&
+           "NtscFilter: only 4 byte formats!");
+    buildTable();
+}
+
+void
+NtscFilter::
+setThreadPool(ThreadPool* pool)
+{
+    m_pool = pool;
+}
+
+void
+NtscFilter::
+buildTable()
+{
+    unsigned int block = blockTaps(m_scale) * CHANNELS;
+    m_table.assign((ENTRIES + 1) * PHASES * BLOCKS * block, 0);
+
+    // Where each channel goes in an output pixel.
+    unsigned int red = 0, blue = 2;
+    if (m_format == PixelConvert::BGRA8888) {
+        std::swap(red, blue);
+    }
+    const float scale = 255.0f * (1 << FIXED_SHIFT);
+
+    for (unsigned int entry = 0; entry < ENTRIES; ++entry) {
+        for (unsigned int phase = 0; phase < PHASES; ++phase) {
+            // A pixel starts on a third of a cycle: 8 samples is 2/3 of one.
+            unsigned int start = phase * SAMPLES_PER_CYCLE / PHASES;
+            std::int16_t *kernel = &m_table[(entry * PHASES + phase) * BLOCKS * block];
+
+            for (unsigned int b = 0; b < BLOCKS; ++b) {
+                for (unsigned int tap = 0; tap < m_scale; ++tap) {
+                    // The output pixel's centre in samples from this pixel's
+                    // start, and the 12 samples around it it's decoded from.
+                    float centre = ((int(b) - int(SELF)) * int(m_scale) + int(tap) + 0.5f) * SAMPLES_PER_PIXEL / m_scale;
+                    float y = 0.0f, i = 0.0f, q = 0.0f;
+                    for (unsigned int sample = 0; sample < SAMPLES_PER_PIXEL; ++sample) {
+                        float distance = sample + 0.5f - centre;
+                        if (distance < -float(SAMPLES_PER_CYCLE / 2) || distance >= float(SAMPLES_PER_CYCLE / 2)) {
+                            continue;
+                        }
+                        unsigned int at    = start + sample;
+                        float        level = signal(entry, at % SAMPLES_PER_CYCLE);
+                        float        angle = PI * (at + HUE) / (SAMPLES_PER_CYCLE / 2);
+                        y += level / SAMPLES_PER_CYCLE;
+                        i += level * std::cos(angle) / (SAMPLES_PER_CYCLE / 2);
+                        q += level * std::sin(angle) / (SAMPLES_PER_CYCLE / 2);
+                    }
+
+                    std::int16_t *out = kernel + b * block + tap * CHANNELS;
+                    out[red]  = std::lround(scale * (y + 0.946882f * i + 0.623557f * q));
+                    out[1]    = std::lround(scale * (y - 0.274788f * i - 0.635691f * q));
+                    out[blue] = std::lround(scale * (y - 1.108545f * i + 1.709007f * q));
+                    // Every output block gets its own pixel's SELF part once.
+                    out[3]    = b == SELF ? std::lround(scale) : 0;
+                }
+            }
+        }
+    }
+}
+
+// Fills one line's blocks of output. kernels[m] is pixel m - 1's, with
+// blanks either side of the picture.
+typedef void (*FilterFunction)(const std::int16_t* const* kernels, unsigned int scale, u8_byte* out);
+
+static void
+filterScalar(const std::int16_t* const* kernels, unsigned int scale, u8_byte* out)
+{
+    unsigned int block = blockTaps(scale) * CHANNELS;
+    for (unsigned int m = 0; m < IndexedFrame::WIDTH; ++m) {
+        const std::int16_t *before = kernels[m]     + AFTER  * block;
+        const std::int16_t *self   = kernels[m + 1] + SELF   * block;
+        const std::int16_t *after  = kernels[m + 2] + BEFORE * block;
+        for (unsigned int c = 0; c < scale * CHANNELS; ++c) {
+            int sum = (before[c] + self[c] + after[c] + (1 << (FIXED_SHIFT - 1))) >> FIXED_SHIFT;
+            *out++ = std::min(std::max(sum, 0), 255);
+        }
+    }
+}
+
+#ifdef KERNEL_DISPATCH_X86
+
+__attribute__((target("sse2")))
+static inline __m128i
+loadSSE2(const std::int16_t* p)
+{
+    return _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+}
+
+__attribute__((target("sse2")))
+static void
+filterSSE2(const std::int16_t* const* kernels, unsigned int scale, u8_byte* out)
+{
+    const __m128i round = _mm_set1_epi16(1 << (FIXED_SHIFT - 1));
+    unsigned int block = blockTaps(scale) * CHANNELS;
+    for (unsigned int m = 0; m < IndexedFrame::WIDTH; ++m) {
+        const std::int16_t *before = kernels[m]     + AFTER  * block;
+        const std::int16_t *self   = kernels[m + 1] + SELF   * block;
+        const std::int16_t *after  = kernels[m + 2] + BEFORE * block;
+        __m128i low = _mm_add_epi16(_mm_add_epi16(loadSSE2(before), loadSSE2(self)), loadSSE2(after));
+        low = _mm_srai_epi16(_mm_add_epi16(low, round), FIXED_SHIFT);
+        if (scale == 2) {
+            _mm_storel_epi64(reinterpret_cast<__m128i*>(out), _mm_packus_epi16(low, low));
+            out += 8;
+            continue;
+        }
+        __m128i high = _mm_add_epi16(_mm_add_epi16(loadSSE2(before + 8), loadSSE2(self + 8)), loadSSE2(after + 8));
+        high = _mm_srai_epi16(_mm_add_epi16(high, round), FIXED_SHIFT);
+        // 3 pixels of the 4 the block has room for.
+        __m128i pixels = _mm_packus_epi16(low, high);
+        _mm_storel_epi64(reinterpret_cast<__m128i*>(out), pixels);
+        std::uint32_t last = _mm_cvtsi128_si32(_mm_srli_si128(pixels, 8));
+        std::memcpy(out + 8, &last, sizeof(last));
+        out += 12;
+    }
+}
+
+__attribute__((target("avx2")))
+static inline __m256i
+loadAVX2(const std::int16_t* p)
+{
+    return _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+}
+
+// Two 8 word blocks, a lane each.
+__attribute__((target("avx2")))
+static inline __m256i
+loadPairAVX2(const std::int16_t* first, const std::int16_t* second)
+{
+    return _mm256_inserti128_si256(_mm256_castsi128_si256(_mm_loadu_si128(reinterpret_cast<const __m128i*>(first))),
+                                   _mm_loadu_si128(reinterpret_cast<const __m128i*>(second)), 1);
+}
+
+__attribute__((target("avx2")))
+static void
+filterAVX2(const std::int16_t* const* kernels, unsigned int scale, u8_byte* out)
+{
+    const __m256i round = _mm256_set1_epi16(1 << (FIXED_SHIFT - 1));
+    unsigned int block = blockTaps(scale) * CHANNELS;
+    if (scale == 2) {
+        for (unsigned int m = 0; m < IndexedFrame::WIDTH; m += 2, out += 16) {
+            __m256i sum = _mm256_add_epi16(
+                _mm256_add_epi16(loadPairAVX2(kernels[m] + AFTER * block, kernels[m + 1] + AFTER * block),
+                                 loadPairAVX2(kernels[m + 1] + SELF * block, kernels[m + 2] + SELF * block)),
+                loadPairAVX2(kernels[m + 2] + BEFORE * block, kernels[m + 3] + BEFORE * block));
+            sum = _mm256_srai_epi16(_mm256_add_epi16(sum, round), FIXED_SHIFT);
+            // Packing works per lane; the two blocks' bytes end up in
+            // quarters 0 and 2.
+            __m256i pixels = _mm256_permute4x64_epi64(_mm256_packus_epi16(sum, sum), 0x08);
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(out), _mm256_castsi256_si128(pixels));
+        }
+        return;
+    }
+    for (unsigned int m = 0; m < IndexedFrame::WIDTH; ++m, out += 12) {
+        __m256i sum = _mm256_add_epi16(_mm256_add_epi16(loadAVX2(kernels[m] + AFTER * block),
+                                                        loadAVX2(kernels[m + 1] + SELF * block)),
+                                       loadAVX2(kernels[m + 2] + BEFORE * block));
+        sum = _mm256_srai_epi16(_mm256_add_epi16(sum, round), FIXED_SHIFT);
+        __m256i pixels = _mm256_packus_epi16(sum, sum);
+        _mm_storel_epi64(reinterpret_cast<__m128i*>(out), _mm256_castsi256_si128(pixels));
+        std::uint32_t last = _mm256_extract_epi32(pixels, 4);
+        std::memcpy(out + 8, &last, sizeof(last));
+    }
+}
+
+#endif // KERNEL_DISPATCH_X86
+
+static const KernelDispatch::Entry<FilterFunction> KERNELS[NtscFilter::KERNEL_COUNT] = {
+    { "scalar", KernelDispatch::NONE, filterScalar },
+    { "sse2",   KernelDispatch::SSE2, KERNEL_DISPATCH_VECTOR(filterSSE2, filterScalar) },
+    { "avx2",   KernelDispatch::AVX2, KERNEL_DISPATCH_VECTOR(filterAVX2, filterScalar) }
+};
+
+static KernelDispatch::Dispatcher<NtscFilter::Kernel, FilterFunction, NtscFilter::KERNEL_COUNT>&
+dispatcher()
+{
+    static KernelDispatch::Dispatcher<NtscFilter::Kernel, FilterFunction, NtscFilter::KERNEL_COUNT>
+        kernels(KERNELS, { NtscFilter::AVX2, NtscFilter::SSE2 });
+    return kernels;
+}
+
+NtscFilter::Kernel
+NtscFilter::
+kernel()
+{
+    return dispatcher().current();
+}
+
+bool
+NtscFilter::
+setKernel(Kernel kernel)
+{
+    return dispatcher().select(kernel);
+}
+
+bool
+NtscFilter::
+supported(Kernel kernel)
+{
+    return dispatcher().supported(kernel);
+}
+
+const char*
+NtscFilter::
+kernelName(Kernel kernel)
+{
+    return dispatcher().name(kernel);
+}
+
+// Lines per task when split across threads.
+static const unsigned int STRIP_LINES = 16;
+
+void
+NtscFilter::
+filter(const IndexedFrame& frame, unsigned int burstPhase,
+       u8_byte* pixels, unsigned int pitch) const
+{
+    assert(pitch >= width() * CHANNELS && "NtscFilter::filter: rows overlap!");
+    if (!m_pool || m_pool->size() < 2) {
+        filterLines(frame, burstPhase, 0, IndexedFrame::HEIGHT, pixels, pitch);
+        return;
+    }
+    unsigned int strips = (IndexedFrame::HEIGHT + STRIP_LINES - 1) / STRIP_LINES;
+    m_pool->run(strips, [&](unsigned int strip) {
+        unsigned int first = strip * STRIP_LINES;
+        filterLines(frame, burstPhase, first, std::min(STRIP_LINES, IndexedFrame::HEIGHT - first), pixels, pitch);
+    });
+}
+
+void
+NtscFilter::
+filterLines(const IndexedFrame& frame, unsigned int burstPhase,
+            unsigned int first, unsigned int count,
+            u8_byte* pixels, unsigned int pitch) const
+{
+    unsigned int entryStride = PHASES * BLOCKS * blockTaps(m_scale) * CHANNELS;
+    unsigned int phaseStride = BLOCKS * blockTaps(m_scale) * CHANNELS;
+    const std::int16_t *table = &m_table[0];
+    FilterFunction filterLine = dispatcher().functions();
+
+    // Pixel m's kernel at m + 1. The AVX2 kernel at 2x reads one past the
+    // blank on the right.
+    const std::int16_t *kernels[IndexedFrame::WIDTH + 3];
+    kernels[0] = kernels[IndexedFrame::WIDTH + 1] = kernels[IndexedFrame::WIDTH + 2] = table + BLANK * entryStride;
+
+    for (unsigned int y = first; y < first + count; ++y) {
+        const u8_byte *row      = frame.row(y);
+        unsigned int   emphasis = (frame.m_emphasis[y] & 0x07) * COLORS;
+        // Each line starts a third of a cycle on from the one before (341
+        // dots of 8 samples), and each pixel two thirds on from the last.
+        unsigned int   phase    = (y + burstPhase) % PHASES;
+        for (unsigned int x = 0; x < IndexedFrame::WIDTH; ++x) {
+            unsigned int entry = emphasis + (row[x] & IndexedFrame::INDEX_MASK);
+            kernels[x + 1] = table + entry * entryStride + phase * phaseStride;
+            phase = (phase + 2) % PHASES;
+        }
+        filterLine(kernels, m_scale, pixels + y * pitch);
+    }
+}
@@ -0,0 +1,90 @@
+#ifndef PPU_NTSC_FILTER_H
+#define PPU_NTSC_FILTER_H
+
+#include "IndexedFrame.hpp"
+#include "PixelConvert.hpp"
+#include "utility/DataTypes.hpp"
+#include "utility/ThreadPool.hpp"
+
+#include <cstdint>
+#include <vector>
+
+/*
+NtscFilter
+
+An output stage like PixelConvert, but through the composite signal the NES
+actually puts out: each pixel is 8 samples of a square wave at the colour
+subcarrier's frequency (12 samples a cycle), its two levels set by the
+palette index and its phase by the hue, with emphasis attenuating parts of
+the cycle. The TV end decodes YIQ from 12 sample windows and turns that into
+RGB at 2 or 3 output pixels per NES pixel, with the colour fringing and
+blur that go with it. Signal levels and decoding follow the NESdev wiki's
+"NTSC video" page.
+
+Decoding is linear, so the whole path from a pixel to the RGB it adds to
+each output pixel near it is worked out once per palette entry (512, with
+emphasis) and per subcarrier phase the pixel can start on (3, as a pixel is
+8 samples). Filtering a line is then just adding up three neighbours'
+contributions for each pixel's block of outputs, in 16 bit fixed point, and
+clamping. As with PixelConvert several kernels do the adding and the
+fastest the CPU supports is used; all give the same result.
+*/
+
+class NtscFilter
+{
+public:
+    enum Kernel
+    {
+        SCALAR = 0,
+        SSE2,       // A block of output pixels per vector.
+        AVX2,       // Two blocks at 2x, one at 3x.
+        KERNEL_COUNT
+    };
+
+    static const unsigned int MIN_SCALE = 2;
+    static const unsigned int MAX_SCALE = 3;
+    // The subcarrier's phase moves on a third of a cycle every line and
+    // from one frame to the next.
+    static const unsigned int PHASES    = 3;
+
+    // Output scale times as wide as the NES picture, in format (RGBA8888
+    // or BGRA8888).
+    NtscFilter(unsigned int scale, PixelConvert::Format format);
+
+    unsigned int scale()  const { return m_scale; }
+    unsigned int width()  const { return IndexedFrame::WIDTH * m_scale; }
+    unsigned int height() const { return IndexedFrame::HEIGHT; }
+    PixelConvert::Format format() const { return m_format; }
+
+    // Lines are split into strips across pool's threads; null filters on
+    // the calling thread only.
+    void setThreadPool(ThreadPool* pool);
+
+    // Filters frame into width() x height() pixels, rows pitch bytes apart.
+    // burstPhase (0-2) is the phase the picture starts on: stepping it each
+    // frame gives the NES's crawling artifacts, keeping it still a steady
+    // picture.
+    void filter(const IndexedFrame& frame, unsigned int burstPhase,
+                u8_byte* pixels, unsigned int pitch) const;
+
+    static Kernel kernel();
+    static bool   setKernel(Kernel kernel);
+    static bool   supported(Kernel kernel);
+    static const char* kernelName(Kernel kernel);
+
+private:
+    void buildTable();
+    void filterLines(const IndexedFrame& frame, unsigned int burstPhase,
+                     unsigned int first, unsigned int count,
+                     u8_byte* pixels, unsigned int pitch) const;
+
+    unsigned int              m_scale;
+    PixelConvert::Format      m_format;
+    ThreadPool               *m_pool;
+    // Per palette entry (and a blank one past the picture's edges) and
+    // phase, what the pixel adds to the output blocks of the pixel before
+    // it, itself and the pixel after.
+    std::vector<std::int16_t> m_table;
+};
+
+#endif //PPU_NTSC_FILTER_H
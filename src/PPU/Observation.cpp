@@ -0,0 +1,442 @@
+#include "Observation.hpp"
+
+#include "PixelConvert.hpp"
+#include "utility/KernelDispatch.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <cstring>
+#include <memory>
+
+namespace Observation
+{
+
+static const unsigned int COLORS          = 64;
+static const unsigned int EMPHASIS_VALUES = 8;
+static const unsigned int MAX_CHANNELS    = 3;
+static const unsigned int LOOKUP_SPAN     = KernelDispatch::LOOKUP_SPAN;
+static const unsigned int LOOKUP_STEPS    = KernelDispatch::LOOKUP_STEPS;
+
+// Resampling weights are fixed point with this as 1. A full weight times a
+// full channel still fits the 16 bit row sums.
+static const unsigned int WEIGHT_ONE   = 256;
+static const unsigned int WEIGHT_SHIFT = 8;
+
+static const unsigned int WIDTHS[SIZE_COUNT]  = { 84, 128 };
+static const unsigned int HEIGHTS[SIZE_COUNT] = { 84, 120 };
+
+// One channel's value for each palette index under one emphasis, and the
+// same split into steps for KernelDispatch's PSHUFB lookups.
+struct ChannelTable
+{
+    u8_byte m_values[COLORS];
+    u8_byte m_steps[COLORS];
+};
+
+// Every channel under every emphasis, from PixelConvert's colours as they
+// are now, and the palette version they're from.
+struct Tables
+{
+    Tables(Color color) {
+        u8_byte colors[EMPHASIS_VALUES][COLORS][3];
+        m_version = PixelConvert::copyColors(colors[0][0]);
+        for (unsigned int emphasis = 0; emphasis < EMPHASIS_VALUES; ++emphasis) {
+            const u8_byte *rgb = colors[emphasis][0];
+            for (unsigned int index = 0; index < COLORS; ++index) {
+                const u8_byte *pixel = rgb + index * 3;
+                if (color == GRAYSCALE) {
+                    m_channels[emphasis][0].m_values[index] = (77 * pixel[0] + 150 * pixel[1] + 29 * pixel[2] + 128) >> 8;
+                }
+                else {
+                    for (unsigned int channel = 0; channel < MAX_CHANNELS; ++channel) {
+                        m_channels[emphasis][channel].m_values[index] = pixel[channel];
+                    }
+                }
+            }
+            for (unsigned int channel = 0; channel < MAX_CHANNELS; ++channel) {
+                ChannelTable &table = m_channels[emphasis][channel];
+                KernelDispatch::splitSteps(table.m_values, table.m_steps);
+            }
+        }
+    }
+
+    ChannelTable m_channels[EMPHASIS_VALUES][MAX_CHANNELS];
+    unsigned int m_version;
+};
+
+typedef std::shared_ptr<const Tables> TablesPointer;
+
+static TablesPointer&
+cachedTables(Color color)
+{
+    static TablesPointer cached[COLOR_COUNT];
+    return cached[color];
+}
+
+// color's tables, made again only after a palette change. Published like
+// PixelConvert's table, so observe() can run on several threads; two of them
+// seeing the same change both rebuild, and either result will do.
+static TablesPointer
+tables(Color color)
+{
+    TablesPointer current = std::atomic_load(&cachedTables(color));
+    if (!current || current->m_version != PixelConvert::paletteVersion()) {
+        current = std::make_shared<const Tables>(color);
+        std::atomic_store(&cachedTables(color), current);
+    }
+    return current;
+}
+
+// Area weights from a line of source pixels down to a shorter one: output
+// pixel o covers source [o * source / output, (o + 1) * source / output),
+// and each source pixel counts by how much of it is covered.
+struct Taps
+{
+    Taps(unsigned int source, unsigned int output) :
+        m_first (output),
+        m_weights (output)
+    {
+        for (unsigned int o = 0; o < output; ++o) {
+            // In 1/output source pixels.
+            unsigned int low  = o * source;
+            unsigned int high = (o + 1) * source;
+            m_first[o] = low / output;
+            unsigned int sum = 0, largest = 0;
+            for (unsigned int s = m_first[o]; s * output < high; ++s) {
+                unsigned int covered = std::min(high, (s + 1) * output) - std::max(low, s * output);
+                unsigned int weight  = (covered * WEIGHT_ONE + source / 2) / source;
+                m_weights[o].push_back(weight);
+                sum += weight;
+                if (weight > m_weights[o][largest]) {
+                    largest = m_weights[o].size() - 1;
+                }
+            }
+            // Rounding leaves the weights a little off 1 in all.
+            m_weights[o][largest] += WEIGHT_ONE - sum;
+        }
+    }
+
+    std::vector<unsigned int>              m_first;
+    std::vector<std::vector<unsigned int>> m_weights;
+};
+
+struct Resampler
+{
+    Resampler(Size size) :
+        m_rows (IndexedFrame::HEIGHT, HEIGHTS[size]),
+        m_columns (IndexedFrame::WIDTH, WIDTHS[size])
+    {
+    }
+
+    Taps m_rows;
+    Taps m_columns;
+};
+
+static const Resampler&
+resampler(Size size)
+{
+    static const Resampler resamplers[SIZE_COUNT] = { Resampler(SIZE_84X84), Resampler(SIZE_128X120) };
+    return resamplers[size];
+}
+
+// Adds weight times each of count pixels' channel values to sums, the
+// values being the max of indices' and previous's (if there is one) looked
+// up in table and previousTable.
+typedef void (*AccumulateFunction)(const u8_byte* indices, const u8_byte* previous,
+                                   const ChannelTable& table, const ChannelTable& previousTable,
+                                   unsigned int weight, unsigned int count, u16_word* sums);
+
+static void
+accumulateScalar(const u8_byte* indices, const u8_byte* previous,
+                 const ChannelTable& table, const ChannelTable& previousTable,
+                 unsigned int weight, unsigned int count, u16_word* sums)
+{
+    for (unsigned int x = 0; x < count; ++x) {
+        u8_byte value = table.m_values[indices[x] & IndexedFrame::INDEX_MASK];
+        if (previous) {
+            value = std::max(value, previousTable.m_values[previous[x] & IndexedFrame::INDEX_MASK]);
+        }
+        sums[x] += value * weight;
+    }
+}
+
+#ifdef KERNEL_DISPATCH_X86
+
+__attribute__((target("ssse3")))
+static void
+accumulateSSSE3(const u8_byte* indices, const u8_byte* previous,
+                const ChannelTable& table, const ChannelTable& previousTable,
+                unsigned int weight, unsigned int count, u16_word* sums)
+{
+    const __m128i indexMask = _mm_set1_epi8(IndexedFrame::INDEX_MASK);
+    const __m128i weights   = _mm_set1_epi16(weight);
+    const __m128i zero      = _mm_setzero_si128();
+
+    __m128i steps[LOOKUP_STEPS], previousSteps[LOOKUP_STEPS];
+    for (unsigned int step = 0; step < LOOKUP_STEPS; ++step) {
+        steps[step]         = _mm_loadu_si128(reinterpret_cast<const __m128i*>(table.m_steps + step * LOOKUP_SPAN));
+        previousSteps[step] = _mm_loadu_si128(reinterpret_cast<const __m128i*>(previousTable.m_steps + step * LOOKUP_SPAN));
+    }
+
+    unsigned int x = 0;
+    for (; x + LOOKUP_SPAN <= count; x += LOOKUP_SPAN) {
+        __m128i index  = _mm_and_si128(_mm_loadu_si128(reinterpret_cast<const __m128i*>(indices + x)), indexMask);
+        __m128i values = KernelDispatch::lookupSSSE3(steps, index);
+        if (previous) {
+            index  = _mm_and_si128(_mm_loadu_si128(reinterpret_cast<const __m128i*>(previous + x)), indexMask);
+            values = _mm_max_epu8(values, KernelDispatch::lookupSSSE3(previousSteps, index));
+        }
+        __m128i *vectors = reinterpret_cast<__m128i*>(sums + x);
+        __m128i low  = _mm_mullo_epi16(_mm_unpacklo_epi8(values, zero), weights);
+        __m128i high = _mm_mullo_epi16(_mm_unpackhi_epi8(values, zero), weights);
+        _mm_storeu_si128(vectors + 0, _mm_add_epi16(_mm_loadu_si128(vectors + 0), low));
+        _mm_storeu_si128(vectors + 1, _mm_add_epi16(_mm_loadu_si128(vectors + 1), high));
+    }
+    accumulateScalar(indices + x, previous ? previous + x : nullptr, table, previousTable,
+                     weight, count - x, sums + x);
+}
+
+__attribute__((target("avx2")))
+static void
+accumulateAVX2(const u8_byte* indices, const u8_byte* previous,
+               const ChannelTable& table, const ChannelTable& previousTable,
+               unsigned int weight, unsigned int count, u16_word* sums)
+{
+    const __m256i indexMask = _mm256_set1_epi8(IndexedFrame::INDEX_MASK);
+    const __m256i weights   = _mm256_set1_epi16(weight);
+
+    __m256i steps[LOOKUP_STEPS], previousSteps[LOOKUP_STEPS];
+    for (unsigned int step = 0; step < LOOKUP_STEPS; ++step) {
+        steps[step] = _mm256_broadcastsi128_si256(
+            _mm_loadu_si128(reinterpret_cast<const __m128i*>(table.m_steps + step * LOOKUP_SPAN)));
+        previousSteps[step] = _mm256_broadcastsi128_si256(
+            _mm_loadu_si128(reinterpret_cast<const __m128i*>(previousTable.m_steps + step * LOOKUP_SPAN)));
+    }
+
+    unsigned int x = 0;
+    for (; x + 2 * LOOKUP_SPAN <= count; x += 2 * LOOKUP_SPAN) {
+        __m256i index  = _mm256_and_si256(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(indices + x)), indexMask);
+        __m256i values = KernelDispatch::lookupAVX2(steps, index);
+        if (previous) {
+            index  = _mm256_and_si256(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(previous + x)), indexMask);
+            values = _mm256_max_epu8(values, KernelDispatch::lookupAVX2(previousSteps, index));
+        }
+        // Widened a lane at a time to keep the pixels in order.
+        __m256i *vectors = reinterpret_cast<__m256i*>(sums + x);
+        __m256i low  = _mm256_mullo_epi16(_mm256_cvtepu8_epi16(_mm256_castsi256_si128(values)), weights);
+        __m256i high = _mm256_mullo_epi16(_mm256_cvtepu8_epi16(_mm256_extracti128_si256(values, 1)), weights);
+        _mm256_storeu_si256(vectors + 0, _mm256_add_epi16(_mm256_loadu_si256(vectors + 0), low));
+        _mm256_storeu_si256(vectors + 1, _mm256_add_epi16(_mm256_loadu_si256(vectors + 1), high));
+    }
+    accumulateScalar(indices + x, previous ? previous + x : nullptr, table, previousTable,
+                     weight, count - x, sums + x);
+}
+
+#endif // KERNEL_DISPATCH_X86
+
+static const KernelDispatch::Entry<AccumulateFunction> KERNELS[KERNEL_COUNT] = {
+    { "scalar", KernelDispatch::NONE,  accumulateScalar },
+    { "ssse3",  KernelDispatch::SSSE3, KERNEL_DISPATCH_VECTOR(accumulateSSSE3, accumulateScalar) },
+    { "avx2",   KernelDispatch::AVX2,  KERNEL_DISPATCH_VECTOR(accumulateAVX2, accumulateScalar) }
+};
+
+static KernelDispatch::Dispatcher<Kernel, AccumulateFunction, KERNEL_COUNT>&
+dispatcher()
+{
+    static KernelDispatch::Dispatcher<Kernel, AccumulateFunction, KERNEL_COUNT> kernels(KERNELS, { AVX2, SSSE3 });
+    return kernels;
+}
+
+unsigned int
+width(Size size)
+{
+    assert(size < SIZE_COUNT && "Observation::width: no such size!");
+    return WIDTHS[size];
+}
+
+unsigned int
+height(Size size)
+{
+    assert(size < SIZE_COUNT && "Observation::height: no such size!");
+    return HEIGHTS[size];
+}
+
+unsigned int
+channels(Color color)
+{
+    assert(color < COLOR_COUNT && "Observation::channels: no such colour!");
+    return color == RGB ? 3 : 1;
+}
+
+unsigned int
+bytes(Size size, Color color)
+{
+    return width(size) * height(size) * channels(color);
+}
+
+void
+observe(const IndexedFrame& frame, const IndexedFrame* previous,
+        Size size, Color color, u8_byte* out)
+{
+    assert(size < SIZE_COUNT && "Observation::observe: no such size!");
+    assert(color < COLOR_COUNT && "Observation::observe: no such colour!");
+
+    TablesPointer      current    = tables(color);
+    const Resampler   &resample   = resampler(size);
+    AccumulateFunction accumulate = dispatcher().functions();
+    unsigned int       count      = channels(color);
+
+    // One output row's worth of source rows, summed a channel at a time.
+    u16_word sums[MAX_CHANNELS][IndexedFrame::WIDTH];
+    for (unsigned int y = 0; y < HEIGHTS[size]; ++y) {
+        std::memset(sums, 0, sizeof(sums));
+        const std::vector<unsigned int> &rowWeights = resample.m_rows.m_weights[y];
+        for (unsigned int tap = 0; tap < rowWeights.size(); ++tap) {
+            unsigned int source = resample.m_rows.m_first[y] + tap;
+            const ChannelTable *table = current->m_channels[frame.m_emphasis[source] % EMPHASIS_VALUES];
+            const ChannelTable *previousTable = table;
+            const u8_byte      *previousRow   = nullptr;
+            if (previous) {
+                previousTable = current->m_channels[previous->m_emphasis[source] % EMPHASIS_VALUES];
+                previousRow   = previous->row(source);
+            }
+            for (unsigned int channel = 0; channel < count; ++channel) {
+                accumulate(frame.row(source), previousRow, table[channel], previousTable[channel],
+                           rowWeights[tap], IndexedFrame::WIDTH, sums[channel]);
+            }
+        }
+
+        // Then across, rounding the two weights' worth of fraction off.
+        for (unsigned int x = 0; x < WIDTHS[size]; ++x) {
+            const std::vector<unsigned int> &columnWeights = resample.m_columns.m_weights[x];
+            unsigned int first = resample.m_columns.m_first[x];
+            for (unsigned int channel = 0; channel < count; ++channel) {
+                unsigned int total = 0;
+                for (unsigned int tap = 0; tap < columnWeights.size(); ++tap) {
+                    total += columnWeights[tap] * sums[channel][first + tap];
+                }
+                *out++ = (total + (1 << (2 * WEIGHT_SHIFT - 1))) >> (2 * WEIGHT_SHIFT);
+            }
+        }
+    }
+}
+
+Kernel
+kernel()
+{
+    return dispatcher().current();
+}
+
+bool
+setKernel(Kernel kernel)
+{
+    return dispatcher().select(kernel);
+}
+
+bool
+supported(Kernel kernel)
+{
+    return dispatcher().supported(kernel);
+}
+
+const char*
+kernelName(Kernel kernel)
+{
+    return dispatcher().name(kernel);
+}
+
+const char*
+sizeName(Size size)
+{
+    assert(size < SIZE_COUNT && "Observation::sizeName: no such size!");
+    static const char* const names[SIZE_COUNT] = { "84x84", "128x120" };
+    return names[size];
+}
+
+}
+
+ObservationStack::
+ObservationStack(Observation::Size size, Observation::Color color,
+                 unsigned int depth, bool maxPool) :
+    m_size (size),
+    m_color (color),
+    m_depth (depth),
+    m_maxPool (maxPool),
+    m_ring (depth * Observation::bytes(size, color), 0),
+    m_newest (0),
+    m_pushed (0)
+{
+    assert(depth > 0 && "ObservationStack: needs room for an observation!");
+}
+
+unsigned int
+ObservationStack::
+observationBytes() const
+{
+    return Observation::bytes(m_size, m_color);
+}
+
+unsigned int
+ObservationStack::
+stackBytes() const
+{
+    return m_ring.size();
+}
+
+void
+ObservationStack::
+push(const IndexedFrame& frame)
+{
+    unsigned int bytes = observationBytes();
+    if (m_pushed > 0) {
+        m_newest = (m_newest + 1) % m_depth;
+    }
+    u8_byte *slot = &m_ring[m_newest * bytes];
+    Observation::observe(frame, m_maxPool && m_pushed > 0 ? &m_previous : nullptr, m_size, m_color, slot);
+
+    if (m_pushed == 0) {
+        for (unsigned int i = 1; i < m_depth; ++i) {
+            std::copy(slot, slot + bytes, &m_ring[i * bytes]);
+        }
+    }
+    if (m_maxPool) {
+        m_previous = frame;
+    }
+    ++m_pushed;
+}
+
+std::function<void(const IndexedFrame&)>
+ObservationStack::
+sink()
+{
+    return [this](const IndexedFrame& frame) { push(frame); };
+}
+
+void
+ObservationStack::
+clear()
+{
+    std::fill(m_ring.begin(), m_ring.end(), 0);
+    m_newest = 0;
+    m_pushed = 0;
+}
+
+const u8_byte*
+ObservationStack::
+observation(unsigned int age) const
+{
+    assert(age < m_depth && "ObservationStack::observation: older than the stack!");
+    return &m_ring[((m_newest + m_depth - age) % m_depth) * observationBytes()];
+}
+
+void
+ObservationStack::
+copy(u8_byte* out) const
+{
+    unsigned int bytes = observationBytes();
+    for (unsigned int age = m_depth; age-- > 0; out += bytes) {
+        const u8_byte *observed = observation(age);
+        std::copy(observed, observed + bytes, out);
+    }
+}
@@ -0,0 +1,122 @@
+#ifndef PPU_OBSERVATION_H
+#define PPU_OBSERVATION_H
+
+#include "IndexedFrame.hpp"
+#include "utility/DataTypes.hpp"
+
+#include <functional>
+#include <vector>
+
+/*
+Observation
+
+A small picture for an agent to look at, made straight from an IndexedFrame:
+84x84 or 128x120, grayscale or RGB, optionally the brighter of each pixel in
+this frame and the one before (games flicker sprites on alternate frames),
+and ObservationStack keeps the last few together.
+
+Nothing full size in colour is ever made. Each output row is the area
+weighted sum of the source rows under it, each source row looked up from its
+palette indices one channel at a time (taking the max against the previous
+frame's row as it goes); the sums are then weighted across into the output
+pixels. Colours and emphasis are PixelConvert's, and gray is their ITU-R 601
+luma; the lookup tables made from them are kept until the palette changes.
+
+As with PixelConvert, the row lookups have several kernels and the fastest
+the CPU supports is picked the first time. All do the same integer sums, so
+their output is identical.
+*/
+
+namespace Observation
+{
+
+enum Size
+{
+    SIZE_84X84 = 0,     // Squashed, as the Atari agents see it.
+    SIZE_128X120,       // Half size in each direction.
+    SIZE_COUNT
+};
+
+enum Color
+{
+    GRAYSCALE = 0,      // One byte a pixel.
+    RGB,                // Three, red first.
+    COLOR_COUNT
+};
+
+enum Kernel
+{
+    SCALAR = 0,
+    SSSE3,              // PSHUFB lookups and 16 bit sums, 16 pixels a pass.
+    AVX2,               // The same, 32 at a time.
+    KERNEL_COUNT
+};
+
+unsigned int width(Size size);
+unsigned int height(Size size);
+unsigned int channels(Color color);
+// Of one observation: rows of width * channels bytes, top first.
+unsigned int bytes(Size size, Color color);
+
+// Writes frame's observation to out. With previous, each pixel is the max
+// of the two frames' before scaling (per channel, for RGB).
+void observe(const IndexedFrame& frame, const IndexedFrame* previous,
+             Size size, Color color, u8_byte* out);
+
+Kernel kernel();
+bool   setKernel(Kernel kernel);
+bool   supported(Kernel kernel);
+const char* kernelName(Kernel kernel);
+const char* sizeName(Size size);
+
+}
+
+/*
+ObservationStack
+
+The last depth observations in a ring. push() writes the newest over the
+oldest; copy() lays them out for the caller oldest first, the usual frame
+stack. Until depth frames have been pushed the first one fills the gaps.
+*/
+
+class ObservationStack
+{
+public:
+    ObservationStack(Observation::Size size, Observation::Color color,
+                     unsigned int depth, bool maxPool);
+
+    Observation::Size  size()  const { return m_size; }
+    Observation::Color color() const { return m_color; }
+    unsigned int depth() const { return m_depth; }
+    bool         maxPool() const { return m_maxPool; }
+
+    // Bytes in one observation, and in the whole stack.
+    unsigned int observationBytes() const;
+    unsigned int stackBytes() const;
+
+    // Adds frame, pooled with the frame pushed before it if maxPool.
+    void push(const IndexedFrame& frame);
+    // push() as a frame handler, for PPU::setFrameHandler. The stack must
+    // outlive the handler's use.
+    std::function<void(const IndexedFrame&)> sink();
+    // Forgets everything pushed, as at the start of an episode.
+    void clear();
+    unsigned int pushed() const { return m_pushed; }
+
+    // The observation age pushes ago (0 is the newest), in the ring.
+    const u8_byte* observation(unsigned int age) const;
+    // stackBytes() bytes to out, oldest observation first.
+    void copy(u8_byte* out) const;
+
+private:
+    Observation::Size    m_size;
+    Observation::Color   m_color;
+    unsigned int         m_depth;
+    bool                 m_maxPool;
+    std::vector<u8_byte> m_ring;
+    unsigned int         m_newest;
+    unsigned int         m_pushed;
+    IndexedFrame         m_previous;
+};
+
+#endif //PPU_OBSERVATION_H
@@ -1,13 +1,17 @@
 #include "PPU.hpp"
+#include "TileDecode.hpp"
 
 #include <algorithm>
 
 const unsigned int PPU::width       = 256;
 const unsigned int PPU::height      = 240;
 const unsigned int PPU::ticksPerScanline = 341;
-const unsigned int PPU::memorySize    = 16 * 1024;
+const unsigned int PPU::scanlinesPerFrame  = 262;
+const unsigned int PPU::dotsPerFrame       = ticksPerScanline * scanlinesPerFrame;
+const unsigned int PPU::postRenderScanline = 240;
+const unsigned int PPU::vblankScanline     = 241;
+const unsigned int PPU::preRenderScanline  = 261;
 const unsigned int PPU::spriteRamSize   = 256;
-const unsigned int PPU::bitmapSize    = width * height * 3;
 const unsigned int PPU::spriteSize    = 4;
 const unsigned int PPU::tileSize     = 16;
 const unsigned int PPU::clockDivisor   = 4;
@@ -28,74 +32,325 @@ const u16_word PPU::SCROLL_ADDRESS            = 0x2005;
 const u16_word PPU::SCROLL_ADDRESS_ADDRESS    = 0x2006;
 const u16_word PPU::SCROLL_DATA_ADDRESS       = 0x2007;
 
+// Timing derived from: http://wiki.nesdev.com/w/index.php/PPU_rendering
+const unsigned int PPU::RENDER_END_DOT      = postRenderScanline * ticksPerScanline;
+const unsigned int PPU::VBLANK_SET_DOT      = vblankScanline    * ticksPerScanline + 1;
+const unsigned int PPU::VBLANK_CLEAR_DOT    = preRenderScanline * ticksPerScanline + 1;
+const unsigned int PPU::ODD_FRAME_SKIP_DOT  = preRenderScanline * ticksPerScanline + 339;
+
 PPU::
-PPU(Memory *cpuMemory, 
-    Clock &clock) :
+PPU(Clock &clock) :
     PoweredDevice(this),
     ClockedDevice(clockDivisor),
-    m_isFirstWrite(true),
     m_NMI(false),
+    m_nmiHandler(),
+    m_frameHandler(),
     m_clock(clock),
-    // Register information derived from: 
-    // http://wiki.nesdev.com/w/index.php/PPU_power_up_state
-    m_control       (),
-    m_mask          (), 
-    m_status        (m_isFirstWrite),
-    m_oamAddress    (),
-    m_spriteRAM     (new BackedMemory(spriteStartAddress, spriteEndAddress)),
-    m_oamData       (m_spriteRAM, m_oamAddress),
-    m_oamDMA        (),
-    m_scroll        (m_isFirstWrite),
-    m_address       (m_isFirstWrite, m_control),
-    m_data          (m_address, cpuMemory),
-    m_bitmap        (new float[bitmapSize]),
-    m_memory        (new BackedMemory(ppuStartAddress, ppuEndAddress)),
-    m_registerBlock (*this)
-{
-
-    std::fill(m_bitmap, m_bitmap + bitmapSize, 0.0);
-
-    for (Register* reg : 
-            { (Register*)&m_control, 
-              (Register*)&m_mask,
-              (Register*)&m_status,
-              (Register*)&m_oamAddress,
-              (Register*)&m_oamData,
-              (Register*)&m_scroll,
-              (Register*)&m_address,
-              (Register*)&m_data }) {
-        m_registers.push_back(reg);
-    }
+    m_ports         (),
+    m_registerBlock (*this),
+    m_video         (),
+    m_spriteRAM     (),
+    m_renderPipeline (),
+    m_outputEnabled (true),
+    m_recording     (false),
+    m_currentScanline (0),
+    m_currentCycle  (0),
+    m_frameDot      (0),
+    m_frameLength   (dotsPerFrame),
+    m_frameCount    (0),
+    m_oddFrame      (false),
+    m_phase         (VisiblePhase),
+    m_pendingDots   (0),
+    m_syncDeadline  (VBLANK_SET_DOT),
+    m_nextLine      (0),
+    m_lineChecked   (false)
+{
+    m_ports.powerOn();
 }
 
 PPU::
 ~PPU()
 {
-    delete m_spriteRAM;
-    delete m_memory;
-    delete[] m_bitmap;
 }
 
 void
 PPU::
-setCartridgeMemory(Memory * ppuMemory)
+mapCartridge(u8_byte* const patterns[VideoMemory::PATTERN_PAGES], bool writable,
+             VideoMemory::Mirroring mirroring)
 {
-    m_memory = ppuMemory;
+    sync();
+    bool recording = m_recording && m_frameDot < RENDER_END_DOT;
+
+    // The nametables as the renderer has them, in case the mirroring moves them.
+    const unsigned int NAMETABLES_SIZE = VideoMemory::NAMETABLES * VideoMemory::PAGE_SIZE;
+    u8_byte nametables[NAMETABLES_SIZE];
+    bool    remirror = recording && mirroring != m_video.mirroring();
+    if (remirror) {
+        for (unsigned int offset = 0; offset < NAMETABLES_SIZE; ++offset) {
+            nametables[offset] = m_video.read(VideoMemory::NAMETABLE_ADDRESS + offset);
+        }
+    }
+
+    bool switched = false;
+    for (unsigned int page = 0; page < VideoMemory::PATTERN_PAGES; ++page) {
+        const u8_byte *before = m_video.patternPage(page);
+        m_video.mapPatterns(page, patterns[page], writable);
+        switched = switched || m_video.patternPage(page) != before;
+    }
+    m_video.setMirroring(mirroring);
+
+    if (!recording) {
+        return;
+    }
+    if (switched) {
+        // The renderer gets its own copy of the newly mapped pattern tables.
+        RenderJob &job = m_renderPipeline.job();
+        u16_word snapshot = job.m_patterns.size() / RenderState::PATTERN_TABLES_SIZE;
+        for (unsigned int page = 0; page < VideoMemory::PATTERN_PAGES; ++page) {
+            const u8_byte *data = m_video.patternPage(page);
+            job.m_patterns.insert(job.m_patterns.end(), data, data + VideoMemory::PAGE_SIZE);
+        }
+        recordEvent(RenderEvent::PatternSwitch, snapshot, 0x00);
+    }
+    if (remirror) {
+        // Only the bytes that now show something else.
+        for (unsigned int offset = 0; offset < NAMETABLES_SIZE; ++offset) {
+            u16_word address = VideoMemory::NAMETABLE_ADDRESS + offset;
+            u8_byte  value   = m_video.read(address);
+            if (value != nametables[offset]) {
+                recordEvent(RenderEvent::VideoWrite, address, value);
+            }
+        }
+    }
+}
+
+void
+PPU::
+oamDMA(u8_byte page, const u8_byte* data)
+{
+    sync();
+    m_ports.m_oamDMA = page;
+
+    // In two pieces if OAMADDR isn't 0, which it stays at afterwards.
+    unsigned int start = m_ports.m_oamAddress;
+    std::copy(data, data + spriteRamSize - start, m_spriteRAM + start);
+    std::copy(data + spriteRamSize - start, data + spriteRamSize, m_spriteRAM);
+
+    for (unsigned int i = 0; i < spriteRamSize; ++i) {
+        recordEvent(RenderEvent::OAMWrite, (start + i) % spriteRamSize, data[i]);
+    }
+}
+
+void
+PPU::
+writeVideo(u16_word address, u8_byte data)
+{
+    if (!m_video.write(address, data)) {
+        return;
+    }
+    // The renderer's copy is flat, so the write goes everywhere it shows.
+    u16_word     aliases[VideoMemory::MAX_ALIASES];
+    unsigned int count = m_video.aliases(address, aliases);
+    for (unsigned int i = 0; i < count; ++i) {
+        recordEvent(RenderEvent::VideoWrite, aliases[i], data);
+    }
 }
 
 void
 PPU::
 tick()
 {
-    // Y-coordinate basically.
-    m_currentScanline = (m_clock.count() / ticksPerScanline) - 1;
+    // Nothing anyone can observe happens before the deadline, so just count.
+    if (++m_pendingDots >= m_syncDeadline) {
+        sync();
+    }
+}
+
+void
+PPU::
+sync()
+{
+    unsigned int dots = m_pendingDots;
+    m_pendingDots = 0;
+    advance(dots);
+    updateScanlines();
+    m_syncDeadline = dotsUntilNextEvent();
+}
+
+void
+PPU::
+advance(unsigned int dots)
+{
+    while (dots > 0) {
+        // Nothing happens until the next event, so jump straight there.
+        unsigned int step = std::min(dots, dotsUntilNextEvent());
+        moveForward(step);
+        dots -= step;
+    }
+}
+
+bool
+PPU::
+renderingEnabled()
+{
+    return m_ports.showBackground() || m_ports.showSprites();
+}
+
+unsigned int
+PPU::
+dotsUntilNextEvent() const
+{
+    if (m_frameDot < RENDER_END_DOT) {
+        return RENDER_END_DOT - m_frameDot;
+    }
+    if (m_frameDot < VBLANK_SET_DOT) {
+        return VBLANK_SET_DOT - m_frameDot;
+    }
+    if (m_frameDot < VBLANK_CLEAR_DOT) {
+        return VBLANK_CLEAR_DOT - m_frameDot;
+    }
+    if (m_frameDot < ODD_FRAME_SKIP_DOT) {
+        return ODD_FRAME_SKIP_DOT - m_frameDot;
+    }
+    return m_frameLength - m_frameDot;
+}
+
+void
+PPU::
+moveForward(unsigned int dots)
+{
+    m_frameDot     += dots;
+    m_currentCycle += dots;
+    if (m_currentCycle >= ticksPerScanline) {
+        m_currentScanline += m_currentCycle / ticksPerScanline;
+        m_currentCycle     = m_currentCycle % ticksPerScanline;
+        updatePhase();
+    }
+
+    // Callers never step past an event, so exact comparisons are enough.
+    if (m_frameDot == RENDER_END_DOT   ||
+        m_frameDot == VBLANK_SET_DOT   ||
+        m_frameDot == VBLANK_CLEAR_DOT ||
+        m_frameDot == ODD_FRAME_SKIP_DOT ||
+        m_frameDot == m_frameLength) {
+        handleEvent();
+    }
+}
+
+void
+PPU::
+handleEvent()
+{
+    if (m_frameDot == RENDER_END_DOT) {
+        updateScanlines();
+        // The last visible line is done, the frame's log is complete.
+        if (m_recording) {
+            if (m_renderPipeline.submit() && m_frameHandler) {
+                m_frameHandler(m_renderPipeline.displayBuffer());
+            }
+            m_recording = false;
+        }
+    }
+    else if (m_frameDot == VBLANK_SET_DOT) {
+        m_ports.setStatus(Ports::VERTICAL_BLANK_MASK, true);
+        ++m_frameCount;
+        if (m_ports.generateNMI()) {
+            signalNMI();
+        }
+    }
+    else if (m_frameDot == VBLANK_CLEAR_DOT) {
+        m_ports.setStatus(Ports::VERTICAL_BLANK_MASK | Ports::SPRITE_0_HIT_MASK |
+                          Ports::SPRITE_OVERFLOW_MASK, false);
+    }
+    else if (m_frameDot == ODD_FRAME_SKIP_DOT) {
+        // With rendering on, odd frames skip the last dot of the pre-render line.
+        if (m_oddFrame && renderingEnabled()) {
+            m_frameLength = dotsPerFrame - 1;
+        }
+    }
+    else if (m_frameDot == m_frameLength) {
+        // The pre-render line's scroll copy, if nothing has synced since.
+        updateScanlines();
+        m_frameDot        = 0;
+        m_currentScanline = 0;
+        m_currentCycle    = 0;
+        m_frameLength     = dotsPerFrame;
+        m_oddFrame        = !m_oddFrame;
+        m_nextLine        = 0;
+        m_lineChecked     = false;
+        updatePhase();
+        beginRenderJob();
+    }
+}
 
-    // Don't draw -1 scanline...
-    // FIXME: Line below is incorrect.
-    // if (m_currentScanline < 0) { return; }
+void
+PPU::
+updatePhase()
+{
+    if (m_currentScanline < postRenderScanline) {
+        m_phase = VisiblePhase;
+    }
+    else if (m_currentScanline < vblankScanline) {
+        m_phase = PostRenderPhase;
+    }
+    else if (m_currentScanline < preRenderScanline) {
+        m_phase = VerticalBlankPhase;
+    }
+    else {
+        m_phase = PreRenderPhase;
+    }
+}
 
-    // X-coordinate basically.
-    m_currentCycle    =  m_clock.count() % ticksPerScanline;
+PPU::Phase
+PPU::
+phase() const
+{
+    return m_phase;
+}
+
+unsigned int
+PPU::
+scanline() const
+{
+    return m_currentScanline;
+}
+
+unsigned int
+PPU::
+dot() const
+{
+    return m_currentCycle;
+}
+
+unsigned int
+PPU::
+frameCount() const
+{
+    return m_frameCount;
+}
+
+void
+PPU::
+signalNMI()
+{
+    m_NMI = true;
+    if (m_nmiHandler) {
+        m_nmiHandler();
+    }
+}
+
+void
+PPU::
+setNMIHandler(std::function<void()> handler)
+{
+    m_nmiHandler = handler;
+}
+
+void
+PPU::
+setFrameHandler(std::function<void(const IndexedFrame&)> handler)
+{
+    m_frameHandler = handler;
 }
 
 PPU::RegisterBlock&
@@ -105,81 +360,237 @@ registerBlock()
     return m_registerBlock;
 }
 
-const PPU::RegisterBlock&
+void
 PPU::
-registerBlock() const
+beginRenderJob()
 {
-    return m_registerBlock;
+    // Frames nobody will see aren't worth logging.
+    m_recording = m_outputEnabled;
+    if (!m_recording) {
+        return;
+    }
+
+    RenderJob &job = m_renderPipeline.job();
+    job.clear();
+    job.m_frameNumber = m_frameCount;
+
+    RenderState &state = job.m_start;
+    state.m_control     = m_ports.m_control;
+    state.m_mask        = m_ports.m_mask;
+    state.m_vramAddress = m_ports.m_vramAddress;
+    state.m_tempAddress = m_ports.m_tempAddress;
+    state.m_fineX       = m_ports.m_fineX;
+    m_video.copyTo(state.m_vram);
+    std::copy(m_spriteRAM, m_spriteRAM + RenderState::OAM_SIZE, state.m_oam);
 }
 
-#if 0
-PPU::Memory::
-Memory() 
+void
+PPU::
+recordEvent(RenderEvent::Type type, u16_word address, u8_byte value)
 {
-    std::fill(m_memory, m_memory + memorySize, 0x00);
+    // Changes after the last visible line are picked up by the next
+    // frame's starting state instead.
+    if (!m_recording || m_frameDot >= RENDER_END_DOT) {
+        return;
+    }
+
+    RenderEvent event;
+    event.m_dot     = m_frameDot;
+    event.m_type    = type;
+    event.m_value   = value;
+    event.m_address = address;
+    m_renderPipeline.job().m_events.push_back(event);
 }
-    
-PPU::Memory::
-Memory(u8_byte * toLoad, unsigned int size)
+
+void
+PPU::
+updateScanlines()
 {
-    std::copy(toLoad, toLoad + size, m_memory);
+    // Lines are caught up lazily, with the registers and memory as they are
+    // now. Anything that could change those syncs first, so they're still
+    // what the line saw.
+    for (; m_nextLine < height; ++m_nextLine, m_lineChecked = false) {
+        unsigned int start = m_nextLine * ticksPerScanline;
+        if (!m_lineChecked) {
+            if (m_frameDot <= start || !updateSpriteStatus(m_nextLine)) {
+                return;
+            }
+            m_lineChecked = true;
+        }
+        if (m_frameDot < start + Loopy::HORIZONTAL_COPY_DOT) {
+            return;
+        }
+        stepScroll();
+    }
+
+    // The pre-render line leaves v pointing at the top of the picture.
+    const unsigned int PRE_RENDER_COPY_DOT = preRenderScanline * ticksPerScanline + Loopy::VERTICAL_COPY_DOT;
+    if (m_nextLine == height && m_frameDot >= PRE_RENDER_COPY_DOT) {
+        if (renderingEnabled()) {
+            m_ports.m_vramAddress = m_ports.m_tempAddress;
+        }
+        ++m_nextLine;
+    }
 }
 
-// FIXME: This function, or whatever replaces it must route 
-// reads and writes through register classes. This will likely
-// require a change in interface.
-u8_byte& 
-PPU::Memory::
-byteAt(const u16_word& address)
+bool
+PPU::
+updateSpriteStatus(unsigned int line)
 {
-    u16_word trueAddress = address & 0x3FFF;
+    const u8_byte BOTH = Ports::SPRITE_0_HIT_MASK | Ports::SPRITE_OVERFLOW_MASK;
+    if (!renderingEnabled() || (m_ports.m_status & BOTH) == BOTH) {
+        return true;
+    }
 
-    // 0x3000-0x3EFF is a mirror of 0x2000-0x2EFF
-    if (trueAddress >= 0x3000 &&
-        trueAddress <  0x3F00) {
-        trueAddress -= 0x1000;
+    SpriteLine sprites;
+    sprites.evaluate(m_spriteRAM, line, m_ports.m_control);
+    if (sprites.overflow()) {
+        m_ports.setStatus(Ports::SPRITE_OVERFLOW_MASK, true);
     }
-    // 0x3F20-0x3FFF are mirrors of 0x3F00-0x3F1F
-    else if (trueAddress >= 0x3F20) {
-        trueAddress = (trueAddress % 0x20) + 0x3F00;
+
+    if (!(m_ports.m_status & Ports::SPRITE_0_HIT_MASK) && sprites.hasSpriteZero() &&
+        m_ports.showBackground() && m_ports.showSprites()) {
+        int x = spriteZeroHit(sprites);
+        if (x >= 0) {
+            // Pixel x is output on dot x + 1; come back if we're not there yet.
+            if (m_frameDot <= line * ticksPerScanline + x + 1) {
+                return false;
+            }
+            m_ports.setStatus(Ports::SPRITE_0_HIT_MASK, true);
+        }
     }
+    return true;
+}
 
-    return m_memory[trueAddress];
+void
+PPU::
+stepScroll()
+{
+    // Dots 256 and 257: down a line, and back to the left edge.
+    if (renderingEnabled()) {
+        m_ports.m_vramAddress = Loopy::copyHorizontal(Loopy::incrementY(m_ports.m_vramAddress),
+                                                      m_ports.m_tempAddress);
+    }
 }
-#endif
 
-// Renders current pixel determined by the clock.
-void 
+int
 PPU::
-render()
+spriteZeroHit(const SpriteLine& sprites)
 {
-    if (m_mask.showBackground()) {
-        renderBackground();
+    // Sprite 0 is in front of every other sprite, so its opaque pixels over
+    // opaque background are the hit whatever its priority.
+    const SpriteLine::Sprite &sprite = sprites.sprite(0);
+    unsigned int x = sprite.m_x;
+    u8_byte hits = spriteZeroMask(sprite) & backgroundMask(x);
+
+    // Either half clipped in the leftmost 8 pixels hides the hit there, and
+    // there's never one at x 255.
+    const u8_byte SHOW_LEFTMOST = Ports::SHOW_LEFTMOST_BACKGROUND_MASK | Ports::SHOW_LEFTMOST_SPRITES_MASK;
+    if (x < Tile::sideLength && (m_ports.m_mask & SHOW_LEFTMOST) != SHOW_LEFTMOST) {
+        hits &= (1 << x) - 1;
     }
-    if (m_mask.showSprites()) {
-        renderSprites();
+    const unsigned int LAST_HIT = width - 1;
+    if (x + Tile::sideLength > LAST_HIT) {
+        hits &= ~(0xFF >> (LAST_HIT - x));
+    }
+
+    if (hits == 0) {
+        return -1;
     }
+    // Leftmost pixel in the top bit.
+    return x + __builtin_clz(hits) - (32 - Tile::sideLength);
 }
 
-void 
+u8_byte
 PPU::
-renderBackground()
+spriteZeroMask(const SpriteLine::Sprite& sprite)
 {
-    //TODO 
+    u8_byte opaque = readVideo(sprite.m_rowAddress) | readVideo(sprite.m_rowAddress + Tile::sideLength);
+    if (sprite.horizontalFlip()) {
+        opaque = ((opaque & 0xF0) >> 4) | ((opaque & 0x0F) << 4);
+        opaque = ((opaque & 0xCC) >> 2) | ((opaque & 0x33) << 2);
+        opaque = ((opaque & 0xAA) >> 1) | ((opaque & 0x55) << 1);
+    }
+    return opaque;
 }
 
-void 
+u8_byte
 PPU::
-renderSprites()
+backgroundMask(unsigned int x)
 {
-    //TODO
+    // v is where the line starts; eight pixels from x straddle at most two
+    // tiles.
+    unsigned int offset = m_ports.m_fineX + x;
+    u16_word     first  = Loopy::addCoarseX(m_ports.m_vramAddress, offset / Tile::sideLength);
+    unsigned int pair   = (backgroundTileMask(first) << 8) |
+                          backgroundTileMask(Loopy::incrementX(first));
+    return (pair << (offset % Tile::sideLength)) >> 8;
 }
 
-const float* 
+u8_byte
+PPU::
+backgroundTileMask(u16_word address)
+{
+    // The row of the tile address points at, the way the renderer fetches it.
+    u16_word rowAddress = m_ports.backgroundTable() +
+                          readVideo(Loopy::tileAddress(address)) * tileSize + Loopy::fineY(address);
+    return readVideo(rowAddress) | readVideo(rowAddress + Tile::sideLength);
+}
+
+void
+PPU::
+setRenderMode(RenderPipeline::Mode mode)
+{
+    m_renderPipeline.setMode(mode);
+}
+
+RenderPipeline::Mode
+PPU::
+renderMode() const
+{
+    return m_renderPipeline.mode();
+}
+
+void
+PPU::
+setRenderThreads(unsigned int threads)
+{
+    m_renderPipeline.setRenderThreads(threads);
+}
+
+unsigned int
+PPU::
+renderThreads() const
+{
+    return m_renderPipeline.renderThreads();
+}
+
+void
+PPU::
+setOutputEnabled(bool enabled)
+{
+    m_outputEnabled = enabled;
+}
+
+bool
+PPU::
+outputEnabled() const
+{
+    return m_outputEnabled;
+}
+
+const IndexedFrame&
 PPU::
 displayBuffer() const
 {
-    return m_bitmap;
+    return m_renderPipeline.displayBuffer();
+}
+
+unsigned int
+PPU::
+displayedFrame() const
+{
+    return m_renderPipeline.displayedFrame();
 }
 
 void 
@@ -187,9 +598,7 @@ PPU::
 resetImpl()
 {
     // TODO: Handle memory.
-    std::for_each(m_registers.begin(), m_registers.end(), [] (Register* reg) {
-            reg->reset();
-    });
+    m_ports.reset();
 }
 
 void 
@@ -197,71 +606,200 @@ PPU::
 powerOnImpl()
 {
     // TODO: Handle memory.
-    std::for_each(m_registers.begin(), m_registers.end(), [] (Register* reg) {
-            reg->powerOn();
-    });
+    m_ports.powerOn();
 }
 
 void 
 PPU::
 powerOffImpl()
 {
-    // TODO: Handle memory.
-    std::for_each(m_registers.begin(), m_registers.end(), [] (Register* reg) {
-            reg->powerOff();
-    });
-}
-
-Register*
-PPU::RegisterBlock::
-getRegister(RegisterBlock::address_t address)
-{
-    Register *reg = nullptr;
-    switch (address) {
-        case CONTROL_ADDRESS:
-            reg = &m_ppu.m_control;
-            break;
-        case MASK_ADDRESS:
-            reg = &m_ppu.m_mask;
-            break;
-        case STATUS_ADDRESS:
-            reg = &m_ppu.m_status;
-            break;
-        case OAM_ADDRESS_ADDRESS:
-            reg = &m_ppu.m_oamAddress;
-            break;
-        case OAM_DATA_ADDRESS:
-            reg = &m_ppu.m_oamData;
-            break;
-        case OAM_DMA_ADDRESS:
-            reg = &m_ppu.m_oamData;
-            break;
-        case SCROLL_ADDRESS:
-            reg = &m_ppu.m_scroll;
-            break;
-        case SCROLL_ADDRESS_ADDRESS:
-            reg = &m_ppu.m_address;
-            break;
-        case SCROLL_DATA_ADDRESS:
-            reg = &m_ppu.m_data;
-            break;
-    }
-    assert(reg != nullptr);
-    return reg;
-}
-
-PPU::RegisterBlock::data_t
-PPU::RegisterBlock::
-getData(address_t address) 
-{
-    Register *reg = getRegister(address);
-    return reg->read();
 }
 
 void
-PPU::RegisterBlock::
-setData(address_t address, data_t data)
+PPU::Ports::
+powerOn()
+{
+    m_control     = 0x00;
+    m_mask        = 0x00;
+    m_status      = 0xA0;
+    m_oamAddress  = 0x00;
+    m_vramAddress = 0x0000;
+    m_tempAddress = 0x0000;
+    m_fineX       = 0x00;
+    m_oamDMA      = 0x00;
+    m_readBuffer  = 0x00;
+    m_firstWrite  = true;
+    m_openBus     = 0x00;
+}
+
+void
+PPU::Ports::
+reset()
+{
+    // Vblank, OAMADDR, the scroll and the VRAM address survive a reset.
+    m_control    = 0x00;
+    m_mask       = 0x00;
+    m_status    &= VERTICAL_BLANK_MASK;
+    m_readBuffer = 0x00;
+    m_firstWrite = true;
+}
+
+const PPU::PortReader PPU::PORT_READERS[PORT_MASK + 1] = {
+    &PPU::readOpenBus,      // $2000 PPUCTRL
+    &PPU::readOpenBus,      // $2001 PPUMASK
+    &PPU::readStatus,       // $2002 PPUSTATUS
+    &PPU::readOpenBus,      // $2003 OAMADDR
+    &PPU::readOAMData,      // $2004 OAMDATA
+    &PPU::readOpenBus,      // $2005 PPUSCROLL
+    &PPU::readOpenBus,      // $2006 PPUADDR
+    &PPU::readVRAMData      // $2007 PPUDATA
+};
+
+const PPU::PortWriter PPU::PORT_WRITERS[PORT_MASK + 1] = {
+    &PPU::writeControl,
+    &PPU::writeMask,
+    &PPU::writeReadOnly,
+    &PPU::writeOAMAddress,
+    &PPU::writeOAMData,
+    &PPU::writeScroll,
+    &PPU::writeAddress,
+    &PPU::writeVRAMData
+};
+
+u8_byte
+PPU::
+readOpenBus()
+{
+    // The bus keeps the last value put on it. It really fades over a few
+    // hundred milliseconds, which no game relies on.
+    return m_ports.m_openBus;
+}
+
+u8_byte
+PPU::
+readStatus()
+{
+    // Reading reports vblank and then clears it. The low bits aren't
+    // driven, so they're whatever was last on the bus.
+    u8_byte value = (m_ports.m_status & Ports::STATUS_MASK) | (m_ports.m_openBus & ~Ports::STATUS_MASK);
+    m_ports.setStatus(Ports::VERTICAL_BLANK_MASK, false);
+    m_ports.m_firstWrite = true;
+    return value;
+}
+
+u8_byte
+PPU::
+readOAMData()
+{
+    return m_spriteRAM[m_ports.m_oamAddress];
+}
+
+u8_byte
+PPU::
+readVRAMData()
+{
+    // Reads lag one behind: the byte comes out of the buffer and the
+    // buffer is refilled. Except for the palette, which is read straight
+    // away while the buffer gets the nametable byte underneath it.
+    u16_word address = m_ports.m_vramAddress & ppuEndAddress;
+    u8_byte value;
+    if (address >= VideoMemory::PALETTE_ADDRESS) {
+        value = readVideo(address);
+        m_ports.m_readBuffer = readVideo(address - 0x1000);
+    }
+    else {
+        value = m_ports.m_readBuffer;
+        m_ports.m_readBuffer = readVideo(address);
+    }
+    m_ports.m_vramAddress = (m_ports.m_vramAddress + m_ports.increment()) & Loopy::ADDRESS_MASK;
+    return value;
+}
+
+void
+PPU::
+writeControl(u8_byte data)
+{
+    bool nmiWasEnabled = m_ports.generateNMI();
+    m_ports.m_control     = data;
+    m_ports.m_tempAddress = Loopy::writeControl(m_ports.m_tempAddress, data);
+    // Tell the renderer about anything that changes the picture. Values are
+    // logged as the registers resolved them.
+    recordEvent(RenderEvent::ControlWrite, m_ports.m_tempAddress, data);
+
+    // Turning NMIs on during vblank fires one straight away.
+    if (!nmiWasEnabled && m_ports.generateNMI() &&
+        (m_ports.m_status & Ports::VERTICAL_BLANK_MASK)) {
+        signalNMI();
+    }
+}
+
+void
+PPU::
+writeMask(u8_byte data)
+{
+    m_ports.m_mask = data;
+    recordEvent(RenderEvent::MaskWrite, MASK_ADDRESS, data);
+}
+
+void
+PPU::
+writeReadOnly(u8_byte data)
+{
+}
+
+void
+PPU::
+writeOAMAddress(u8_byte data)
+{
+    m_ports.m_oamAddress = data;
+}
+
+void
+PPU::
+writeOAMData(u8_byte data)
+{
+    u8_byte address = m_ports.m_oamAddress++;
+    m_spriteRAM[address] = data;
+    recordEvent(RenderEvent::OAMWrite, address, data);
+}
+
+void
+PPU::
+writeScroll(u8_byte data)
+{
+    // X then Y, both into t; fine X goes straight to x.
+    if (m_ports.m_firstWrite) {
+        m_ports.m_tempAddress = Loopy::writeScrollX(m_ports.m_tempAddress, data);
+        m_ports.m_fineX       = Loopy::fineX(data);
+    }
+    else {
+        m_ports.m_tempAddress = Loopy::writeScrollY(m_ports.m_tempAddress, data);
+    }
+    m_ports.m_firstWrite = !m_ports.m_firstWrite;
+    recordEvent(RenderEvent::TempAddressWrite, m_ports.m_tempAddress, m_ports.m_fineX);
+}
+
+void
+PPU::
+writeAddress(u8_byte data)
+{
+    // High byte first, into t; the low byte completes it and copies it to v.
+    if (m_ports.m_firstWrite) {
+        m_ports.m_tempAddress = Loopy::writeAddressHigh(m_ports.m_tempAddress, data);
+        recordEvent(RenderEvent::TempAddressWrite, m_ports.m_tempAddress, m_ports.m_fineX);
+    }
+    else {
+        m_ports.m_tempAddress = Loopy::writeAddressLow(m_ports.m_tempAddress, data);
+        m_ports.m_vramAddress = m_ports.m_tempAddress;
+        recordEvent(RenderEvent::AddressWrite, m_ports.m_vramAddress, data);
+    }
+    m_ports.m_firstWrite = !m_ports.m_firstWrite;
+}
+
+void
+PPU::
+writeVRAMData(u8_byte data)
 {
-    Register *reg = getRegister(address);
-    reg->write(data);
+    writeVideo(m_ports.m_vramAddress, data);
+    m_ports.m_vramAddress = (m_ports.m_vramAddress + m_ports.increment()) & Loopy::ADDRESS_MASK;
 }
@@ -2,28 +2,36 @@
 #define PPU_H
 
 #include "utility/DataTypes.hpp"
-#include "utility/Register.hpp"
 #include "utility/PoweredDevice.hpp"
 #include "utility/Clock.hpp"
 #include "utility/Memory.hpp"
 #include "CPU/Cpu65XX.hpp"
+#include "IndexedFrame.hpp"
+#include "Loopy.hpp"
+#include "RenderLog.hpp"
+#include "RenderPipeline.hpp"
+#include "SpriteLine.hpp"
+#include "VideoMemory.hpp"
 
 #include <vector>
 #include <cassert>
+#include <functional>
 
 class PPU : public PoweredDevice, public ClockedDevice
 {
 public:
-    PPU(Memory *cpuMemory,
-        Clock& clock);
+    PPU(Clock& clock);
     ~PPU();
 
     const static unsigned int width;             
     const static unsigned int height;            
     const static unsigned int ticksPerScanline;  
-    const static unsigned int memorySize;        
+    const static unsigned int scanlinesPerFrame;
+    const static unsigned int dotsPerFrame;
+    const static unsigned int postRenderScanline;
+    const static unsigned int vblankScanline;
+    const static unsigned int preRenderScanline;
     const static unsigned int spriteRamSize;     
-    const static unsigned int bitmapSize;        
     const static unsigned int spriteSize;        
     const static unsigned int tileSize;          
     const static unsigned int clockDivisor;      
@@ -44,11 +52,28 @@ public:
     const static u16_word SCROLL_ADDRESS_ADDRESS;    
     const static u16_word SCROLL_DATA_ADDRESS;       
 
+    // The CPU's side, $2000-$2007 and its mirrors up to $3FFF: only the
+    // low three address bits matter. Each goes straight to its port's
+    // handler once the PPU has caught up. Whatever crosses the bus is
+    // latched for the write-only ports to read back.
+    u8_byte readPort(u16_word address) {
+        sync();
+        m_ports.m_openBus = (this->*PORT_READERS[address & PORT_MASK])();
+        return m_ports.m_openBus;
+    }
+    void writePort(u16_word address, u8_byte data) {
+        sync();
+        m_ports.m_openBus = data;
+        (this->*PORT_WRITERS[address & PORT_MASK])(data);
+    }
+
+    // The ports as a Memory at $2000-$2007, for code that wants one. The
+    // NES bus calls readPort() and writePort() itself.
     class RegisterBlock : public Memory 
     {
     public:
         static const address_t  baseAddress = 0x2000;
-        static const address_t  lastAddress = 0x2008;
+        static const address_t  lastAddress = 0x2007;
 
         RegisterBlock(PPU &ppu) : 
             Memory(baseAddress, lastAddress),
@@ -58,29 +83,84 @@ public:
         Memory* clone() { return new RegisterBlock(*this); }
 
     protected:
-        virtual data_t getData(address_t address);
-        virtual void   setData(address_t address, data_t data);
-
-        Register* getRegister(address_t address);
+        virtual data_t getData(address_t address) { return m_ppu.readPort(address); }
+        virtual void   setData(address_t address, data_t data) { m_ppu.writePort(address, data); }
 
     private:
         PPU &m_ppu;
     };
 
     RegisterBlock& registerBlock();
-    const RegisterBlock& registerBlock() const;
 
-    void setCartridgeMemory(Memory *ppuMemory);
+    // The cartridge's part of VRAM: the CHR each pattern page reads (null
+    // for the PPU's own CHR RAM), whether it's writable, and the nametable
+    // mirroring. Called again whenever the mapper switches either, which
+    // may be in the middle of a frame.
+    void mapCartridge(u8_byte* const patterns[VideoMemory::PATTERN_PAGES], bool writable,
+                      VideoMemory::Mirroring mirroring);
+
+    // OAM DMA ($4014): the 256 bytes of CPU page page land in OAM from
+    // OAMADDR on, wrapping, as if written to $2004 one after another. All
+    // at once rather than over the 513 cycles the CPU is stalled for.
+    void oamDMA(u8_byte page, const u8_byte* data);
+
+    // Timing engine.
+    //
+    // The PPU keeps its own dot/scanline position and is advanced lazily:
+    // tick() only counts dots until something the rest of the machine can
+    // see is due (vblank and its NMI) or the CPU touches a register, then
+    // sync() catches up. Pixels aren't produced here at all (see Rendering
+    // below), so catching up only ever crosses from one event to the next.
+    enum Phase {
+        PreRenderPhase,
+        VisiblePhase,
+        PostRenderPhase,
+        VerticalBlankPhase
+    };
 
     virtual void tick();
+    void         sync();
+    void         advance(unsigned int dots);
 
-    void signalNMI();
-
-    void render();
-    void renderBackground();
-    void renderSprites();
+    Phase        phase()      const;
+    unsigned int scanline()   const;
+    unsigned int dot()        const;
+    // Number of completed pictures, incremented as vblank starts.
+    unsigned int frameCount() const;
 
-    const float* displayBuffer() const;
+    void signalNMI();
+    void setNMIHandler(std::function<void()> handler);
+
+    // Rendering.
+    //
+    // While the visible scanlines run, the PPU logs every change that affects
+    // the picture (see RenderLog.hpp). At the end of the last visible line the
+    // log is handed to the render pipeline, which draws it either immediately
+    // or on a worker thread while we get on with the next frame.
+    void                 setRenderMode(RenderPipeline::Mode mode);
+    RenderPipeline::Mode renderMode() const;
+    void                 setRenderThreads(unsigned int threads);
+    unsigned int         renderThreads() const;
+
+    // With output disabled the PPU is logic only: nothing is logged or drawn
+    // and displayBuffer() keeps the last picture, but everything the CPU can
+    // observe (vblank and NMI timing, sprite 0 hit and overflow, the $2007
+    // read buffer) is exactly as it would have been. Takes effect from the
+    // next frame, so it can be switched frame by frame. Used to skip frames
+    // in turbo mode, and by bots that only need the game's logic.
+    void setOutputEnabled(bool enabled);
+    bool outputEnabled() const;
+
+    // Latest completed picture, as palette indices (convert it with
+    // PixelConvert to show it). In pipelined mode this lags a frame behind.
+    const IndexedFrame& displayBuffer() const;
+    // Number of the frame displayBuffer() holds.
+    unsigned int displayedFrame() const;
+    // Called with displayBuffer() whenever a new picture lands in it, on the
+    // emulation thread at the end of the visible lines; it's only good for
+    // the call. Empty (the default) for none. Feeds an ObservationStack
+    // (see ObservationStack::sink) or anything else wanting every frame.
+    void setFrameHandler(std::function<void(const IndexedFrame&)> handler);
 
 protected:
     void resetImpl();
@@ -89,283 +169,79 @@ protected:
         
 private:
 
-    class PPUController : public WriteOnlyRegister
-    {
-    public:
-        PPUController() :
-            WriteOnlyRegister(StateData("ppu_controller", 0x00, 0x00, 0x00, 0x00))
-        {}
-        ~PPUController() {}
-
-        static const u8_byte BASE_NAMETABLE_ADDRESS_MASK            = 0x03;
-        static const u8_byte VRAM_ADDRESS_INCREMENT_MASK            = 0x04;
-        static const u8_byte SPRITE_PATTERN_TABLE_ADDRESS_MASK      = 0x08;
-        static const u8_byte BACKGROUND_PATTERN_TABLE_ADDRESS_MASK  = 0x10;
-        static const u8_byte SPRITE_SIZE_MASK                       = 0x20;
-        static const u8_byte MASTER_SLAVE_SELECT_MASK               = 0x40;
-        static const u8_byte GENERATE_NMI_MASK                      = 0x80;
-
-        u16_word baseNameTableAddress() const {
-            return 0x2000 + ((rawRead() & BASE_NAMETABLE_ADDRESS_MASK) != 0) * 0x400;
-        }
-        bool vramAddressIncrement() const { return rawRead() & VRAM_ADDRESS_INCREMENT_MASK; }
-
-        int addressIncrementAmount() const { 
-            if (vramAddressIncrement()) {
-                return 32;
-            }
-            return 1;
-        }
-
-        u16_word spritePatternTableAddress() const { 
-            return ((rawRead() & SPRITE_PATTERN_TABLE_ADDRESS_MASK) != 0) * 0x1000; 
-        }
-        u16_word backgroundPatternTableAddress() const {
-            return ((rawRead() & BACKGROUND_PATTERN_TABLE_ADDRESS_MASK) != 0) * 0x1000;
-        }
-        std::pair<unsigned int, unsigned int> spriteSize() const {
-            return std::pair<unsigned int, unsigned int>(8, 8 + (8 * (rawRead() & SPRITE_SIZE_MASK)));
-        }
-        bool masterSlaveSelect() const { return rawRead() & MASTER_SLAVE_SELECT_MASK; }
-        bool generateNMI() const { return rawRead() & GENERATE_NMI_MASK; }
-    };
-
-    class PPUMask : public Register 
-    {
-    public:
-        PPUMask() :
-            Register(StateData("ppu_mask", 0x00, 0x00, 0x00, 0x00))
-        {}
-        ~PPUMask() {}
-
-        static const u8_byte GRAYSCALE_MASK                     = 0x01;
-        static const u8_byte SHOW_LEFTMOST_BACKGROUND_MASK      = 0x02;
-        static const u8_byte SHOW_LEFTMOST_SPRITES_MASK         = 0x04;
-        static const u8_byte SHOW_BACKGROUND_MASK               = 0x08;
-        static const u8_byte SHOW_SPRITES_MASK                  = 0x10;
-        static const u8_byte INTENSIFY_REDS_MASK                = 0x20;
-        static const u8_byte INTENSIFY_GREENS_MASK              = 0x40;
-        static const u8_byte INTENSIFY_BLUES_MASK               = 0x80;
-
-        bool grayscale() const { return rawRead() & GRAYSCALE_MASK; }
-        bool showLeftmostBackground() const { return rawRead() & SHOW_LEFTMOST_BACKGROUND_MASK; }
-        bool showLeftmostSprites() const { return rawRead() & SHOW_LEFTMOST_SPRITES_MASK; }
-        bool showBackground() const { return rawRead() & SHOW_BACKGROUND_MASK; }
-        bool showSprites() const { return rawRead() & SHOW_SPRITES_MASK; }
-        bool intensifyReds() const { return rawRead() & INTENSIFY_REDS_MASK; }
-        bool intensifyGreens() const { return rawRead() & INTENSIFY_GREENS_MASK; }
-        bool intensifyBlues() const { return rawRead() & INTENSIFY_BLUES_MASK; }
-    };
-
-    class PPUStatus : public Register {
-    public:
-        PPUStatus(bool &isFirstWrite) :
-            Register(StateData("ppu_status", 0xA0, 0x00, 0x00, 0x80)),
-            m_isFirstWrite (isFirstWrite)
-        {}
-        ~PPUStatus() {}
-
-        static const u8_byte LEAST_SIGNIFICANT_BITS_MASK    = 0x1F;
-        static const u8_byte SPRITE_OVERFLOW_MASK           = 0x20;
-        static const u8_byte SPRITE_0_HIT_MASK              = 0x40;
-        static const u8_byte VERTICAL_BLANK_STARTED_MASK    = 0x80;
-
-        virtual u8_byte read() {
-            rawWrite(rawRead() & ~VERTICAL_BLANK_STARTED_MASK);
-            m_isFirstWrite = true;
-            return Register::read();
-        }
-
-        bool spriteOverflow() { return rawRead() & SPRITE_OVERFLOW_MASK; }
-        bool sprite0Hit() { return rawRead() & SPRITE_0_HIT_MASK; }
-        bool verticalBlank() { return rawRead() & VERTICAL_BLANK_STARTED_MASK; }
-
-    private:
-        bool &m_isFirstWrite;
-    };
-
-    class OAMAddress : public WriteOnlyRegister
-    {
-    public:
-        OAMAddress() :
-            WriteOnlyRegister(StateData("oam_address", 0x00, 0x00, 0x00, 0xFF))
-        {}
-        ~OAMAddress() {}
-
-        void increment() { rawWrite(rawRead() + 1); }
-
-        u8_byte address() const { return rawRead(); }
-    };
-
-    class OAMData : public Register
-    {
-    public:
-        OAMData(Memory *&spriteRAM,
-                OAMAddress &address) :
-            Register(StateData("oam_data", 0x00, 0x00, 0x00, 0x00)),
-            m_spriteRAM (spriteRAM),
-            m_address(address)
-        {}
-
-        virtual u8_byte read() {
-            rawWrite(m_spriteRAM->read(m_address.address()));
-            return Register::read();
-        }
-
-        virtual void write(u8_byte data, u8_byte mask = 0xFF) {
-            Register::write(data, mask);
-            m_spriteRAM->write(m_address.address(), rawRead());
-            m_address.increment();
-        }
-
-    private:
-        Memory     *&m_spriteRAM;
-        OAMAddress &m_address;
-    };
-
-    class OAMDMA : public WriteOnlyRegister 
-    {
-    public:
-        OAMDMA() :
-            WriteOnlyRegister(StateData("oam_dma", 0x00, 0x00, 0x00, 0x00))
-        {}
-        ~OAMDMA() {}
-
-        u16_word address() const { return rawRead() * 0x100; }
-    };
-
-    class VRAMScroll : public WriteOnlyRegister
-    {
-    public:
-        VRAMScroll(bool &isFirstWrite) :
-            WriteOnlyRegister(StateData("vram_scroll", 0x00, 0x00, 0x00, 0xFF)),
-            m_isFirstWrite (isFirstWrite)
-        {}
-        ~VRAMScroll() {}
-
-        virtual void write(u8_byte data, u8_byte mask = 0xFF) {
-            WriteOnlyRegister::write(data, mask);
-            if (m_isFirstWrite) {
-                m_horizontalScrollOrigin = rawRead();
-            }
-            else {
-                m_verticalScrollOrigin = rawRead();
-            }
-            m_isFirstWrite = !m_isFirstWrite;
-        }
-
-        u8_byte horizontalScrollOrigin() const {
-            return m_horizontalScrollOrigin;
-        }
-
-        u8_byte verticalScrollOrigin() const {
-            return m_verticalScrollOrigin;
-        }
+    friend class PPUInspector;
 
-    private:
-        u8_byte m_horizontalScrollOrigin;
-        u8_byte m_verticalScrollOrigin;
-        bool   &m_isFirstWrite;
-    };
-
-    // (v) register
-    class VRAMAddress : public WriteOnlyRegister
+    // What's behind the ports, as plain bytes. The console looks at it
+    // through PPUInspector; nothing here knows about that.
+    struct Ports
     {
-    public:
-        // Breakdown of register bits taken from:
-        // http://wiki.nesdev.com/w/index.php/The_skinny_on_NES_scrolling
-        static const u16_word COARSE_X_SCROLL_MASK  = 0x001F;
-        static const u16_word COARSE_Y_SCROLL_MASK  = 0x03E0;
-        static const u16_word NAMETABLE_SELECT_MASK = 0x0C00;
-        static const u16_word FINE_Y_SCROLL_MASK    = 0x7000;
-
-        VRAMAddress(bool &isFirstWrite,
-                    PPUController &ppuController) :
-            WriteOnlyRegister(StateData("vram_address", 0x00, 0x00, 0x00, 0xFF)),
-            m_isFirstWrite (isFirstWrite),
-            m_ppuController (ppuController),
-            m_highByte (0x00),
-            m_lowByte (0x00)
-        {}
-        ~VRAMAddress() {}
-
-        u8_byte coarseXScroll() const {
-            return address() & COARSE_X_SCROLL_MASK;
-        }
-
-        u8_byte coarseYScroll() const {
-            return (address() & COARSE_Y_SCROLL_MASK) >> 5; 
+        // $2000 PPUCTRL
+        static const u8_byte NAMETABLE_MASK             = 0x03;
+        static const u8_byte INCREMENT_MASK             = 0x04;
+        static const u8_byte SPRITE_TABLE_MASK          = 0x08;
+        static const u8_byte BACKGROUND_TABLE_MASK      = 0x10;
+        static const u8_byte SPRITE_SIZE_MASK           = 0x20;
+        static const u8_byte GENERATE_NMI_MASK          = 0x80;
+        // $2001 PPUMASK
+        static const u8_byte SHOW_LEFTMOST_BACKGROUND_MASK = 0x02;
+        static const u8_byte SHOW_LEFTMOST_SPRITES_MASK    = 0x04;
+        static const u8_byte SHOW_BACKGROUND_MASK       = 0x08;
+        static const u8_byte SHOW_SPRITES_MASK          = 0x10;
+        // $2002 PPUSTATUS
+        static const u8_byte SPRITE_OVERFLOW_MASK       = 0x20;
+        static const u8_byte SPRITE_0_HIT_MASK          = 0x40;
+        static const u8_byte VERTICAL_BLANK_MASK        = 0x80;
+        // The bits PPUSTATUS drives; the rest read as the open bus.
+        static const u8_byte STATUS_MASK                = 0xE0;
+
+        // Power up and reset state from:
+        // http://wiki.nesdev.com/w/index.php/PPU_power_up_state
+        void powerOn();
+        void reset();
+
+        bool     showBackground() const { return m_mask & SHOW_BACKGROUND_MASK; }
+        bool     showSprites()    const { return m_mask & SHOW_SPRITES_MASK; }
+        bool     generateNMI()    const { return m_control & GENERATE_NMI_MASK; }
+        u16_word backgroundTable() const { return (m_control & BACKGROUND_TABLE_MASK) ? 0x1000 : 0x0000; }
+        u16_word increment()      const { return (m_control & INCREMENT_MASK) ? 32 : 1; }
+
+        void setStatus(u8_byte mask, bool set) {
+            m_status = set ? (m_status | mask) : (m_status & ~mask);
         }
 
-        u8_byte nametableSelect() const {
-            return (address() & NAMETABLE_SELECT_MASK) >> 10;
-        }
-
-        u8_byte fineYScroll() const {
-            return (address() & FINE_Y_SCROLL_MASK) >> 12;
-        }
-
-        u16_word address() const {
-            return m_address;
-        }
-
-        virtual void write(u8_byte data, u8_byte mask = 0xFF) {
-            WriteOnlyRegister::write(data, mask);
-            if (m_isFirstWrite) {
-                m_highByte = rawRead();
-                m_address  = (m_highByte * 0x100) | (m_address & 0x00FF);
-            }
-            else {
-                m_lowByte = rawRead();
-                m_address = (m_address & 0xFF00) | m_lowByte;
-            }
-            m_isFirstWrite = !m_isFirstWrite;
-        }
-
-        void increment() {
-            rawWrite(rawRead() + m_ppuController.addressIncrementAmount());
-        }
-
-    private:
-        PPUController  &m_ppuController;
-        bool           &m_isFirstWrite;
-        u8_byte         m_highByte;
-        u8_byte         m_lowByte;
-        u16_word        m_address;
+        u8_byte  m_control;
+        u8_byte  m_mask;
+        u8_byte  m_status;
+        u8_byte  m_oamAddress;
+        u16_word m_vramAddress;     // v, t and x; see Loopy.hpp.
+        u16_word m_tempAddress;
+        u8_byte  m_fineX;
+        u8_byte  m_oamDMA;          // Last page copied.
+        u8_byte  m_readBuffer;      // $2007 reads return the previous read.
+        bool     m_firstWrite;      // The $2005/$2006 write latch.
+        u8_byte  m_openBus;         // The last value read or written.
     };
 
-    class VRAMData : public Register 
-    {
-    public:
-        VRAMData(VRAMAddress &vramAddress,
-                 Memory *cpuMemory) :
-            Register(StateData("vram_data", 0x00, 0x00, 0x00, 0x00)),
-            m_vramAddress (vramAddress),
-            m_cpuMemory (cpuMemory)
-        {}
-        ~VRAMData() {}
-
-        virtual u8_byte read() {
-            // Load the data from CPU memory into this register.
-            Register::rawWrite(m_cpuMemory->read(m_vramAddress.address()));
-            m_vramAddress.increment();
-            return Register::read();
-        }
-        
-        virtual void write(u8_byte data, u8_byte mask = 0xFF) {
-            u8_byte vramData = m_cpuMemory->read(m_vramAddress.address());
-            // Update the contents of this register.
-            rawWrite(vramData);
-            Register::write(data, mask);
-            // Write back to the CPU's memory.
-            m_cpuMemory->write(m_vramAddress.address(), rawRead());
-            m_vramAddress.increment();
-        }
-
-    private:
-        VRAMAddress         &m_vramAddress;
-        Memory              *m_cpuMemory; 
-    };
+    static const u16_word PORT_MASK = 0x07;
+
+    typedef u8_byte (PPU::*PortReader)();
+    typedef void    (PPU::*PortWriter)(u8_byte);
+    static const PortReader PORT_READERS[PORT_MASK + 1];
+    static const PortWriter PORT_WRITERS[PORT_MASK + 1];
+
+    // Port handlers, one per register.
+    u8_byte readOpenBus();
+    u8_byte readStatus();
+    u8_byte readOAMData();
+    u8_byte readVRAMData();
+    void    writeControl(u8_byte data);
+    void    writeMask(u8_byte data);
+    void    writeReadOnly(u8_byte data);
+    void    writeOAMAddress(u8_byte data);
+    void    writeOAMData(u8_byte data);
+    void    writeScroll(u8_byte data);
+    void    writeAddress(u8_byte data);
+    void    writeVRAMData(u8_byte data);
 
     class Tile
     {
@@ -378,100 +254,94 @@ private:
         static const unsigned int sideLength = 8;
         static const unsigned int byteSize   = 16;
 
+        // Slow, one pixel at a time; the renderer uses TileCache instead.
         u8_byte color(unsigned int x, unsigned int y) const {
-            assert(0 <= x && x < sideLength);
-            assert(0 <= y && y < sideLength);
+            assert(x < sideLength && y < sideLength);
 
-            bool bit0 = m_backing[x] & (0x01 << y);
-            bool bit1 = m_backing[sideLength + x] & (0x01 << y);
+            // Row y of each bit plane, leftmost pixel in the top bit.
+            unsigned int shift = sideLength - 1 - x;
+            u8_byte bit0 = (m_backing[y] >> shift) & 0x01;
+            u8_byte bit1 = (m_backing[sideLength + y] >> shift) & 0x01;
 
-            return ((u8_byte)bit1 << 1) & ((u8_byte)bit0);
+            return (bit1 << 1) | bit0;
         }
 
     private:
         u8_byte *m_backing;
     };
 
-    class Sprite 
-    {
-    public:
-        Sprite(u8_byte *backing,
-               PPUController &controller) :
-            m_backing (backing),
-            m_controller (controller)
-        {}
-        ~Sprite() { m_backing = nullptr; }
-
-        const static u8_byte VERTICAL_FLIP_MASK         = 0x80;
-        const static u8_byte HORIZONTAL_FLIP_MASK       = 0x40;
-        const static u8_byte BACKGROUND_PRIORITY_MASK   = 0x20;
-        const static u8_byte SPRITE_PALETTE_MASK        = 0x03;
-
-        unsigned int x() const { return m_backing[3]; }
-        unsigned int y() const { return m_backing[0] - 1; }
-
-        std::pair<unsigned int, unsigned int> size() const {
-            return m_controller.spriteSize();
-        }
-
-        unsigned int numTiles() {
-            return size().second >> 3;
-        }
-
-        u16_word tileAddress() {
-            if (size().second == 8) {
-                return m_controller.spritePatternTableAddress() + (tileSize * m_backing[1]);
-            }
-            return ((m_backing[1] & 0x01) * 0x1000) + ((m_backing[1] >> 1) * 2);
-        }
-
-        bool verticalFlip() const { return VERTICAL_FLIP_MASK & m_backing[2]; }
-        bool horizontalFlip() const { return HORIZONTAL_FLIP_MASK & m_backing[2]; }
-        bool isBehindBackground() const { return BACKGROUND_PRIORITY_MASK & m_backing[2]; }
-
-        u8_byte paletteNumber() const { return SPRITE_PALETTE_MASK & m_backing[2]; }
-
-    private:
-        u8_byte       *m_backing;
-        PPUController &m_controller;
-    };
+    // Positions within a frame, in dots from the start of scanline 0, at
+    // which the timing engine has to do something.
+    static const unsigned int RENDER_END_DOT;
+    static const unsigned int VBLANK_SET_DOT;
+    static const unsigned int VBLANK_CLEAR_DOT;
+    static const unsigned int ODD_FRAME_SKIP_DOT;
+
+    bool         renderingEnabled();
+    unsigned int dotsUntilNextEvent() const;
+    void         moveForward(unsigned int dots);
+    void         handleEvent();
+    void         updatePhase();
+
+    // VRAM as seen through $2007 and by the renderer.
+    u8_byte      readVideo(u16_word address) { return m_video.read(address); }
+    void         writeVideo(u16_word address, u8_byte data);
+
+    void         beginRenderJob();
+    void         recordEvent(RenderEvent::Type type, u16_word address, u8_byte value);
+
+    // The scanlines' effects on what the CPU can see, caught up a line at a
+    // time as the frame goes by: sprite 0 hit and overflow, and v moving
+    // down the nametables (only a line at a time; the coarse X steps within
+    // a line aren't kept).
+    void         updateScanlines();
+    // False if the line has a sprite 0 hit still to come.
+    bool         updateSpriteStatus(unsigned int line);
+    void         stepScroll();
+
+    // Sprite 0 hit, using the same sprite evaluation as the renderer. No
+    // pixels are drawn: sprite 0's row and the background under it are
+    // reduced to 8 bit opaque masks (leftmost pixel in the top bit).
+    int          spriteZeroHit(const SpriteLine& sprites);
+    u8_byte      spriteZeroMask(const SpriteLine::Sprite& sprite);
+    u8_byte      backgroundMask(unsigned int x);
+    u8_byte      backgroundTileMask(u16_word address);
 
     bool m_NMI;
+    std::function<void()> m_nmiHandler;
+    std::function<void(const IndexedFrame&)> m_frameHandler;
 
     Clock &m_clock;
 
-    // PPU Control and Status Registers
-    PPUController   m_control; 
-    PPUMask         m_mask;
-    PPUStatus       m_status;
-
-    // PPU Object Attribute Memory registers
-    OAMAddress      m_oamAddress;
-    OAMData         m_oamData;
-    OAMDMA          m_oamDMA;
-
-    // PPU VRAM Access Registers
-    VRAMScroll      m_scroll;
-    VRAMAddress     m_address;      // (v) in "The skinny on NES scrolling"
-    //VRAMAddress     m_temp_address; // (t) in "The skinny on NES scrolling"
-    VRAMData        m_data;
-
+    Ports           m_ports;
     RegisterBlock   m_registerBlock;
 
-    //1st write flip-flop/latch.
-    bool            m_isFirstWrite;
-
-    std::vector<Register*> m_registers;
-
     // PPU Memory
-    Memory  *m_memory;
-    Memory  *m_spriteRAM;
+    VideoMemory m_video;
+    u8_byte     m_spriteRAM[RenderState::OAM_SIZE];
 
-    // Rendering that we can display.
-    float*   m_bitmap;
+    // Rendering.
+    RenderPipeline m_renderPipeline;
+    bool           m_outputEnabled;
+    bool           m_recording;     // Is this frame being logged for the renderer?
 
+    // Timing engine state.
     unsigned int m_currentScanline;
-    unsigned int m_currentCycle;
+    unsigned int m_currentCycle;    // Dot within the scanline.
+    unsigned int m_frameDot;        // Dot within the frame.
+    unsigned int m_frameLength;     // One short on odd frames with rendering on.
+    unsigned int m_frameCount;
+    bool         m_oddFrame;
+    Phase        m_phase;
+
+    // Dots ticked but not yet run, and how many may pile up before we must sync.
+    unsigned int m_pendingDots;
+    unsigned int m_syncDeadline;
+
+    // The next line to catch up (height for the pre-render line's copy,
+    // past it when the frame is done), and whether its sprites are.
+    unsigned int m_nextLine;
+    bool         m_lineChecked;
 };
 
 #endif
@@ -0,0 +1,195 @@
+#include "PPUInspector.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <sstream>
+#include <vector>
+
+const CommandCode REGISTERS_COMMAND_CODE = 0;
+const CommandCode READ_COMMAND_CODE      = 1;
+const CommandCode WRITE_COMMAND_CODE     = 2;
+
+static const char* FIELD_NAMES[PPUInspector::FIELD_COUNT] = {
+    "control",
+    "mask",
+    "status",
+    "oam_address",
+    "vram_address",
+    "temp_address",
+    "fine_x",
+    "write_latch",
+    "oam_dma",
+    "read_buffer",
+    "open_bus"
+};
+
+static std::string
+formatField(PPUInspector::Field field, unsigned int value)
+{
+    std::stringstream output;
+    output << PPUInspector::fieldName(field) << " = 0x" << std::hex << value;
+    return output.str();
+}
+
+PPUInspector::
+PPUInspector(PPU &ppu) :
+    Commandable("ppu"),
+    m_ppu (ppu)
+{
+    registerCommands();
+}
+
+const char*
+PPUInspector::
+fieldName(Field field)
+{
+    assert(field < FIELD_COUNT && "PPUInspector::fieldName: no such field!");
+    return FIELD_NAMES[field];
+}
+
+PPUInspector::Field
+PPUInspector::
+findField(const std::string& name)
+{
+    for (unsigned int field = 0; field < FIELD_COUNT; ++field) {
+        if (name == FIELD_NAMES[field]) {
+            return static_cast<Field>(field);
+        }
+    }
+    return FIELD_COUNT;
+}
+
+unsigned int
+PPUInspector::
+read(Field field) const
+{
+    const PPU::Ports &ports = m_ppu.m_ports;
+    switch (field) {
+        case CONTROL:       return ports.m_control;
+        case MASK:          return ports.m_mask;
+        case STATUS:        return ports.m_status;
+        case OAM_ADDRESS:   return ports.m_oamAddress;
+        case VRAM_ADDRESS:  return ports.m_vramAddress;
+        case TEMP_ADDRESS:  return ports.m_tempAddress;
+        case FINE_X:        return ports.m_fineX;
+        case WRITE_LATCH:   return ports.m_firstWrite;
+        case OAM_DMA:       return ports.m_oamDMA;
+        case READ_BUFFER:   return ports.m_readBuffer;
+        case OPEN_BUS:      return ports.m_openBus;
+        case FIELD_COUNT:   break;
+    }
+    assert(false && "PPUInspector::read: no such field!");
+    return 0;
+}
+
+void
+PPUInspector::
+write(Field field, unsigned int value)
+{
+    // Straight into the ports, so the PPU has to be where the CPU thinks it is.
+    m_ppu.sync();
+    PPU::Ports &ports = m_ppu.m_ports;
+    switch (field) {
+        case CONTROL:       ports.m_control     = value; break;
+        case MASK:          ports.m_mask        = value; break;
+        case STATUS:        ports.m_status      = value; break;
+        case OAM_ADDRESS:   ports.m_oamAddress  = value; break;
+        case VRAM_ADDRESS:  ports.m_vramAddress = value & Loopy::ADDRESS_MASK; break;
+        case TEMP_ADDRESS:  ports.m_tempAddress = value & Loopy::ADDRESS_MASK; break;
+        case FINE_X:        ports.m_fineX       = value & 0x07; break;
+        case WRITE_LATCH:   ports.m_firstWrite  = value != 0; break;
+        case OAM_DMA:       ports.m_oamDMA      = value; break;
+        case READ_BUFFER:   ports.m_readBuffer  = value; break;
+        case OPEN_BUS:      ports.m_openBus     = value; break;
+        case FIELD_COUNT:
+            assert(false && "PPUInspector::write: no such field!");
+            break;
+    }
+
+    // The renderer follows the registers through the same events the ports
+    // log, resolved as the fields now stand. AddressWrite sets t as well as
+    // v, so t is put back after it.
+    switch (field) {
+        case CONTROL:
+            m_ppu.recordEvent(RenderEvent::ControlWrite, ports.m_tempAddress, ports.m_control);
+            break;
+        case MASK:
+            m_ppu.recordEvent(RenderEvent::MaskWrite, PPU::MASK_ADDRESS, ports.m_mask);
+            break;
+        case VRAM_ADDRESS:
+            m_ppu.recordEvent(RenderEvent::AddressWrite, ports.m_vramAddress, 0);
+            m_ppu.recordEvent(RenderEvent::TempAddressWrite, ports.m_tempAddress, ports.m_fineX);
+            break;
+        case TEMP_ADDRESS:
+        case FINE_X:
+            m_ppu.recordEvent(RenderEvent::TempAddressWrite, ports.m_tempAddress, ports.m_fineX);
+            break;
+        default:
+            break;
+    }
+}
+
+void
+PPUInspector::
+registerCommands()
+{
+    std::vector<Command> commands = {
+        { "registers", REGISTERS_COMMAND_CODE, "Print every PPU register.", 0 },
+        { "read",      READ_COMMAND_CODE,      "Takes 1 argument: the register to print.", 1 },
+        { "write",     WRITE_COMMAND_CODE,     "Takes 2 arguments: <register> <hex value>.\n"
+                                               " Set a register without any side effects.", 2 }
+    };
+
+    std::for_each(commands.begin(), commands.end(), [&](Command c) { addCommand(c); });
+}
+
+CommandResult
+PPUInspector::
+receiveCommand(CommandInput command)
+{
+    CommandResult result;
+    result.m_code = CommandResult::NO_RECEIVER;
+
+    switch (command.m_code) {
+        case REGISTERS_COMMAND_CODE:
+        {
+            std::stringstream output;
+            for (unsigned int field = 0; field < FIELD_COUNT; ++field) {
+                output << formatField(static_cast<Field>(field), read(static_cast<Field>(field))) << std::endl;
+            }
+            result.m_output = output.str();
+            result.m_code   = CommandResult::OK;
+        }
+        break;
+        case READ_COMMAND_CODE:
+        case WRITE_COMMAND_CODE:
+        {
+            unsigned int wanted = command.m_code == READ_COMMAND_CODE ? 1 : 2;
+            if (command.m_arguments.size() != wanted) {
+                result.m_code = CommandResult::WRONG_NUM_ARGS;
+                break;
+            }
+            Field field = findField(command.m_arguments[0]);
+            if (field == FIELD_COUNT) {
+                result.m_code = CommandResult::INVALID_ARGUMENT;
+                result.m_meta = "No PPU register called '" + command.m_arguments[0] + "'.";
+                break;
+            }
+            if (command.m_code == WRITE_COMMAND_CODE) {
+                unsigned int value;
+                std::istringstream stream(command.m_arguments[1]);
+                if (!(stream >> std::hex >> value)) {
+                    result.m_code = CommandResult::INVALID_ARGUMENT;
+                    result.m_meta = "Expected a hexadecimal value.";
+                    break;
+                }
+                write(field, value);
+            }
+            result.m_output = formatField(field, read(field));
+            result.m_code   = CommandResult::OK;
+        }
+        break;
+    }
+
+    return result;
+}
@@ -0,0 +1,60 @@
+#ifndef PPU_INSPECTOR_H
+#define PPU_INSPECTOR_H
+
+#include "PPU.hpp"
+#include "utility/Commandable.hpp"
+
+#include <string>
+
+/*
+PPUInspector
+
+The PPU's registers by name, for the console and the debug display, kept
+apart from the PPU so the ports themselves are plain bytes. Reading and
+writing here has none of the side effects the CPU's accesses do: reading
+status doesn't clear vblank, writing the VRAM address doesn't flip the
+latch. Registered with the console as "ppu":
+
+  ppu registers             every field
+  ppu read <field>
+  ppu write <field> <hex>
+*/
+
+class PPUInspector : public Commandable
+{
+public:
+    enum Field {
+        CONTROL = 0,
+        MASK,
+        STATUS,
+        OAM_ADDRESS,
+        VRAM_ADDRESS,   // v, t and x; see Loopy.hpp.
+        TEMP_ADDRESS,
+        FINE_X,
+        WRITE_LATCH,    // 1 if the next $2005/$2006 write is the first.
+        OAM_DMA,
+        READ_BUFFER,    // What the next $2007 read returns, below the palette.
+        OPEN_BUS,       // What the write-only ports read back.
+        FIELD_COUNT
+    };
+
+    PPUInspector(PPU &ppu);
+
+    static const char* fieldName(Field field);
+    // FIELD_COUNT if there's no field called name.
+    static Field       findField(const std::string& name);
+
+    unsigned int read(Field field) const;
+    void         write(Field field, unsigned int value);
+
+    // Commandable interface
+    virtual CommandResult receiveCommand(CommandInput command);
+    virtual std::string   typeName() { return std::string("PPUInspector"); }
+
+private:
+    void registerCommands();
+
+    PPU &m_ppu;
+};
+
+#endif //PPU_INSPECTOR_H
@@ -0,0 +1,408 @@
+#include "PixelConvert.hpp"
+
+#include "Palette.hpp"
+#include "utility/KernelDispatch.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <memory>
+
+namespace PixelConvert
+{
+
+static const unsigned int COLORS          = 64;
+static const unsigned int EMPHASIS_VALUES = 8;
+static const unsigned int ENTRIES         = COLORS * EMPHASIS_VALUES;
+static const unsigned int MAX_PIXEL_BYTES = 4;
+// KernelDispatch::lookupSSSE3 takes this many table entries at once.
+static const unsigned int LOOKUP_SPAN     = KernelDispatch::LOOKUP_SPAN;
+static const unsigned int LOOKUP_STEPS    = KernelDispatch::LOOKUP_STEPS;
+
+// How much each emphasis bit darkens the two channels it doesn't emphasize.
+// An approximation of the NTSC PPU, which attenuates in the signal domain.
+static const float EMPHASIS_ATTENUATION = 0.816328f;
+
+static const unsigned int PIXEL_BYTES[FORMAT_COUNT] = { 4, 4, 2, 3 };
+
+// Built once and never changed after: setPalette publishes a new one.
+struct ColorTable
+{
+    ColorTable(const std::vector<u8_byte>& rgb, unsigned int version) :
+        m_version (version)
+    {
+        build(rgb);
+    }
+
+    // 64 colours with emphasis worked out, 512 used as they are, or none
+    // for Palette's.
+    void build(const std::vector<u8_byte>& rgb) {
+        for (unsigned int emphasis = 0; emphasis < EMPHASIS_VALUES; ++emphasis) {
+            for (unsigned int index = 0; index < COLORS; ++index) {
+                u8_byte *color = m_colors[emphasis][index];
+                if (rgb.size() == ENTRIES * 3) {
+                    std::copy(&rgb[(emphasis * COLORS + index) * 3], &rgb[(emphasis * COLORS + index) * 3] + 3, color);
+                }
+                else if (rgb.size() == COLORS * 3) {
+                    emphasize(&rgb[index * 3], emphasis, color);
+                }
+                else {
+                    Palette::Color base = Palette(index).color();
+                    const u8_byte channels[3] = { base.red(), base.green(), base.blue() };
+                    emphasize(channels, emphasis, color);
+                }
+                pack(emphasis, index);
+            }
+            for (unsigned int format = 0; format < FORMAT_COUNT; ++format) {
+                split(static_cast<Format>(format), emphasis);
+            }
+        }
+    }
+
+    static void emphasize(const u8_byte* base, unsigned int emphasis, u8_byte* color) {
+        float channels[3] = { float(base[0]), float(base[1]), float(base[2]) };
+        for (unsigned int bit = 0; bit < 3; ++bit) {
+            if (!(emphasis & (1 << bit))) {
+                continue;
+            }
+            for (unsigned int channel = 0; channel < 3; ++channel) {
+                if (channel != bit) {
+                    channels[channel] *= EMPHASIS_ATTENUATION;
+                }
+            }
+        }
+        for (unsigned int channel = 0; channel < 3; ++channel) {
+            color[channel] = static_cast<u8_byte>(channels[channel] + 0.5f);
+        }
+    }
+
+    void pack(unsigned int emphasis, unsigned int index) {
+        std::uint32_t red   = m_colors[emphasis][index][0];
+        std::uint32_t green = m_colors[emphasis][index][1];
+        std::uint32_t blue  = m_colors[emphasis][index][2];
+        m_packed[RGBA8888][emphasis][index] = red | (green << 8) | (blue << 16) | 0xFF000000;
+        m_packed[BGRA8888][emphasis][index] = blue | (green << 8) | (red << 16) | 0xFF000000;
+        m_packed[RGB565][emphasis][index]   = ((red >> 3) << 11) | ((green >> 2) << 5) | (blue >> 3);
+        m_packed[RGB24][emphasis][index]    = red | (green << 8) | (blue << 16);
+    }
+
+    // Each byte of the packed pixels as its own table, split into steps for
+    // KernelDispatch::lookupSSSE3.
+    void split(Format format, unsigned int emphasis) {
+        for (unsigned int byte = 0; byte < MAX_PIXEL_BYTES; ++byte) {
+            u8_byte values[COLORS];
+            for (unsigned int index = 0; index < COLORS; ++index) {
+                values[index] = m_packed[format][emphasis][index] >> (8 * byte);
+            }
+            KernelDispatch::splitSteps(values, m_steps[format][emphasis][byte]);
+        }
+    }
+
+    // ENTRIES colours (and pixels) in all, emphasis in the top 3 bits of the
+    // 9 bit index.
+    u8_byte       m_colors[EMPHASIS_VALUES][COLORS][3];
+    // A pixel in each format, read from memory as a little endian word.
+    std::uint32_t m_packed[FORMAT_COUNT][EMPHASIS_VALUES][COLORS];
+    u8_byte       m_steps[FORMAT_COUNT][EMPHASIS_VALUES][MAX_PIXEL_BYTES][COLORS];
+    unsigned int  m_version;
+};
+
+typedef std::shared_ptr<const ColorTable> TablePointer;
+
+static TablePointer&
+publishedTable()
+{
+    static TablePointer table = std::make_shared<ColorTable>(std::vector<u8_byte>(), 0);
+    return table;
+}
+
+// The table in use. A converter holds on to the one it started with, so a
+// palette change never shows halfway through a frame, and the old table
+// goes when the last one using it lets go.
+static TablePointer
+colorTable()
+{
+    return std::atomic_load(&publishedTable());
+}
+
+// Converts one row of count indices, all drawn with the same emphasis.
+typedef void (*ConvertFunction)(const u8_byte* indices, unsigned int count, Format format,
+                                const ColorTable& table, unsigned int emphasis, u8_byte* out);
+
+static void
+convertScalar(const u8_byte* indices, unsigned int count, Format format,
+              const ColorTable& table, unsigned int emphasis, u8_byte* out)
+{
+    const std::uint32_t *packed = table.m_packed[format][emphasis];
+    unsigned int size = PIXEL_BYTES[format];
+    for (unsigned int x = 0; x < count; ++x, out += size) {
+        std::uint32_t pixel = packed[indices[x] & IndexedFrame::INDEX_MASK];
+        for (unsigned int byte = 0; byte < size; ++byte) {
+            out[byte] = pixel >> (8 * byte);
+        }
+    }
+}
+
+#ifdef KERNEL_DISPATCH_X86
+
+// The low 12 bytes of a register: 4 RGB24 pixels, without touching the 4
+// bytes after them.
+__attribute__((target("sse2")))
+static inline void
+storeTriplets(u8_byte* out, __m128i pixels)
+{
+    _mm_storel_epi64(reinterpret_cast<__m128i*>(out), pixels);
+    std::uint32_t last = _mm_cvtsi128_si32(_mm_srli_si128(pixels, 8));
+    std::memcpy(out + 8, &last, sizeof(last));
+}
+
+__attribute__((target("ssse3")))
+static void
+convertSSSE3(const u8_byte* indices, unsigned int count, Format format,
+             const ColorTable& table, unsigned int emphasis, u8_byte* out)
+{
+    const __m128i indexMask = _mm_set1_epi8(IndexedFrame::INDEX_MASK);
+    // 4 byte pixels down to 3.
+    const __m128i triplets  = _mm_setr_epi8(0, 1, 2, 4, 5, 6, 8, 9, 10, 12, 13, 14, -1, -1, -1, -1);
+    unsigned int size = PIXEL_BYTES[format];
+
+    __m128i steps[MAX_PIXEL_BYTES][LOOKUP_STEPS];
+    for (unsigned int byte = 0; byte < MAX_PIXEL_BYTES; ++byte) {
+        const u8_byte *bytes = table.m_steps[format][emphasis][byte];
+        for (unsigned int step = 0; step < LOOKUP_STEPS; ++step) {
+            steps[byte][step] = _mm_loadu_si128(reinterpret_cast<const __m128i*>(bytes + step * LOOKUP_SPAN));
+        }
+    }
+
+    unsigned int x = 0;
+    for (; x + LOOKUP_SPAN <= count; x += LOOKUP_SPAN, out += LOOKUP_SPAN * size) {
+        __m128i index = _mm_and_si128(_mm_loadu_si128(reinterpret_cast<const __m128i*>(indices + x)), indexMask);
+
+        // Byte planes, then interleaved into pixels.
+        __m128i bytes[MAX_PIXEL_BYTES];
+        for (unsigned int byte = 0; byte < MAX_PIXEL_BYTES; ++byte) {
+            bytes[byte] = byte < size ? KernelDispatch::lookupSSSE3(steps[byte], index) : _mm_setzero_si128();
+        }
+
+        __m128i *vectors = reinterpret_cast<__m128i*>(out);
+        __m128i low01 = _mm_unpacklo_epi8(bytes[0], bytes[1]);
+        __m128i high01 = _mm_unpackhi_epi8(bytes[0], bytes[1]);
+        if (size == 2) {
+            _mm_storeu_si128(vectors + 0, low01);
+            _mm_storeu_si128(vectors + 1, high01);
+            continue;
+        }
+
+        __m128i low23  = _mm_unpacklo_epi8(bytes[2], bytes[3]);
+        __m128i high23 = _mm_unpackhi_epi8(bytes[2], bytes[3]);
+        __m128i pixels[4] = {
+            _mm_unpacklo_epi16(low01, low23),
+            _mm_unpackhi_epi16(low01, low23),
+            _mm_unpacklo_epi16(high01, high23),
+            _mm_unpackhi_epi16(high01, high23)
+        };
+        for (unsigned int quarter = 0; quarter < 4; ++quarter) {
+            if (size == 4) {
+                _mm_storeu_si128(vectors + quarter, pixels[quarter]);
+            }
+            else {
+                storeTriplets(out + quarter * 12, _mm_shuffle_epi8(pixels[quarter], triplets));
+            }
+        }
+    }
+    convertScalar(indices + x, count - x, format, table, emphasis, out);
+}
+
+__attribute__((target("avx2")))
+static void
+convertAVX2(const u8_byte* indices, unsigned int count, Format format,
+            const ColorTable& table, unsigned int emphasis, u8_byte* out)
+{
+    const int *packed = reinterpret_cast<const int*>(table.m_packed[format][emphasis]);
+    const __m256i indexMask = _mm256_set1_epi32(IndexedFrame::INDEX_MASK);
+    // 4 byte pixels down to 3, in each 128 bit lane.
+    const __m256i triplets  = _mm256_setr_epi8(0, 1, 2, 4, 5, 6, 8, 9, 10, 12, 13, 14, -1, -1, -1, -1,
+                                               0, 1, 2, 4, 5, 6, 8, 9, 10, 12, 13, 14, -1, -1, -1, -1);
+    unsigned int size = PIXEL_BYTES[format];
+
+    unsigned int x = 0;
+    for (; x + 16 <= count; x += 16, out += 16 * size) {
+        __m128i index = _mm_loadu_si128(reinterpret_cast<const __m128i*>(indices + x));
+        __m256i lowIndex  = _mm256_and_si256(_mm256_cvtepu8_epi32(index), indexMask);
+        __m256i highIndex = _mm256_and_si256(_mm256_cvtepu8_epi32(_mm_srli_si128(index, 8)), indexMask);
+        __m256i low  = _mm256_i32gather_epi32(packed, lowIndex, 4);
+        __m256i high = _mm256_i32gather_epi32(packed, highIndex, 4);
+
+        __m256i *vectors = reinterpret_cast<__m256i*>(out);
+        if (size == 4) {
+            _mm256_storeu_si256(vectors + 0, low);
+            _mm256_storeu_si256(vectors + 1, high);
+        }
+        else if (size == 2) {
+            // Packing works per lane, which leaves the quarters out of order.
+            _mm256_storeu_si256(vectors, _mm256_permute4x64_epi64(_mm256_packus_epi32(low, high), 0xD8));
+        }
+        else {
+            low  = _mm256_shuffle_epi8(low, triplets);
+            high = _mm256_shuffle_epi8(high, triplets);
+            storeTriplets(out + 0,  _mm256_castsi256_si128(low));
+            storeTriplets(out + 12, _mm256_extracti128_si256(low, 1));
+            storeTriplets(out + 24, _mm256_castsi256_si128(high));
+            storeTriplets(out + 36, _mm256_extracti128_si256(high, 1));
+        }
+    }
+    convertScalar(indices + x, count - x, format, table, emphasis, out);
+}
+
+#endif // KERNEL_DISPATCH_X86
+
+static const KernelDispatch::Entry<ConvertFunction> KERNELS[KERNEL_COUNT] = {
+    { "scalar", KernelDispatch::NONE,  convertScalar },
+    { "ssse3",  KernelDispatch::SSSE3, KERNEL_DISPATCH_VECTOR(convertSSSE3, convertScalar) },
+    { "avx2",   KernelDispatch::AVX2,  KERNEL_DISPATCH_VECTOR(convertAVX2, convertScalar) }
+};
+
+// Best first. Gathers are around three times the PSHUFB kernel's speed on
+// recent Intel parts, but slow on AMD before Zen 4; setKernel(SSSE3) there.
+static KernelDispatch::Dispatcher<Kernel, ConvertFunction, KERNEL_COUNT>&
+dispatcher()
+{
+    static KernelDispatch::Dispatcher<Kernel, ConvertFunction, KERNEL_COUNT> kernels(KERNELS, { AVX2, SSSE3 });
+    return kernels;
+}
+
+unsigned int
+bytesPerPixel(Format format)
+{
+    assert(format < FORMAT_COUNT && "PixelConvert::bytesPerPixel: no such format!");
+    return PIXEL_BYTES[format];
+}
+
+void
+convert(const IndexedFrame& frame, Format format, u8_byte* pixels, unsigned int pitch)
+{
+    assert(format < FORMAT_COUNT && "PixelConvert::convert: no such format!");
+    assert(pitch >= IndexedFrame::WIDTH * PIXEL_BYTES[format] && "PixelConvert::convert: rows overlap!");
+
+    TablePointer    table      = colorTable();
+    ConvertFunction convertRow = dispatcher().functions();
+    for (unsigned int y = 0; y < IndexedFrame::HEIGHT; ++y) {
+        convertRow(frame.row(y), IndexedFrame::WIDTH, format, *table,
+                   frame.m_emphasis[y] % EMPHASIS_VALUES, pixels + y * pitch);
+    }
+}
+
+void
+convertRow(const u8_byte* indices, unsigned int count, unsigned int emphasis,
+           Format format, u8_byte* pixels)
+{
+    assert(format < FORMAT_COUNT && "PixelConvert::convertRow: no such format!");
+    assert(emphasis < EMPHASIS_VALUES && "PixelConvert::convertRow: no such emphasis!");
+    dispatcher().functions()(indices, count, format, *colorTable(), emphasis, pixels);
+}
+
+void
+toRGB24(const IndexedFrame& frame, u8_byte* rgb)
+{
+    convert(frame, RGB24, rgb, IndexedFrame::WIDTH * PIXEL_BYTES[RGB24]);
+}
+
+void
+toRGBFloat(const IndexedFrame& frame, float* rgb)
+{
+    TablePointer table = colorTable();
+    for (unsigned int y = 0; y < IndexedFrame::HEIGHT; ++y) {
+        const u8_byte (*colors)[3] = table->m_colors[frame.m_emphasis[y] % EMPHASIS_VALUES];
+        const u8_byte *row = frame.row(y);
+        for (unsigned int x = 0; x < IndexedFrame::WIDTH; ++x, rgb += 3) {
+            const u8_byte *color = colors[row[x] & IndexedFrame::INDEX_MASK];
+            rgb[0] = color[0] / 255.0f;
+            rgb[1] = color[1] / 255.0f;
+            rgb[2] = color[2] / 255.0f;
+        }
+    }
+}
+
+unsigned int
+copyColors(u8_byte* rgb)
+{
+    TablePointer table = colorTable();
+    std::memcpy(rgb, table->m_colors, sizeof(table->m_colors));
+    return table->m_version;
+}
+
+unsigned int
+paletteVersion()
+{
+    return colorTable()->m_version;
+}
+
+bool
+readPalette(const std::string& filename, std::vector<u8_byte>& rgb, std::string& error)
+{
+    std::ifstream input(filename.c_str(), std::ios::in | std::ios::binary);
+    if (!input.is_open()) {
+        error = "Couldn't open palette " + filename + ".";
+        return false;
+    }
+    // One byte more than the biggest palette, to tell it from a longer file.
+    std::vector<char> bytes(ENTRIES * 3 + 1);
+    input.read(&bytes[0], bytes.size());
+    std::streamsize size = input.gcount();
+    if (size != COLORS * 3 && size != ENTRIES * 3) {
+        error = "Palette " + filename + " isn't 192 or 1536 bytes of RGB.";
+        return false;
+    }
+    rgb.assign(bytes.begin(), bytes.begin() + size);
+    return true;
+}
+
+bool
+setPalette(const std::vector<u8_byte>& rgb)
+{
+    if (!rgb.empty() && rgb.size() != COLORS * 3 && rgb.size() != ENTRIES * 3) {
+        return false;
+    }
+    // Built off to the side, then swapped in whole.
+    static std::atomic<unsigned int> versions(0);
+    TablePointer table = std::make_shared<ColorTable>(rgb, ++versions);
+    std::atomic_store(&publishedTable(), table);
+    return true;
+}
+
+Kernel
+kernel()
+{
+    return dispatcher().current();
+}
+
+bool
+setKernel(Kernel kernel)
+{
+    return dispatcher().select(kernel);
+}
+
+bool
+supported(Kernel kernel)
+{
+    return dispatcher().supported(kernel);
+}
+
+const char*
+kernelName(Kernel kernel)
+{
+    return dispatcher().name(kernel);
+}
+
+const char*
+formatName(Format format)
+{
+    assert(format < FORMAT_COUNT && "PixelConvert::formatName: no such format!");
+    static const char* const names[FORMAT_COUNT] = { "rgba8888", "bgra8888", "rgb565", "rgb24" };
+    return names[format];
+}
+
+}
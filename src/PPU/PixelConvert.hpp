@@ -0,0 +1,87 @@
+#ifndef PPU_PIXEL_CONVERT_H
+#define PPU_PIXEL_CONVERT_H
+
+#include "IndexedFrame.hpp"
+#include "utility/DataTypes.hpp"
+
+#include <string>
+#include <vector>
+
+/*
+PixelConvert
+
+The output stage: turns an IndexedFrame into colours for whoever shows or
+saves it, applying each line's colour emphasis on the way. Grayscale is
+already in the indices.
+
+Every format is a lookup per pixel into a 512 entry table, 64 colours for
+each of the 8 emphasis settings, built once from Palette::colors or from a
+.pal file loaded at runtime: 64 RGB triples, with emphasis worked out here,
+or 512 in emphasis order with it already applied. As with TileDecode,
+several kernels do the lookup and the fastest the CPU supports is picked the
+first time anything is converted; the scalar one is the reference.
+*/
+
+namespace PixelConvert
+{
+
+// Named by byte order in memory, not by the value of a packed pixel.
+enum Format
+{
+    RGBA8888 = 0,
+    BGRA8888,   // SDL's ARGB8888 on little endian machines.
+    RGB565,     // 16 bit little endian, red in the top 5 bits.
+    RGB24,
+    FORMAT_COUNT
+};
+
+enum Kernel
+{
+    SCALAR = 0,
+    SSSE3,      // PSHUFB lookups, 16 table entries at a time, 16 pixels per pass.
+    AVX2,       // Gathers packed pixels from the table, 8 at a time.
+    KERNEL_COUNT
+};
+
+unsigned int bytesPerPixel(Format format);
+
+// pitch is the distance in bytes from one row's start to the next.
+void convert(const IndexedFrame& frame, Format format, u8_byte* pixels, unsigned int pitch);
+
+// One row of count indices drawn with emphasis (0-7), as convert does it.
+void convertRow(const u8_byte* indices, unsigned int count, unsigned int emphasis,
+                Format format, u8_byte* pixels);
+
+// 3 bytes a pixel, red first, row after row.
+void toRGB24(const IndexedFrame& frame, u8_byte* rgb);
+
+// 3 floats a pixel in [0, 1], red first, row after row.
+void toRGBFloat(const IndexedFrame& frame, float* rgb);
+
+// Copies the 512 colours in use into rgb, 3 bytes each, red first: 64 for
+// each emphasis setting (0-7) in turn. Returns their palette's version.
+unsigned int copyColors(u8_byte* rgb);
+
+// Goes up with every setPalette, for anyone keeping tables made from the
+// colours.
+unsigned int paletteVersion();
+
+// Reads a .pal file into rgb, ready for setPalette.
+bool readPalette(const std::string& filename, std::vector<u8_byte>& rgb, std::string& error);
+
+// Converts with rgb's colours from now on, or Palette's if it's empty.
+// False (and nothing changes) if it's not 64 or 512 colours. Safe while
+// other threads convert: a conversion already under way finishes with the
+// old colours.
+bool setPalette(const std::vector<u8_byte>& rgb);
+
+// As TileDecode: the kernel in use and a way to force one.
+Kernel kernel();
+bool   setKernel(Kernel kernel);
+bool   supported(Kernel kernel);
+const char* kernelName(Kernel kernel);
+const char* formatName(Format format);
+
+}
+
+#endif //PPU_PIXEL_CONVERT_H
@@ -0,0 +1,99 @@
+#ifndef PPU_RENDER_LOG_H
+#define PPU_RENDER_LOG_H
+
+#include "utility/DataTypes.hpp"
+
+#include <vector>
+
+/*
+Render log
+
+Everything the renderer needs to draw one frame, recorded by the PPU on the
+CPU thread: the render-visible state as it was when the frame started, plus
+every change made to it while the visible scanlines were being drawn, each
+stamped with the dot (counted from the start of the frame) it happened on.
+
+Register values are logged after the PPU has resolved them into its scroll
+registers (v, t and x; see Loopy.hpp) so replaying the log never has to know
+about the write latch. How v then moves while the frame is drawn is the
+renderer's business.
+*/
+
+struct RenderState
+{
+    static const unsigned int VRAM_SIZE           = 0x4000;
+    static const unsigned int PATTERN_TABLES_SIZE = 0x2000;
+    static const unsigned int OAM_SIZE            = 0x100;
+    static const u16_word     PALETTE_ADDRESS     = 0x3F00;
+
+    u8_byte  m_control;
+    u8_byte  m_mask;
+    // v as the pre-render line left it, so the top of the picture.
+    u16_word m_vramAddress;
+    u16_word m_tempAddress;
+    u8_byte  m_fineX;
+
+    // The PPU address space as the renderer sees it, pattern tables included.
+    u8_byte  m_vram[VRAM_SIZE];
+    u8_byte  m_oam[OAM_SIZE];
+};
+
+// The registers as replaying the log leaves them, at any point in a frame.
+struct RenderRegisters
+{
+    // PPUCTRL bits the renderers care about.
+    static const u8_byte BACKGROUND_PATTERN_TABLE_MASK = 0x10;
+    // PPUMASK bits the renderers care about.
+    static const u8_byte GRAYSCALE_MASK                = 0x01;
+    static const u8_byte SHOW_LEFTMOST_BACKGROUND_MASK = 0x02;
+    static const u8_byte SHOW_LEFTMOST_SPRITES_MASK    = 0x04;
+    static const u8_byte SHOW_BACKGROUND_MASK          = 0x08;
+    static const u8_byte SHOW_SPRITES_MASK             = 0x10;
+
+    u8_byte  m_control;
+    u8_byte  m_mask;
+    u16_word m_vramAddress;
+    u16_word m_tempAddress;
+    u8_byte  m_fineX;
+};
+
+struct RenderEvent
+{
+    enum Type {
+        ControlWrite,       // m_address is the new t.
+        MaskWrite,
+        TempAddressWrite,   // $2005 or the first $2006 write; m_address is t, m_value x.
+        AddressWrite,       // m_address is the new v (and t).
+        VideoWrite,     // m_value written to VRAM at m_address.
+        OAMWrite,       // m_value written to OAM at m_address.
+        PatternSwitch   // Mapper changed CHR banks; m_address indexes RenderJob::m_patterns.
+    };
+
+    unsigned int m_dot;
+    u8_byte      m_type;
+    u8_byte      m_value;
+    u16_word     m_address;
+};
+
+struct RenderJob
+{
+    RenderJob() :
+        m_frameNumber (0),
+        m_start (),
+        m_events (),
+        m_patterns ()
+    {}
+
+    void clear() {
+        m_events.clear();
+        m_patterns.clear();
+    }
+
+    unsigned int             m_frameNumber;
+    RenderState              m_start;
+    std::vector<RenderEvent> m_events;
+    // PATTERN_TABLES_SIZE bytes for each PatternSwitch event.
+    std::vector<u8_byte>     m_patterns;
+};
+
+#endif //PPU_RENDER_LOG_H
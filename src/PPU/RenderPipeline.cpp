@@ -0,0 +1,190 @@
+#include "RenderPipeline.hpp"
+
+RenderPipeline::
+RenderPipeline() :
+    m_renderer (),
+    m_mode (InlineMode),
+    m_pool (nullptr),
+    m_recording (0),
+    m_frames (2, IndexedFrame()),
+    m_displayed (0),
+    m_displayedFrame (0),
+    m_worker (),
+    m_mutex (),
+    m_wake (),
+    m_done (),
+    m_pending (nullptr),
+    m_pendingFrame (0),
+    m_busy (false),
+    m_quit (false)
+{
+}
+
+RenderPipeline::
+~RenderPipeline()
+{
+    stopWorker();
+    delete m_pool;
+}
+
+void
+RenderPipeline::
+setMode(Mode mode)
+{
+    if (mode == m_mode) {
+        return;
+    }
+
+    if (mode == PipelinedMode) {
+        startWorker();
+    }
+    else {
+        stopWorker();
+    }
+    m_mode = mode;
+}
+
+RenderPipeline::Mode
+RenderPipeline::
+mode() const
+{
+    return m_mode;
+}
+
+void
+RenderPipeline::
+setRenderThreads(unsigned int threads)
+{
+    if (threads == renderThreads()) {
+        return;
+    }
+
+    // The renderer may be using the old pool.
+    finish();
+    delete m_pool;
+    m_pool = threads > 1 ? new ThreadPool(threads) : nullptr;
+    m_renderer.setThreadPool(m_pool);
+}
+
+unsigned int
+RenderPipeline::
+renderThreads() const
+{
+    return m_pool ? m_pool->size() : 1;
+}
+
+RenderJob&
+RenderPipeline::
+job()
+{
+    return m_jobs[m_recording];
+}
+
+bool
+RenderPipeline::
+submit()
+{
+    RenderJob &recorded = m_jobs[m_recording];
+
+    if (m_mode == InlineMode) {
+        m_renderer.render(recorded, m_frames[m_displayed]);
+        m_displayedFrame = recorded.m_frameNumber;
+        return true;
+    }
+
+    // The previous job's picture is complete once the worker is idle.
+    finish();
+    bool displayed = m_pending != nullptr;
+    if (displayed) {
+        m_displayed      = m_pendingFrame;
+        m_displayedFrame = m_pending->m_frameNumber;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_pending       = &recorded;
+        m_pendingFrame  = 1 - m_displayed;
+        m_busy          = true;
+    }
+    m_wake.notify_one();
+
+    m_recording = 1 - m_recording;
+    return displayed;
+}
+
+void
+RenderPipeline::
+finish()
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_done.wait(lock, [this] { return !m_busy; });
+}
+
+const IndexedFrame&
+RenderPipeline::
+displayBuffer() const
+{
+    return m_frames[m_displayed];
+}
+
+unsigned int
+RenderPipeline::
+displayedFrame() const
+{
+    return m_displayedFrame;
+}
+
+void
+RenderPipeline::
+startWorker()
+{
+    m_quit    = false;
+    m_pending = nullptr;
+    m_worker  = std::thread(&RenderPipeline::workerLoop, this);
+}
+
+void
+RenderPipeline::
+stopWorker()
+{
+    if (!m_worker.joinable()) {
+        return;
+    }
+
+    finish();
+    // Don't lose the last picture when going back to inline rendering.
+    if (m_pending) {
+        m_displayed      = m_pendingFrame;
+        m_displayedFrame = m_pending->m_frameNumber;
+        m_pending        = nullptr;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_quit = true;
+    }
+    m_wake.notify_one();
+    m_worker.join();
+}
+
+void
+RenderPipeline::
+workerLoop()
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    while (true) {
+        m_wake.wait(lock, [this] { return m_quit || m_busy; });
+        if (m_quit) {
+            return;
+        }
+
+        RenderJob    *job   = m_pending;
+        IndexedFrame &frame = m_frames[m_pendingFrame];
+        lock.unlock();
+        m_renderer.render(*job, frame);
+        lock.lock();
+
+        m_busy = false;
+        m_done.notify_all();
+    }
+}
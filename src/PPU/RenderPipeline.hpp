@@ -0,0 +1,84 @@
+#ifndef PPU_RENDER_PIPELINE_H
+#define PPU_RENDER_PIPELINE_H
+
+#include "FrameRenderer.hpp"
+#include "RenderLog.hpp"
+#include "utility/ThreadPool.hpp"
+
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/*
+RenderPipeline
+
+Takes the PPU's per-frame render jobs and turns them into pictures, either
+straight away on the calling thread (inline) or on a worker thread while the
+PPU records the next frame (pipelined). Both modes run the same FrameRenderer
+over the same log, so their pictures are identical; pipelined output is just
+one frame later.
+
+At most one job is ever in flight. submit() waits for the previous one, which
+has had a whole frame of emulation to finish in.
+*/
+
+class RenderPipeline
+{
+public:
+    enum Mode {
+        InlineMode,
+        PipelinedMode
+    };
+
+    RenderPipeline();
+    ~RenderPipeline();
+
+    void setMode(Mode mode);
+    Mode mode() const;
+
+    // Threads each picture is split across (see FrameRenderer); 1 is serial.
+    void         setRenderThreads(unsigned int threads);
+    unsigned int renderThreads() const;
+
+    // The job the PPU is currently recording into.
+    RenderJob& job();
+    // Hands the recorded job over for rendering and starts a fresh one.
+    // True if that put a new picture in displayBuffer(): always inline, and
+    // pipelined once the previous job is done.
+    bool submit();
+    // Waits for any job still being rendered.
+    void finish();
+
+    // Latest completed picture, and the frame number of the job it came from.
+    // Stable until the next submit().
+    const IndexedFrame& displayBuffer() const;
+    unsigned int displayedFrame() const;
+
+private:
+    void startWorker();
+    void stopWorker();
+    void workerLoop();
+
+    FrameRenderer m_renderer;
+    Mode          m_mode;
+    ThreadPool   *m_pool;
+
+    RenderJob          m_jobs[2];
+    unsigned int       m_recording;
+    std::vector<IndexedFrame> m_frames;
+    unsigned int              m_displayed;
+    unsigned int              m_displayedFrame;
+
+    // Worker hand-off, all guarded by m_mutex.
+    std::thread             m_worker;
+    std::mutex              m_mutex;
+    std::condition_variable m_wake;
+    std::condition_variable m_done;
+    RenderJob              *m_pending;
+    unsigned int            m_pendingFrame;
+    bool                    m_busy;
+    bool                    m_quit;
+};
+
+#endif //PPU_RENDER_PIPELINE_H
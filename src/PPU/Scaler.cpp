@@ -0,0 +1,462 @@
+#include "Scaler.hpp"
+
+#include "utility/KernelDispatch.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <vector>
+
+namespace Scaler
+{
+
+// Byte 3 of a pixel in either format, read as a little endian word.
+static const std::uint32_t ALPHA_MASK   = 0xFF000000;
+// A quarter of each channel, taken off for a scanline.
+static const std::uint32_t QUARTER_MASK = 0x3F3F3F3F;
+
+static const unsigned int MIN_FACTORS[FILTER_COUNT] = { 1, 2, 2 };
+static const unsigned int MAX_FACTORS[FILTER_COUNT] = { MAX_FACTOR, MAX_FACTOR, 3 };
+
+// What each kernel does to a row. EPX rows have a pixel to spare either
+// side (row[-1] and row[width]).
+struct Functions
+{
+    void (*expand)(const std::uint32_t* row, unsigned int width, unsigned int factor, std::uint32_t* out);
+    void (*darken)(const std::uint32_t* row, unsigned int count, std::uint32_t* out);
+    void (*epx2)(const std::uint32_t* above, const std::uint32_t* row, const std::uint32_t* below,
+                 unsigned int width, std::uint32_t* top, std::uint32_t* bottom);
+    void (*epx3)(const std::uint32_t* above, const std::uint32_t* row, const std::uint32_t* below,
+                 unsigned int width, std::uint32_t* top, std::uint32_t* middle, std::uint32_t* bottom);
+};
+
+static void
+expandScalar(const std::uint32_t* row, unsigned int width, unsigned int factor, std::uint32_t* out)
+{
+    for (unsigned int x = 0; x < width; ++x) {
+        std::fill(out + x * factor, out + (x + 1) * factor, row[x]);
+    }
+}
+
+static void
+darkenScalar(const std::uint32_t* row, unsigned int count, std::uint32_t* out)
+{
+    for (unsigned int x = 0; x < count; ++x) {
+        std::uint32_t pixel = row[x];
+        out[x] = ((pixel - ((pixel >> 2) & QUARTER_MASK)) & ~ALPHA_MASK) | (pixel & ALPHA_MASK);
+    }
+}
+
+// Scale2x, with E the pixel, B above, H below, D left and F right.
+static void
+epx2Scalar(const std::uint32_t* above, const std::uint32_t* row, const std::uint32_t* below,
+           unsigned int width, std::uint32_t* top, std::uint32_t* bottom)
+{
+    for (unsigned int x = 0; x < width; ++x) {
+        std::uint32_t b = above[x], d = row[int(x) - 1], e = row[x], f = row[x + 1], h = below[x];
+        bool on = b != h && d != f;
+        top[2 * x]        = on && d == b ? d : e;
+        top[2 * x + 1]    = on && b == f ? f : e;
+        bottom[2 * x]     = on && d == h ? d : e;
+        bottom[2 * x + 1] = on && h == f ? f : e;
+    }
+}
+
+// Scale3x, with the corners A, C, G and I as well.
+static void
+epx3Scalar(const std::uint32_t* above, const std::uint32_t* row, const std::uint32_t* below,
+           unsigned int width, std::uint32_t* top, std::uint32_t* middle, std::uint32_t* bottom)
+{
+    for (unsigned int x = 0; x < width; ++x) {
+        std::uint32_t a = above[int(x) - 1], b = above[x], c = above[x + 1];
+        std::uint32_t d = row[int(x) - 1],   e = row[x],   f = row[x + 1];
+        std::uint32_t g = below[int(x) - 1], h = below[x], i = below[x + 1];
+        bool on = b != h && d != f;
+        std::uint32_t *out[3] = { top + 3 * x, middle + 3 * x, bottom + 3 * x };
+        out[0][0] = on && d == b ? d : e;
+        out[0][1] = on && ((d == b && e != c) || (b == f && e != a)) ? b : e;
+        out[0][2] = on && b == f ? f : e;
+        out[1][0] = on && ((d == b && e != g) || (d == h && e != a)) ? d : e;
+        out[1][1] = e;
+        out[1][2] = on && ((b == f && e != i) || (h == f && e != c)) ? f : e;
+        out[2][0] = on && d == h ? d : e;
+        out[2][1] = on && ((d == h && e != i) || (h == f && e != g)) ? h : e;
+        out[2][2] = on && h == f ? f : e;
+    }
+}
+
+static const Functions SCALAR_FUNCTIONS = { expandScalar, darkenScalar, epx2Scalar, epx3Scalar };
+
+#ifdef KERNEL_DISPATCH_X86
+
+__attribute__((target("sse2")))
+static inline __m128i
+load128(const std::uint32_t* p)
+{
+    return _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+}
+
+__attribute__((target("sse2")))
+static inline void
+store128(std::uint32_t* p, __m128i v)
+{
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(p), v);
+}
+
+// mask ? a : b
+__attribute__((target("sse2")))
+static inline __m128i
+select128(__m128i mask, __m128i a, __m128i b)
+{
+    return _mm_or_si128(_mm_and_si128(mask, a), _mm_andnot_si128(mask, b));
+}
+
+__attribute__((target("sse2")))
+static void
+expandSSE2(const std::uint32_t* row, unsigned int width, unsigned int factor, std::uint32_t* out)
+{
+    unsigned int x = 0;
+    if (factor == 2) {
+        for (; x + 4 <= width; x += 4) {
+            __m128i pixels = load128(row + x);
+            store128(out + 2 * x,     _mm_unpacklo_epi32(pixels, pixels));
+            store128(out + 2 * x + 4, _mm_unpackhi_epi32(pixels, pixels));
+        }
+    }
+    else {
+        // Each pixel stored as a vector of itself, the spare part covered
+        // up by the next; the last few go one at a time to stay in the row.
+        for (; x * factor + 4 <= width * factor && x + 1 < width; ++x) {
+            __m128i pixel = _mm_set1_epi32(row[x]);
+            store128(out + x * factor, pixel);
+            if (factor > 4) {
+                store128(out + x * factor + factor - 4, pixel);
+            }
+        }
+    }
+    expandScalar(row + x, width - x, factor, out + x * factor);
+}
+
+__attribute__((target("sse2")))
+static void
+darkenSSE2(const std::uint32_t* row, unsigned int count, std::uint32_t* out)
+{
+    const __m128i quarter = _mm_set1_epi32(QUARTER_MASK);
+    const __m128i alpha   = _mm_set1_epi32(ALPHA_MASK);
+    unsigned int x = 0;
+    for (; x + 4 <= count; x += 4) {
+        __m128i pixels = load128(row + x);
+        __m128i darker = _mm_sub_epi8(pixels, _mm_and_si128(_mm_srli_epi32(pixels, 2), quarter));
+        store128(out + x, select128(alpha, pixels, darker));
+    }
+    darkenScalar(row + x, count - x, out + x);
+}
+
+__attribute__((target("sse2")))
+static void
+epx2SSE2(const std::uint32_t* above, const std::uint32_t* row, const std::uint32_t* below,
+         unsigned int width, std::uint32_t* top, std::uint32_t* bottom)
+{
+    unsigned int x = 0;
+    for (; x + 4 <= width; x += 4) {
+        __m128i b = load128(above + x), d = load128(row + x - 1), e = load128(row + x);
+        __m128i f = load128(row + x + 1), h = load128(below + x);
+        // Where nothing happens: B and H match, or D and F.
+        __m128i off = _mm_or_si128(_mm_cmpeq_epi32(b, h), _mm_cmpeq_epi32(d, f));
+        __m128i e0 = select128(_mm_andnot_si128(off, _mm_cmpeq_epi32(d, b)), d, e);
+        __m128i e1 = select128(_mm_andnot_si128(off, _mm_cmpeq_epi32(b, f)), f, e);
+        __m128i e2 = select128(_mm_andnot_si128(off, _mm_cmpeq_epi32(d, h)), d, e);
+        __m128i e3 = select128(_mm_andnot_si128(off, _mm_cmpeq_epi32(h, f)), f, e);
+        store128(top + 2 * x,        _mm_unpacklo_epi32(e0, e1));
+        store128(top + 2 * x + 4,    _mm_unpackhi_epi32(e0, e1));
+        store128(bottom + 2 * x,     _mm_unpacklo_epi32(e2, e3));
+        store128(bottom + 2 * x + 4, _mm_unpackhi_epi32(e2, e3));
+    }
+    epx2Scalar(above + x, row + x, below + x, width - x, top + 2 * x, bottom + 2 * x);
+}
+
+// Four pixels from each of p, q and r as p0 q0 r0 p1 q1 r1 ...
+__attribute__((target("sse2")))
+static inline void
+storeTriples(std::uint32_t* out, __m128i p, __m128i q, __m128i r)
+{
+    __m128 pqLow  = _mm_castsi128_ps(_mm_unpacklo_epi32(p, q));
+    __m128 pqHigh = _mm_castsi128_ps(_mm_unpackhi_epi32(p, q));
+    __m128 qrLow  = _mm_castsi128_ps(_mm_unpacklo_epi32(q, r));
+    __m128 qrHigh = _mm_castsi128_ps(_mm_unpackhi_epi32(q, r));
+    __m128 rpLow  = _mm_castsi128_ps(_mm_unpacklo_epi32(r, p));
+    __m128 rpHigh = _mm_castsi128_ps(_mm_unpackhi_epi32(r, p));
+    store128(out + 0, _mm_castps_si128(_mm_shuffle_ps(pqLow,  rpLow,  _MM_SHUFFLE(3, 0, 1, 0))));
+    store128(out + 4, _mm_castps_si128(_mm_shuffle_ps(qrLow,  pqHigh, _MM_SHUFFLE(1, 0, 3, 2))));
+    store128(out + 8, _mm_castps_si128(_mm_shuffle_ps(rpHigh, qrHigh, _MM_SHUFFLE(3, 2, 3, 0))));
+}
+
+__attribute__((target("sse2")))
+static void
+epx3SSE2(const std::uint32_t* above, const std::uint32_t* row, const std::uint32_t* below,
+         unsigned int width, std::uint32_t* top, std::uint32_t* middle, std::uint32_t* bottom)
+{
+    unsigned int x = 0;
+    for (; x + 4 <= width; x += 4) {
+        __m128i a = load128(above + x - 1), b = load128(above + x), c = load128(above + x + 1);
+        __m128i d = load128(row + x - 1),   e = load128(row + x),   f = load128(row + x + 1);
+        __m128i g = load128(below + x - 1), h = load128(below + x), i = load128(below + x + 1);
+        __m128i off = _mm_or_si128(_mm_cmpeq_epi32(b, h), _mm_cmpeq_epi32(d, f));
+        __m128i db = _mm_andnot_si128(off, _mm_cmpeq_epi32(d, b));
+        __m128i bf = _mm_andnot_si128(off, _mm_cmpeq_epi32(b, f));
+        __m128i dh = _mm_andnot_si128(off, _mm_cmpeq_epi32(d, h));
+        __m128i hf = _mm_andnot_si128(off, _mm_cmpeq_epi32(h, f));
+        __m128i ea = _mm_cmpeq_epi32(e, a), ec = _mm_cmpeq_epi32(e, c);
+        __m128i eg = _mm_cmpeq_epi32(e, g), ei = _mm_cmpeq_epi32(e, i);
+
+        storeTriples(top + 3 * x,
+                     select128(db, d, e),
+                     select128(_mm_or_si128(_mm_andnot_si128(ec, db), _mm_andnot_si128(ea, bf)), b, e),
+                     select128(bf, f, e));
+        storeTriples(middle + 3 * x,
+                     select128(_mm_or_si128(_mm_andnot_si128(eg, db), _mm_andnot_si128(ea, dh)), d, e),
+                     e,
+                     select128(_mm_or_si128(_mm_andnot_si128(ei, bf), _mm_andnot_si128(ec, hf)), f, e));
+        storeTriples(bottom + 3 * x,
+                     select128(dh, d, e),
+                     select128(_mm_or_si128(_mm_andnot_si128(ei, dh), _mm_andnot_si128(eg, hf)), h, e),
+                     select128(hf, f, e));
+    }
+    epx3Scalar(above + x, row + x, below + x, width - x, top + 3 * x, middle + 3 * x, bottom + 3 * x);
+}
+
+static const Functions SSE2_FUNCTIONS = { expandSSE2, darkenSSE2, epx2SSE2, epx3SSE2 };
+
+__attribute__((target("avx2")))
+static inline __m256i
+load256(const std::uint32_t* p)
+{
+    return _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+}
+
+__attribute__((target("avx2")))
+static inline void
+store256(std::uint32_t* p, __m256i v)
+{
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(p), v);
+}
+
+__attribute__((target("avx2")))
+static inline __m256i
+select256(__m256i mask, __m256i a, __m256i b)
+{
+    return _mm256_blendv_epi8(b, a, mask);
+}
+
+// p and q interleaved, 16 pixels. Unpacking works per lane, so the halves
+// come out as lanes 0 and 1 of low and high.
+__attribute__((target("avx2")))
+static inline void
+storePairs(std::uint32_t* out, __m256i p, __m256i q)
+{
+    __m256i low  = _mm256_unpacklo_epi32(p, q);
+    __m256i high = _mm256_unpackhi_epi32(p, q);
+    store256(out,     _mm256_permute2x128_si256(low, high, 0x20));
+    store256(out + 8, _mm256_permute2x128_si256(low, high, 0x31));
+}
+
+__attribute__((target("avx2")))
+static void
+expandAVX2(const std::uint32_t* row, unsigned int width, unsigned int factor, std::uint32_t* out)
+{
+    unsigned int x = 0;
+    if (factor == 2) {
+        for (; x + 8 <= width; x += 8) {
+            __m256i pixels = load256(row + x);
+            storePairs(out + 2 * x, pixels, pixels);
+        }
+    }
+    else {
+        for (; x * factor + 8 <= width * factor && x + 1 < width; ++x) {
+            store256(out + x * factor, _mm256_set1_epi32(row[x]));
+        }
+    }
+    expandScalar(row + x, width - x, factor, out + x * factor);
+}
+
+__attribute__((target("avx2")))
+static void
+darkenAVX2(const std::uint32_t* row, unsigned int count, std::uint32_t* out)
+{
+    const __m256i quarter = _mm256_set1_epi32(QUARTER_MASK);
+    const __m256i alpha   = _mm256_set1_epi32(ALPHA_MASK);
+    unsigned int x = 0;
+    for (; x + 8 <= count; x += 8) {
+        __m256i pixels = load256(row + x);
+        __m256i darker = _mm256_sub_epi8(pixels, _mm256_and_si256(_mm256_srli_epi32(pixels, 2), quarter));
+        store256(out + x, select256(alpha, pixels, darker));
+    }
+    darkenScalar(row + x, count - x, out + x);
+}
+
+__attribute__((target("avx2")))
+static void
+epx2AVX2(const std::uint32_t* above, const std::uint32_t* row, const std::uint32_t* below,
+         unsigned int width, std::uint32_t* top, std::uint32_t* bottom)
+{
+    unsigned int x = 0;
+    for (; x + 8 <= width; x += 8) {
+        __m256i b = load256(above + x), d = load256(row + x - 1), e = load256(row + x);
+        __m256i f = load256(row + x + 1), h = load256(below + x);
+        __m256i off = _mm256_or_si256(_mm256_cmpeq_epi32(b, h), _mm256_cmpeq_epi32(d, f));
+        storePairs(top + 2 * x,
+                   select256(_mm256_andnot_si256(off, _mm256_cmpeq_epi32(d, b)), d, e),
+                   select256(_mm256_andnot_si256(off, _mm256_cmpeq_epi32(b, f)), f, e));
+        storePairs(bottom + 2 * x,
+                   select256(_mm256_andnot_si256(off, _mm256_cmpeq_epi32(d, h)), d, e),
+                   select256(_mm256_andnot_si256(off, _mm256_cmpeq_epi32(h, f)), f, e));
+    }
+    epx2SSE2(above + x, row + x, below + x, width - x, top + 2 * x, bottom + 2 * x);
+}
+
+// Three way interleaving doesn't go across lanes cheaply, so EPX at 3x
+// stays with SSE2.
+static const Functions AVX2_FUNCTIONS = { expandAVX2, darkenAVX2, epx2AVX2, epx3SSE2 };
+
+#endif // KERNEL_DISPATCH_X86
+
+static const KernelDispatch::Entry<Functions> KERNELS[KERNEL_COUNT] = {
+    { "scalar", KernelDispatch::NONE, SCALAR_FUNCTIONS },
+    { "sse2",   KernelDispatch::SSE2, KERNEL_DISPATCH_VECTOR(SSE2_FUNCTIONS, SCALAR_FUNCTIONS) },
+    { "avx2",   KernelDispatch::AVX2, KERNEL_DISPATCH_VECTOR(AVX2_FUNCTIONS, SCALAR_FUNCTIONS) }
+};
+
+static KernelDispatch::Dispatcher<Kernel, Functions, KERNEL_COUNT>&
+dispatcher()
+{
+    static KernelDispatch::Dispatcher<Kernel, Functions, KERNEL_COUNT> kernels(KERNELS, { AVX2, SSE2 });
+    return kernels;
+}
+
+bool
+supported(Kernel kernel)
+{
+    return dispatcher().supported(kernel);
+}
+
+bool
+supports(Filter filter, unsigned int factor)
+{
+    assert(filter < FILTER_COUNT && "Scaler::supports: no such filter!");
+    return factor >= MIN_FACTORS[filter] && factor <= MAX_FACTORS[filter];
+}
+
+// Fills row with source row y.
+typedef std::function<void(unsigned int y, std::uint32_t* row)> RowSource;
+
+static void
+scaleRows(const RowSource& source, unsigned int width, unsigned int height,
+          Filter filter, unsigned int factor, u8_byte* destination, unsigned int pitch)
+{
+    assert(supports(filter, factor) && "Scaler::scale: filter can't scale that much!");
+    assert(pitch >= width * factor * 4 && "Scaler::scale: rows overlap!");
+    const Functions &kernel = dispatcher().functions();
+    auto out = [destination, pitch](unsigned int y) {
+        return reinterpret_cast<std::uint32_t*>(destination + y * pitch);
+    };
+
+    if (filter != EPX) {
+        std::vector<std::uint32_t> row(width);
+        for (unsigned int y = 0; y < height; ++y) {
+            source(y, &row[0]);
+            std::uint32_t *first = out(y * factor);
+            kernel.expand(&row[0], width, factor, first);
+            for (unsigned int copy = 1; copy < factor; ++copy) {
+                if (filter == SCANLINES && copy == factor - 1) {
+                    kernel.darken(first, width * factor, out(y * factor + copy));
+                }
+                else {
+                    std::memcpy(out(y * factor + copy), first, width * factor * sizeof(std::uint32_t));
+                }
+            }
+        }
+        return;
+    }
+
+    // The rows above, at and below the one being scaled, each with its edge
+    // pixels repeated either side. Off the top and bottom the edge rows are
+    // repeated too.
+    unsigned int stride = width + 2;
+    std::vector<std::uint32_t> storage(3 * stride);
+    std::uint32_t *rows[3] = { &storage[1], &storage[stride + 1], &storage[2 * stride + 1] };
+    auto load = [&](unsigned int y, std::uint32_t* row) {
+        source(y, row);
+        row[-1]    = row[0];
+        row[width] = row[width - 1];
+    };
+    load(0, rows[1]);
+    std::memcpy(rows[0] - 1, rows[1] - 1, stride * sizeof(std::uint32_t));
+    for (unsigned int y = 0; y < height; ++y) {
+        if (y + 1 < height) {
+            load(y + 1, rows[2]);
+        }
+        else {
+            std::memcpy(rows[2] - 1, rows[1] - 1, stride * sizeof(std::uint32_t));
+        }
+        if (factor == 2) {
+            kernel.epx2(rows[0], rows[1], rows[2], width, out(2 * y), out(2 * y + 1));
+        }
+        else {
+            kernel.epx3(rows[0], rows[1], rows[2], width, out(3 * y), out(3 * y + 1), out(3 * y + 2));
+        }
+        std::rotate(rows, rows + 1, rows + 3);
+    }
+}
+
+void
+scale(const u8_byte* source, unsigned int width, unsigned int height, unsigned int sourcePitch,
+      Filter filter, unsigned int factor, u8_byte* destination, unsigned int pitch)
+{
+    scaleRows([=](unsigned int y, std::uint32_t* row) {
+                  std::memcpy(row, source + y * sourcePitch, width * sizeof(std::uint32_t));
+              },
+              width, height, filter, factor, destination, pitch);
+}
+
+void
+scale(const IndexedFrame& frame, PixelConvert::Format format,
+      Filter filter, unsigned int factor, u8_byte* destination, unsigned int pitch)
+{
+    assert((format == PixelConvert::RGBA8888 || format == PixelConvert::BGRA8888) &&
+           "Scaler::scale: only 4 byte formats!");
+    scaleRows([&](unsigned int y, std::uint32_t* row) {
+                  PixelConvert::convertRow(frame.row(y), IndexedFrame::WIDTH, frame.m_emphasis[y] & 0x07,
+                                           format, reinterpret_cast<u8_byte*>(row));
+              },
+              IndexedFrame::WIDTH, IndexedFrame::HEIGHT, filter, factor, destination, pitch);
+}
+
+Kernel
+kernel()
+{
+    return dispatcher().current();
+}
+
+bool
+setKernel(Kernel kernel)
+{
+    return dispatcher().select(kernel);
+}
+
+const char*
+kernelName(Kernel kernel)
+{
+    return dispatcher().name(kernel);
+}
+
+const char*
+filterName(Filter filter)
+{
+    assert(filter < FILTER_COUNT && "Scaler::filterName: no such filter!");
+    static const char* const names[FILTER_COUNT] = { "nearest", "scanlines", "epx" };
+    return names[filter];
+}
+
+}
@@ -0,0 +1,71 @@
+#ifndef PPU_SCALER_H
+#define PPU_SCALER_H
+
+#include "IndexedFrame.hpp"
+#include "PixelConvert.hpp"
+#include "utility/DataTypes.hpp"
+
+/*
+Scaler
+
+Blows a picture up for a window, straight into the texture's buffer:
+
+    NEAREST     each pixel a factor x factor square (1x-6x).
+    SCANLINES   the same, with the last row of each square darkened to a
+                quarter down (2x-6x), for the look of a CRT's gaps.
+    EPX         AdvMAME's Scale2x/Scale3x (2x, 3x): where two neighbours
+                across a corner match and the other two don't, the corner
+                takes their colour, so diagonals come out as lines rather
+                than steps. Only exact matches count, which is what pixel
+                art wants and what makes it cheap.
+
+Pixels are 4 bytes, RGBA8888 or BGRA8888, and compared or darkened as such
+(alpha is kept). Palette index input is converted a row at a time as it's
+needed, so no full size picture is made before scaling either.
+
+As with PixelConvert several kernels do the work, the fastest the CPU
+supports is used and all give the same result.
+*/
+
+namespace Scaler
+{
+
+enum Filter
+{
+    NEAREST = 0,
+    SCANLINES,
+    EPX,
+    FILTER_COUNT
+};
+
+enum Kernel
+{
+    SCALAR = 0,
+    SSE2,       // 4 pixels at a time.
+    AVX2,       // 8, except for EPX at 3x, which stays with SSE2.
+    KERNEL_COUNT
+};
+
+static const unsigned int MAX_FACTOR = 6;
+
+// Whether filter can scale by factor.
+bool supports(Filter filter, unsigned int factor);
+
+// width x height pixels at source, rows sourcePitch bytes apart, factor
+// times each way to destination, rows pitch bytes apart.
+void scale(const u8_byte* source, unsigned int width, unsigned int height, unsigned int sourcePitch,
+           Filter filter, unsigned int factor, u8_byte* destination, unsigned int pitch);
+
+// frame converted to format (RGBA8888 or BGRA8888) on the way.
+void scale(const IndexedFrame& frame, PixelConvert::Format format,
+           Filter filter, unsigned int factor, u8_byte* destination, unsigned int pitch);
+
+Kernel kernel();
+bool   setKernel(Kernel kernel);
+bool   supported(Kernel kernel);
+const char* kernelName(Kernel kernel);
+const char* filterName(Filter filter);
+
+}
+
+#endif //PPU_SCALER_H
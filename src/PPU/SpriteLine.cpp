@@ -0,0 +1,176 @@
+#include "SpriteLine.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+const unsigned int SpriteLine::MAX_SPRITES;
+const unsigned int SpriteLine::WIDTH;
+
+// OAM layout.
+const unsigned int SPRITE_BYTES    = 4;
+const unsigned int Y_BYTE          = 0;
+const unsigned int TILE_BYTE       = 1;
+const unsigned int ATTRIBUTE_BYTE  = 2;
+const unsigned int X_BYTE          = 3;
+
+// PPUCTRL bits that matter for sprites.
+const u8_byte SPRITE_PATTERN_TABLE_MASK = 0x08;
+const u8_byte SPRITE_SIZE_MASK          = 0x20;
+
+const u16_word     PATTERN_TABLE_SIZE = 0x1000;
+const unsigned int SPRITE_PALETTES    = 0x10;
+
+SpriteLine::
+SpriteLine() :
+    m_count (0),
+    m_overflow (false)
+{
+}
+
+void
+SpriteLine::
+evaluate(const u8_byte* oam, unsigned int line, u8_byte control)
+{
+    m_count    = 0;
+    m_overflow = false;
+
+    int height = (control & SPRITE_SIZE_MASK) ? 2 * TileCache::TILE_SIDE : TileCache::TILE_SIDE;
+    for (unsigned int index = 0; index < OAM_SPRITES; ++index) {
+        const u8_byte *entry = oam + index * SPRITE_BYTES;
+        // OAM holds the line above the sprite's top, so nothing shows on line 0.
+        int row = static_cast<int>(line) - 1 - entry[Y_BYTE];
+        if (row < 0 || row >= height) {
+            continue;
+        }
+        if (m_count == MAX_SPRITES) {
+            m_overflow = true;
+            break;
+        }
+
+        Sprite &sprite = m_sprites[m_count++];
+        sprite.m_x          = entry[X_BYTE];
+        sprite.m_attributes = entry[ATTRIBUTE_BYTE];
+        sprite.m_spriteZero = index == 0;
+
+        if (sprite.m_attributes & VERTICAL_FLIP_MASK) {
+            row = height - 1 - row;
+        }
+        u8_byte  tile  = entry[TILE_BYTE];
+        u16_word table = (control & SPRITE_PATTERN_TABLE_MASK) ? PATTERN_TABLE_SIZE : 0;
+        if (height > static_cast<int>(TileCache::TILE_SIDE)) {
+            // 8x16 sprites pick their table with bit 0; the bottom half is the next tile.
+            table = (tile & 0x01) * PATTERN_TABLE_SIZE;
+            tile  = (tile & 0xFE) + (row >= static_cast<int>(TileCache::TILE_SIDE));
+            row  &= TileCache::TILE_SIDE - 1;
+        }
+        sprite.m_rowAddress = table + tile * TileCache::TILE_BYTES + row;
+    }
+}
+
+void
+SpriteLine::
+fetch(const TileCache::DecodedTable* const tables[2])
+{
+    for (unsigned int i = 0; i < m_count; ++i) {
+        Sprite &sprite = m_sprites[i];
+        const TileCache::DecodedTable *table = tables[sprite.m_rowAddress / PATTERN_TABLE_SIZE];
+        u8_byte      tile  = (sprite.m_rowAddress % PATTERN_TABLE_SIZE) / TileCache::TILE_BYTES;
+        unsigned int fineY = sprite.m_rowAddress % TileCache::TILE_SIDE;
+        std::memcpy(sprite.m_pixels, table->row(tile, fineY, sprite.horizontalFlip()), TileCache::TILE_SIDE);
+    }
+}
+
+void
+SpriteLine::
+draw(bool showLeftmost, u8_byte* pixels) const
+{
+    std::fill(pixels, pixels + WIDTH, 0);
+
+    unsigned int firstX = showLeftmost ? 0 : TileCache::TILE_SIDE;
+    // In OAM order, and a sprite only fills pixels nobody has claimed, so the
+    // first opaque pixel wins even if its sprite is behind the background.
+    for (unsigned int i = 0; i < m_count; ++i) {
+        const Sprite &sprite = m_sprites[i];
+        u8_byte base = SPRITE_PALETTES | ((sprite.m_attributes & PALETTE_MASK) << 2);
+        if (sprite.m_attributes & BEHIND_BACKGROUND_MASK) {
+            base |= BEHIND_BACKGROUND;
+        }
+        if (sprite.m_spriteZero) {
+            base |= SPRITE_ZERO;
+        }
+
+        for (unsigned int px = 0; px < TileCache::TILE_SIDE; ++px) {
+            unsigned int x = sprite.m_x + px;
+            if (x >= WIDTH) {
+                break;
+            }
+            u8_byte index = sprite.m_pixels[px];
+            if (index == 0 || x < firstX || pixels[x] != 0) {
+                continue;
+            }
+            pixels[x] = base | index;
+        }
+    }
+}
+
+int
+SpriteLine::
+composite(const u8_byte* background, const u8_byte* sprites, u8_byte* entries)
+{
+    // A sprite pixel shows unless it's behind an opaque background pixel.
+    // Sprite 0 hits where it's opaque over opaque background, except at x 255.
+    int hit = -1;
+#ifdef __SSE2__
+    const __m128i zero       = _mm_setzero_si128();
+    const __m128i colorMask  = _mm_set1_epi8(0x03);
+    const __m128i entryMask  = _mm_set1_epi8(ENTRY_MASK);
+    const __m128i behindMask = _mm_set1_epi8(BEHIND_BACKGROUND);
+    const __m128i spriteZero = _mm_set1_epi8(static_cast<char>(SPRITE_ZERO));
+
+    for (unsigned int x = 0; x < WIDTH; x += 16) {
+        __m128i back   = _mm_loadu_si128(reinterpret_cast<const __m128i*>(background + x));
+        __m128i sprite = _mm_loadu_si128(reinterpret_cast<const __m128i*>(sprites + x));
+
+        __m128i backClear   = _mm_cmpeq_epi8(_mm_and_si128(back, colorMask), zero);
+        __m128i spriteClear = _mm_cmpeq_epi8(sprite, zero);
+        __m128i behind      = _mm_cmpeq_epi8(_mm_and_si128(sprite, behindMask), behindMask);
+        __m128i hidden      = _mm_or_si128(spriteClear, _mm_andnot_si128(backClear, behind));
+
+        __m128i backEntry   = _mm_andnot_si128(backClear, back);
+        __m128i result      = _mm_or_si128(_mm_and_si128(hidden, backEntry),
+                                           _mm_andnot_si128(hidden, _mm_and_si128(sprite, entryMask)));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(entries + x), result);
+
+        if (hit < 0) {
+            __m128i zeroHit = _mm_andnot_si128(backClear,
+                                               _mm_cmpeq_epi8(_mm_and_si128(sprite, spriteZero), spriteZero));
+            int bits = _mm_movemask_epi8(zeroHit);
+            if (x + 16 == WIDTH) {
+                bits &= 0x7FFF;
+            }
+            if (bits != 0) {
+                hit = x + __builtin_ctz(bits);
+            }
+        }
+    }
+#else
+    for (unsigned int x = 0; x < WIDTH; ++x) {
+        bool backOpaque = background[x] & 0x03;
+        u8_byte sprite  = sprites[x];
+        if (sprite != 0 && !(backOpaque && (sprite & BEHIND_BACKGROUND))) {
+            entries[x] = sprite & ENTRY_MASK;
+        }
+        else {
+            entries[x] = backOpaque ? background[x] : 0;
+        }
+        if (hit < 0 && backOpaque && (sprite & SPRITE_ZERO) && x != WIDTH - 1) {
+            hit = x;
+        }
+    }
+#endif
+    return hit;
+}
@@ -0,0 +1,91 @@
+#ifndef PPU_SPRITE_LINE_H
+#define PPU_SPRITE_LINE_H
+
+#include "TileCache.hpp"
+#include "utility/DataTypes.hpp"
+
+/*
+SpriteLine
+
+The sprites on one scanline, and the line buffers they are drawn through.
+
+evaluate() picks the first eight sprites on the line out of OAM, the way the
+PPU does during the line before, into a compact list with the pattern row
+each one shows already worked out (size, table and vertical flip applied).
+Their pixels are then filled in, left to right and horizontally flipped if
+need be, from a TileCache or by whoever has the pattern bytes.
+
+Drawing works on 256 byte line buffers holding palette entries. In the
+background buffer 0 is transparent and the low two bits are the colour
+index; in the sprite buffer 0 is transparent and anything else is a sprite
+palette entry (0x10-0x1F) plus the flags below. composite() merges the two
+in one pass and reports sprite 0 hits on the way.
+
+Shared by the renderer and the PPU, which needs sprite 0 hit and overflow
+on the CPU thread.
+*/
+
+class SpriteLine
+{
+public:
+    static const unsigned int MAX_SPRITES = 8;
+    static const unsigned int OAM_SPRITES = 64;
+    static const unsigned int WIDTH       = 256;
+
+    // OAM attribute byte.
+    static const u8_byte PALETTE_MASK             = 0x03;
+    static const u8_byte BEHIND_BACKGROUND_MASK   = 0x20;
+    static const u8_byte HORIZONTAL_FLIP_MASK     = 0x40;
+    static const u8_byte VERTICAL_FLIP_MASK       = 0x80;
+
+    // Sprite line buffer pixels.
+    static const u8_byte ENTRY_MASK               = 0x1F;
+    static const u8_byte BEHIND_BACKGROUND        = 0x40;
+    static const u8_byte SPRITE_ZERO              = 0x80;
+
+    struct Sprite
+    {
+        u8_byte  m_x;
+        u8_byte  m_attributes;
+        bool     m_spriteZero;
+        // Plane 0 address of the row this sprite shows on the line.
+        u16_word m_rowAddress;
+        // Colour indices left to right, flipped if the sprite is.
+        u8_byte  m_pixels[TileCache::TILE_SIDE];
+
+        bool horizontalFlip() const { return m_attributes & HORIZONTAL_FLIP_MASK; }
+    };
+
+    SpriteLine();
+
+    // Sprites showing on line, given PPUCTRL for their size and pattern
+    // table. Like the PPU, OAM order decides which eight make it.
+    void evaluate(const u8_byte* oam, unsigned int line, u8_byte control);
+
+    unsigned int  count() const { return m_count; }
+    // More than eight sprites wanted the line. The PPU's buggy overflow
+    // search (which misses some and flags some that aren't there) isn't
+    // reproduced.
+    bool          overflow() const { return m_overflow; }
+    bool          hasSpriteZero() const { return m_count > 0 && m_sprites[0].m_spriteZero; }
+    Sprite&       sprite(unsigned int index)       { return m_sprites[index]; }
+    const Sprite& sprite(unsigned int index) const { return m_sprites[index]; }
+
+    // Fills in the sprites' pixels from decoded pattern tables.
+    void fetch(const TileCache::DecodedTable* const tables[2]);
+
+    // Draws the sprites into a sprite line buffer, clearing it first.
+    // showLeftmost is PPUMASK's "show sprites in leftmost 8 pixels".
+    void draw(bool showLeftmost, u8_byte* pixels) const;
+
+    // Merges the background and sprite line buffers into palette entries
+    // (0 for the backdrop). Returns the x of the first sprite 0 hit, or -1.
+    static int composite(const u8_byte* background, const u8_byte* sprites, u8_byte* entries);
+
+private:
+    Sprite       m_sprites[MAX_SPRITES];
+    unsigned int m_count;
+    bool         m_overflow;
+};
+
+#endif //PPU_SPRITE_LINE_H
@@ -0,0 +1,176 @@
+#include "TileCache.hpp"
+#include "TileDecode.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+
+const unsigned int TileCache::TILES_PER_TABLE;
+const unsigned int TileCache::SLOTS;
+
+TileCache::
+TileCache() :
+    m_slots (SLOTS),
+    m_clock (0)
+{
+    clear();
+}
+
+void
+TileCache::
+clear()
+{
+    for (Slot &slot : m_slots) {
+        slot.m_hash      = 0;
+        slot.m_hashValid = false;
+        slot.m_used      = false;
+        slot.m_lastUse   = 0;
+    }
+    m_stats.m_hits         = 0;
+    m_stats.m_misses       = 0;
+    m_stats.m_tilesDecoded = 0;
+}
+
+void
+TileCache::
+decodeTile(const u8_byte* tile, u8_byte* pixels)
+{
+    TileDecode::decodeTiles(tile, 1, pixels);
+}
+
+void
+TileCache::
+decode(DecodedTable& table, const u8_byte* patterns, unsigned int first, unsigned int count)
+{
+    for (unsigned int flip = 0; flip < 2; ++flip) {
+        TileDecode::decodeTiles(patterns + first * TILE_BYTES, count,
+                                table.m_pixels[flip] + first * TILE_PIXELS, flip);
+    }
+}
+
+std::uint64_t
+TileCache::
+hash(const u8_byte* patterns)
+{
+    // FNV-1a a word at a time; it only has to tell banks apart, a match is
+    // confirmed byte for byte.
+    std::uint64_t result = 0xcbf29ce484222325ULL;
+    for (unsigned int offset = 0; offset < TABLE_BYTES; offset += sizeof(std::uint64_t)) {
+        std::uint64_t word;
+        std::memcpy(&word, patterns + offset, sizeof(word));
+        result = (result ^ word) * 0x100000001b3ULL;
+    }
+    return result;
+}
+
+const TileCache::DecodedTable*
+TileCache::
+lookup(const u8_byte* patterns, const DecodedTable* keep)
+{
+    std::uint64_t patternHash = hash(patterns);
+    for (Slot &slot : m_slots) {
+        if (!slot.m_used) {
+            continue;
+        }
+        if (!slot.m_hashValid) {
+            slot.m_hash      = hash(slot.m_patterns);
+            slot.m_hashValid = true;
+        }
+        if (slot.m_hash == patternHash &&
+            std::memcmp(slot.m_patterns, patterns, TABLE_BYTES) == 0) {
+            slot.m_lastUse = ++m_clock;
+            ++m_stats.m_hits;
+            return &slot.m_decoded;
+        }
+    }
+
+    ++m_stats.m_misses;
+    Slot &slot = *victim(keep);
+    refill(slot, patterns, patternHash);
+    return &slot.m_decoded;
+}
+
+const TileCache::DecodedTable*
+TileCache::
+update(const DecodedTable* table, const u8_byte* patterns,
+       unsigned int tile, const DecodedTable* keep)
+{
+    assert(tile < TILES_PER_TABLE && "TileCache::update: no such tile!");
+    if (table == keep) {
+        return lookup(patterns, keep);
+    }
+
+    Slot *slot = slotFor(table);
+    assert(slot != nullptr && "TileCache::update: table isn't from this cache!");
+
+    unsigned int offset = tile * TILE_BYTES;
+    std::copy(patterns + offset, patterns + offset + TILE_BYTES, slot->m_patterns + offset);
+    decode(slot->m_decoded, slot->m_patterns, tile, 1);
+    ++m_stats.m_tilesDecoded;
+    slot->m_hashValid = false;
+    slot->m_lastUse   = ++m_clock;
+    return table;
+}
+
+TileCache::Slot*
+TileCache::
+slotFor(const DecodedTable* table)
+{
+    for (Slot &slot : m_slots) {
+        if (&slot.m_decoded == table) {
+            return &slot;
+        }
+    }
+    return nullptr;
+}
+
+TileCache::Slot*
+TileCache::
+victim(const DecodedTable* keep)
+{
+    Slot *oldest = nullptr;
+    for (Slot &slot : m_slots) {
+        if (&slot.m_decoded == keep) {
+            continue;
+        }
+        if (!slot.m_used) {
+            return &slot;
+        }
+        if (oldest == nullptr || slot.m_lastUse < oldest->m_lastUse) {
+            oldest = &slot;
+        }
+    }
+    assert(oldest != nullptr);
+    return oldest;
+}
+
+void
+TileCache::
+refill(Slot& slot, const u8_byte* patterns, std::uint64_t patternHash)
+{
+    // Only tiles that changed need decoding again. Banks usually share a lot
+    // (CHR RAM between frames, say), so this is often a handful of tiles.
+    // Runs of changed tiles are decoded in one go.
+    unsigned int tile = 0;
+    while (tile < TILES_PER_TABLE) {
+        unsigned int first = tile;
+        while (tile < TILES_PER_TABLE &&
+               (!slot.m_used || std::memcmp(slot.m_patterns + tile * TILE_BYTES,
+                                            patterns + tile * TILE_BYTES, TILE_BYTES) != 0)) {
+            ++tile;
+        }
+        if (tile > first) {
+            std::copy(patterns + first * TILE_BYTES, patterns + tile * TILE_BYTES,
+                      slot.m_patterns + first * TILE_BYTES);
+            decode(slot.m_decoded, slot.m_patterns, first, tile - first);
+            m_stats.m_tilesDecoded += tile - first;
+        }
+        else {
+            ++tile;
+        }
+    }
+    slot.m_hash      = patternHash;
+    slot.m_hashValid = true;
+    slot.m_used      = true;
+    slot.m_lastUse   = ++m_clock;
+}
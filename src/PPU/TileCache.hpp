@@ -0,0 +1,97 @@
+#ifndef PPU_TILE_CACHE_H
+#define PPU_TILE_CACHE_H
+
+#include "utility/DataTypes.hpp"
+
+#include <cstdint>
+#include <vector>
+
+/*
+TileCache
+
+Pattern tables decoded ahead of time, so drawing a row of a tile is one
+lookup instead of sixteen bit plane extractions per pixel. Each 4k pattern
+table is decoded into 256 tiles of 8x8 colour indices (0-3), row-major, and
+again mirrored left to right for horizontally flipped sprites.
+
+Tables are found by content: CHR bank switches that bring back a bank seen
+before get its decoded copy straight back, only the pointer changes. When a
+table isn't cached the least recently used slot is refilled, re-decoding just
+the 16 byte tiles that differ from what it held, and CHR RAM writes re-decode
+the one tile they touch.
+
+Not thread safe. Decoded tables may be read from any thread as long as
+nothing calls into the cache meanwhile.
+*/
+
+class TileCache
+{
+public:
+    static const unsigned int TILE_SIDE       = 8;
+    static const unsigned int TILE_PIXELS     = TILE_SIDE * TILE_SIDE;
+    static const unsigned int TILE_BYTES      = 16;
+    static const unsigned int TABLE_BYTES     = 0x1000;
+    static const unsigned int TILES_PER_TABLE = TABLE_BYTES / TILE_BYTES;
+    // Enough for a game flipping between a handful of banks per half.
+    static const unsigned int SLOTS           = 16;
+
+    struct DecodedTable
+    {
+        // The 8 colour indices of one row of a tile, left to right.
+        const u8_byte* row(u8_byte tile, unsigned int fineY, bool flip = false) const {
+            return &m_pixels[flip][tile * TILE_PIXELS + fineY * TILE_SIDE];
+        }
+
+        u8_byte m_pixels[2][TILES_PER_TABLE * TILE_PIXELS];
+    };
+
+    TileCache();
+
+    // The decoded form of TABLE_BYTES of pattern data. Never evicts keep.
+    const DecodedTable* lookup(const u8_byte* patterns, const DecodedTable* keep = nullptr);
+
+    // table's tile was rewritten; patterns is the table's new content. If
+    // table is also keep (both halves showing the same bank) it's left alone
+    // and a different table is returned.
+    const DecodedTable* update(const DecodedTable* table, const u8_byte* patterns,
+                               unsigned int tile, const DecodedTable* keep = nullptr);
+
+    void clear();
+
+    struct Statistics
+    {
+        unsigned long m_hits;
+        unsigned long m_misses;
+        unsigned long m_tilesDecoded;
+    };
+    const Statistics& statistics() const { return m_stats; }
+
+    static void decodeTile(const u8_byte* tile, u8_byte* pixels);
+
+private:
+    // Decodes count tiles from first on, both ways round.
+    static void decode(DecodedTable& table, const u8_byte* patterns,
+                       unsigned int first, unsigned int count);
+
+    struct Slot
+    {
+        DecodedTable  m_decoded;
+        u8_byte       m_patterns[TABLE_BYTES];
+        std::uint64_t m_hash;
+        bool          m_hashValid;
+        bool          m_used;
+        unsigned long m_lastUse;
+    };
+
+    static std::uint64_t hash(const u8_byte* patterns);
+
+    Slot* slotFor(const DecodedTable* table);
+    Slot* victim(const DecodedTable* keep);
+    void  refill(Slot& slot, const u8_byte* patterns, std::uint64_t patternHash);
+
+    std::vector<Slot> m_slots;
+    unsigned long     m_clock;
+    Statistics        m_stats;
+};
+
+#endif //PPU_TILE_CACHE_H
@@ -0,0 +1,205 @@
+#include "TileDecode.hpp"
+
+#include "utility/KernelDispatch.hpp"
+
+#include <cassert>
+#include <cstdint>
+#include <cstring>
+
+namespace TileDecode
+{
+
+static const unsigned int TILE_SIDE   = 8;
+static const unsigned int TILE_BYTES  = 16;
+static const unsigned int TILE_PIXELS = TILE_SIDE * TILE_SIDE;
+
+void
+decodeRow(u8_byte plane0, u8_byte plane1, u8_byte* pixels, bool flip)
+{
+    for (unsigned int x = 0; x < TILE_SIDE; ++x) {
+        unsigned int shift = flip ? x : TILE_SIDE - 1 - x;
+        pixels[x] = ((plane0 >> shift) & 0x01) | (((plane1 >> shift) & 0x01) << 1);
+    }
+}
+
+static void
+decodeScalar(const u8_byte* patterns, unsigned int count, u8_byte* pixels, bool flip)
+{
+    for (unsigned int tile = 0; tile < count; ++tile) {
+        const u8_byte *planes = patterns + tile * TILE_BYTES;
+        u8_byte *out = pixels + tile * TILE_PIXELS;
+        for (unsigned int y = 0; y < TILE_SIDE; ++y) {
+            decodeRow(planes[y], planes[y + TILE_SIDE], out + y * TILE_SIDE, flip);
+        }
+    }
+}
+
+#ifdef KERNEL_DISPATCH_X86
+
+// Both vector kernels copy each plane byte across the 8 bytes of its row,
+// keep one bit per byte with a mask (0x80, 0x40, ... or reversed to flip) and
+// compare to turn that into 0x00/0xFF, then take bit 0 from plane 0 and bit 1
+// from plane 1.
+
+__attribute__((target("sse2")))
+static inline __m128i
+pixelsSSE2(__m128i rows0, __m128i rows1, __m128i mask)
+{
+    __m128i low  = _mm_cmpeq_epi8(_mm_and_si128(rows0, mask), mask);
+    __m128i high = _mm_cmpeq_epi8(_mm_and_si128(rows1, mask), mask);
+    return _mm_or_si128(_mm_and_si128(low,  _mm_set1_epi8(0x01)),
+                        _mm_and_si128(high, _mm_set1_epi8(0x02)));
+}
+
+__attribute__((target("sse2")))
+static void
+decodeSSE2(const u8_byte* patterns, unsigned int count, u8_byte* pixels, bool flip)
+{
+    const __m128i mask = flip ?
+        _mm_setr_epi8(0x01, 0x02, 0x04, 0x08, 0x10, 0x20, 0x40, char(0x80),
+                      0x01, 0x02, 0x04, 0x08, 0x10, 0x20, 0x40, char(0x80)) :
+        _mm_setr_epi8(char(0x80), 0x40, 0x20, 0x10, 0x08, 0x04, 0x02, 0x01,
+                      char(0x80), 0x40, 0x20, 0x10, 0x08, 0x04, 0x02, 0x01);
+
+    for (unsigned int tile = 0; tile < count; ++tile) {
+        const u8_byte *planes = patterns + tile * TILE_BYTES;
+        u8_byte *out = pixels + tile * TILE_PIXELS;
+
+        // Widen each row byte to 8 copies: 2, then 4, then 8 at a time.
+        __m128i plane0 = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(planes));
+        __m128i plane1 = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(planes + TILE_SIDE));
+        plane0 = _mm_unpacklo_epi8(plane0, plane0);
+        plane1 = _mm_unpacklo_epi8(plane1, plane1);
+        __m128i top0    = _mm_unpacklo_epi16(plane0, plane0);
+        __m128i bottom0 = _mm_unpackhi_epi16(plane0, plane0);
+        __m128i top1    = _mm_unpacklo_epi16(plane1, plane1);
+        __m128i bottom1 = _mm_unpackhi_epi16(plane1, plane1);
+
+        __m128i *row = reinterpret_cast<__m128i*>(out);
+        _mm_storeu_si128(row + 0, pixelsSSE2(_mm_unpacklo_epi32(top0, top0),
+                                             _mm_unpacklo_epi32(top1, top1), mask));
+        _mm_storeu_si128(row + 1, pixelsSSE2(_mm_unpackhi_epi32(top0, top0),
+                                             _mm_unpackhi_epi32(top1, top1), mask));
+        _mm_storeu_si128(row + 2, pixelsSSE2(_mm_unpacklo_epi32(bottom0, bottom0),
+                                             _mm_unpacklo_epi32(bottom1, bottom1), mask));
+        _mm_storeu_si128(row + 3, pixelsSSE2(_mm_unpackhi_epi32(bottom0, bottom0),
+                                             _mm_unpackhi_epi32(bottom1, bottom1), mask));
+    }
+}
+
+__attribute__((target("avx2")))
+static inline __m256i
+pixelsAVX2(__m256i rows0, __m256i rows1, __m256i mask)
+{
+    __m256i low  = _mm256_cmpeq_epi8(_mm256_and_si256(rows0, mask), mask);
+    __m256i high = _mm256_cmpeq_epi8(_mm256_and_si256(rows1, mask), mask);
+    return _mm256_or_si256(_mm256_and_si256(low,  _mm256_set1_epi8(0x01)),
+                           _mm256_and_si256(high, _mm256_set1_epi8(0x02)));
+}
+
+__attribute__((target("avx2")))
+static void
+decodeAVX2(const u8_byte* patterns, unsigned int count, u8_byte* pixels, bool flip)
+{
+    const __m256i mask = flip ?
+        _mm256_set1_epi64x(static_cast<long long>(0x8040201008040201ULL)) :
+        _mm256_set1_epi64x(0x0102040810204080LL);
+    // Shuffles work within each 128 bit lane, so with the 8 row bytes in both
+    // lanes one shuffle spreads rows 0-3 (or 4-7) over a register.
+    const __m256i top = _mm256_setr_epi8(0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 1, 1, 1, 1,
+                                         2, 2, 2, 2, 2, 2, 2, 2, 3, 3, 3, 3, 3, 3, 3, 3);
+    const __m256i bottom = _mm256_setr_epi8(4, 4, 4, 4, 4, 4, 4, 4, 5, 5, 5, 5, 5, 5, 5, 5,
+                                            6, 6, 6, 6, 6, 6, 6, 6, 7, 7, 7, 7, 7, 7, 7, 7);
+
+    for (unsigned int tile = 0; tile < count; ++tile) {
+        const u8_byte *planes = patterns + tile * TILE_BYTES;
+        u8_byte *out = pixels + tile * TILE_PIXELS;
+
+        std::int64_t row0, row1;
+        std::memcpy(&row0, planes, sizeof(row0));
+        std::memcpy(&row1, planes + TILE_SIDE, sizeof(row1));
+        __m256i plane0 = _mm256_set1_epi64x(row0);
+        __m256i plane1 = _mm256_set1_epi64x(row1);
+
+        __m256i *rows = reinterpret_cast<__m256i*>(out);
+        _mm256_storeu_si256(rows + 0, pixelsAVX2(_mm256_shuffle_epi8(plane0, top),
+                                                 _mm256_shuffle_epi8(plane1, top), mask));
+        _mm256_storeu_si256(rows + 1, pixelsAVX2(_mm256_shuffle_epi8(plane0, bottom),
+                                                 _mm256_shuffle_epi8(plane1, bottom), mask));
+    }
+}
+
+#ifdef __x86_64__
+__attribute__((target("bmi2")))
+static void
+decodeBMI2(const u8_byte* patterns, unsigned int count, u8_byte* pixels, bool flip)
+{
+    // PDEP puts plane bit n in byte n, which is the flipped order; a byte swap
+    // puts it the right way round. Fast on Intel and Zen 3 on, but microcoded
+    // (and far slower than the vector kernels) on earlier AMD parts.
+    for (unsigned int tile = 0; tile < count; ++tile) {
+        const u8_byte *planes = patterns + tile * TILE_BYTES;
+        u8_byte *out = pixels + tile * TILE_PIXELS;
+        for (unsigned int y = 0; y < TILE_SIDE; ++y) {
+            std::uint64_t row = _pdep_u64(planes[y],             0x0101010101010101ULL) |
+                                _pdep_u64(planes[y + TILE_SIDE], 0x0202020202020202ULL);
+            if (!flip) {
+                row = __builtin_bswap64(row);
+            }
+            std::memcpy(out + y * TILE_SIDE, &row, sizeof(row));
+        }
+    }
+}
+#endif
+
+#endif // KERNEL_DISPATCH_X86
+
+typedef void (*DecodeFunction)(const u8_byte*, unsigned int, u8_byte*, bool);
+
+static const KernelDispatch::Entry<DecodeFunction> KERNELS[KERNEL_COUNT] = {
+    { "scalar", KernelDispatch::NONE, decodeScalar },
+    { "sse2",   KernelDispatch::SSE2, KERNEL_DISPATCH_VECTOR(decodeSSE2, decodeScalar) },
+    { "avx2",   KernelDispatch::AVX2, KERNEL_DISPATCH_VECTOR(decodeAVX2, decodeScalar) },
+    { "bmi2",   KernelDispatch::BMI2, KERNEL_DISPATCH_VECTOR64(decodeBMI2, decodeScalar) }
+};
+
+// Best first. BMI2 isn't picked on its own: where PDEP is fast it's no quicker
+// than AVX2, which every CPU with BMI2 also has.
+static KernelDispatch::Dispatcher<Kernel, DecodeFunction, KERNEL_COUNT>&
+dispatcher()
+{
+    static KernelDispatch::Dispatcher<Kernel, DecodeFunction, KERNEL_COUNT> kernels(KERNELS, { AVX2, SSE2 });
+    return kernels;
+}
+
+void
+decodeTiles(const u8_byte* patterns, unsigned int count, u8_byte* pixels, bool flip)
+{
+    dispatcher().functions()(patterns, count, pixels, flip);
+}
+
+Kernel
+kernel()
+{
+    return dispatcher().current();
+}
+
+bool
+setKernel(Kernel kernel)
+{
+    return dispatcher().select(kernel);
+}
+
+bool
+supported(Kernel kernel)
+{
+    return dispatcher().supported(kernel);
+}
+
+const char*
+kernelName(Kernel kernel)
+{
+    return dispatcher().name(kernel);
+}
+
+}
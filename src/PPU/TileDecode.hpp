@@ -0,0 +1,47 @@
+#ifndef PPU_TILE_DECODE_H
+#define PPU_TILE_DECODE_H
+
+#include "utility/DataTypes.hpp"
+
+/*
+TileDecode
+
+Turns pattern data into pixels. A tile is 16 bytes: 8 rows of plane 0 (bit 0
+of each pixel) followed by 8 rows of plane 1 (bit 1), leftmost pixel in the
+most significant bit. Decoded tiles are 64 colour indices (0-3), row-major,
+optionally mirrored left to right the way sprites flip.
+
+Several kernels do the same job; the fastest one the CPU supports is picked
+the first time anything is decoded. decodeRow is the plain reference the
+others are tested against.
+*/
+
+namespace TileDecode
+{
+
+enum Kernel
+{
+    SCALAR = 0,
+    SSE2,       // Compare against per-pixel bit masks, 16 pixels at a time.
+    AVX2,       // Same again, 32 at a time.
+    BMI2,       // PDEP scatters a plane's bits straight into a row's bytes.
+    KERNEL_COUNT
+};
+
+// One row of 8 pixels from its two plane bytes.
+void decodeRow(u8_byte plane0, u8_byte plane1, u8_byte* pixels, bool flip = false);
+
+// count whole tiles, 16 bytes in and 64 pixels out each.
+void decodeTiles(const u8_byte* patterns, unsigned int count, u8_byte* pixels, bool flip = false);
+
+// The kernel decodeTiles uses, and a way to force one (for tests and
+// benchmarks). Choosing a kernel the CPU can't run returns false. Don't
+// switch while another thread is decoding.
+Kernel kernel();
+bool   setKernel(Kernel kernel);
+bool   supported(Kernel kernel);
+const char* kernelName(Kernel kernel);
+
+}
+
+#endif //PPU_TILE_DECODE_H
@@ -0,0 +1,164 @@
+#include "VideoMemory.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+
+const unsigned int VideoMemory::SIZE;
+const unsigned int VideoMemory::PAGE_SIZE;
+const unsigned int VideoMemory::PATTERN_PAGES;
+const unsigned int VideoMemory::NAMETABLES;
+const unsigned int VideoMemory::PALETTE_SIZE;
+const unsigned int VideoMemory::MAX_ALIASES;
+const u16_word     VideoMemory::NAMETABLE_ADDRESS;
+const u16_word     VideoMemory::PALETTE_ADDRESS;
+
+// The first page of the nametables, and of their mirror at $3000.
+const unsigned int NAMETABLE_PAGE = VideoMemory::NAMETABLE_ADDRESS / VideoMemory::PAGE_SIZE;
+const unsigned int MIRROR_PAGE    = NAMETABLE_PAGE + VideoMemory::NAMETABLES;
+
+VideoMemory::
+VideoMemory() :
+    m_mirroring (HorizontalMirroring)
+{
+    clear();
+    for (unsigned int page = 0; page < PATTERN_PAGES; ++page) {
+        mapPatterns(page, nullptr, true);
+    }
+    mapNametables();
+}
+
+void
+VideoMemory::
+mapPatterns(unsigned int page, u8_byte* data, bool writable)
+{
+    assert(page < PATTERN_PAGES && "VideoMemory::mapPatterns: not a pattern page!");
+    if (data == nullptr) {
+        data     = m_chrRam + page * PAGE_SIZE;
+        writable = true;
+    }
+    m_pages[page]    = data;
+    m_writable[page] = writable;
+}
+
+const u8_byte*
+VideoMemory::
+patternPage(unsigned int page) const
+{
+    assert(page < PATTERN_PAGES && "VideoMemory::patternPage: not a pattern page!");
+    return m_pages[page];
+}
+
+void
+VideoMemory::
+setMirroring(Mirroring mirroring)
+{
+    m_mirroring = mirroring;
+    mapNametables();
+}
+
+unsigned int
+VideoMemory::
+nametablePage(unsigned int nametable) const
+{
+    switch (m_mirroring) {
+        case HorizontalMirroring:
+            return nametable / 2;
+        case VerticalMirroring:
+            return nametable % 2;
+        case SingleScreenLower:
+            return 0;
+        case SingleScreenUpper:
+            return 1;
+        case FourScreenMirroring:
+            return nametable;
+    }
+    assert(false && "VideoMemory::nametablePage: unknown mirroring!");
+    return 0;
+}
+
+void
+VideoMemory::
+mapNametables()
+{
+    for (unsigned int nametable = 0; nametable < NAMETABLES; ++nametable) {
+        u8_byte *page = m_ciram + nametablePage(nametable) * PAGE_SIZE;
+        m_pages[NAMETABLE_PAGE + nametable]    = page;
+        m_pages[MIRROR_PAGE + nametable]       = page;
+        m_writable[NAMETABLE_PAGE + nametable] = true;
+        m_writable[MIRROR_PAGE + nametable]    = true;
+    }
+}
+
+bool
+VideoMemory::
+write(u16_word address, u8_byte data)
+{
+    address &= SIZE - 1;
+    if (address >= PALETTE_ADDRESS) {
+        m_palette[paletteIndex(address)] = data;
+        return true;
+    }
+    unsigned int page = address / PAGE_SIZE;
+    if (!m_writable[page]) {
+        return false;
+    }
+    m_pages[page][address % PAGE_SIZE] = data;
+    return true;
+}
+
+void
+VideoMemory::
+clear()
+{
+    std::fill(m_chrRam, m_chrRam + CHR_SIZE, 0x00);
+    std::fill(m_ciram, m_ciram + CIRAM_SIZE, 0x00);
+    std::fill(m_palette, m_palette + PALETTE_SIZE, 0x00);
+}
+
+void
+VideoMemory::
+copyTo(u8_byte* vram) const
+{
+    // Everything up to the palette is whole pages.
+    for (unsigned int page = 0; page < PALETTE_ADDRESS / PAGE_SIZE; ++page) {
+        std::memcpy(vram + page * PAGE_SIZE, m_pages[page], PAGE_SIZE);
+    }
+    u16_word last = PALETTE_ADDRESS & ~(PAGE_SIZE - 1);
+    std::memcpy(vram + last, m_pages[last / PAGE_SIZE], PALETTE_ADDRESS - last);
+    for (unsigned int address = PALETTE_ADDRESS; address < SIZE; ++address) {
+        vram[address] = m_palette[paletteIndex(address)];
+    }
+}
+
+unsigned int
+VideoMemory::
+aliases(u16_word address, u16_word* aliases) const
+{
+    address &= SIZE - 1;
+    if (address >= PALETTE_ADDRESS) {
+        unsigned int index = paletteIndex(address);
+        aliases[0] = PALETTE_ADDRESS + index;
+        if ((index & 0x03) == 0 && index < 0x10) {
+            aliases[1] = PALETTE_ADDRESS + 0x10 + index;
+            return 2;
+        }
+        return 1;
+    }
+
+    unsigned int page = address / PAGE_SIZE;
+    if (page < NAMETABLE_PAGE) {
+        aliases[0] = address;
+        return 1;
+    }
+
+    // Any nametable sharing the CIRAM page, at the same offset.
+    unsigned int count = 0;
+    const u8_byte *target = m_pages[page];
+    for (unsigned int nametable = 0; nametable < NAMETABLES; ++nametable) {
+        if (m_pages[NAMETABLE_PAGE + nametable] == target) {
+            aliases[count++] = NAMETABLE_ADDRESS + nametable * PAGE_SIZE + address % PAGE_SIZE;
+        }
+    }
+    return count;
+}
@@ -0,0 +1,106 @@
+#ifndef PPU_VIDEO_MEMORY_H
+#define PPU_VIDEO_MEMORY_H
+
+#include "utility/DataTypes.hpp"
+
+/*
+VideoMemory
+
+The PPU's 16K address space, as a table of 1K pages over the memory that's
+really there rather than 16K of its own:
+
+  $0000-$1FFF  pattern tables, eight pages pointing into the cartridge's CHR
+               ROM or RAM (or our own 8K of CHR RAM if there's no cartridge).
+  $2000-$2FFF  four nametables, each one of the console's two 1K CIRAM pages
+               as the mirroring says; four screen carts bring another 2K.
+  $3000-$3EFF  the nametables again.
+  $3F00-$3FFF  32 bytes of palette RAM, repeated. $3F10, $3F14, $3F18 and
+               $3F1C are the same bytes as $3F00, $3F04, $3F08 and $3F0C.
+
+Reads and writes are a table lookup and a pointer access. The renderer
+works on a flat copy (see RenderState); copyTo() makes one, and aliases()
+lists the places in it a write shows up.
+*/
+
+class VideoMemory
+{
+public:
+    static const unsigned int SIZE          = 0x4000;
+    static const unsigned int PAGE_SIZE     = 0x400;
+    static const unsigned int PATTERN_PAGES = 8;
+    static const unsigned int NAMETABLES    = 4;
+    static const unsigned int PALETTE_SIZE  = 0x20;
+    // Most places one byte can show up in a flat copy: single screen.
+    static const unsigned int MAX_ALIASES   = NAMETABLES;
+
+    static const u16_word NAMETABLE_ADDRESS = 0x2000;
+    static const u16_word PALETTE_ADDRESS   = 0x3F00;
+
+    // Named after the copies, as in the iNES header: horizontal mirroring
+    // makes $2000 and $2400 the same nametable.
+    enum Mirroring {
+        HorizontalMirroring = 0,
+        VerticalMirroring,
+        SingleScreenLower,      // All four are CIRAM's first page...
+        SingleScreenUpper,      // ...or its second.
+        FourScreenMirroring
+    };
+
+    VideoMemory();
+
+    // Pattern page page ($0000 + page * PAGE_SIZE) reads PAGE_SIZE bytes
+    // from data, and writes to it too if writable (CHR RAM). A null data
+    // puts our own CHR RAM back.
+    void mapPatterns(unsigned int page, u8_byte* data, bool writable);
+    const u8_byte* patternPage(unsigned int page) const;
+
+    void      setMirroring(Mirroring mirroring);
+    Mirroring mirroring() const { return m_mirroring; }
+
+    u8_byte read(u16_word address) const {
+        address &= SIZE - 1;
+        if (address >= PALETTE_ADDRESS) {
+            return m_palette[paletteIndex(address)];
+        }
+        return m_pages[address / PAGE_SIZE][address % PAGE_SIZE];
+    }
+
+    // False if nothing changed because address is CHR ROM.
+    bool write(u16_word address, u8_byte data);
+
+    // All of it back to zero, CHR RAM included.
+    void clear();
+
+    // The whole space as SIZE flat bytes, mirrors filled in.
+    void copyTo(u8_byte* vram) const;
+    // Every address below $3000 or in $3F00-$3F1F holding the same byte as
+    // address, i.e. where a write to it lands in a flat copy. Returns how
+    // many were put in aliases.
+    unsigned int aliases(u16_word address, u16_word* aliases) const;
+
+private:
+    static const unsigned int PAGES     = SIZE / PAGE_SIZE;
+    static const unsigned int CHR_SIZE  = PATTERN_PAGES * PAGE_SIZE;
+    static const unsigned int CIRAM_SIZE = NAMETABLES * PAGE_SIZE;
+
+    static unsigned int paletteIndex(u16_word address) {
+        unsigned int index = address % PALETTE_SIZE;
+        // Sprite palettes' colour 0 is the background's.
+        return (index & 0x13) == 0x10 ? index & 0x0F : index;
+    }
+
+    // The CIRAM page nametable (0-3) is under the current mirroring.
+    unsigned int nametablePage(unsigned int nametable) const;
+    void         mapNametables();
+
+    u8_byte*  m_pages[PAGES];
+    bool      m_writable[PAGES];
+    Mirroring m_mirroring;
+
+    u8_byte   m_chrRam[CHR_SIZE];
+    // Two pages on the console, the other two only used by four screen carts.
+    u8_byte   m_ciram[CIRAM_SIZE];
+    u8_byte   m_palette[PALETTE_SIZE];
+};
+
+#endif //PPU_VIDEO_MEMORY_H
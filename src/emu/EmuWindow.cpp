@@ -9,7 +9,8 @@ EmuWindow(const char * name,
           const char * title,
           unsigned int x, unsigned int y, 
           unsigned int width, unsigned int height) :
-    Commandable(std::string(name))
+    Commandable(std::string(name)),
+    m_pendingVisibility (UNCHANGED)
 {
     registerCommands();
     m_sdl_window   = SDL_CreateWindow(title,
@@ -31,6 +32,20 @@ id()
     return SDL_GetWindowID(m_sdl_window);
 }
 
+void
+EmuWindow::
+updateVisibility()
+{
+    switch (m_pendingVisibility.exchange(UNCHANGED)) {
+        case SHOW:
+            SDL_ShowWindow(m_sdl_window);
+            break;
+        case HIDE:
+            SDL_HideWindow(m_sdl_window);
+            break;
+    }
+}
+
 void
 EmuWindow::
 registerCommands()
@@ -59,13 +74,13 @@ receiveCommand(CommandInput command)
     switch (command.m_code) {
         case SHOW_WINDOW_COMMAND:
             {
-                SDL_ShowWindow(m_sdl_window);
+                m_pendingVisibility = SHOW;
                 result.m_code = CommandResult::ResultCode::OK;
             }
            break; 
         case HIDE_WINDOW_COMMAND:
            {
-                SDL_HideWindow(m_sdl_window);
+                m_pendingVisibility = HIDE;
                 result.m_code = CommandResult::ResultCode::OK;
            }
            break;
@@ -5,6 +5,7 @@
 
 #include "utility/Commandable.hpp"
 
+#include <atomic>
 #include <cassert>
 
 class EmuWindow : public Commandable {
@@ -20,6 +21,10 @@ class EmuWindow : public Commandable {
 
         unsigned int id();
 
+        // show/hide arrive on the emulation thread, but SDL windows may only
+        // be touched from the UI thread. They're applied here instead.
+        void updateVisibility();
+
         // Commandable interface.
         static const CommandCode SHOW_WINDOW_COMMAND;
         static const CommandCode HIDE_WINDOW_COMMAND;
@@ -31,6 +36,10 @@ class EmuWindow : public Commandable {
         void registerCommands();
 
         SDL_Window*     m_sdl_window;
+
+    private:
+        enum Visibility { UNCHANGED, SHOW, HIDE };
+        std::atomic<int> m_pendingVisibility;
 };
 
 class DiagnosticWindow : public EmuWindow {
@@ -0,0 +1,124 @@
+#include "EmulationThread.hpp"
+
+#include <algorithm>
+
+EmulationThread::
+EmulationThread(NES &nes) :
+    m_nes (nes),
+    m_thread (),
+    m_stopRequested (false),
+    m_framesPublished (0),
+    m_frames (),
+    m_commands (),
+    m_capture ()
+{
+}
+
+EmulationThread::
+~EmulationThread()
+{
+    stop();
+}
+
+void
+EmulationThread::
+start()
+{
+    if (running()) {
+        return;
+    }
+    // With a thread of our own to spare for it, draw frames on yet another
+    // one while we emulate the next.
+    m_nes.ppu().setRenderMode(RenderPipeline::PipelinedMode);
+
+    m_stopRequested = false;
+    m_thread = std::thread(&EmulationThread::run, this);
+}
+
+void
+EmulationThread::
+stop()
+{
+    m_stopRequested = true;
+    if (m_thread.joinable()) {
+        m_thread.join();
+    }
+    m_capture.stop();
+}
+
+bool
+EmulationThread::
+running() const
+{
+    return m_thread.joinable();
+}
+
+TripleBuffer<EmulationThread::VideoFrame>&
+EmulationThread::
+frames()
+{
+    return m_frames;
+}
+
+CommandChannel&
+EmulationThread::
+commands()
+{
+    return m_commands;
+}
+
+FrameCapture&
+EmulationThread::
+capture()
+{
+    return m_capture;
+}
+
+void
+EmulationThread::
+run()
+{
+    while (!m_stopRequested) {
+        // Between frames nothing is mid-flight, so this is where commands
+        // (load, reset, register pokes, ...) get to touch the machine.
+        m_commands.process(*CommandDispatcher::instance());
+
+        // runFrame() paces itself, even while paused, so this never spins.
+        bool ran = m_nes.runFrame();
+
+        // Turbo mode skips output on most frames; there's nothing new to show
+        // for those. While paused we keep publishing so the UI sees changes
+        // made through the console.
+        if (!ran || m_nes.frameRendered()) {
+            publishFrame();
+        }
+        // Only new pictures are recorded, not the same one again while paused.
+        if (ran && m_nes.frameRendered()) {
+            m_capture.capture(m_nes.ppu().displayBuffer());
+        }
+    }
+}
+
+void
+EmulationThread::
+publishFrame()
+{
+    VideoFrame &frame = m_frames.back();
+
+    frame.m_picture     = m_nes.ppu().displayBuffer();
+    frame.m_frameNumber = m_framesPublished++;
+
+    const Cpu65XX &cpu = m_nes.cpu();
+    frame.m_state.m_A  = cpu.A();
+    frame.m_state.m_X  = cpu.X();
+    frame.m_state.m_Y  = cpu.Y();
+    frame.m_state.m_S  = cpu.S();
+    frame.m_state.m_PC = cpu.PC();
+
+    const PPUInspector &inspector = m_nes.ppuInspector();
+    for (unsigned int i = 0; i < PPUInspector::FIELD_COUNT; ++i) {
+        frame.m_state.m_ppuRegisters[i] = inspector.read(static_cast<PPUInspector::Field>(i));
+    }
+
+    m_frames.publish();
+}
@@ -0,0 +1,82 @@
+#ifndef EMULATION_THREAD_H
+#define EMULATION_THREAD_H
+
+#include "FrameCapture.hpp"
+#include "NES.hpp"
+#include "PPU/IndexedFrame.hpp"
+#include "utility/CommandChannel.hpp"
+#include "utility/TripleBuffer.hpp"
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+/*
+EmulationThread
+
+Runs the NES on its own thread so that nothing the UI does (slow presents,
+text rendering, window events) can stall emulation. Each completed frame,
+along with a snapshot of the state the diagnostic windows show, is handed to
+the UI through a lock-free triple buffer, and to a FrameCapture ('capture'
+commands) when recording. Console commands come the other way
+through a CommandChannel and are run between frames, so they never race with
+the machine.
+*/
+
+class EmulationThread
+{
+public:
+    EmulationThread(NES &nes);
+    ~EmulationThread();
+
+    struct MachineState
+    {
+        u8_byte  m_A;
+        u8_byte  m_X;
+        u8_byte  m_Y;
+        u8_byte  m_S;
+        u16_word m_PC;
+        // Indexed by PPUInspector::Field.
+        unsigned int m_ppuRegisters[PPUInspector::FIELD_COUNT];
+    };
+
+    struct VideoFrame
+    {
+        VideoFrame() :
+            m_picture (),
+            m_frameNumber (0),
+            m_state ()
+        {}
+
+        // Palette indices; the UI converts to colours when it draws.
+        IndexedFrame m_picture;
+        unsigned int m_frameNumber;
+        MachineState m_state;
+    };
+
+    void start();
+    // Asks the thread to finish its current frame and waits for it to exit.
+    void stop();
+    bool running() const;
+
+    // The UI consumes from here.
+    TripleBuffer<VideoFrame>& frames();
+    // The UI posts commands here.
+    CommandChannel&           commands();
+    // Started and stopped by console commands, on this thread.
+    FrameCapture&             capture();
+
+private:
+    void run();
+    void publishFrame();
+
+    NES                     &m_nes;
+    std::thread              m_thread;
+    std::atomic<bool>        m_stopRequested;
+    unsigned int             m_framesPublished;
+    TripleBuffer<VideoFrame> m_frames;
+    CommandChannel           m_commands;
+    FrameCapture             m_capture;
+};
+
+#endif //EMULATION_THREAD_H
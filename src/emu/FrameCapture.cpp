@@ -0,0 +1,528 @@
+#include "FrameCapture.hpp"
+#include "NES.hpp"
+#include "PPU/PixelConvert.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+#include <iomanip>
+#include <sstream>
+
+const CommandCode START_COMMAND_CODE = 0;
+const CommandCode STOP_COMMAND_CODE  = 1;
+const CommandCode STATS_COMMAND_CODE = 2;
+
+static const unsigned int COLORS          = 64;
+static const unsigned int EMPHASIS_VALUES = 8;
+static const unsigned int RGB_BYTES       = IndexedFrame::PIXELS * 3;
+
+// Deflate's stored blocks hold at most this much each.
+static const unsigned int STORED_BLOCK_SIZE = 65535;
+// zlib's Adler-32 sums are kept below this.
+static const std::uint32_t ADLER_MODULUS    = 65521;
+
+FrameCapture::
+FrameCapture(std::string name, unsigned int queueFrames) :
+    Commandable(name),
+    m_format (PPM),
+    m_policy (BLOCK),
+    m_destination (),
+    m_stream (nullptr),
+    m_pipe (false),
+    m_queue (queueFrames),
+    m_writer (),
+    m_mutex (),
+    m_pictureQueued (),
+    m_pictureTaken (),
+    m_stopping (false),
+    m_captured (0),
+    m_written (0),
+    m_dropped (0),
+    m_waits (0),
+    m_errors (0),
+    m_colors (EMPHASIS_VALUES * COLORS * 3),
+    m_picture (),
+    m_rgb (RGB_BYTES),
+    m_encoded (),
+    m_fileNumber (0)
+{
+    registerCommands();
+}
+
+FrameCapture::
+~FrameCapture()
+{
+    stop();
+}
+
+bool
+FrameCapture::
+start(Format format, const std::string& destination, Policy policy, std::string& error)
+{
+    assert(format < FORMAT_COUNT && "FrameCapture::start: no such format!");
+    stop();
+
+    if (destination.empty()) {
+        error = "Nowhere to write to.";
+        return false;
+    }
+
+    m_pipe = false;
+    if (!sequence(format)) {
+        if (destination == "-") {
+            m_stream = stdout;
+        }
+        else if (destination[0] == '|') {
+            m_stream = popen(destination.c_str() + 1, "w");
+            m_pipe   = true;
+        }
+        else {
+            m_stream = std::fopen(destination.c_str(), "wb");
+        }
+        if (m_stream == nullptr) {
+            error = "Couldn't open " + destination + ".";
+            return false;
+        }
+    }
+
+    if (format == Y4M) {
+        // A frame is 341 x 262 dots of 4 master clock ticks; pixels are 8:7.
+        std::fprintf(m_stream, "YUV4MPEG2 W%u H%u F%u:%u Ip A8:7 C444\n",
+                     IndexedFrame::WIDTH, IndexedFrame::HEIGHT,
+                     NES::clockHertz, NES::masterTicksPerFrame);
+    }
+
+    PixelConvert::copyColors(&m_colors[0]);
+
+    m_format      = format;
+    m_policy      = policy;
+    m_destination = destination;
+    m_fileNumber  = 0;
+    m_captured    = 0;
+    m_written     = 0;
+    m_dropped     = 0;
+    m_waits       = 0;
+    m_errors      = 0;
+    m_stopping    = false;
+    m_writer = std::thread(&FrameCapture::writeLoop, this);
+    return true;
+}
+
+void
+FrameCapture::
+stop()
+{
+    if (!m_writer.joinable()) {
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stopping = true;
+    }
+    m_pictureQueued.notify_one();
+    m_writer.join();
+
+    if (m_pipe) {
+        pclose(m_stream);
+    }
+    else if (m_stream == stdout) {
+        std::fflush(m_stream);
+    }
+    else if (m_stream != nullptr) {
+        std::fclose(m_stream);
+    }
+    m_stream = nullptr;
+}
+
+bool
+FrameCapture::
+capturing() const
+{
+    return m_writer.joinable();
+}
+
+bool
+FrameCapture::
+capture(const IndexedFrame& picture)
+{
+    if (!capturing()) {
+        return false;
+    }
+    ++m_captured;
+
+    if (!m_queue.push(picture)) {
+        if (m_policy == DROP) {
+            ++m_dropped;
+            return false;
+        }
+        ++m_waits;
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_pictureTaken.wait(lock, [&] { return m_queue.push(picture); });
+    }
+    else {
+        // Taking the lock makes sure the writer is either asleep, and
+        // will be woken, or hasn't checked the queue yet.
+        std::lock_guard<std::mutex> lock(m_mutex);
+    }
+    m_pictureQueued.notify_one();
+    return true;
+}
+
+void
+FrameCapture::
+writeLoop()
+{
+    for (;;) {
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_pictureQueued.wait(lock, [this] { return m_stopping || !m_queue.empty(); });
+        }
+        // Stopping only ends the loop once everything queued is written.
+        if (!m_queue.pop(m_picture)) {
+            break;
+        }
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+        }
+        m_pictureTaken.notify_one();
+
+        if (writePicture(m_picture)) {
+            ++m_written;
+        }
+        else {
+            ++m_errors;
+        }
+    }
+}
+
+bool
+FrameCapture::
+writePicture(const IndexedFrame& picture)
+{
+    toRGB(picture);
+
+    const std::vector<u8_byte> *bytes = &m_rgb;
+    std::string header;
+    switch (m_format) {
+        case PPM:
+        {
+            std::ostringstream ppm;
+            ppm << "P6\n" << IndexedFrame::WIDTH << " " << IndexedFrame::HEIGHT << "\n255\n";
+            header = ppm.str();
+        }
+        break;
+        case PNG:
+            encodePNG();
+            bytes = &m_encoded;
+            break;
+        case Y4M:
+            encodeY4M();
+            header = "FRAME\n";
+            bytes  = &m_encoded;
+            break;
+        default:
+            break;
+    }
+
+    std::FILE *output = m_stream;
+    if (sequence(m_format)) {
+        std::ostringstream filename;
+        filename << m_destination << std::setw(6) << std::setfill('0') << m_fileNumber++
+                 << "." << formatName(m_format);
+        output = std::fopen(filename.str().c_str(), "wb");
+        if (output == nullptr) {
+            return false;
+        }
+    }
+
+    bool written = std::fwrite(header.data(), 1, header.size(), output) == header.size() &&
+                   std::fwrite(&(*bytes)[0], 1, bytes->size(), output) == bytes->size();
+    if (sequence(m_format)) {
+        written = std::fclose(output) == 0 && written;
+    }
+    return written;
+}
+
+void
+FrameCapture::
+toRGB(const IndexedFrame& picture)
+{
+    u8_byte *rgb = &m_rgb[0];
+    for (unsigned int y = 0; y < IndexedFrame::HEIGHT; ++y) {
+        const u8_byte *colors = &m_colors[(picture.m_emphasis[y] % EMPHASIS_VALUES) * COLORS * 3];
+        const u8_byte *row    = picture.row(y);
+        for (unsigned int x = 0; x < IndexedFrame::WIDTH; ++x, rgb += 3) {
+            const u8_byte *color = colors + (row[x] & IndexedFrame::INDEX_MASK) * 3;
+            rgb[0] = color[0];
+            rgb[1] = color[1];
+            rgb[2] = color[2];
+        }
+    }
+}
+
+struct CrcTable
+{
+    CrcTable() {
+        for (std::uint32_t n = 0; n < 256; ++n) {
+            std::uint32_t c = n;
+            for (unsigned int bit = 0; bit < 8; ++bit) {
+                c = (c & 1) ? 0xEDB88320 ^ (c >> 1) : c >> 1;
+            }
+            m_entries[n] = c;
+        }
+    }
+
+    std::uint32_t m_entries[256];
+};
+
+// PNG's (and zlib's) CRC-32.
+static std::uint32_t
+crc32(const u8_byte* data, std::size_t size)
+{
+    static const CrcTable table;
+    std::uint32_t crc = 0xFFFFFFFF;
+    for (std::size_t i = 0; i < size; ++i) {
+        crc = table.m_entries[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+    }
+    return ~crc;
+}
+
+static void
+putBigEndian(std::vector<u8_byte>& out, std::uint32_t value)
+{
+    out.push_back(value >> 24);
+    out.push_back(value >> 16);
+    out.push_back(value >> 8);
+    out.push_back(value);
+}
+
+// Closes the chunk whose type starts at typeAt: fills in its length and
+// adds its CRC.
+static void
+endChunk(std::vector<u8_byte>& out, std::size_t typeAt)
+{
+    std::uint32_t length = out.size() - typeAt - 4;
+    out[typeAt - 4] = length >> 24;
+    out[typeAt - 3] = length >> 16;
+    out[typeAt - 2] = length >> 8;
+    out[typeAt - 1] = length;
+    putBigEndian(out, crc32(&out[typeAt], out.size() - typeAt));
+}
+
+static std::size_t
+beginChunk(std::vector<u8_byte>& out, const char* type)
+{
+    putBigEndian(out, 0);
+    std::size_t typeAt = out.size();
+    out.insert(out.end(), type, type + 4);
+    return typeAt;
+}
+
+// 8 bit RGB, every row unfiltered, the zlib stream made of stored deflate
+// blocks. Nothing is compressed, but nothing needs zlib either.
+void
+FrameCapture::
+encodePNG()
+{
+    static const u8_byte SIGNATURE[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+    const unsigned int rowBytes = IndexedFrame::WIDTH * 3;
+
+    m_encoded.assign(SIGNATURE, SIGNATURE + sizeof(SIGNATURE));
+
+    std::size_t chunk = beginChunk(m_encoded, "IHDR");
+    putBigEndian(m_encoded, IndexedFrame::WIDTH);
+    putBigEndian(m_encoded, IndexedFrame::HEIGHT);
+    const u8_byte format[5] = { 8, 2, 0, 0, 0 };    // Depth, RGB, deflate, no filtering, no interlace.
+    m_encoded.insert(m_encoded.end(), format, format + sizeof(format));
+    endChunk(m_encoded, chunk);
+
+    chunk = beginChunk(m_encoded, "IDAT");
+    m_encoded.push_back(0x78);                      // Deflate, 32K window,
+    m_encoded.push_back(0x01);                      // no dictionary, fastest.
+
+    // The filter type byte before each row, then the row, split into blocks
+    // wherever they fill up.
+    std::uint32_t a = 1, b = 0;
+    unsigned int  total = IndexedFrame::HEIGHT * (rowBytes + 1);
+    unsigned int  left  = 0;
+    for (unsigned int y = 0; y < IndexedFrame::HEIGHT; ++y) {
+        for (unsigned int x = 0; x <= rowBytes; ++x) {
+            if (left == 0) {
+                unsigned int size = std::min(total, STORED_BLOCK_SIZE);
+                total -= size;
+                m_encoded.push_back(total == 0 ? 1 : 0);
+                m_encoded.push_back(size);
+                m_encoded.push_back(size >> 8);
+                m_encoded.push_back(~size);
+                m_encoded.push_back(~size >> 8);
+                left = size;
+            }
+            u8_byte byte = x == 0 ? 0 : m_rgb[y * rowBytes + x - 1];
+            m_encoded.push_back(byte);
+            --left;
+            a = (a + byte) % ADLER_MODULUS;
+            b = (b + a) % ADLER_MODULUS;
+        }
+    }
+    putBigEndian(m_encoded, (b << 16) | a);
+    endChunk(m_encoded, chunk);
+
+    chunk = beginChunk(m_encoded, "IEND");
+    endChunk(m_encoded, chunk);
+}
+
+// Studio range BT.601, a full size plane each for Y, Cb and Cr.
+void
+FrameCapture::
+encodeY4M()
+{
+    m_encoded.resize(RGB_BYTES);
+    u8_byte *luma = &m_encoded[0];
+    u8_byte *cb   = luma + IndexedFrame::PIXELS;
+    u8_byte *cr   = cb + IndexedFrame::PIXELS;
+    for (unsigned int i = 0; i < IndexedFrame::PIXELS; ++i) {
+        int r = m_rgb[i * 3], g = m_rgb[i * 3 + 1], b = m_rgb[i * 3 + 2];
+        luma[i] = ((66 * r + 129 * g + 25 * b + 128) >> 8) + 16;
+        cb[i]   = ((-38 * r - 74 * g + 112 * b + 128) >> 8) + 128;
+        cr[i]   = ((112 * r - 94 * g - 18 * b + 128) >> 8) + 128;
+    }
+}
+
+FrameCapture::Statistics
+FrameCapture::
+statistics() const
+{
+    Statistics stats;
+    stats.m_captured = m_captured;
+    stats.m_written  = m_written;
+    stats.m_dropped  = m_dropped;
+    stats.m_waits    = m_waits;
+    stats.m_errors   = m_errors;
+    return stats;
+}
+
+std::string
+FrameCapture::
+statisticsReport() const
+{
+    Statistics stats = statistics();
+
+    std::stringstream output;
+    output << (capturing() ? "Capturing " : "Not capturing ")
+           << formatName(m_format) << " to " << m_destination
+           << (m_policy == BLOCK ? " (block)" : " (drop)") << "\n"
+           << "Captured: " << stats.m_captured << "\n"
+           << "Written:  " << stats.m_written  << "\n"
+           << "Dropped:  " << stats.m_dropped  << "\n"
+           << "Waits:    " << stats.m_waits    << "\n"
+           << "Errors:   " << stats.m_errors   << "\n";
+    return output.str();
+}
+
+const char*
+FrameCapture::
+formatName(Format format)
+{
+    assert(format < FORMAT_COUNT && "FrameCapture::formatName: no such format!");
+    static const char* const names[FORMAT_COUNT] = { "ppm", "png", "raw", "y4m" };
+    return names[format];
+}
+
+bool
+FrameCapture::
+parseFormat(const std::string& name, Format& format)
+{
+    for (unsigned int i = 0; i < FORMAT_COUNT; ++i) {
+        if (name == formatName(static_cast<Format>(i))) {
+            format = static_cast<Format>(i);
+            return true;
+        }
+    }
+    return false;
+}
+
+bool
+FrameCapture::
+sequence(Format format)
+{
+    return format == PPM || format == PNG;
+}
+
+void
+FrameCapture::
+registerCommands()
+{
+    std::vector<Command> commands = {
+        { "start", START_COMMAND_CODE, "Takes 3 or more arguments: <ppm|png|raw|y4m> <block|drop> <destination>.\n"
+                                       " Write every picture from now on, as <destination>000000.ppm and on\n"
+                                       " for ppm and png, or into one stream: a file, '-' for stdout or\n"
+                                       " '|command' to pipe. When the writer falls behind, wait for it (block)\n"
+                                       " or skip pictures (drop).", 3 },
+        { "stop",  STOP_COMMAND_CODE,  "Finish writing what's queued and stop capturing.", 0 },
+        { "stats", STATS_COMMAND_CODE, "Print how many pictures were captured, written and dropped.", 0 }
+    };
+
+    std::for_each(commands.begin(), commands.end(), [&](Command c) { addCommand(c); });
+}
+
+CommandResult
+FrameCapture::
+receiveCommand(CommandInput command)
+{
+    CommandResult result;
+    result.m_code = CommandResult::NO_RECEIVER;
+
+    switch (command.m_code) {
+        case START_COMMAND_CODE:
+        {
+            if (command.m_arguments.size() < 3) {
+                result.m_code = CommandResult::WRONG_NUM_ARGS;
+                result.m_meta = std::string("Usage: start <ppm|png|raw|y4m> <block|drop> <destination>");
+                return result;
+            }
+
+            Format format;
+            if (!parseFormat(command.m_arguments[0], format)) {
+                result.m_code = CommandResult::INVALID_ARGUMENT;
+                result.m_meta = std::string("Format must be 'ppm', 'png', 'raw' or 'y4m'.");
+                return result;
+            }
+            const std::string &policy = command.m_arguments[1];
+            if (policy != "block" && policy != "drop") {
+                result.m_code = CommandResult::INVALID_ARGUMENT;
+                result.m_meta = std::string("Policy must be 'block' or 'drop'.");
+                return result;
+            }
+            // Arguments are split at spaces; a piped command needs them back.
+            std::string destination = command.m_arguments[2];
+            for (unsigned int i = 3; i < command.m_arguments.size(); ++i) {
+                destination += " " + command.m_arguments[i];
+            }
+
+            std::string error;
+            if (!start(format, destination, policy == "block" ? BLOCK : DROP, error)) {
+                result.m_code = CommandResult::ERROR;
+                result.m_meta = error;
+                return result;
+            }
+            result.m_output = std::string("Capturing ") + formatName(format) + " to " + destination + ".";
+            result.m_code   = CommandResult::OK;
+        }
+        break;
+        case STOP_COMMAND_CODE:
+        {
+            stop();
+            result.m_output = statisticsReport();
+            result.m_code   = CommandResult::OK;
+        }
+        break;
+        case STATS_COMMAND_CODE:
+        {
+            result.m_output = statisticsReport();
+            result.m_code   = CommandResult::OK;
+        }
+        break;
+    }
+
+    return result;
+}
@@ -0,0 +1,148 @@
+#ifndef FRAME_CAPTURE_H
+#define FRAME_CAPTURE_H
+
+#include "PPU/IndexedFrame.hpp"
+#include "utility/Commandable.hpp"
+#include "utility/DataTypes.hpp"
+#include "utility/SPSCQueue.hpp"
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdio>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+/*
+FrameCapture
+
+Records pictures without slowing the machine down: capture() only copies the
+palette indices into a bounded SPSCQueue, and a writer thread of its own
+turns them into colours and writes them out as
+
+    PPM     numbered .ppm files,
+    PNG     numbered .png files (stored, not compressed; recompress later),
+    RAW     one stream of 8 bit RGB pictures back to back,
+    Y4M     one YUV4MPEG2 stream (4:4:4, BT.601), ready for ffmpeg & co.
+
+Files go to <destination>000000.ppm and on; streams go to the destination
+file, to stdout for "-" or into a command's standard input for "|command".
+
+When the writer falls behind and the queue fills up, BLOCK makes capture()
+wait for room (every picture is kept, emulation slows down) and DROP makes it
+throw the picture away; both are counted. Colours are taken from
+PixelConvert when capturing starts, so a later palette change doesn't race
+with the writer.
+
+start(), stop() and capture() are for one thread, the one pictures come from.
+*/
+
+class FrameCapture : public Commandable
+{
+public:
+    enum Format
+    {
+        PPM = 0,
+        PNG,
+        RAW,
+        Y4M,
+        FORMAT_COUNT
+    };
+
+    enum Policy
+    {
+        BLOCK = 0,
+        DROP
+    };
+
+    struct Statistics
+    {
+        Statistics() :
+            m_captured (0),
+            m_written (0),
+            m_dropped (0),
+            m_waits (0),
+            m_errors (0)
+        {}
+
+        unsigned int m_captured;    // Pictures handed to capture().
+        unsigned int m_written;
+        unsigned int m_dropped;     // Queue full under DROP.
+        unsigned int m_waits;       // Queue full under BLOCK.
+        unsigned int m_errors;      // Pictures that couldn't be written.
+    };
+
+    static const unsigned int DEFAULT_QUEUE_FRAMES = 16;
+
+    // queueFrames must be a power of two.
+    FrameCapture(std::string name = "capture", unsigned int queueFrames = DEFAULT_QUEUE_FRAMES);
+    // Stops, writing out what's queued.
+    virtual ~FrameCapture();
+
+    // Returns false and sets error if the destination can't be opened.
+    // Capturing already stops first.
+    bool start(Format format, const std::string& destination, Policy policy, std::string& error);
+    // Waits for the queue to be written out and closes the destination.
+    void stop();
+    bool capturing() const;
+
+    // Queues a copy of picture; false if it was dropped or we aren't
+    // capturing.
+    bool capture(const IndexedFrame& picture);
+
+    // Since the last start().
+    Statistics  statistics() const;
+    std::string statisticsReport() const;
+
+    static const char* formatName(Format format);
+    static bool        parseFormat(const std::string& name, Format& format);
+    // Whether format is numbered files rather than a stream.
+    static bool        sequence(Format format);
+
+    // Commandable interface
+    virtual CommandResult receiveCommand(CommandInput command);
+    virtual std::string   typeName() { return std::string("FrameCapture"); }
+
+private:
+    void registerCommands();
+    void writeLoop();
+    bool writePicture(const IndexedFrame& picture);
+    void toRGB(const IndexedFrame& picture);
+    void encodePNG();
+    void encodeY4M();
+
+    Format                     m_format;
+    Policy                     m_policy;
+    std::string                m_destination;
+    // The stream for RAW and Y4M; pclose()d if it's a pipe.
+    std::FILE                 *m_stream;
+    bool                       m_pipe;
+
+    SPSCQueue<IndexedFrame>    m_queue;
+    std::thread                m_writer;
+    // Only for sleeping on: the writer for pictures, capture() for room.
+    std::mutex                 m_mutex;
+    std::condition_variable    m_pictureQueued;
+    std::condition_variable    m_pictureTaken;
+    bool                       m_stopping;
+
+    std::atomic<unsigned int>  m_captured;
+    std::atomic<unsigned int>  m_written;
+    std::atomic<unsigned int>  m_dropped;
+    std::atomic<unsigned int>  m_waits;
+    std::atomic<unsigned int>  m_errors;
+
+    // Writer side: the palette in use, 3 bytes a colour, per emphasis, and
+    // the picture being written in each of its forms.
+    std::vector<u8_byte>       m_colors;
+    IndexedFrame               m_picture;
+    std::vector<u8_byte>       m_rgb;
+    std::vector<u8_byte>       m_encoded;
+    unsigned int               m_fileNumber;
+
+    FrameCapture(const FrameCapture&);
+    FrameCapture& operator=(const FrameCapture&);
+};
+
+#endif //FRAME_CAPTURE_H
@@ -1,11 +1,15 @@
 #include "NES.hpp"
 
 #include <algorithm>
+#include <cassert>
+#include <sstream>
 
 const CommandCode RESET_COMMAND_CODE       = 0;
 const CommandCode LOAD_ROM_COMMAND_CODE    = 1;
 const CommandCode PAUSE_COMMAND_CODE       = 2;
 const CommandCode CONTINUE_COMMAND_CODE    = 3;
+const CommandCode TURBO_COMMAND_CODE       = 4;
+const CommandCode RENDER_COMMAND_CODE      = 5;
 
 NES::
 NES() :
@@ -13,15 +17,22 @@ NES() :
     PoweredDevice(this),
     m_clock (clockHertz),
     m_cpu (m_memory),
-    m_ppu (&m_memory, m_clock),
+    m_ppu (m_clock),
+    m_ppuInspector (m_ppu),
     m_controllerIO (),
     m_memory (nullptr, nullptr),
     m_mapper (nullptr),
-    m_paused (true)
+    m_pacer (m_clock.hertz() / static_cast<double>(masterTicksPerFrame)),
+    m_paused (true),
+    m_renderInterval (1),
+    m_logicOnly (false),
+    m_frameCount (0)
 {
-    m_memory = MainMemory(&m_ppu.registerBlock(), &m_controllerIO);
+    m_memory.setDevices(&m_ppu, &m_controllerIO);
     m_clock.registerDevice(&m_cpu);
     m_clock.registerDevice(&m_ppu);
+    m_ppu.setNMIHandler([this] { m_cpu.signalNMI(); });
+    m_memory.setOAMDMAHandler([this] (u8_byte page) { oamDMA(page); });
     registerCommands();
 }
 
@@ -32,21 +43,65 @@ NES::
     m_mapper = nullptr;
 }
 
-void
+bool
 NES::
 load(const char * filename)
 {
     iNESFile nesFile(filename);
+    if (!nesFile.isGood()) {
+        return false;
+    }
+    Mapper *mapper = Mapper::getMapper(nesFile);
+    if (mapper == nullptr) {
+        return false;
+    }
     delete m_mapper;
-    m_mapper = Mapper::getMapper(nesFile);
+    m_mapper = mapper;
 
     // Load cartridge Memory objects into MainMemory and the PPU...
-    Memory *cpuMemory = m_mapper->cpuMemory();
-    MappedMemory *mappedMemory = m_memory.mappedMemory();
-    mappedMemory->removeSegment(cpuMemory->startAddress());
-    mappedMemory->addSegment(cpuMemory);
+    m_memory.setCartridge(m_mapper->cpuMemory());
+    mapVideo();
+    m_mapper->setVideoChangeHandler([this] { mapVideo(); });
+    return true;
+}
+
+void
+NES::
+mapVideo()
+{
+    u8_byte *patterns[VideoMemory::PATTERN_PAGES];
+    for (unsigned int page = 0; page < VideoMemory::PATTERN_PAGES; ++page) {
+        patterns[page] = m_mapper->chrPage(page);
+    }
+    m_ppu.mapCartridge(patterns, m_mapper->chrWritable(), m_mapper->mirroring());
+}
+
+void
+NES::
+setController1(NESController *controller)
+{
+    m_controllerIO.setController1(controller);
+}
+
+void
+NES::
+setController2(NESController *controller)
+{
+    m_controllerIO.setController2(controller);
+}
+
+void
+NES::
+setPaused(bool paused)
+{
+    m_paused = paused;
+}
 
-    m_ppu.setCartridgeMemory(m_mapper->ppuMemory());
+bool
+NES::
+paused() const
+{
+    return m_paused;
 }
 
 void 
@@ -57,6 +112,90 @@ tick()
     m_clock.tick();
 }
 
+bool
+NES::
+runFrame()
+{
+    bool ran = !m_paused;
+    if (ran) {
+        m_ppu.setOutputEnabled(!m_logicOnly && m_frameCount % m_renderInterval == 0);
+        // Run until the PPU finishes a picture. The bound only matters if the
+        // PPU isn't being clocked.
+        unsigned int ppuFrame = m_ppu.frameCount();
+        for (unsigned int i = 0; i < 2 * masterTicksPerFrame && m_ppu.frameCount() == ppuFrame; ++i) {
+            m_clock.tick();
+        }
+        ++m_frameCount;
+    }
+    // Pace even when paused so callers polling us don't spin.
+    m_pacer.waitForNextFrame();
+    return ran;
+}
+
+double
+NES::
+frameHertz() const
+{
+    return m_clock.hertz() / static_cast<double>(masterTicksPerFrame);
+}
+
+void
+NES::
+setTurbo(double speed, unsigned int renderInterval)
+{
+    assert(renderInterval > 0 && "NES::setTurbo: render interval must be at least 1!");
+    m_pacer.setSpeed(speed);
+    m_pacer.resetStatistics();
+    m_renderInterval = renderInterval;
+}
+
+void
+NES::
+clearTurbo()
+{
+    setTurbo(1.0, 1);
+    m_ppu.setOutputEnabled(true);
+}
+
+bool
+NES::
+turbo() const
+{
+    return m_pacer.speed() != 1.0 || m_renderInterval != 1;
+}
+
+void
+NES::
+setLogicOnly(bool logicOnly)
+{
+    m_logicOnly = logicOnly;
+}
+
+bool
+NES::
+logicOnly() const
+{
+    return m_logicOnly;
+}
+
+bool
+NES::
+frameRendered() const
+{
+    return m_ppu.outputEnabled();
+}
+
+void
+NES::
+oamDMA(u8_byte page)
+{
+    u8_byte data[RenderState::OAM_SIZE];
+    m_memory.readPage(page, data);
+    m_ppu.oamDMA(page, data);
+    // The CPU reads on odd cycles, so DMA may wait one to line up.
+    m_cpu.stall(OAM_DMA_CYCLES + (m_cpu.cycles() & 0x01));
+}
+
 void
 NES::
 resetImpl()
@@ -82,28 +221,21 @@ powerOffImpl()
 }
 
 NES::MainMemory::
-MainMemory(Memory *ppuRegisters,
+MainMemory(PPU    *ppu,
            Memory *controllerIO) :
     Memory(WORK_RAM_BEGIN, CARTRIDGE_PRGROM_END),
-    m_mappedMemory (nullptr),
     m_workRam (WORK_RAM_BEGIN, WORK_RAM_END),
     m_apuRam  (APU_REGISTERS_BEGIN, APU_REGISTERS_END),
-    m_cartridgeRam (CARTRIDGE_EXPO_BEGIN, CARTRIDGE_PRGROM_END)
+    m_cartridgeRam (CARTRIDGE_EXPO_BEGIN, CARTRIDGE_PRGROM_END),
+    m_ppu (ppu),
+    m_controllerIO (controllerIO),
+    m_cartridge (nullptr),
+    m_mappedMemory (nullptr),
+    m_oamDMAHandler ()
 {
     // TODO: Invert this so the PPU draws on its registers from the main memory pool rather than
     // passing its own memory to this object.
-    /* assert(ppuRegisters != nullptr && "ppuRegisters is nullptr!");
-       assert(controllerIO != nullptr && "controllerIO is nullptr!"); */
-
-    std::vector<Memory*> segments;
-    segments.push_back(&m_workRam);
-    segments.push_back(ppuRegisters);
-    segments.push_back(&m_apuRam);
-    segments.push_back(&m_cartridgeRam);
-    // FIXME: APU & ControllerIO share some registers...
-    segments.push_back(controllerIO);
-    m_mappedMemory = new MappedMemory(WORK_RAM_BEGIN, CARTRIDGE_PRGROM_END, segments);
-    assert(m_mappedMemory != nullptr);
+    buildMap();
 }
 
 NES::MainMemory::
@@ -111,10 +243,14 @@ MainMemory(const MainMemory& other) :
     Memory (other.m_startAddress, other.m_endAddress),
     m_workRam (other.m_workRam),
     m_apuRam  (other.m_apuRam),
-    m_cartridgeRam (other.m_cartridgeRam)
+    m_cartridgeRam (other.m_cartridgeRam),
+    m_ppu (other.m_ppu),
+    m_controllerIO (other.m_controllerIO),
+    m_cartridge (other.m_cartridge),
+    m_mappedMemory (nullptr),
+    m_oamDMAHandler (other.m_oamDMAHandler)
 {
-    m_mappedMemory = dynamic_cast<MappedMemory*>(other.m_mappedMemory->clone());
-    assert(m_mappedMemory != nullptr);
+    buildMap();
 }
 
 NES::MainMemory::
@@ -126,30 +262,73 @@ NES::MainMemory::
     }
 }
 
-NES::MainMemory&
+void
+NES::MainMemory::
+setDevices(PPU *ppu, Memory *controllerIO)
+{
+    m_ppu = ppu;
+    m_controllerIO = controllerIO;
+    buildMap();
+}
+
+void
+NES::MainMemory::
+setCartridge(Memory *cartridge)
+{
+    m_cartridge = cartridge;
+    buildMap();
+}
+
+void
+NES::MainMemory::
+setOAMDMAHandler(std::function<void(u8_byte)> handler)
+{
+    m_oamDMAHandler = handler;
+}
+
+void
+NES::MainMemory::
+readPage(u8_byte page, u8_byte* data)
+{
+    const unsigned int PAGE_SIZE = 0x100;
+    address_t address = page * PAGE_SIZE;
+    if (address <= WORK_RAM_MIRROR_END) {
+        m_workRam.readBlock(correctAddress(address), PAGE_SIZE, data);
+        return;
+    }
+    for (unsigned int i = 0; i < PAGE_SIZE; ++i) {
+        data[i] = read(address + i);
+    }
+}
+
+void
 NES::MainMemory::
-operator=(MainMemory tmp)
+buildMap()
 {
-    std::swap(m_workRam,      tmp.m_workRam); 
-    std::swap(m_apuRam,       tmp.m_apuRam); 
-    std::swap(m_cartridgeRam, tmp.m_cartridgeRam); 
-    std::swap(m_mappedMemory, tmp.m_mappedMemory);
+    // Segments are searched in order, so where two overlap the earlier one wins.
+    std::vector<Memory*> segments;
+    segments.push_back(&m_workRam);
+    // FIXME: APU & ControllerIO share some registers...
+    if (m_controllerIO != nullptr) {
+        segments.push_back(m_controllerIO);
+    }
+    segments.push_back(&m_apuRam);
+    if (m_cartridge != nullptr) {
+        segments.push_back(m_cartridge);
+    }
+    segments.push_back(&m_cartridgeRam);
 
-    return *this;
+    delete m_mappedMemory;
+    m_mappedMemory = new MappedMemory(WORK_RAM_BEGIN, CARTRIDGE_PRGROM_END, segments);
+    assert(m_mappedMemory != nullptr);
 }
 
 Memory::address_t
 NES::MainMemory::
 correctAddress(address_t address) const
 {
-    // TODO: Modulo is expensive...
-    if (address >  WORK_RAM_END &&
-        address <= WORK_RAM_MIRROR_END) {
-        return address % WORK_RAM_SIZE; 
-    }
-    else if (address >  PPU_REGISTERS_END &&
-             address <= PPU_MIRROR_END) {
-        return PPU_REGISTERS_BEGIN + (address % PPU_REGISTERS_SIZE); 
+    if (address <= WORK_RAM_MIRROR_END) {
+        return address & (WORK_RAM_SIZE - 1);
     }
     return address;
 }
@@ -158,14 +337,40 @@ NES::MainMemory::data_t
 NES::MainMemory::
 getData(address_t address) 
 {
-    return m_mappedMemory->read(correctAddress(address));
+    // Work RAM and the PPU ports, the busiest regions, skip the segment
+    // search; masking folds their mirrors in.
+    switch (address >> REGION_SHIFT) {
+        case WORK_RAM_BEGIN >> REGION_SHIFT:
+            return m_workRam.data()[address & (WORK_RAM_SIZE - 1)];
+        case PPU_REGISTERS_BEGIN >> REGION_SHIFT:
+            if (m_ppu != nullptr) {
+                return m_ppu->readPort(address);
+            }
+            break;
+    }
+    return m_mappedMemory->read(address);
 }
 
 void
 NES::MainMemory::
 setData(address_t address, data_t data) 
 {
-    return m_mappedMemory->write(correctAddress(address), data);
+    switch (address >> REGION_SHIFT) {
+        case WORK_RAM_BEGIN >> REGION_SHIFT:
+            m_workRam.data()[address & (WORK_RAM_SIZE - 1)] = data;
+            return;
+        case PPU_REGISTERS_BEGIN >> REGION_SHIFT:
+            if (m_ppu != nullptr) {
+                m_ppu->writePort(address, data);
+                return;
+            }
+            break;
+    }
+    if (address == PPU::OAM_DMA_ADDRESS && m_oamDMAHandler) {
+        m_oamDMAHandler(data);
+        return;
+    }
+    m_mappedMemory->write(address, data);
 }
 
 void
@@ -182,7 +387,13 @@ registerCommands()
         { "continue", CONTINUE_COMMAND_CODE, "Continues execution of the NES.", 0 },
         { "reset",    RESET_COMMAND_CODE,    "Resets the NES.", 0 },
         { "load",     LOAD_ROM_COMMAND_CODE, "Takes 1 argument: The file to load.\n"
-                                             " Load a ROM into the NES. Causes NES to reset.", 1}
+                                             " Load a ROM into the NES. Causes NES to reset.", 1},
+        { "turbo",    TURBO_COMMAND_CODE,    "Takes 1 or 2 arguments: <speed|max|off> [render interval].\n"
+                                             " Run at a multiple of normal speed (or unthrottled with 'max'),\n"
+                                             " only drawing every Nth frame. 'pacer stats' shows the FPS.", 2},
+        { "render",   RENDER_COMMAND_CODE,   "Takes 1 or 2 arguments: <inline|pipelined|threads> [count].\n"
+                                             " Draw frames on the emulation thread, or on a worker thread\n"
+                                             " one frame behind. 'threads' splits each frame across count threads.", 2}
     };
 
     std::for_each(commands.begin(), commands.end(), [&](Command c) { addCommand(c); });
@@ -198,13 +409,13 @@ receiveCommand(CommandInput command)
     switch(command.m_code) {
             case PAUSE_COMMAND_CODE:
             {
-                m_paused = true;
+                setPaused(true);
                 result.m_code = CommandResult::OK;
             }
             break;
             case CONTINUE_COMMAND_CODE:
             {
-                m_paused = false;
+                setPaused(false);
                 result.m_code = CommandResult::OK;
             }
             break;
@@ -222,11 +433,101 @@ receiveCommand(CommandInput command)
                     return result;
                 }
                 std::string filename = *command.m_arguments.begin();            
-                load(filename.c_str());
+                if (!load(filename.c_str())) {
+                    result.m_code = CommandResult::ERROR;
+                    result.m_meta = std::string("Couldn't load ") + filename + ".";
+                    return result;
+                }
                 reset();
                 result.m_code = CommandResult::OK;
             }
             break;
+            case TURBO_COMMAND_CODE:
+            {
+                if (command.m_arguments.size() < 1) {
+                    result.m_code = CommandResult::WRONG_NUM_ARGS;
+                    result.m_meta = std::string("Usage: turbo <speed|max|off> [render interval]");
+                    return result;
+                }
+
+                std::string mode = command.m_arguments[0];
+                if (mode == "off") {
+                    clearTurbo();
+                    result.m_output = "Turbo off.";
+                    result.m_code   = CommandResult::OK;
+                    return result;
+                }
+
+                double speed = FramePacer::UNTHROTTLED;
+                if (mode != "max") {
+                    std::istringstream stream(mode);
+                    if (!(stream >> speed) || speed <= 0.0) {
+                        result.m_code = CommandResult::INVALID_ARGUMENT;
+                        result.m_meta = std::string("Speed must be a positive number, 'max' or 'off'.");
+                        return result;
+                    }
+                }
+
+                unsigned int renderInterval = DEFAULT_TURBO_RENDER_INTERVAL;
+                if (command.m_arguments.size() > 1) {
+                    std::istringstream stream(command.m_arguments[1]);
+                    if (!(stream >> renderInterval) || renderInterval == 0) {
+                        result.m_code = CommandResult::INVALID_ARGUMENT;
+                        result.m_meta = std::string("Render interval must be at least 1.");
+                        return result;
+                    }
+                }
+
+                setTurbo(speed, renderInterval);
+                std::stringstream output;
+                output << "Turbo " << (speed == FramePacer::UNTHROTTLED ? std::string("unthrottled") : mode + "x")
+                       << ", drawing every " << renderInterval << " frame(s).";
+                result.m_output = output.str();
+                result.m_code   = CommandResult::OK;
+            }
+            break;
+            case RENDER_COMMAND_CODE:
+            {
+                if (command.m_arguments.size() < 1) {
+                    result.m_code = CommandResult::WRONG_NUM_ARGS;
+                    result.m_meta = std::string("Usage: render <inline|pipelined|threads> [count]");
+                    return result;
+                }
+
+                std::string mode = command.m_arguments[0];
+                if (mode == "threads") {
+                    unsigned int threads = 0;
+                    if (command.m_arguments.size() > 1) {
+                        std::istringstream stream(command.m_arguments[1]);
+                        stream >> threads;
+                    }
+                    if (threads == 0) {
+                        result.m_code = CommandResult::INVALID_ARGUMENT;
+                        result.m_meta = std::string("Thread count must be at least 1.");
+                        return result;
+                    }
+                    m_ppu.setRenderThreads(threads);
+                    std::stringstream output;
+                    output << "Rendering on " << threads << " thread(s).";
+                    result.m_output = output.str();
+                    result.m_code   = CommandResult::OK;
+                    return result;
+                }
+                if (mode == "inline") {
+                    m_ppu.setRenderMode(RenderPipeline::InlineMode);
+                }
+                else if (mode == "pipelined") {
+                    m_ppu.setRenderMode(RenderPipeline::PipelinedMode);
+                }
+                else {
+                    result.m_code = CommandResult::INVALID_ARGUMENT;
+                    result.m_meta = std::string("Render mode must be 'inline', 'pipelined' or 'threads'.");
+                    return result;
+                }
+                result.m_output = "Rendering " + mode + ".";
+                result.m_code   = CommandResult::OK;
+            }
+            break;
             // TODO POWER ON / OFF 
     }
 
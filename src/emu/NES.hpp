@@ -6,11 +6,14 @@
 #include "utility/Clock.hpp"
 #include "utility/Memory.hpp"
 #include "utility/Commandable.hpp"
+#include "utility/FramePacer.hpp"
 #include "CPU/Cpu65XX.hpp"
 #include "PPU/PPU.hpp"
+#include "PPU/PPUInspector.hpp"
 #include "IO/ControllerIO.hpp"
 #include "mapper/Mapper.hpp"
 
+#include <functional>
 #include <vector>
 
 class NES : public PoweredDevice, public Commandable
@@ -19,27 +22,73 @@ public:
     NES();
     ~NES();
 
-    void load(const char * filename);
+    // Returns false (and leaves the old cartridge in) if the file isn't a
+    // ROM we can run.
+    bool load(const char * filename);
+
+    // Controllers aren't owned by the NES. Pass nullptr to unplug.
+    void setController1(NESController *controller);
+    void setController2(NESController *controller);
+
+    void setPaused(bool paused);
+    bool paused() const;
 
     void tick();
 
+    // Runs until the PPU completes a frame, then waits until it is time for
+    // the next one. Returns false if the NES is paused.
+    bool runFrame();
+
     static const unsigned int clockHertz = 21477270;
+    // 341 PPU dots * 262 scanlines * 4 master ticks per dot.
+    static const unsigned int masterTicksPerFrame = 341 * 262 * 4;
+
+    // ~60.0988 Hz for NTSC.
+    double frameHertz() const;
+
+    // Turbo runs at speed times the normal frame rate (FramePacer::UNTHROTTLED
+    // for as fast as possible) and only produces pixels on every
+    // renderInterval'th frame. The skipped frames are still fully emulated.
+    void setTurbo(double speed, unsigned int renderInterval);
+    void clearTurbo();
+    bool turbo() const;
+
+    static const unsigned int DEFAULT_TURBO_RENDER_INTERVAL = 8;
+
+    // Logic only: frames run with no pixels at all (see
+    // PPU::setOutputEnabled), for bots and input searches that only look at
+    // the game's state. Checked as each frame starts, so a caller can turn
+    // it off for just the frames it wants to see.
+    void setLogicOnly(bool logicOnly);
+    bool logicOnly() const;
+
+    // CPU cycles an OAM DMA takes, plus one if it starts on an odd cycle.
+    static const unsigned int OAM_DMA_CYCLES = 513;
+
+    // Did the last frame run produce output worth displaying?
+    bool frameRendered() const;
 
     class MainMemory : public Memory
     {
     public:
-        MainMemory(Memory *ppuRegisters,
+        MainMemory(PPU    *ppu,
                    Memory *controllerIO);
 
+        // Copies the RAM; the devices and cartridge are shared.
         MainMemory(const MainMemory& other);
 
         virtual ~MainMemory();
 
-        MappedMemory* mappedMemory() {
-            return m_mappedMemory;
-        }
+        // Devices may be nullptr until they exist.
+        void setDevices(PPU *ppu, Memory *controllerIO);
+        // The cartridge's CPU space wins over the open cartridge RAM below it.
+        void setCartridge(Memory *cartridge);
+        // Called with the page written to $4014 instead of storing it.
+        void setOAMDMAHandler(std::function<void(u8_byte)> handler);
 
-        MainMemory& operator=(MainMemory tmp);
+        // The 256 bytes of a page, the way DMA reads them: a block copy
+        // out of work RAM, a byte at a time from anywhere else.
+        void readPage(u8_byte page, u8_byte* data);
 
         Memory* clone() { return new MainMemory(*this); }
 
@@ -62,16 +111,27 @@ public:
         static const address_t CARTRIDGE_PRGROM_BEGIN   = 0x8000;
         static const address_t CARTRIDGE_PRGROM_END     = 0xFFFF;
 
+        // The bus decodes 8 KB regions (the top three address bits) first.
+        static const unsigned int REGION_SHIFT          = 13;
+
     protected:
         virtual data_t getData(address_t address);
         virtual void   setData(address_t address, data_t data);
 
         address_t correctAddress(address_t address) const;
+        void      buildMap();
 
         BackedMemory m_workRam;
         BackedMemory m_apuRam;
         BackedMemory m_cartridgeRam;
+        PPU          *m_ppu;
+        Memory       *m_controllerIO;
+        Memory       *m_cartridge;
         MappedMemory *m_mappedMemory;
+
+        std::function<void(u8_byte)> m_oamDMAHandler;
+
+        MainMemory& operator=(const MainMemory&);
     };
 
     // Commandable interface
@@ -79,7 +139,10 @@ public:
     virtual std::string   typeName() { return std::string("NES"); }
 
     const Cpu65XX& cpu() const { return m_cpu; }
+    Cpu65XX&       cpu() { return m_cpu; }
     const PPU&     ppu() const { return m_ppu; }
+    const PPUInspector& ppuInspector() const { return m_ppuInspector; }
+    FramePacer&    pacer() { return m_pacer; }
     // FIXME: Here for easy coding... should remove.
     PPU&     ppu() { return m_ppu; }
 
@@ -91,15 +154,24 @@ protected:
 
 private:
     void registerCommands();
+    void oamDMA(u8_byte page);
+    // Points the PPU at the mapper's current CHR banks and mirroring.
+    void mapVideo();
 
     Mapper      *m_mapper;
     MainMemory   m_memory;
     Cpu65XX      m_cpu;
     PPU          m_ppu;
+    PPUInspector m_ppuInspector;
     Clock        m_clock;
     ControllerIO m_controllerIO;
+    FramePacer   m_pacer;
 
     bool m_paused;
+
+    unsigned int m_renderInterval;
+    bool         m_logicOnly;
+    unsigned int m_frameCount;
 };
 
 #endif //NES_H
@@ -14,11 +14,17 @@ const unsigned int CONSOLE_WIDTH        = 256 * 4;
 const unsigned int CONSOLE_HEIGHT       = 240 * 2;
 const unsigned int NES_DISPLAY_WIDTH    = 256;
 const unsigned int NES_DISPLAY_HEIGHT   = 240;
+const unsigned int NES_DISPLAY_SCALE    = 2;
+// How long the UI waits for input before checking for a new frame.
+const unsigned int UI_POLL_INTERVAL_MS  = 5;
 
 NESApp::
 NESApp(std::string script_name) :
     m_running (true),
+    m_nes (),
+    m_emulation (m_nes),
     m_console_window (nullptr),
+    m_display_window (nullptr),
     m_startup_script_name (script_name)
 {
 }
@@ -34,8 +40,12 @@ onExecute()
     SDL_Event Event;
 
     while (m_running) {
-        while (SDL_PollEvent(&Event)) {
+        // Wake up for input, or often enough to pick up new frames.
+        if (SDL_WaitEventTimeout(&Event, UI_POLL_INTERVAL_MS)) {
             onEvent(&Event);
+            while (SDL_PollEvent(&Event)) {
+                onEvent(&Event);
+            }
         }
         onLoop();
         onRender();
@@ -143,67 +153,241 @@ render()
 }
 
 NESApp::CpuWindow::
-CpuWindow(const Cpu65XX& cpu) :
+CpuWindow() :
     DiagnosticWindow("win-cpu",
               "NES CPU Instrumentation",
               CONSOLE_WIDTH + 5, 5,
               200, 200),
-    m_cpu (cpu)
+    m_state (),
+    m_dirty (true)
+{
+}
+
+void
+NESApp::CpuWindow::
+update(const EmulationThread::MachineState& state)
 {
+    m_state = state;
+    m_dirty = true;
 }
 
 void
 NESApp::CpuWindow::
 render()
 {
-    // FIXME: Only render on tick change.. or only when the simulation is paused.
-    // Get information from the CPU.
+    if (!m_dirty) {
+        return;
+    }
+
     std::stringstream output;
     output << "Cpu65XX Status" << std::endl
-           << std::hex << "A:  0x" << (int)m_cpu.A()  << std::endl
-           << std::hex << "X:  0x" << (int)m_cpu.X()  << std::endl
-           << std::hex << "Y:  0x" << (int)m_cpu.Y()  << std::endl
-           << std::hex << "PC: 0x" << (int)m_cpu.PC() << std::endl
-           << std::hex << "S:  0x" << (int)m_cpu.S()  << std::endl;
+           << std::hex << "A:  0x" << (int)m_state.m_A  << std::endl
+           << std::hex << "X:  0x" << (int)m_state.m_X  << std::endl
+           << std::hex << "Y:  0x" << (int)m_state.m_Y  << std::endl
+           << std::hex << "PC: 0x" << (int)m_state.m_PC << std::endl
+           << std::hex << "S:  0x" << (int)m_state.m_S  << std::endl;
     render_diagnostic_text(output.str());
+    m_dirty = false;
 }
 
 
 NESApp::PpuWindow::
-PpuWindow(PPU& ppu) :
+PpuWindow() :
     DiagnosticWindow("win-ppu",
               "NES PPU Instrumentation",
               CONSOLE_WIDTH + 205, 5,
               300, 200),
-    m_ppu (ppu)
+    m_state (),
+    m_dirty (true)
 {}
 
+void
+NESApp::PpuWindow::
+update(const EmulationThread::MachineState& state)
+{
+    m_state = state;
+    m_dirty = true;
+}
+
 void
 NESApp::PpuWindow::
 render()
 {
+    if (!m_dirty) {
+        return;
+    }
+
     std::stringstream output;
 
-    std::vector<std::pair<u16_word, const char *>> registers = {
-            { PPU::CONTROL_ADDRESS,         "Control        :" },
-            { PPU::MASK_ADDRESS,            "Mask           :" },            
-            { PPU::STATUS_ADDRESS,          "Status         :" },          
-            { PPU::OAM_ADDRESS_ADDRESS,     "OAM Address    :" },     
-            { PPU::OAM_DATA_ADDRESS,        "OAM Data       :" },        
-            { PPU::OAM_DMA_ADDRESS,         "OAM DMA        :" },         
-            { PPU::SCROLL_ADDRESS,          "Scroll         :" },          
-            { PPU::SCROLL_ADDRESS_ADDRESS,  "Scroll Address :" },  
-            /* { PPU::SCROLL_DATA_ADDRESS,     "Scroll Data    :" } */     
-    };
-    
     output << "PPU Status" << std::endl;
 
-    std::for_each(registers.begin(), registers.end(), [&](std::pair<u16_word, const char *> p) {
-            output << p.second << " " << std::hex 
-                   << (int)m_ppu.registerBlock().rawReadByte(p.first) << std::endl;
-    });
+    for (unsigned int i = 0; i < PPUInspector::FIELD_COUNT; ++i) {
+        PPUInspector::Field field = static_cast<PPUInspector::Field>(i);
+        output << PPUInspector::fieldName(field) << ": "
+               << std::hex << m_state.m_ppuRegisters[i] << std::endl;
+    }
 
     render_diagnostic_text(output.str());
+    m_dirty = false;
+}
+
+const CommandCode NESApp::DisplayWindow::PALETTE_COMMAND = 3;
+const CommandCode NESApp::DisplayWindow::NTSC_COMMAND    = 4;
+
+NESApp::DisplayWindow::
+DisplayWindow() :
+    EmuWindow("win-display",
+              "NES",
+              CONSOLE_WIDTH + 5, 210,
+              NES_DISPLAY_WIDTH * NES_DISPLAY_SCALE, NES_DISPLAY_HEIGHT * NES_DISPLAY_SCALE),
+    m_sdl_renderer (nullptr),
+    m_texture (nullptr),
+    m_textureWidth (NES_DISPLAY_WIDTH),
+    m_pixels (NES_DISPLAY_WIDTH * NES_DISPLAY_HEIGHT * PixelConvert::bytesPerPixel(PIXEL_FORMAT), 0),
+    m_width (NES_DISPLAY_WIDTH),
+    m_dirty (true),
+    m_ntsc (),
+    m_ntscFrame (0),
+    m_settingsMutex (),
+    m_paletteChanged (false),
+    m_palette (),
+    m_ntscChanged (false),
+    m_ntscScale (0)
+{
+    registerCommands();
+
+    m_sdl_renderer = SDL_CreateRenderer(m_sdl_window, -1, 0);
+    checkSDLError(NULL == m_sdl_renderer, "SDL_CreateRenderer() failed: ");
+
+    m_texture = SDL_CreateTexture(m_sdl_renderer,
+                                  SDL_PIXELFORMAT_ARGB8888,
+                                  SDL_TEXTUREACCESS_STREAMING,
+                                  NES_DISPLAY_WIDTH, NES_DISPLAY_HEIGHT);
+    checkSDLError(NULL == m_texture, "SDL_CreateTexture() failed: ");
+}
+
+NESApp::DisplayWindow::
+~DisplayWindow()
+{
+    SDL_DestroyTexture(m_texture);
+    SDL_DestroyRenderer(m_sdl_renderer);
+}
+
+void
+NESApp::DisplayWindow::
+registerCommands()
+{
+    addCommand(Command("palette", PALETTE_COMMAND,
+                       "Takes 1 argument: <file.pal|default>.\n"
+                       " Show colours from a .pal file of 64 or 512 RGB triples.", 1));
+    addCommand(Command("ntsc", NTSC_COMMAND,
+                       "Takes 1 argument: <2|3|off>.\n"
+                       " Show pictures through an NTSC composite filter at 2 or 3 times\n"
+                       " the width, or without it. The filter makes its own colours.", 1));
+}
+
+CommandResult
+NESApp::DisplayWindow::
+receiveCommand(CommandInput command)
+{
+    if (command.m_code != PALETTE_COMMAND && command.m_code != NTSC_COMMAND) {
+        return EmuWindow::receiveCommand(command);
+    }
+
+    CommandResult result;
+    std::vector<u8_byte> palette;
+    if (command.m_arguments.size() != 1) {
+        result.m_code = CommandResult::WRONG_NUM_ARGS;
+        return result;
+    }
+
+    if (command.m_code == NTSC_COMMAND) {
+        const std::string &argument = command.m_arguments[0];
+        unsigned int scale = 0;
+        if (argument == "2" || argument == "3") {
+            scale = argument[0] - '0';
+        }
+        else if (argument != "off") {
+            result.m_code = CommandResult::INVALID_ARGUMENT;
+            return result;
+        }
+        std::lock_guard<std::mutex> lock(m_settingsMutex);
+        m_ntscScale   = scale;
+        m_ntscChanged = true;
+        result.m_code = CommandResult::OK;
+        return result;
+    }
+
+    if (command.m_arguments[0] != "default" &&
+        !PixelConvert::readPalette(command.m_arguments[0], palette, result.m_output)) {
+        result.m_code = CommandResult::ERROR;
+        return result;
+    }
+
+    std::lock_guard<std::mutex> lock(m_settingsMutex);
+    m_palette.swap(palette);
+    m_paletteChanged = true;
+    result.m_code = CommandResult::OK;
+    return result;
+}
+
+void
+NESApp::DisplayWindow::
+applySettings()
+{
+    std::lock_guard<std::mutex> lock(m_settingsMutex);
+    if (m_paletteChanged) {
+        PixelConvert::setPalette(m_palette);
+        m_paletteChanged = false;
+    }
+    if (m_ntscChanged) {
+        m_ntsc.reset(m_ntscScale ? new NtscFilter(m_ntscScale, PIXEL_FORMAT) : nullptr);
+        m_width = m_ntsc ? m_ntsc->width() : NES_DISPLAY_WIDTH;
+        m_pixels.assign(m_width * NES_DISPLAY_HEIGHT * PixelConvert::bytesPerPixel(PIXEL_FORMAT), 0);
+        m_ntscChanged = false;
+    }
+}
+
+void
+NESApp::DisplayWindow::
+update(const IndexedFrame& picture)
+{
+    applySettings();
+    if (m_ntsc) {
+        m_ntsc->filter(picture, m_ntscFrame++ % NtscFilter::PHASES, &m_pixels[0], pitch());
+    }
+    else {
+        PixelConvert::convert(picture, PIXEL_FORMAT, &m_pixels[0], pitch());
+    }
+    m_dirty = true;
+}
+
+void
+NESApp::DisplayWindow::
+render()
+{
+    if (!m_dirty) {
+        return;
+    }
+
+    // The window stays the same size; the filtered picture is squeezed
+    // back into it.
+    if (m_textureWidth != m_width) {
+        SDL_DestroyTexture(m_texture);
+        m_texture = SDL_CreateTexture(m_sdl_renderer,
+                                      SDL_PIXELFORMAT_ARGB8888,
+                                      SDL_TEXTUREACCESS_STREAMING,
+                                      m_width, NES_DISPLAY_HEIGHT);
+        checkSDLError(NULL == m_texture, "SDL_CreateTexture() failed: ");
+        m_textureWidth = m_width;
+    }
+
+    SDL_UpdateTexture(m_texture, NULL, &m_pixels[0], pitch());
+    SDL_RenderClear(m_sdl_renderer);
+    SDL_RenderCopy(m_sdl_renderer, m_texture, NULL, NULL);
+    SDL_RenderPresent(m_sdl_renderer);
+
+    m_dirty = false;
 }
 
 bool 
@@ -224,13 +408,21 @@ onInit()
 
     m_focused_window = m_console_window;
 
-    m_cpu_window = new CpuWindow(m_nes.cpu());    
+    m_cpu_window = new CpuWindow();    
     m_windows[m_cpu_window->id()] = m_cpu_window;
 
-    m_ppu_window = new PpuWindow(m_nes.ppu());    
+    m_ppu_window = new PpuWindow();    
     m_windows[m_ppu_window->id()] = m_ppu_window;
 
+    m_display_window = new DisplayWindow();
+    m_windows[m_display_window->id()] = m_display_window;
+
+    // The startup script runs here, before there's anything to race with.
+    // Everything after goes through the emulation thread.
     runStartupScript();
+
+    m_console.setCommandChannel(&m_emulation.commands());
+    m_emulation.start();
 /*
     if ((m_nes_display = SDL_SetVideoMode(NES_DISPLAY_WIDTH, NES_DISPLAY_HEIGHT, video->vfmt->BitsPerPixel, SDL_OPENGL)) == NULL) { 
         return false; 
@@ -311,8 +503,17 @@ void
 NESApp::
 onLoop()
 {
-    //TODO: Measure time between frames?
-    m_nes.tick();
+    m_console.poll();
+
+    // Pick up the most recent frame. The emulation thread never waits on us,
+    // frames we were too slow to show are simply replaced.
+    TripleBuffer<EmulationThread::VideoFrame> &frames = m_emulation.frames();
+    if (frames.consume()) {
+        const EmulationThread::VideoFrame &frame = frames.front();
+        m_display_window->update(frame.m_picture);
+        m_cpu_window->update(frame.m_state);
+        m_ppu_window->update(frame.m_state);
+    }
 }
 
 void 
@@ -320,13 +521,18 @@ NESApp::
 onRender()
 {
     std::for_each(m_windows.begin(), m_windows.end(), 
-            [](std::pair<unsigned int, EmuWindow*> it) { it.second->render(); });
+            [](std::pair<unsigned int, EmuWindow*> it) {
+                it.second->updateVisibility();
+                it.second->render();
+            });
 }
 
 void 
 NESApp::
 onCleanup()
 {
+    // Stop emulating before tearing down anything it might be using.
+    m_emulation.stop();
     delete m_console_window;
 }
 
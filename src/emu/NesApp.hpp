@@ -5,8 +5,14 @@
 
 #include "NES.hpp"
 #include "EmuWindow.hpp"
+#include "EmulationThread.hpp"
+#include "PPU/NtscFilter.hpp"
+#include "PPU/PixelConvert.hpp"
 #include "utility/Console.hpp"
 
+#include <memory>
+#include <mutex>
+
 class NESApp {
     public:
         NESApp(std::string startup_script);
@@ -35,29 +41,84 @@ class NESApp {
                 Console&      m_console;
         };
 
+        // Diagnostic windows show the machine state published with the
+        // latest frame, never the live (and busy) emulation thread's.
         class CpuWindow : public DiagnosticWindow {
             public:
-                CpuWindow(const Cpu65XX& cpu);
+                CpuWindow();
+
+                void update(const EmulationThread::MachineState& state);
 
                 virtual void render(); 
                 virtual void onEvent(SDL_Event* Event) {}
 
             private:
-                const Cpu65XX& m_cpu;
+                EmulationThread::MachineState m_state;
+                bool          m_dirty;
                 SDL_Renderer* m_sdl_renderer;
                 TTF_Font*     m_font;
         };
 
         class PpuWindow : public DiagnosticWindow {
             public:
-                // FIXME: We should be taking a const reference here...
-                PpuWindow(PPU& ppu);
+                PpuWindow();
+
+                void update(const EmulationThread::MachineState& state);
 
                 virtual void render();
                 virtual void onEvent(SDL_Event* Event) {}
 
             protected:
-                PPU& m_ppu;
+                EmulationThread::MachineState m_state;
+                bool m_dirty;
+        };
+
+        class DisplayWindow : public EmuWindow {
+            public:
+                DisplayWindow();
+                virtual ~DisplayWindow();
+
+                void update(const IndexedFrame& picture);
+
+                virtual void render();
+                virtual void onEvent(SDL_Event* Event) {}
+
+                // Commandable interface.
+                static const CommandCode PALETTE_COMMAND;
+                static const CommandCode NTSC_COMMAND;
+
+                virtual CommandResult receiveCommand(CommandInput command);
+
+            private:
+                void registerCommands();
+                void applySettings();
+
+                // SDL_PIXELFORMAT_ARGB8888 as laid out in memory; the
+                // texture format renderers take without converting.
+                static const PixelConvert::Format PIXEL_FORMAT = PixelConvert::BGRA8888;
+
+                int pitch() const { return m_width * PixelConvert::bytesPerPixel(PIXEL_FORMAT); }
+
+                SDL_Renderer*        m_sdl_renderer;
+                SDL_Texture*         m_texture;
+                unsigned int         m_textureWidth;
+                std::vector<u8_byte> m_pixels;
+                unsigned int         m_width;
+                bool                 m_dirty;
+
+                // With the NTSC filter on, pictures go through it rather
+                // than PixelConvert, with the subcarrier phase stepping
+                // each frame.
+                std::unique_ptr<NtscFilter> m_ntsc;
+                unsigned int                m_ntscFrame;
+
+                // 'palette' and 'ntsc' arrive on the emulation thread; the
+                // settings change on the UI thread, between conversions.
+                std::mutex           m_settingsMutex;
+                bool                 m_paletteChanged;
+                std::vector<u8_byte> m_palette;
+                bool                 m_ntscChanged;
+                unsigned int         m_ntscScale;       // 0 for off.
         };
 
     protected:
@@ -67,11 +128,13 @@ class NESApp {
     private:
         bool            m_running;
         NES             m_nes;
+        EmulationThread m_emulation;
         Console         m_console;
 
         ConsoleWindow*         m_console_window;
         CpuWindow*             m_cpu_window;
         PpuWindow*             m_ppu_window;
+        DisplayWindow*         m_display_window;
         EmuWindow*             m_focused_window;
         std::map<unsigned int, EmuWindow*> m_windows;
 
@@ -4,6 +4,7 @@
 
 MMC1Mapper::
 MMC1Mapper(iNESFile &file) :
+    Mapper(file),
     m_rom(file),
     m_shift(),
     m_configuration(),
@@ -13,9 +14,6 @@ MMC1Mapper(iNESFile &file) :
     m_cpuMemory(PRG_RAM_BANK_BEGIN, 
                 SECOND_PRG_ROM_BANK_END, 
                 std::vector<Memory*>()),
-    m_ppuMemory(FIRST_VROM_BANK_BEGIN,
-                SECOND_VROM_BANK_END,
-                std::vector<Memory*>()),
     m_prgRam(PRG_RAM_BANK_BEGIN, PRG_RAM_BANK_END),
     m_prgBanks(),
     m_vromBanks()
@@ -31,13 +29,17 @@ MMC1Mapper(iNESFile &file) :
         m_prgBanks.push_back(BackedMemory(PRG_BANK_SIZE));
     }
 
-    // Copy valid data.
+    // CHR ROM comes in 8 KB pages, switched 4 KB at a time. Without any
+    // the banks are CHR RAM.
+    unsigned int vromBanks = m_rom.CHRROMDataSize() / VROM_BANK_SIZE;
     for (unsigned int n = 0; n < NUM_VROM_BANKS; ++n) {
-        m_prgBanks.push_back(BackedMemory(VROM_BANK_SIZE, m_rom.vromPage(n)));
-    }
-    // Fill in rest of pages.
-    for (unsigned int n = 0; n < m_rom.numberOfCHRROMPages(); ++n) {
-        m_vromBanks.push_back(BackedMemory(VROM_BANK_SIZE));
+        if (n < vromBanks) {
+            u8_byte *page = m_rom.vromPage(n / 2) + (n % 2) * VROM_BANK_SIZE;
+            m_vromBanks.push_back(BackedMemory(VROM_BANK_SIZE, page));
+        }
+        else {
+            m_vromBanks.push_back(BackedMemory(VROM_BANK_SIZE));
+        }
     }
 
     assert(m_prgBanks.size()  == NUM_PRG_BANKS);
@@ -56,17 +58,6 @@ MMC1Mapper(iNESFile &file) :
     segment->setAddressRange(SECOND_PRG_ROM_BANK_BEGIN,
                              SECOND_PRG_ROM_BANK_END);
     m_cpuMemory.addSegment(segment);
-
-    // PPU Banks.
-    segment = &(m_vromBanks.at(0));
-    segment->setAddressRange(FIRST_VROM_BANK_BEGIN,
-                             FIRST_VROM_BANK_END);
-    m_ppuMemory.addSegment(segment);
-
-    segment =&(m_vromBanks.at(1));
-    segment->setAddressRange(SECOND_VROM_BANK_BEGIN,
-                             SECOND_VROM_BANK_END);
-    m_ppuMemory.addSegment(segment);
 }
 
 MMC1Mapper::
@@ -81,11 +72,38 @@ cpuMemory()
     return &m_cpuMemory;
 }
 
-Memory*
+u8_byte*
+MMC1Mapper::
+chrPage(unsigned int page)
+{
+    const unsigned int pagesPerBank = VROM_BANK_SIZE / VideoMemory::PAGE_SIZE;
+    assert(page < 2 * pagesPerBank && "MMC1Mapper::chrPage: no such page!");
+    return m_vromBanks.at(vromBank(page / pagesPerBank)).data() +
+           (page % pagesPerBank) * VideoMemory::PAGE_SIZE;
+}
+
+bool
 MMC1Mapper::
-ppuMemory()
+chrWritable() const
 {
-    return &m_ppuMemory;
+    return m_rom.CHRROMDataSize() == 0;
+}
+
+VideoMemory::Mirroring
+MMC1Mapper::
+mirroring() const
+{
+    switch (m_configuration.mirroringType()) {
+        case ConfigurationRegister::SingleScreenBlk0:
+            return VideoMemory::SingleScreenLower;
+        case ConfigurationRegister::SingleScreenBlk1:
+            return VideoMemory::SingleScreenUpper;
+        case ConfigurationRegister::TwoScreenVerticalMirroring:
+            return VideoMemory::VerticalMirroring;
+        case ConfigurationRegister::TwoScreenHorizontalMirroring:
+            return VideoMemory::HorizontalMirroring;
+    }
+    return VideoMemory::HorizontalMirroring;
 }
 
 const char *
@@ -136,31 +154,21 @@ updateMemory()
     m_cpuMemory.addSegment(firstCpuBank);
     m_cpuMemory.addSegment(secondCpuBank);
 
-    // Update PPU memory map.
-    
-    // Remove current PPU segments.
-    m_ppuMemory.removeSegment(FIRST_VROM_BANK_BEGIN);
-    m_ppuMemory.removeSegment(SECOND_VROM_BANK_BEGIN);
-
-    BackedMemory * firstPpuBank     = nullptr;
-    BackedMemory * secondPpuBank    = nullptr;
+    // The PPU reads CHR (see chrPage()) and mirroring straight from the
+    // registers; it just needs telling they've changed.
+    videoChanged();
+}
 
+unsigned int
+MMC1Mapper::
+vromBank(unsigned int half) const
+{
     // Switch 2 separate 4 KB banks.
     if (m_configuration.vromSwitchingSize()) {
-        firstPpuBank    = &(m_vromBanks.at(m_vromSelect0k.bankNumber()));
-        secondPpuBank   = &(m_vromBanks.at(m_vromSelect1k.bankNumber()));
-    } 
-    // Switch 8 KB bank.
-    else {
-        // We ignore the lowbit.
-        u8_byte ppuBankSelect = m_vromSelect0k.bankNumber() & 0x1E;
-        firstPpuBank          = &(m_vromBanks.at(ppuBankSelect));
-        secondPpuBank         = &(m_vromBanks.at(ppuBankSelect + 1));
+        return half == 0 ? m_vromSelect0k.bankNumber() : m_vromSelect1k.bankNumber();
     }
-
-    // Now add the select banks into the ppu memory map.
-    m_ppuMemory.addSegment(firstPpuBank);
-    m_ppuMemory.addSegment(secondPpuBank);
+    // Switch 8 KB bank. We ignore the lowbit.
+    return (m_vromSelect0k.bankNumber() & 0x1E) + half;
 }
 
 MMC1Mapper::CpuMemory::
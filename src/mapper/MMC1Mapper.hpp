@@ -11,7 +11,10 @@ public:
     virtual ~MMC1Mapper();
 
     virtual Memory *cpuMemory();
-    virtual Memory *ppuMemory();
+
+    virtual u8_byte* chrPage(unsigned int page);
+    virtual bool     chrWritable() const;
+    virtual VideoMemory::Mirroring mirroring() const;
 
     virtual const char* name() const;
 
@@ -48,6 +51,8 @@ public:
 private:
     // Makes cpu & ppu memory maps reflect current configuration.
     void  updateMemory();
+    // The VROM bank the PPU sees at $0000 (half 0) or $1000 (half 1).
+    unsigned int vromBank(unsigned int half) const;
 
     class CpuMemory : public MappedMemory
     {
@@ -151,7 +156,6 @@ private:
     PRGROMSelectRegister  m_prgromSelect;   // Register 3
 
     MappedMemory m_cpuMemory;
-    MappedMemory m_ppuMemory;
     BackedMemory m_prgRam;
     std::vector<BackedMemory> m_prgBanks;
     std::vector<BackedMemory> m_vromBanks;
@@ -7,13 +7,50 @@
 #include <cassert>
 
 Mapper::
-Mapper()
-{}
+Mapper(iNESFile &file) :
+    m_mirroring (VideoMemory::HorizontalMirroring),
+    m_videoChangeHandler ()
+{
+    switch (file.mirrorMode()) {
+        case iNESFile::horizontalMirroring:
+            m_mirroring = VideoMemory::HorizontalMirroring;
+            break;
+        case iNESFile::verticalMirroring:
+            m_mirroring = VideoMemory::VerticalMirroring;
+            break;
+        case iNESFile::fourScreenMirroring:
+            m_mirroring = VideoMemory::FourScreenMirroring;
+            break;
+    }
+}
 
 Mapper::
 ~Mapper()
 {}
 
+VideoMemory::Mirroring
+Mapper::
+mirroring() const
+{
+    return m_mirroring;
+}
+
+void
+Mapper::
+setVideoChangeHandler(std::function<void()> handler)
+{
+    m_videoChangeHandler = handler;
+}
+
+void
+Mapper::
+videoChanged()
+{
+    if (m_videoChangeHandler) {
+        m_videoChangeHandler();
+    }
+}
+
 Mapper*
 Mapper::
 getMapper(iNESFile &file)
@@ -27,7 +64,6 @@ getMapper(iNESFile &file)
         {
             // FIXME: Send to logger instead?
             std::cerr << "Unhandled mapper number encountered! Number: " << file.mapperNumber() << std::endl;
-            assert(false && "Unhandled mapper encountered!");
         }
     }
     return nullptr;
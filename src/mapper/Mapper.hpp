@@ -3,11 +3,14 @@
 
 #include "utility/Memory.hpp"
 #include "IO/iNESFile.hpp"
+#include "PPU/VideoMemory.hpp"
+
+#include <functional>
 
 class Mapper 
 {
 public:
-    Mapper();
+    Mapper(iNESFile &file);
     virtual ~Mapper();
 
     enum MapperNumber {
@@ -18,14 +21,31 @@ public:
     };
 
     virtual Memory *cpuMemory() = 0;
-    virtual Memory *ppuMemory() = 0;
+
+    // The 1KB of CHR the PPU sees at page * 0x400 (page 0-7), and whether
+    // it's RAM the PPU may write to.
+    virtual u8_byte* chrPage(unsigned int page) = 0;
+    virtual bool     chrWritable() const = 0;
+    // The header's unless the board switches it.
+    virtual VideoMemory::Mirroring mirroring() const;
 
     virtual const char* name() const = 0;
 
+    // Called whenever the mapper switches the CHR banks or the mirroring
+    // the PPU sees.
+    void setVideoChangeHandler(std::function<void()> handler);
+
     //Constructs and returns an appropriate Mapper for the supplied
-    //iNESFile argument.
+    //iNESFile argument, or nullptr if the mapper isn't supported.
     //TODO: Used some sort of shared_ptr instead?
     static Mapper* getMapper(iNESFile &file);
+
+protected:
+    void videoChanged();
+
+private:
+    VideoMemory::Mirroring m_mirroring;
+    std::function<void()>  m_videoChangeHandler;
 };
 
 #endif //NES_MAPPER_H
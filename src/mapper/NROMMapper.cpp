@@ -1,15 +1,32 @@
 #include "NROMMapper.hpp"
 
+#include <cassert>
+
 NROMMapper::
 NROMMapper(iNESFile &file) :
+    Mapper(file),
     m_rom (file),
-    m_cpuMemory(file.PRGROMDataSize(), file.prgRomPage(0)),
-    m_ppuMemory(file.CHRROMDataSize(), file.vromPage(0))
+    m_cpuMemory(PRG_ROM_BANK_BEGIN, PRG_ROM_BANK_END),
+    m_ppuMemory(VROM_BANK_BEGIN, VROM_BANK_END),
+    m_chrRam (file.CHRROMDataSize() == 0)
 {
-    // FIXME: What if the data size in the file doesn't fill the needed space?
-    m_cpuMemory.setAddressRange(PRG_ROM_BANK_BEGIN, PRG_ROM_BANK_BEGIN + file.PRGROMDataSize());
-    // FIXME: What if the data size in the file doesn't fill the needed space?
-    m_ppuMemory.setAddressRange(VROM_BANK_BEGIN, VROM_BANK_BEGIN + file.CHRROMDataSize());
+    // NROM-128 carts only have 16k of PRG ROM, which shows up twice.
+    unsigned int prgSize = file.PRGROMDataSize();
+    if (prgSize > 0) {
+        u8_byte *prg = file.prgRomPage(0);
+        for (unsigned int offset = 0; offset < PRG_BANK_SIZE; ++offset) {
+            m_cpuMemory.rawWrite(PRG_ROM_BANK_BEGIN + offset, prg[offset % prgSize]);
+        }
+    }
+
+    // No CHR ROM means the board has CHR RAM, which starts out zeroed.
+    unsigned int chrSize = file.CHRROMDataSize();
+    if (chrSize > 0) {
+        u8_byte *chr = file.vromPage(0);
+        for (unsigned int offset = 0; offset < VROM_BANK_SIZE && offset < chrSize; ++offset) {
+            m_ppuMemory.rawWrite(VROM_BANK_BEGIN + offset, chr[offset]);
+        }
+    }
 }
 
 Memory*
@@ -19,9 +36,17 @@ cpuMemory()
     return &m_cpuMemory;
 }
 
-Memory*
+u8_byte*
+NROMMapper::
+chrPage(unsigned int page)
+{
+    assert(page < VROM_BANK_SIZE / VideoMemory::PAGE_SIZE && "NROMMapper::chrPage: no such page!");
+    return m_ppuMemory.data() + page * VideoMemory::PAGE_SIZE;
+}
+
+bool
 NROMMapper::
-ppuMemory() 
+chrWritable() const
 {
-    return &m_ppuMemory;
+    return m_chrRam;
 }
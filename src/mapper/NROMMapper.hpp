@@ -9,7 +9,9 @@ public:
     NROMMapper(iNESFile &file); 
 
     virtual Memory *cpuMemory(); 
-    virtual Memory *ppuMemory();
+
+    virtual u8_byte* chrPage(unsigned int page);
+    virtual bool     chrWritable() const;
 
     virtual const char* name() const { return "NROM"; }
 
@@ -34,6 +36,7 @@ private:
     iNESFile     m_rom;
     BackedMemory m_cpuMemory;
     BackedMemory m_ppuMemory;
+    bool         m_chrRam;
 };
 
 #endif //NROM_MAPPER_H
@@ -0,0 +1,112 @@
+#include "InputScript.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <fstream>
+#include <sstream>
+
+InputScript::
+InputScript() :
+    m_entries (),
+    m_error ()
+{
+}
+
+bool
+InputScript::
+load(const std::string& filename)
+{
+    std::ifstream input(filename.c_str());
+    if (!input.is_open()) {
+        m_error = "Couldn't open input script " + filename + ".";
+        return false;
+    }
+    return parse(input);
+}
+
+bool
+InputScript::
+parse(std::istream& input)
+{
+    m_entries.clear();
+    m_error.clear();
+
+    std::string line;
+    for (unsigned int lineNumber = 1; std::getline(input, line); ++lineNumber) {
+        line = line.substr(0, line.find('#'));
+
+        std::istringstream fields(line);
+        std::string frame;
+        if (!(fields >> frame)) {
+            continue;
+        }
+
+        std::stringstream where;
+        where << "Input script line " << lineNumber << ": ";
+
+        Entry entry;
+        std::istringstream frameStream(frame);
+        if (!(frameStream >> entry.m_frame) || !frameStream.eof()) {
+            m_error = where.str() + "bad frame number '" + frame + "'.";
+            return false;
+        }
+        if (!m_entries.empty() && entry.m_frame <= m_entries.back().m_frame) {
+            m_error = where.str() + "frames must be in increasing order.";
+            return false;
+        }
+
+        for (unsigned int port = 0; port < PORTS; ++port) {
+            std::string pad(".");
+            fields >> pad;
+            if (!parseButtons(pad, entry.m_buttons[port])) {
+                m_error = where.str() + "bad buttons '" + pad + "'.";
+                return false;
+            }
+        }
+        std::string extra;
+        if (fields >> extra) {
+            m_error = where.str() + "unexpected '" + extra + "'.";
+            return false;
+        }
+
+        m_entries.push_back(entry);
+    }
+    return true;
+}
+
+bool
+InputScript::
+parseButtons(const std::string& text, u8_byte& buttons) const
+{
+    buttons = 0x00;
+    if (text == ".") {
+        return true;
+    }
+
+    // Indexed by NESJoypad::Button.
+    const std::string letters("ABsSUDLR");
+    for (char letter : text) {
+        std::string::size_type button = letters.find(letter);
+        if (button == std::string::npos) {
+            return false;
+        }
+        buttons |= 0x01 << button;
+    }
+    return true;
+}
+
+u8_byte
+InputScript::
+buttons(unsigned int frame, unsigned int port) const
+{
+    assert(port < PORTS && "InputScript::buttons: no such port!");
+
+    // The last entry at or before frame.
+    std::vector<Entry>::const_iterator it =
+        std::upper_bound(m_entries.begin(), m_entries.end(), frame,
+                         [] (unsigned int f, const Entry& entry) { return f < entry.m_frame; });
+    if (it == m_entries.begin()) {
+        return 0x00;
+    }
+    return (it - 1)->m_buttons[port];
+}
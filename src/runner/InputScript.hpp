@@ -0,0 +1,52 @@
+#ifndef INPUT_SCRIPT_H
+#define INPUT_SCRIPT_H
+
+#include "utility/DataTypes.hpp"
+
+#include <istream>
+#include <string>
+#include <vector>
+
+/*
+InputScript
+
+Controller input for a headless run, as a text file of lines
+
+    <frame> <pad 1> [pad 2]
+
+where each pad is the set of buttons held from that frame on, written with
+the letters A, B, s (select), S (start), U, D, L and R, or '.' for none.
+Lines must be in frame order; '#' starts a comment. Buttons are held until
+the next line, so a script only needs a line when something changes.
+*/
+
+class InputScript
+{
+public:
+    static const unsigned int PORTS = 2;
+
+    InputScript();
+
+    // Both return false and set error() on a bad script.
+    bool load(const std::string& filename);
+    bool parse(std::istream& input);
+
+    // Buttons held on a port during frame (NESJoypad bit order).
+    u8_byte buttons(unsigned int frame, unsigned int port) const;
+
+    const std::string& error() const { return m_error; }
+
+private:
+    struct Entry
+    {
+        unsigned int m_frame;
+        u8_byte      m_buttons[PORTS];
+    };
+
+    bool parseButtons(const std::string& text, u8_byte& buttons) const;
+
+    std::vector<Entry> m_entries;
+    std::string        m_error;
+};
+
+#endif //INPUT_SCRIPT_H
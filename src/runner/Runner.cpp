@@ -0,0 +1,299 @@
+#include "Runner.hpp"
+#include "InputScript.hpp"
+#include "emu/NES.hpp"
+#include "PPU/PixelConvert.hpp"
+#include "utility/Hash.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+
+typedef std::chrono::steady_clock RunnerClock;
+
+static std::string
+dumpName(const std::string& prefix, unsigned int frame, const char* what)
+{
+    std::stringstream name;
+    name << prefix << std::setw(6) << std::setfill('0') << frame << "-" << what << ".ppm";
+    return name.str();
+}
+
+static double
+secondsSince(RunnerClock::time_point start)
+{
+    return std::chrono::duration<double>(RunnerClock::now() - start).count();
+}
+
+Runner::
+Runner(unsigned int threads, bool pinned) :
+    m_pool (threads, pinned),
+    m_seconds (0.0)
+{
+}
+
+std::vector<RunnerResult>
+Runner::
+run(const std::vector<RunnerJob>& jobs)
+{
+    std::vector<RunnerResult> results(jobs.size());
+
+    // Deal the longest jobs out first so stragglers are short ones that
+    // can be stolen, not one long job keeping a core busy at the end.
+    std::vector<unsigned int> order;
+    for (unsigned int i = 0; i < jobs.size(); ++i) {
+        order.push_back(i);
+    }
+    std::stable_sort(order.begin(), order.end(), [&jobs] (unsigned int a, unsigned int b) {
+            return jobs[a].m_frames > jobs[b].m_frames;
+    });
+
+    RunnerClock::time_point start = RunnerClock::now();
+    m_pool.run(order.size(), [&] (unsigned int task, unsigned int worker) {
+            unsigned int job = order[task];
+            results[job] = runJob(jobs[job]);
+            results[job].m_worker = worker;
+    });
+    m_seconds = secondsSince(start);
+
+    return results;
+}
+
+RunnerResult
+Runner::
+runJob(const RunnerJob& job)
+{
+    RunnerResult result;
+    RunnerClock::time_point start = RunnerClock::now();
+
+    InputScript script;
+    if (!job.m_inputPath.empty() && !script.load(job.m_inputPath)) {
+        result.m_error   = script.error();
+        result.m_seconds = secondsSince(start);
+        return result;
+    }
+
+    NESJoypad pads[InputScript::PORTS];
+    NES nes;
+    if (!nes.load(job.m_romPath.c_str())) {
+        result.m_error   = "Couldn't load ROM " + job.m_romPath + ".";
+        result.m_seconds = secondsSince(start);
+        return result;
+    }
+    nes.setController1(&pads[0]);
+    nes.setController2(&pads[1]);
+
+    std::vector<std::uint64_t> golden;
+    bool checkGolden = !job.m_goldenPath.empty();
+    if (checkGolden && !readFrameHashes(job.m_goldenPath, golden, result.m_error)) {
+        result.m_seconds = secondsSince(start);
+        return result;
+    }
+
+    FrameCapture capture("capture", job.m_captureQueueFrames);
+    if (!job.m_capturePath.empty() &&
+        !capture.start(job.m_captureFormat, job.m_capturePath, job.m_capturePolicy, result.m_error)) {
+        result.m_seconds = secondsSince(start);
+        return result;
+    }
+
+    // Flat out, pictures ready as soon as the frame is.
+    nes.cpu().setTracing(false);
+    nes.ppu().setRenderMode(RenderPipeline::InlineMode);
+    nes.pacer().setSpeed(FramePacer::UNTHROTTLED);
+    nes.powerOn();
+    nes.setPaused(false);
+
+    // The last picture that matched, kept only until something doesn't.
+    IndexedFrame matched;
+
+    result.m_frameHashes.reserve(job.m_frames);
+    for (unsigned int frame = 0; frame < job.m_frames; ++frame) {
+        for (unsigned int port = 0; port < InputScript::PORTS; ++port) {
+            pads[port].setButtons(script.buttons(frame, port));
+        }
+        nes.runFrame();
+        const IndexedFrame &picture = nes.ppu().displayBuffer();
+        std::uint64_t hash = picture.hash();
+        result.m_frameHashes.push_back(hash);
+        capture.capture(picture);
+
+        if (!checkGolden || result.m_diverged) {
+            continue;
+        }
+        if (frame < golden.size() && golden[frame] == hash) {
+            if (!job.m_dumpPrefix.empty()) {
+                matched = picture;
+            }
+            continue;
+        }
+        result.m_diverged       = true;
+        result.m_divergentFrame = frame;
+        result.m_goldenHash     = frame < golden.size() ? golden[frame] : 0;
+        if (!job.m_dumpPrefix.empty()) {
+            dumpPicture(picture, dumpName(job.m_dumpPrefix, frame, "actual"));
+            if (frame > 0) {
+                dumpPicture(matched, dumpName(job.m_dumpPrefix, frame - 1, "matched"));
+            }
+        }
+    }
+    capture.stop();
+    result.m_capture = capture.statistics();
+
+    // Stopping short of the golden stream is a divergence too, just one
+    // without a picture.
+    if (checkGolden && !result.m_diverged && golden.size() > job.m_frames) {
+        result.m_diverged       = true;
+        result.m_divergentFrame = job.m_frames;
+        result.m_goldenHash     = golden[job.m_frames];
+    }
+
+    result.m_hash = Hash::xxh3(result.m_frameHashes.data(),
+                               result.m_frameHashes.size() * sizeof(std::uint64_t));
+    result.m_status = ((job.m_checkHash && result.m_hash != job.m_expectedHash) || result.m_diverged) ?
+        RunnerResult::Mismatch : RunnerResult::Passed;
+    result.m_seconds = secondsSince(start);
+    return result;
+}
+
+bool
+Runner::
+parseJobList(std::istream& input,
+             const std::string& baseDirectory,
+             std::vector<RunnerJob>& jobs,
+             std::string& error)
+{
+    auto resolve = [&baseDirectory] (const std::string& path) {
+        if (path.empty() || path[0] == '/' || baseDirectory.empty()) {
+            return path;
+        }
+        return baseDirectory + "/" + path;
+    };
+
+    std::string line;
+    for (unsigned int lineNumber = 1; std::getline(input, line); ++lineNumber) {
+        line = line.substr(0, line.find('#'));
+
+        std::istringstream fields(line);
+        std::string rom;
+        if (!(fields >> rom)) {
+            continue;
+        }
+
+        std::stringstream where;
+        where << "Job list line " << lineNumber << ": ";
+
+        RunnerJob job;
+        if (!(fields >> job.m_frames)) {
+            error = where.str() + "expected a frame count after the ROM.";
+            return false;
+        }
+
+        std::string inputScript;
+        if (fields >> inputScript && inputScript != "-") {
+            job.m_inputPath = resolve(inputScript);
+        }
+
+        std::string expected;
+        if (fields >> expected) {
+            std::istringstream hashStream(expected);
+            if (!(hashStream >> std::hex >> job.m_expectedHash) || !hashStream.eof()) {
+                error = where.str() + "bad expected hash '" + expected + "'.";
+                return false;
+            }
+            job.m_checkHash = true;
+        }
+
+        job.m_name    = rom + (inputScript.empty() || inputScript == "-" ? std::string() : " < " + inputScript);
+        job.m_romPath = resolve(rom);
+        jobs.push_back(job);
+    }
+    return true;
+}
+
+bool
+Runner::
+loadJobList(const std::string& filename,
+            std::vector<RunnerJob>& jobs,
+            std::string& error)
+{
+    std::ifstream input(filename.c_str());
+    if (!input.is_open()) {
+        error = "Couldn't open job list " + filename + ".";
+        return false;
+    }
+    std::string::size_type slash = filename.rfind('/');
+    std::string directory = slash == std::string::npos ? std::string() : filename.substr(0, slash);
+    return parseJobList(input, directory, jobs, error);
+}
+
+bool
+Runner::
+writeFrameHashes(const RunnerResult& result, const std::string& filename)
+{
+    std::ofstream output(filename.c_str());
+    if (!output.is_open()) {
+        return false;
+    }
+    output << std::hex << std::setfill('0');
+    for (unsigned int frame = 0; frame < result.m_frameHashes.size(); ++frame) {
+        output << std::dec << frame << " " << std::hex << std::setw(16) << result.m_frameHashes[frame] << "\n";
+    }
+    return output.good();
+}
+
+bool
+Runner::
+readFrameHashes(const std::string& filename,
+                std::vector<std::uint64_t>& hashes,
+                std::string& error)
+{
+    std::ifstream input(filename.c_str());
+    if (!input.is_open()) {
+        error = "Couldn't open golden stream " + filename + ".";
+        return false;
+    }
+    hashes.clear();
+    std::string line;
+    for (unsigned int lineNumber = 1; std::getline(input, line); ++lineNumber) {
+        std::istringstream fields(line);
+        unsigned int  frame;
+        std::uint64_t hash;
+        if (!(fields >> std::dec >> frame >> std::hex >> hash) || frame != hashes.size()) {
+            std::stringstream where;
+            where << filename << " line " << lineNumber << ": expected frame " << hashes.size() << " and a hash.";
+            error = where.str();
+            return false;
+        }
+        hashes.push_back(hash);
+    }
+    return true;
+}
+
+bool
+Runner::
+dumpPicture(const IndexedFrame& picture, const std::string& filename)
+{
+    std::vector<u8_byte> rgb(IndexedFrame::PIXELS * 3);
+    PixelConvert::toRGB24(picture, rgb.data());
+    std::ofstream output(filename.c_str(), std::ios::binary);
+    if (!output.is_open()) {
+        return false;
+    }
+    output << "P6\n" << IndexedFrame::WIDTH << " " << IndexedFrame::HEIGHT << "\n255\n";
+    output.write(reinterpret_cast<const char*>(rgb.data()), rgb.size());
+    return output.good();
+}
+
+const char*
+Runner::
+statusName(RunnerResult::Status status)
+{
+    switch (status) {
+        case RunnerResult::Passed:   return "ok";
+        case RunnerResult::Mismatch: return "MISMATCH";
+        case RunnerResult::Failed:   return "FAILED";
+    }
+    return "?";
+}
@@ -0,0 +1,155 @@
+#ifndef RUNNER_H
+#define RUNNER_H
+
+#include "emu/FrameCapture.hpp"
+#include "utility/WorkStealingPool.hpp"
+
+#include <cstdint>
+#include <istream>
+#include <string>
+#include <vector>
+
+/*
+Runner
+
+Runs a corpus of headless jobs (a ROM, an optional input script and a frame
+count each) in one process, one independent NES per job, spread over a
+WorkStealingPool. Machines share nothing, so jobs scale with cores; every job
+renders inline and unthrottled and hashes each picture it produces
+(IndexedFrame::hash, XXH3).
+
+A job list is a text file of lines
+
+    <rom> <frames> [input script|-] [expected hash]
+
+with '#' comments. Relative paths are taken from the job list's directory.
+
+A job can also record its pictures through a FrameCapture of its own, on a
+writer thread beside the worker.
+
+Given a golden stream, a file of frame hashes from writeFrameHashes, a job is
+checked frame by frame against it. The first frame that differs (or is
+missing from either side) makes it a Mismatch, and with a dump prefix that
+picture and the last one that still matched are written out as PPMs, so a
+PPU regression shows up with where it starts and what it looks like,
+without anyone having kept video of the good run.
+*/
+
+struct RunnerJob
+{
+    RunnerJob() :
+        m_name (),
+        m_romPath (),
+        m_inputPath (),
+        m_frames (0),
+        m_expectedHash (0),
+        m_checkHash (false),
+        m_capturePath (),
+        m_captureFormat (FrameCapture::PPM),
+        m_capturePolicy (FrameCapture::BLOCK),
+        m_captureQueueFrames (FrameCapture::DEFAULT_QUEUE_FRAMES),
+        m_goldenPath (),
+        m_dumpPrefix ()
+    {}
+
+    std::string   m_name;
+    std::string   m_romPath;
+    std::string   m_inputPath;      // Empty for no input.
+    unsigned int  m_frames;
+    std::uint64_t m_expectedHash;
+    bool          m_checkHash;
+
+    // Empty for no capture; see FrameCapture::start.
+    std::string          m_capturePath;
+    FrameCapture::Format m_captureFormat;
+    FrameCapture::Policy m_capturePolicy;
+    unsigned int         m_captureQueueFrames;
+
+    // Empty for no golden stream. Pictures are dumped to
+    // <m_dumpPrefix>000041-actual.ppm and <m_dumpPrefix>000040-matched.ppm;
+    // empty to not dump them.
+    std::string          m_goldenPath;
+    std::string          m_dumpPrefix;
+};
+
+struct RunnerResult
+{
+    enum Status {
+        Passed,     // Ran, and matched the expected hash and golden stream
+                    // if there were any.
+        Mismatch,   // Ran, but the hash was wrong or a frame diverged.
+        Failed      // Couldn't run; see m_error.
+    };
+
+    RunnerResult() :
+        m_status (Failed),
+        m_error (),
+        m_frameHashes (),
+        m_hash (0),
+        m_seconds (0.0),
+        m_worker (0),
+        m_capture (),
+        m_diverged (false),
+        m_divergentFrame (0),
+        m_goldenHash (0)
+    {}
+
+    Status                     m_status;
+    std::string                m_error;
+    std::vector<std::uint64_t> m_frameHashes;   // One per frame run.
+    std::uint64_t              m_hash;          // Of all the frame hashes.
+    double                     m_seconds;
+    unsigned int               m_worker;
+    FrameCapture::Statistics   m_capture;
+
+    // Against the golden stream: the first frame that differs and what it
+    // should have hashed to (0 if the golden stream has no such frame).
+    bool                       m_diverged;
+    unsigned int               m_divergentFrame;
+    std::uint64_t              m_goldenHash;
+};
+
+class Runner
+{
+public:
+    Runner(unsigned int threads, bool pinned);
+
+    // Results are in job order.
+    std::vector<RunnerResult> run(const std::vector<RunnerJob>& jobs);
+
+    // Wall time of the last run().
+    double seconds() const { return m_seconds; }
+
+    WorkStealingPool& pool() { return m_pool; }
+
+    // Runs one job on the calling thread.
+    static RunnerResult runJob(const RunnerJob& job);
+
+    // Returns false and sets error on a bad list. Relative paths are made
+    // relative to baseDirectory.
+    static bool parseJobList(std::istream& input,
+                             const std::string& baseDirectory,
+                             std::vector<RunnerJob>& jobs,
+                             std::string& error);
+    static bool loadJobList(const std::string& filename,
+                            std::vector<RunnerJob>& jobs,
+                            std::string& error);
+
+    // Writes "<frame> <hash>" lines.
+    static bool writeFrameHashes(const RunnerResult& result, const std::string& filename);
+    // Reads them back; returns false and sets error if the file can't be
+    // read or frames aren't 0, 1, 2 ... in order.
+    static bool readFrameHashes(const std::string& filename,
+                                std::vector<std::uint64_t>& hashes,
+                                std::string& error);
+    // Writes picture as a binary PPM in the current palette.
+    static bool dumpPicture(const IndexedFrame& picture, const std::string& filename);
+
+    static const char* statusName(RunnerResult::Status status);
+
+private:
+    WorkStealingPool m_pool;
+    double           m_seconds;
+};
+
+#endif //RUNNER_H
@@ -0,0 +1,261 @@
+#include "Runner.hpp"
+
+#include <algorithm>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <string>
+
+// Runs a corpus of ROM jobs headless, in parallel, and reports per-job hashes,
+// timings and failures.
+//
+// Usage: nesrunner [-j threads] [--no-pin] [-o hash dir] [--scaling]
+//                  [--capture format dir [--capture-drop] [--capture-queue frames]]
+//                  [--golden dir [--dump dir]] <job list>
+
+static void
+usage()
+{
+    std::cerr << "Usage: nesrunner [options] <job list>\n"
+              << "  -j <threads>  Worker threads (default: one per core).\n"
+              << "  --no-pin      Don't pin workers to cores.\n"
+              << "  -o <dir>      Write each job's frame hashes to <dir>/NNNN.hashes, NNNN being\n"
+              << "                the job's place in the list from 0000.\n"
+              << "  --scaling     Run the corpus at 1, 2, 4 ... threads and report the speedup.\n"
+              << "  --capture <ppm|png|raw|y4m> <dir>\n"
+              << "                Record each job's pictures, as <dir>/NNNN-000000.png and on or\n"
+              << "                as one <dir>/NNNN.y4m stream.\n"
+              << "  --capture-drop\n"
+              << "                Drop pictures the writer can't keep up with instead of waiting.\n"
+              << "  --capture-queue <frames>\n"
+              << "                Pictures queued for the writer (a power of two, default "
+              << FrameCapture::DEFAULT_QUEUE_FRAMES << ").\n"
+              << "  --golden <dir>\n"
+              << "                Check each job's frame hashes against <dir>/NNNN.hashes, as\n"
+              << "                written by -o, and report the first frame that differs.\n"
+              << "  --dump <dir>  Where to write the divergent picture and the last matching\n"
+              << "                one, as <dir>/NNNN-FFFFFF-actual.ppm and -matched.ppm, FFFFFF\n"
+              << "                being the frame (default: the current directory).\n";
+}
+
+static unsigned int
+totalFrames(const std::vector<RunnerResult>& results)
+{
+    unsigned int frames = 0;
+    for (const RunnerResult &result : results) {
+        frames += result.m_frameHashes.size();
+    }
+    return frames;
+}
+
+static void
+printResults(const std::vector<RunnerJob>& jobs, const std::vector<RunnerResult>& results)
+{
+    for (unsigned int i = 0; i < jobs.size(); ++i) {
+        const RunnerResult &result = results[i];
+        std::cout << std::left << std::setw(8) << Runner::statusName(result.m_status) << std::right
+                  << std::fixed << std::setprecision(3) << std::setw(9) << result.m_seconds << " s"
+                  << "  worker " << std::setw(2) << result.m_worker << "  ";
+        if (result.m_status == RunnerResult::Failed) {
+            std::cout << result.m_error;
+        }
+        else {
+            std::cout << std::hex << std::setfill('0') << std::setw(16) << result.m_hash
+                      << std::dec << std::setfill(' ');
+        }
+        std::cout << "  " << jobs[i].m_name << "\n";
+        if (result.m_diverged) {
+            std::cout << "        first divergence at frame " << result.m_divergentFrame << ": expected "
+                      << std::hex << std::setfill('0') << std::setw(16) << result.m_goldenHash << ", got ";
+            if (result.m_divergentFrame < result.m_frameHashes.size()) {
+                std::cout << std::setw(16) << result.m_frameHashes[result.m_divergentFrame];
+            }
+            else {
+                std::cout << "no frame";
+            }
+            std::cout << std::dec << std::setfill(' ') << "\n";
+        }
+    }
+}
+
+static void
+printCapture(const std::vector<RunnerResult>& results)
+{
+    FrameCapture::Statistics total;
+    for (const RunnerResult &result : results) {
+        total.m_captured += result.m_capture.m_captured;
+        total.m_written  += result.m_capture.m_written;
+        total.m_dropped  += result.m_capture.m_dropped;
+        total.m_waits    += result.m_capture.m_waits;
+        total.m_errors   += result.m_capture.m_errors;
+    }
+    std::cout << "captured " << total.m_captured << " pictures: " << total.m_written << " written, "
+              << total.m_dropped << " dropped, " << total.m_waits << " waits, "
+              << total.m_errors << " errors\n";
+}
+
+static void
+printScaling(Runner& runner, const std::vector<RunnerJob>& jobs, double seconds)
+{
+    std::vector<WorkStealingPool::WorkerStatistics> stats = runner.pool().statistics();
+    unsigned int stolen = 0;
+    for (const WorkStealingPool::WorkerStatistics &worker : stats) {
+        stolen += worker.m_stolen;
+    }
+    std::cout << std::fixed << std::setprecision(3)
+              << runner.pool().size() << " thread(s)" << (runner.pool().pinned() ? ", pinned" : "")
+              << ": " << seconds << " s, "
+              << std::setprecision(2) << jobs.size() / seconds << " jobs/s, "
+              << stolen << " stolen\n";
+}
+
+int main(int argc, char** argv)
+{
+    unsigned int threads = WorkStealingPool::availableCores();
+    bool         pinned  = true;
+    bool         scaling = false;
+    std::string  hashDirectory;
+    std::string  jobList;
+
+    std::string          captureDirectory;
+    FrameCapture::Format captureFormat = FrameCapture::PPM;
+    FrameCapture::Policy capturePolicy = FrameCapture::BLOCK;
+    unsigned int         captureQueue  = FrameCapture::DEFAULT_QUEUE_FRAMES;
+
+    std::string goldenDirectory;
+    std::string dumpDirectory = ".";
+
+    for (int i = 1; i < argc; ++i) {
+        std::string argument(argv[i]);
+        if (argument == "-j" && i + 1 < argc) {
+            threads = std::atoi(argv[++i]);
+        }
+        else if (argument == "--no-pin") {
+            pinned = false;
+        }
+        else if (argument == "-o" && i + 1 < argc) {
+            hashDirectory = argv[++i];
+        }
+        else if (argument == "--scaling") {
+            scaling = true;
+        }
+        else if (argument == "--capture" && i + 2 < argc &&
+                 FrameCapture::parseFormat(argv[i + 1], captureFormat)) {
+            captureDirectory = argv[i + 2];
+            i += 2;
+        }
+        else if (argument == "--capture-drop") {
+            capturePolicy = FrameCapture::DROP;
+        }
+        else if (argument == "--capture-queue" && i + 1 < argc) {
+            captureQueue = std::atoi(argv[++i]);
+            if (captureQueue == 0 || (captureQueue & (captureQueue - 1)) != 0) {
+                usage();
+                return 2;
+            }
+        }
+        else if (argument == "--golden" && i + 1 < argc) {
+            goldenDirectory = argv[++i];
+        }
+        else if (argument == "--dump" && i + 1 < argc) {
+            dumpDirectory = argv[++i];
+        }
+        else if (jobList.empty() && argument[0] != '-') {
+            jobList = argument;
+        }
+        else {
+            usage();
+            return 2;
+        }
+    }
+    if (jobList.empty() || threads == 0) {
+        usage();
+        return 2;
+    }
+
+    std::vector<RunnerJob> jobs;
+    std::string error;
+    if (!Runner::loadJobList(jobList, jobs, error)) {
+        std::cerr << error << "\n";
+        return 2;
+    }
+
+    for (unsigned int i = 0; !captureDirectory.empty() && i < jobs.size(); ++i) {
+        std::stringstream path;
+        path << captureDirectory << "/" << std::setw(4) << std::setfill('0') << i
+             << (FrameCapture::sequence(captureFormat) ? "-" : std::string(".") + FrameCapture::formatName(captureFormat));
+        jobs[i].m_capturePath        = path.str();
+        jobs[i].m_captureFormat      = captureFormat;
+        jobs[i].m_capturePolicy      = capturePolicy;
+        jobs[i].m_captureQueueFrames = captureQueue;
+    }
+
+    for (unsigned int i = 0; !goldenDirectory.empty() && i < jobs.size(); ++i) {
+        std::stringstream golden, dump;
+        golden << goldenDirectory << "/" << std::setw(4) << std::setfill('0') << i << ".hashes";
+        dump << dumpDirectory << "/" << std::setw(4) << std::setfill('0') << i << "-";
+        jobs[i].m_goldenPath = golden.str();
+        jobs[i].m_dumpPrefix = dump.str();
+    }
+
+    if (scaling) {
+        // Same corpus on more and more threads; the hashes must not change.
+        double       baseline = 0.0;
+        std::uint64_t firstHash = 0;
+        for (unsigned int count = 1; ; count = std::min(count * 2, threads)) {
+            Runner runner(count, pinned);
+            std::vector<RunnerResult> results = runner.run(jobs);
+
+            std::uint64_t hash = 0;
+            for (const RunnerResult &result : results) {
+                hash = hash * 31 + result.m_hash;
+            }
+            if (count == 1) {
+                baseline  = runner.seconds();
+                firstHash = hash;
+            }
+
+            printScaling(runner, jobs, runner.seconds());
+            std::cout << "    speedup " << std::setprecision(2) << baseline / runner.seconds()
+                      << "x, efficiency " << std::setprecision(0)
+                      << 100.0 * baseline / (runner.seconds() * count) << "%"
+                      << (hash == firstHash ? "" : ", HASHES DIFFER FROM 1 THREAD") << "\n";
+            if (hash != firstHash) {
+                return 1;
+            }
+            if (count == threads) {
+                break;
+            }
+        }
+        return 0;
+    }
+
+    Runner runner(threads, pinned);
+    std::vector<RunnerResult> results = runner.run(jobs);
+    printResults(jobs, results);
+
+    unsigned int passed = 0;
+    for (unsigned int i = 0; i < results.size(); ++i) {
+        if (results[i].m_status == RunnerResult::Passed) {
+            ++passed;
+        }
+        if (!hashDirectory.empty() && results[i].m_status != RunnerResult::Failed) {
+            std::stringstream filename;
+            filename << hashDirectory << "/" << std::setw(4) << std::setfill('0') << i << ".hashes";
+            if (!Runner::writeFrameHashes(results[i], filename.str())) {
+                std::cerr << "Couldn't write " << filename.str() << "\n";
+            }
+        }
+    }
+
+    std::cout << "\n" << passed << "/" << results.size() << " passed, "
+              << totalFrames(results) << " frames, "
+              << std::fixed << std::setprecision(1) << totalFrames(results) / runner.seconds() << " frames/s\n";
+    if (!captureDirectory.empty()) {
+        printCapture(results);
+    }
+    printScaling(runner, jobs, runner.seconds());
+
+    return passed == results.size() ? 0 : 1;
+}
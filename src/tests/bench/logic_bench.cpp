@@ -0,0 +1,59 @@
+#include "emu/NES.hpp"
+
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+
+// Whole-machine throughput with every frame drawn, with one in eight drawn
+// (turbo's default), and logic only, on one thread with inline rendering.
+//
+// Usage: logic_bench <rom> [frames]
+
+// Frames per second, with every interval'th frame drawn (0 for none).
+static double
+framesPerSecond(const char* rom, unsigned int frames, unsigned int interval)
+{
+    NES nes;
+    if (!nes.load(rom)) {
+        std::cerr << "Couldn't load " << rom << std::endl;
+        std::exit(1);
+    }
+    nes.cpu().setTracing(false);
+    nes.ppu().setRenderMode(RenderPipeline::InlineMode);
+    nes.pacer().setSpeed(FramePacer::UNTHROTTLED);
+    nes.powerOn();
+    nes.setPaused(false);
+
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    for (unsigned int frame = 0; frame < frames; ++frame) {
+        nes.setLogicOnly(interval == 0 || frame % interval != 0);
+        nes.runFrame();
+    }
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    return frames / elapsed.count();
+}
+
+int main(int argc, char ** argv)
+{
+    if (argc < 2) {
+        std::cerr << "Usage: logic_bench <rom> [frames]" << std::endl;
+        return 2;
+    }
+    unsigned int frames = argc > 2 ? std::atoi(argv[2]) : 600;
+
+    const unsigned int INTERVALS[] = { 1, NES::DEFAULT_TURBO_RENDER_INTERVAL, 0 };
+    double full = 0.0;
+    std::cout << "drawn               fps     speedup" << std::endl;
+    for (unsigned int interval : INTERVALS) {
+        double fps = framesPerSecond(argv[1], frames, interval);
+        if (interval == 1) {
+            full = fps;
+        }
+        std::cout << (interval == 0 ? "none     " : (interval == 1 ? "every    " : "1 in 8   "))
+                  << std::fixed << std::setprecision(1)
+                  << std::setw(12) << fps
+                  << std::setprecision(2) << std::setw(11) << fps / full << "x" << std::endl;
+    }
+    return 0;
+}
@@ -0,0 +1,397 @@
+#include "PPU/FrameRenderer.hpp"
+#include "PPU/Loopy.hpp"
+#include "PPU/NtscFilter.hpp"
+#include "PPU/Observation.hpp"
+#include "PPU/PPU.hpp"
+#include "PPU/PixelConvert.hpp"
+#include "PPU/Scaler.hpp"
+#include "PPU/TileDecode.hpp"
+#include "utility/Hash.hpp"
+#include "utility/ThreadPool.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+// Measures tile decoding, frame conversion, frame hashing, agent
+// observations, the NTSC filter and the scalers with each kernel the CPU
+// supports, then
+// FrameRenderer throughput: the renderer alone on one thread, with static
+// patterns and with CHR RAM rewritten every frame, then with each picture
+// split over 1..N threads.
+//
+// Usage: render_bench [frames] [max threads]
+
+static void
+buildJob(RenderJob &job)
+{
+    std::srand(1);
+    for (unsigned int i = 0; i < RenderState::VRAM_SIZE; ++i) {
+        job.m_start.m_vram[i] = std::rand() & 0xFF;
+    }
+    for (unsigned int i = 0; i < RenderState::OAM_SIZE; ++i) {
+        job.m_start.m_oam[i] = std::rand() & 0xFF;
+    }
+    job.m_start.m_control     = 0x10;
+    job.m_start.m_mask        = 0x1E;
+    job.m_start.m_vramAddress = 0x0000;
+    job.m_start.m_tempAddress = 0x0000;
+    job.m_start.m_fineX       = 0;
+
+    // A raster split per line, the sort of thing a status bar or parallax
+    // effect does. Register-only, so lines can still go in parallel.
+    for (unsigned int line = 0; line < PPU::height; ++line) {
+        RenderEvent event;
+        event.m_dot     = line * PPU::ticksPerScanline + 260;
+        event.m_type    = RenderEvent::TempAddressWrite;
+        event.m_value   = Loopy::fineX(line);
+        event.m_address = Loopy::writeScrollX(0, line);
+        job.m_events.push_back(event);
+    }
+}
+
+// Rewrites tiles each frame, in the middle of the picture, like a game
+// streaming animation frames into CHR RAM.
+static void
+addPatternWrites(RenderJob &job, unsigned int tiles)
+{
+    for (unsigned int i = 0; i < tiles * 16; ++i) {
+        RenderEvent event;
+        event.m_dot     = 120 * PPU::ticksPerScanline + 300;
+        event.m_type    = RenderEvent::VideoWrite;
+        event.m_value   = std::rand() & 0xFF;
+        event.m_address = 0x1000 + i;
+        job.m_events.push_back(event);
+    }
+    // Events are replayed in dot order.
+    std::stable_sort(job.m_events.begin(), job.m_events.end(),
+                     [](const RenderEvent &a, const RenderEvent &b) { return a.m_dot < b.m_dot; });
+}
+
+static double
+timeRenderer(FrameRenderer &renderer, const RenderJob &job, unsigned int frames, IndexedFrame &frame)
+{
+    // Warm up caches (and the pool) before timing.
+    renderer.render(job, frame);
+
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    for (unsigned int i = 0; i < frames; ++i) {
+        renderer.render(job, frame);
+    }
+    std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+    return elapsed.count() / frames;
+}
+
+// Whole pattern tables (256 tiles) decoded per millisecond, for each kernel.
+static void
+benchDecode(unsigned int tables)
+{
+    std::vector<u8_byte> patterns(RenderState::PATTERN_TABLES_SIZE / 2);
+    for (u8_byte &byte : patterns) {
+        byte = std::rand() & 0xFF;
+    }
+    std::vector<u8_byte> pixels(256 * 64);
+
+    TileDecode::Kernel original = TileDecode::kernel();
+    std::cout << "kernel    tables/ms    Mpixels/s" << std::endl;
+    for (unsigned int k = 0; k < TileDecode::KERNEL_COUNT; ++k) {
+        TileDecode::Kernel kernel = static_cast<TileDecode::Kernel>(k);
+        if (!TileDecode::setKernel(kernel)) {
+            continue;
+        }
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        for (unsigned int table = 0; table < tables; ++table) {
+            TileDecode::decodeTiles(&patterns[0], 256, &pixels[0], table & 1);
+        }
+        std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+        std::cout << std::setw(6) << TileDecode::kernelName(kernel)
+                  << (kernel == original ? "*" : " ")
+                  << std::fixed << std::setprecision(1)
+                  << std::setw(12) << tables / elapsed.count()
+                  << std::setw(13) << tables * 256 * 64 / elapsed.count() / 1000.0 << std::endl;
+    }
+    TileDecode::setKernel(original);
+    std::cout << std::endl;
+}
+
+// Megapixels per second converted to each output format, for each kernel.
+static void
+benchConvert(unsigned int frames)
+{
+    IndexedFrame frame;
+    for (unsigned int i = 0; i < IndexedFrame::PIXELS; ++i) {
+        frame.m_pixels[i] = (i * 13 + i / IndexedFrame::WIDTH) & IndexedFrame::INDEX_MASK;
+    }
+    for (unsigned int y = 0; y < IndexedFrame::HEIGHT; ++y) {
+        frame.m_emphasis[y] = y / 30;
+    }
+    std::vector<u8_byte> pixels(IndexedFrame::PIXELS * 4);
+
+    std::cout << "convert   ";
+    for (unsigned int f = 0; f < PixelConvert::FORMAT_COUNT; ++f) {
+        std::cout << std::setw(12) << PixelConvert::formatName(static_cast<PixelConvert::Format>(f));
+    }
+    std::cout << "   (Mpixels/s)" << std::endl;
+
+    PixelConvert::Kernel original = PixelConvert::kernel();
+    for (unsigned int k = 0; k < PixelConvert::KERNEL_COUNT; ++k) {
+        PixelConvert::Kernel kernel = static_cast<PixelConvert::Kernel>(k);
+        if (!PixelConvert::setKernel(kernel)) {
+            continue;
+        }
+        std::cout << std::setw(9) << PixelConvert::kernelName(kernel)
+                  << (kernel == original ? "*" : " ");
+        for (unsigned int f = 0; f < PixelConvert::FORMAT_COUNT; ++f) {
+            PixelConvert::Format format = static_cast<PixelConvert::Format>(f);
+            unsigned int pitch = IndexedFrame::WIDTH * PixelConvert::bytesPerPixel(format);
+            std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+            for (unsigned int i = 0; i < frames; ++i) {
+                PixelConvert::convert(frame, format, &pixels[0], pitch);
+            }
+            std::chrono::duration<double, std::micro> elapsed = std::chrono::steady_clock::now() - start;
+            std::cout << std::fixed << std::setprecision(1)
+                      << std::setw(12) << double(frames) * IndexedFrame::PIXELS / elapsed.count();
+        }
+        std::cout << std::endl;
+    }
+    PixelConvert::setKernel(original);
+    std::cout << std::endl;
+}
+
+// Frames hashed per second and GB/s, for each kernel.
+static void
+benchHash(unsigned int frames)
+{
+    IndexedFrame frame;
+    for (unsigned int i = 0; i < IndexedFrame::PIXELS; ++i) {
+        frame.m_pixels[i] = (i * 13 + i / IndexedFrame::WIDTH) & IndexedFrame::INDEX_MASK;
+    }
+    for (unsigned int y = 0; y < IndexedFrame::HEIGHT; ++y) {
+        frame.m_emphasis[y] = y / 30;
+    }
+    frames *= 10;
+
+    std::cout << "hash         frames/s      GB/s" << std::endl;
+    Hash::Kernel original = Hash::kernel();
+    for (unsigned int k = 0; k < Hash::KERNEL_COUNT; ++k) {
+        Hash::Kernel kernel = static_cast<Hash::Kernel>(k);
+        if (!Hash::setKernel(kernel)) {
+            continue;
+        }
+        std::uint64_t sum = 0;
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        for (unsigned int i = 0; i < frames; ++i) {
+            frame.m_pixels[0] = i & IndexedFrame::INDEX_MASK;
+            sum += frame.hash();
+        }
+        std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+        std::cout << std::setw(9) << Hash::kernelName(kernel) << (kernel == original ? "*" : " ")
+                  << std::fixed << std::setprecision(0) << std::setw(12) << frames / elapsed.count()
+                  << std::setprecision(2) << std::setw(10)
+                  << frames * double(sizeof(IndexedFrame)) / elapsed.count() / 1e9
+                  << (sum == 0 ? " " : "") << std::endl;
+    }
+    Hash::setKernel(original);
+    std::cout << std::endl;
+}
+
+// Microseconds per max pooled observation, for each size and colour.
+static void
+benchObserve(unsigned int frames)
+{
+    IndexedFrame frame, previous;
+    for (unsigned int i = 0; i < IndexedFrame::PIXELS; ++i) {
+        frame.m_pixels[i]    = (i * 13 + i / IndexedFrame::WIDTH) & IndexedFrame::INDEX_MASK;
+        previous.m_pixels[i] = (i * 5) & IndexedFrame::INDEX_MASK;
+    }
+    for (unsigned int y = 0; y < IndexedFrame::HEIGHT; ++y) {
+        frame.m_emphasis[y]    = 0;
+        previous.m_emphasis[y] = 0;
+    }
+    std::vector<u8_byte> out(Observation::bytes(Observation::SIZE_128X120, Observation::RGB));
+
+    std::cout << "observe   ";
+    for (unsigned int s = 0; s < Observation::SIZE_COUNT; ++s) {
+        const char *name = Observation::sizeName(static_cast<Observation::Size>(s));
+        std::cout << std::setw(9) << name << " gray" << std::setw(9) << name << " rgb ";
+    }
+    std::cout << "   (us/frame)" << std::endl;
+
+    Observation::Kernel original = Observation::kernel();
+    for (unsigned int k = 0; k < Observation::KERNEL_COUNT; ++k) {
+        Observation::Kernel kernel = static_cast<Observation::Kernel>(k);
+        if (!Observation::setKernel(kernel)) {
+            continue;
+        }
+        std::cout << std::setw(9) << Observation::kernelName(kernel)
+                  << (kernel == original ? "*" : " ");
+        for (unsigned int s = 0; s < Observation::SIZE_COUNT; ++s) {
+            for (unsigned int c = 0; c < Observation::COLOR_COUNT; ++c) {
+                std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+                for (unsigned int i = 0; i < frames; ++i) {
+                    Observation::observe(frame, &previous, static_cast<Observation::Size>(s),
+                                         static_cast<Observation::Color>(c), &out[0]);
+                }
+                std::chrono::duration<double, std::micro> elapsed = std::chrono::steady_clock::now() - start;
+                std::cout << std::fixed << std::setprecision(1)
+                          << std::setw(14) << elapsed.count() / frames;
+            }
+        }
+        std::cout << std::endl;
+    }
+    Observation::setKernel(original);
+    std::cout << std::endl;
+}
+
+// Milliseconds per NTSC filtered frame at each scale, for each kernel, and
+// with the best split over maxThreads.
+static void
+benchNtsc(unsigned int frames, unsigned int maxThreads)
+{
+    IndexedFrame frame;
+    for (unsigned int i = 0; i < IndexedFrame::PIXELS; ++i) {
+        frame.m_pixels[i] = (i * 13 + i / IndexedFrame::WIDTH) & IndexedFrame::INDEX_MASK;
+    }
+    for (unsigned int y = 0; y < IndexedFrame::HEIGHT; ++y) {
+        frame.m_emphasis[y] = y / 30;
+    }
+    std::vector<u8_byte> pixels(IndexedFrame::PIXELS * NtscFilter::MAX_SCALE * 4);
+    ThreadPool pool(maxThreads);
+
+    std::cout << "ntsc          2x ms      3x ms" << std::endl;
+    NtscFilter::Kernel original = NtscFilter::kernel();
+    for (unsigned int k = 0; k <= NtscFilter::KERNEL_COUNT; ++k) {
+        bool threaded = k == NtscFilter::KERNEL_COUNT;
+        NtscFilter::Kernel kernel = threaded ? original : static_cast<NtscFilter::Kernel>(k);
+        if (!NtscFilter::setKernel(kernel)) {
+            continue;
+        }
+        std::cout << std::setw(9) << NtscFilter::kernelName(kernel)
+                  << (threaded ? "x" : kernel == original ? "*" : " ");
+        for (unsigned int scale = NtscFilter::MIN_SCALE; scale <= NtscFilter::MAX_SCALE; ++scale) {
+            NtscFilter ntsc(scale, PixelConvert::BGRA8888);
+            ntsc.setThreadPool(threaded ? &pool : nullptr);
+            std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+            for (unsigned int i = 0; i < frames; ++i) {
+                ntsc.filter(frame, i % NtscFilter::PHASES, &pixels[0], ntsc.width() * 4);
+            }
+            std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+            std::cout << std::fixed << std::setprecision(3)
+                      << std::setw(11) << elapsed.count() / frames;
+        }
+        if (threaded) {
+            std::cout << "   (" << maxThreads << " threads)";
+        }
+        std::cout << std::endl;
+    }
+    NtscFilter::setKernel(original);
+    std::cout << std::endl;
+}
+
+// Each scaler at each factor it supports, from palette indices, ms/frame.
+static void
+benchScale(unsigned int frames)
+{
+    IndexedFrame frame;
+    for (unsigned int i = 0; i < IndexedFrame::PIXELS; ++i) {
+        frame.m_pixels[i] = (i / 7 + i / IndexedFrame::WIDTH / 5) % 3 == 0 ? 0x16 : 0x0F;
+    }
+    std::memset(frame.m_emphasis, 0, sizeof(frame.m_emphasis));
+    std::vector<u8_byte> pixels(IndexedFrame::PIXELS * Scaler::MAX_FACTOR * Scaler::MAX_FACTOR * 4);
+
+    std::cout << "scale       filter     1x ms     2x ms     3x ms     4x ms     5x ms     6x ms" << std::endl;
+    Scaler::Kernel original = Scaler::kernel();
+    for (unsigned int k = 0; k < Scaler::KERNEL_COUNT; ++k) {
+        Scaler::Kernel kernel = static_cast<Scaler::Kernel>(k);
+        if (!Scaler::setKernel(kernel)) {
+            continue;
+        }
+        for (unsigned int f = 0; f < Scaler::FILTER_COUNT; ++f) {
+            Scaler::Filter filter = static_cast<Scaler::Filter>(f);
+            std::cout << std::setw(9) << Scaler::kernelName(kernel) << (kernel == original ? "*" : " ")
+                      << std::setw(10) << Scaler::filterName(filter);
+            for (unsigned int factor = 1; factor <= Scaler::MAX_FACTOR; ++factor) {
+                if (!Scaler::supports(filter, factor)) {
+                    std::cout << std::setw(10) << "-";
+                    continue;
+                }
+                unsigned int pitch = IndexedFrame::WIDTH * factor * 4;
+                std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+                for (unsigned int i = 0; i < frames; ++i) {
+                    Scaler::scale(frame, PixelConvert::BGRA8888, filter, factor, &pixels[0], pitch);
+                }
+                std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+                std::cout << std::fixed << std::setprecision(3) << std::setw(10) << elapsed.count() / frames;
+            }
+            std::cout << std::endl;
+        }
+    }
+    Scaler::setKernel(original);
+    std::cout << std::endl;
+}
+
+int main(int argc, char ** argv)
+{
+    unsigned int frames     = argc > 1 ? std::atoi(argv[1]) : 2000;
+    unsigned int maxThreads = argc > 2 ? std::atoi(argv[2]) : std::thread::hardware_concurrency();
+    if (maxThreads == 0) {
+        maxThreads = 1;
+    }
+
+    benchDecode(frames * 10);
+    benchConvert(frames);
+    benchHash(frames);
+    benchObserve(frames);
+    benchNtsc(frames, maxThreads);
+    benchScale(frames);
+
+    RenderJob job;
+    buildJob(job);
+    IndexedFrame frame;
+
+    std::cout << "patterns                ms/frame         fps  tiles decoded/frame  bg lines drawn" << std::endl;
+    for (unsigned int tiles = 0; tiles <= 16; tiles += 16) {
+        RenderJob churn = job;
+        addPatternWrites(churn, tiles);
+
+        FrameRenderer renderer;
+        double ms = timeRenderer(renderer, churn, frames, frame);
+        double decoded = static_cast<double>(renderer.tileCache().statistics().m_tilesDecoded) / (frames + 1);
+        std::cout << (tiles == 0 ? "static CHR         " : "CHR RAM, 16 tiles  ")
+                  << std::fixed << std::setprecision(4)
+                  << std::setw(12) << ms
+                  << std::setprecision(1)
+                  << std::setw(12) << 1000.0 / ms
+                  << std::setw(21) << decoded
+                  << std::setw(15) << renderer.backgroundStatistics().drawnFraction() * 100.0 << "%" << std::endl;
+    }
+    std::cout << std::endl;
+
+    std::cout << "threads    ms/frame         fps     speedup" << std::endl;
+
+    double serialMs = 0.0;
+    for (unsigned int threads = 1; threads <= maxThreads; ++threads) {
+        ThreadPool    pool(threads);
+        FrameRenderer renderer;
+        renderer.setThreadPool(threads > 1 ? &pool : nullptr);
+
+        double ms = timeRenderer(renderer, job, frames, frame);
+        if (threads == 1) {
+            serialMs = ms;
+        }
+        std::cout << std::setw(7) << threads
+                  << std::fixed << std::setprecision(4)
+                  << std::setw(12) << ms
+                  << std::setprecision(1)
+                  << std::setw(12) << 1000.0 / ms
+                  << std::setprecision(2)
+                  << std::setw(11) << serialMs / ms << "x" << std::endl;
+    }
+
+    return 0;
+}
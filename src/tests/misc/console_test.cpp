@@ -1,5 +1,8 @@
 #include "utility/Console.hpp"
 #include "utility/Register.hpp"
+#include "utility/CommandChannel.hpp"
+
+#include <cassert>
 
 int main(int argc, char ** argv) 
 {
@@ -14,5 +17,18 @@ int main(int argc, char ** argv)
     console.receive_input("test_reg write");
     console.receive_input("test_reg write asdf");
 
+    // Same again, but marshalled the way the emulator does it.
+    CommandChannel channel(2);
+    console.setCommandChannel(&channel);
+    console.receive_input("test_reg write 17");
+    console.receive_input("test_reg read");
+    console.receive_input("test_reg read");
+    assert(channel.outstanding() == 2);
+
+    assert(channel.process(*CommandDispatcher::instance()) == 2);
+    console.poll();
+    assert(channel.outstanding() == 0);
+    assert(reg.read() == 17);
+
     return 0;
 }
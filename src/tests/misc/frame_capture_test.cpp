@@ -0,0 +1,274 @@
+#include "emu/FrameCapture.hpp"
+#include "PPU/PixelConvert.hpp"
+
+#include <cassert>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <sstream>
+#include <string>
+#include <vector>
+
+// Writes into the current directory and cleans up after itself.
+const std::string PREFIX = "frame_capture_test_";
+const unsigned int RGB_BYTES = IndexedFrame::PIXELS * 3;
+
+static std::vector<u8_byte>
+readFile(const std::string& filename)
+{
+    std::ifstream input(filename.c_str(), std::ios::binary);
+    assert(input.is_open());
+    return std::vector<u8_byte>(std::istreambuf_iterator<char>(input), std::istreambuf_iterator<char>());
+}
+
+static std::string
+sequenceName(unsigned int number, const char* extension)
+{
+    std::ostringstream name;
+    name << PREFIX;
+    name.width(6);
+    name.fill('0');
+    name << number << "." << extension;
+    return name.str();
+}
+
+static void
+makePicture(IndexedFrame& picture, unsigned int seed)
+{
+    for (unsigned int i = 0; i < IndexedFrame::PIXELS; ++i) {
+        picture.m_pixels[i] = (i * 7 + i / 300 + seed) & IndexedFrame::INDEX_MASK;
+    }
+    for (unsigned int y = 0; y < IndexedFrame::HEIGHT; ++y) {
+        picture.m_emphasis[y] = (y + seed) / 30 % 8;
+    }
+}
+
+static std::vector<u8_byte>
+rgb(const IndexedFrame& picture)
+{
+    std::vector<u8_byte> pixels(RGB_BYTES);
+    PixelConvert::toRGB24(picture, &pixels[0]);
+    return pixels;
+}
+
+static std::uint32_t
+bigEndian(const u8_byte* bytes)
+{
+    return (std::uint32_t(bytes[0]) << 24) | (bytes[1] << 16) | (bytes[2] << 8) | bytes[3];
+}
+
+// Bit at a time, to check the writer's table driven one.
+static std::uint32_t
+crc32(const u8_byte* data, std::size_t size)
+{
+    std::uint32_t crc = 0xFFFFFFFF;
+    for (std::size_t i = 0; i < size; ++i) {
+        crc ^= data[i];
+        for (unsigned int bit = 0; bit < 8; ++bit) {
+            crc = (crc >> 1) ^ (crc & 1 ? 0xEDB88320 : 0);
+        }
+    }
+    return ~crc;
+}
+
+// Unpacks a PNG as FrameCapture writes them, checking everything on the way.
+static std::vector<u8_byte>
+decodePNG(const std::vector<u8_byte>& png)
+{
+    const u8_byte signature[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+    assert(png.size() > 8 && std::memcmp(&png[0], signature, 8) == 0);
+
+    std::vector<u8_byte> zlib;
+    std::size_t at = 8;
+    bool ended = false;
+    while (at < png.size()) {
+        std::uint32_t length = bigEndian(&png[at]);
+        std::string type(png.begin() + at + 4, png.begin() + at + 8);
+        assert(bigEndian(&png[at + 8 + length]) == crc32(&png[at + 4], length + 4));
+        if (type == "IHDR") {
+            assert(bigEndian(&png[at + 8]) == IndexedFrame::WIDTH);
+            assert(bigEndian(&png[at + 12]) == IndexedFrame::HEIGHT);
+            assert(png[at + 16] == 8 && png[at + 17] == 2);
+        }
+        else if (type == "IDAT") {
+            zlib.insert(zlib.end(), png.begin() + at + 8, png.begin() + at + 8 + length);
+        }
+        else if (type == "IEND") {
+            ended = true;
+        }
+        at += length + 12;
+    }
+    assert(ended && at == png.size());
+
+    // Stored blocks only.
+    assert(zlib.size() > 6 && ((zlib[0] << 8) | zlib[1]) % 31 == 0);
+    std::vector<u8_byte> filtered;
+    at = 2;
+    for (bool final = false; !final; ) {
+        final = zlib[at] & 1;
+        assert((zlib[at] >> 1) == 0);
+        unsigned int size = zlib[at + 1] | (zlib[at + 2] << 8);
+        assert((size ^ (zlib[at + 3] | (zlib[at + 4] << 8))) == 0xFFFF);
+        filtered.insert(filtered.end(), zlib.begin() + at + 5, zlib.begin() + at + 5 + size);
+        at += 5 + size;
+    }
+    std::uint32_t a = 1, b = 0;
+    for (u8_byte byte : filtered) {
+        a = (a + byte) % 65521;
+        b = (b + a) % 65521;
+    }
+    assert(at + 4 == zlib.size() && bigEndian(&zlib[at]) == ((b << 16) | a));
+
+    std::vector<u8_byte> pixels;
+    unsigned int rowBytes = IndexedFrame::WIDTH * 3;
+    assert(filtered.size() == IndexedFrame::HEIGHT * (rowBytes + 1));
+    for (unsigned int y = 0; y < IndexedFrame::HEIGHT; ++y) {
+        assert(filtered[y * (rowBytes + 1)] == 0);
+        pixels.insert(pixels.end(), filtered.begin() + y * (rowBytes + 1) + 1,
+                      filtered.begin() + (y + 1) * (rowBytes + 1));
+    }
+    return pixels;
+}
+
+static void
+testFiles()
+{
+    FrameCapture capture;
+    IndexedFrame pictures[3];
+    for (unsigned int i = 0; i < 3; ++i) {
+        makePicture(pictures[i], i);
+    }
+    std::string error;
+
+    assert(capture.start(FrameCapture::PPM, PREFIX, FrameCapture::BLOCK, error));
+    for (unsigned int i = 0; i < 3; ++i) {
+        assert(capture.capture(pictures[i]));
+    }
+    capture.stop();
+    assert(!capture.capturing() && !capture.capture(pictures[0]));
+    FrameCapture::Statistics stats = capture.statistics();
+    assert(stats.m_captured == 3 && stats.m_written == 3 && stats.m_dropped == 0 && stats.m_errors == 0);
+    for (unsigned int i = 0; i < 3; ++i) {
+        std::vector<u8_byte> ppm = readFile(sequenceName(i, "ppm"));
+        std::string header = "P6\n256 240\n255\n";
+        assert(ppm.size() == header.size() + RGB_BYTES);
+        assert(std::string(ppm.begin(), ppm.begin() + header.size()) == header);
+        assert(std::vector<u8_byte>(ppm.begin() + header.size(), ppm.end()) == rgb(pictures[i]));
+        std::remove(sequenceName(i, "ppm").c_str());
+    }
+
+    assert(capture.start(FrameCapture::PNG, PREFIX, FrameCapture::BLOCK, error));
+    assert(capture.capture(pictures[1]));
+    capture.stop();
+    assert(decodePNG(readFile(sequenceName(0, "png"))) == rgb(pictures[1]));
+    std::remove(sequenceName(0, "png").c_str());
+}
+
+static void
+testStreams()
+{
+    FrameCapture capture;
+    IndexedFrame pictures[2];
+    makePicture(pictures[0], 5);
+    makePicture(pictures[1], 9);
+    std::string error;
+
+    // Straight to a file and through a pipe, the same bytes either way.
+    std::string raw = PREFIX + "stream.raw", piped = PREFIX + "piped.raw";
+    assert(capture.start(FrameCapture::RAW, raw, FrameCapture::BLOCK, error));
+    assert(capture.capture(pictures[0]) && capture.capture(pictures[1]));
+    capture.stop();
+    assert(capture.start(FrameCapture::RAW, "|cat > " + piped, FrameCapture::BLOCK, error));
+    assert(capture.capture(pictures[0]) && capture.capture(pictures[1]));
+    capture.stop();
+
+    std::vector<u8_byte> expected = rgb(pictures[0]), second = rgb(pictures[1]);
+    expected.insert(expected.end(), second.begin(), second.end());
+    assert(readFile(raw) == expected);
+    assert(readFile(piped) == expected);
+    std::remove(raw.c_str());
+    std::remove(piped.c_str());
+
+    // A white picture, then a black one.
+    std::string y4m = PREFIX + "stream.y4m";
+    std::memset(pictures[0].m_pixels, 0x30, sizeof(pictures[0].m_pixels));
+    std::memset(pictures[0].m_emphasis, 0, sizeof(pictures[0].m_emphasis));
+    std::memset(pictures[1].m_pixels, 0x0F, sizeof(pictures[1].m_pixels));
+    std::memset(pictures[1].m_emphasis, 0, sizeof(pictures[1].m_emphasis));
+    assert(capture.start(FrameCapture::Y4M, y4m, FrameCapture::BLOCK, error));
+    assert(capture.capture(pictures[0]) && capture.capture(pictures[1]));
+    capture.stop();
+
+    std::vector<u8_byte> video = readFile(y4m);
+    std::string text(video.begin(), video.end());
+    std::size_t headerEnd = text.find('\n') + 1;
+    assert(text.compare(0, 19, "YUV4MPEG2 W256 H240") == 0);
+    assert(text.find(" C444") < headerEnd);
+    std::size_t frameSize = 6 + RGB_BYTES;
+    assert(video.size() == headerEnd + 2 * frameSize);
+    for (unsigned int frame = 0; frame < 2; ++frame) {
+        std::size_t at = headerEnd + frame * frameSize;
+        assert(text.compare(at, 6, "FRAME\n") == 0);
+        u8_byte luma = video[at + 6], cb = video[at + 6 + IndexedFrame::PIXELS];
+        assert(frame == 0 ? luma > 200 : luma < 32);
+        assert(cb > 120 && cb < 136);
+    }
+    std::remove(y4m.c_str());
+
+    assert(!capture.start(FrameCapture::RAW, PREFIX + "missing/stream.raw", FrameCapture::BLOCK, error));
+    assert(!error.empty() && !capture.capturing());
+}
+
+// A one picture queue: blocking keeps everything, dropping keeps count of
+// what it throws away.
+static void
+testPolicies()
+{
+    FrameCapture capture("capture", 1);
+    IndexedFrame picture;
+    makePicture(picture, 0);
+    std::string error;
+    std::string raw = PREFIX + "policy.raw";
+
+    assert(capture.start(FrameCapture::RAW, raw, FrameCapture::BLOCK, error));
+    for (unsigned int i = 0; i < 20; ++i) {
+        assert(capture.capture(picture));
+    }
+    capture.stop();
+    FrameCapture::Statistics stats = capture.statistics();
+    assert(stats.m_written == 20 && stats.m_dropped == 0);
+    assert(readFile(raw).size() == 20 * RGB_BYTES);
+
+    assert(capture.start(FrameCapture::PNG, PREFIX + "policy_", FrameCapture::DROP, error));
+    unsigned int kept = 0;
+    for (unsigned int i = 0; i < 20; ++i) {
+        kept += capture.capture(picture);
+    }
+    capture.stop();
+    stats = capture.statistics();
+    assert(stats.m_captured == 20 && stats.m_waits == 0 && stats.m_errors == 0);
+    assert(stats.m_written == kept && stats.m_written + stats.m_dropped == 20);
+    for (unsigned int i = 0; i < kept; ++i) {
+        std::ostringstream name;
+        name << PREFIX << "policy_";
+        name.width(6);
+        name.fill('0');
+        name << i << ".png";
+        assert(std::remove(name.str().c_str()) == 0);
+    }
+    std::remove(raw.c_str());
+}
+
+int main()
+{
+    FrameCapture::Format format;
+    assert(FrameCapture::parseFormat("y4m", format) && format == FrameCapture::Y4M);
+    assert(!FrameCapture::parseFormat("gif", format));
+    assert(FrameCapture::sequence(FrameCapture::PNG) && !FrameCapture::sequence(FrameCapture::RAW));
+
+    testFiles();
+    testStreams();
+    testPolicies();
+    return 0;
+}
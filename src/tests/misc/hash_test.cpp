@@ -0,0 +1,70 @@
+#include "utility/Hash.hpp"
+#include "PPU/IndexedFrame.hpp"
+
+#include <cassert>
+#include <cstring>
+#include <vector>
+
+// Values from the reference xxHash (XXH3_64bits) for the same bytes, one
+// per code path: empty, 1-3, 4-8, 9-16, 17-128, 129-240 and long.
+struct Vector
+{
+    std::size_t   m_size;
+    std::uint64_t m_hash;
+};
+
+const Vector VECTORS[] = {
+    {     0, 0x2d06800538d394c2ULL },
+    {     3, 0xa9088dda485b481cULL },
+    {     8, 0x60539db630471163ULL },
+    {    16, 0xb8c859b0f030b585ULL },
+    {   100, 0xb5937857f0d78c9fULL },
+    {   200, 0x746cd0025327bf5bULL },
+    {  1000, 0x6c4f14bd97bd9e82ULL },
+    { 61680, 0x461f91063b01ae6cULL }
+};
+
+int main()
+{
+    std::vector<unsigned char> bytes(70000);
+    for (std::size_t i = 0; i < bytes.size(); ++i) {
+        bytes[i] = (i * 7 + 3) & 0xFF;
+    }
+
+    Hash::Kernel original = Hash::kernel();
+    for (int k = 0; k < Hash::KERNEL_COUNT; ++k) {
+        Hash::Kernel kernel = static_cast<Hash::Kernel>(k);
+        if (!Hash::setKernel(kernel)) {
+            assert(!Hash::supported(kernel));
+            continue;
+        }
+        for (const Vector &vector : VECTORS) {
+            assert(Hash::xxh3(bytes.data(), vector.m_size) == vector.m_hash);
+        }
+    }
+
+    // Every kernel agrees on every length around the stripe and block edges,
+    // and from any alignment.
+    for (std::size_t size = 0; size < 5000; size += size < 300 ? 1 : 61) {
+        for (std::size_t offset = 0; offset < 3; ++offset) {
+            Hash::setKernel(Hash::SCALAR);
+            std::uint64_t expected = Hash::xxh3(bytes.data() + offset, size);
+            for (int k = 1; k < Hash::KERNEL_COUNT; ++k) {
+                if (Hash::setKernel(static_cast<Hash::Kernel>(k))) {
+                    assert(Hash::xxh3(bytes.data() + offset, size) == expected);
+                }
+            }
+        }
+    }
+    assert(Hash::setKernel(original));
+
+    // A frame hashes its indices and emphasis and nothing else.
+    IndexedFrame frame;
+    std::memcpy(frame.m_pixels, bytes.data(), sizeof(frame.m_pixels));
+    std::memcpy(frame.m_emphasis, bytes.data() + sizeof(frame.m_pixels), sizeof(frame.m_emphasis));
+    assert(frame.hash() == 0x461f91063b01ae6cULL);
+    frame.m_emphasis[IndexedFrame::HEIGHT - 1] ^= IndexedFrame::EMPHASIZE_BLUE;
+    assert(frame.hash() != 0x461f91063b01ae6cULL);
+
+    return 0;
+}
@@ -0,0 +1,103 @@
+#include "emu/NES.hpp"
+#include "PPU/Observation.hpp"
+
+#include <cassert>
+#include <cstring>
+#include <functional>
+#include <vector>
+
+// Usage: logic_only_test <nestest.nes>
+
+static void
+start(NES &nes, const char* rom)
+{
+    assert(nes.load(rom));
+    nes.cpu().setTracing(false);
+    nes.ppu().setRenderMode(RenderPipeline::InlineMode);
+    nes.pacer().setSpeed(FramePacer::UNTHROTTLED);
+    nes.powerOn();
+    nes.setPaused(false);
+}
+
+// The same frames with and without pictures leave the machine the same.
+static void
+testSameLogic(const char* rom)
+{
+    const unsigned int FRAMES = 30;
+
+    NES full;
+    NES logic;
+    start(full, rom);
+    start(logic, rom);
+    logic.setLogicOnly(true);
+
+    for (unsigned int frame = 0; frame < FRAMES; ++frame) {
+        full.runFrame();
+        logic.runFrame();
+        assert(full.frameRendered() && !logic.frameRendered());
+        assert(full.cpu().cycles() == logic.cpu().cycles());
+        assert(full.cpu().PC() == logic.cpu().PC());
+        for (unsigned int field = 0; field < PPUInspector::FIELD_COUNT; ++field) {
+            PPUInspector::Field f = static_cast<PPUInspector::Field>(field);
+            assert(full.ppuInspector().read(f) == logic.ppuInspector().read(f));
+        }
+    }
+    assert(logic.ppu().displayedFrame() == 0);
+
+    // Switched back on for one frame, the picture is the one the full run drew.
+    logic.setLogicOnly(false);
+    full.runFrame();
+    logic.runFrame();
+    assert(logic.frameRendered());
+    assert(logic.ppu().displayedFrame() == full.ppu().displayedFrame());
+    assert(std::memcmp(full.ppu().displayBuffer().m_pixels, logic.ppu().displayBuffer().m_pixels,
+                       IndexedFrame::PIXELS) == 0);
+
+    logic.setLogicOnly(true);
+    logic.runFrame();
+    assert(!logic.frameRendered());
+}
+
+// The frame handler sees every picture drawn, and none while logic only.
+static void
+testFrameHandler(const char* rom)
+{
+    NES nes;
+    start(nes, rom);
+    ObservationStack stack(Observation::SIZE_84X84, Observation::GRAYSCALE, 4, false);
+    unsigned int handled = 0;
+    std::function<void(const IndexedFrame&)> sink = stack.sink();
+    nes.ppu().setFrameHandler([&](const IndexedFrame& frame) {
+            assert(&frame == &nes.ppu().displayBuffer());
+            ++handled;
+            sink(frame);
+        });
+
+    // Power on is partway into a frame, so the first picture is the second's.
+    nes.runFrame();
+    assert(handled == 0);
+    for (unsigned int frame = 0; frame < 3; ++frame) {
+        nes.runFrame();
+    }
+    assert(handled == 3 && stack.pushed() == 3);
+    std::vector<u8_byte> expected(stack.observationBytes());
+    Observation::observe(nes.ppu().displayBuffer(), nullptr, stack.size(), stack.color(), &expected[0]);
+    assert(std::memcmp(stack.observation(0), &expected[0], expected.size()) == 0);
+
+    nes.setLogicOnly(true);
+    nes.runFrame();
+    assert(handled == 3);
+
+    nes.setLogicOnly(false);
+    nes.ppu().setFrameHandler(nullptr);
+    nes.runFrame();
+    assert(handled == 3);
+}
+
+int main(int argc, char ** argv)
+{
+    assert(argc == 2 && "logic_only_test needs the path to a ROM!");
+    testSameLogic(argv[1]);
+    testFrameHandler(argv[1]);
+    return 0;
+}
@@ -0,0 +1,69 @@
+#include "emu/NES.hpp"
+
+#include <cassert>
+
+const u16_word PROGRAM = 0x8000;
+const u16_word END     = 0x8006;
+
+// Runs LDA #$03, STA target, NOP and returns the cycles taken to get past
+// them. OAMADDR starts at oamAddress.
+static unsigned int
+run(NES &nes, u16_word target, u8_byte oamAddress)
+{
+    Cpu65XX &cpu = nes.cpu();
+    const u8_byte program[] = {
+        0xA9, 0x03,                                     // LDA #$03
+        0x8D, u8_byte(target), u8_byte(target >> 8),    // STA target
+        0xEA,                                           // NOP
+        0xEA                                            // NOP
+    };
+    for (unsigned int i = 0; i < sizeof(program); ++i) {
+        cpu.write(PROGRAM + i, program[i]);
+    }
+    // Page 3 of work RAM, written through its mirror at $0B00 to make sure
+    // DMA follows mirrors.
+    for (unsigned int i = 0; i < 0x100; ++i) {
+        cpu.write(0x0B00 + i, i ^ 0x5A);
+    }
+    nes.ppu().registerBlock().write(PPU::OAM_ADDRESS_ADDRESS, oamAddress);
+    cpu.setPC(PROGRAM);
+
+    unsigned int start = cpu.cycles();
+    while (cpu.PC() != END) {
+        cpu.tick();
+    }
+    return cpu.cycles() - start;
+}
+
+int main()
+{
+    // Without DMA, for the cycle count to compare against.
+    NES plainNES;
+    unsigned int plain = run(plainNES, 0x4015, 0x00);
+
+    NES nes;
+    unsigned int dma = run(nes, PPU::OAM_DMA_ADDRESS, 0x04);
+    assert(dma - plain == NES::OAM_DMA_CYCLES || dma - plain == NES::OAM_DMA_CYCLES + 1);
+
+    // OAM filled from OAMADDR on, wrapping.
+    Memory &registers = nes.ppu().registerBlock();
+    for (unsigned int i = 0; i < 0x100; ++i) {
+        registers.write(PPU::OAM_ADDRESS_ADDRESS, (0x04 + i) & 0xFF);
+        assert(registers.read(PPU::OAM_DATA_ADDRESS) == (i ^ 0x5A));
+    }
+
+    // A reset part way through a DMA doesn't stall what runs next.
+    NES resetNES;
+    Cpu65XX &cpu = resetNES.cpu();
+    cpu.powerOn();
+    cpu.write(PROGRAM,     0x8D);                      // STA $4014
+    cpu.write(PROGRAM + 1, u8_byte(PPU::OAM_DMA_ADDRESS));
+    cpu.write(PROGRAM + 2, u8_byte(PPU::OAM_DMA_ADDRESS >> 8));
+    cpu.setPC(PROGRAM);
+    while (cpu.PC() == PROGRAM) {
+        cpu.tick();
+    }
+    cpu.reset();
+    assert(run(resetNES, 0x4015, 0x00) == plain);
+    return 0;
+}
@@ -0,0 +1,137 @@
+#include "emu/NES.hpp"
+
+#include <cassert>
+
+// The PPU ports as the CPU sees them, through their mirrors.
+static void
+testPorts()
+{
+    NES nes;
+    // A bus of our own, to read as well as write.
+    NES::MainMemory bus(&nes.ppu(), nullptr);
+
+    // PPUADDR at $3FFE and $2006, then PPUDATA at $2FFF and $2007.
+    bus.write(0x3FFE, 0x21);
+    bus.write(0x2006, 0x08);
+    bus.write(0x2FFF, 0x5A);
+    bus.write(0x2007, 0xA5);
+    bus.write(0x2006, 0x21);
+    bus.write(0x2006, 0x08);
+    // Reads come through a buffer, a read behind.
+    bus.read(0x2007);
+    assert(bus.read(0x2007) == 0x5A);
+    assert(bus.read(0x3FEF) == 0xA5);
+    assert(nes.ppuInspector().read(PPUInspector::READ_BUFFER) == 0x00);
+
+    // Except the palette's, which fill the buffer from the nametable below.
+    bus.write(0x2006, 0x3F);
+    bus.write(0x2006, 0x01);
+    bus.write(0x2007, 0x2C);
+    bus.write(0x2006, 0x2F);
+    bus.write(0x2006, 0x01);
+    bus.write(0x2007, 0x66);
+    bus.write(0x2006, 0x3F);
+    bus.write(0x2006, 0x01);
+    assert(bus.read(0x2007) == 0x2C);
+    assert(nes.ppuInspector().read(PPUInspector::READ_BUFFER) == 0x66);
+
+    // +32 increments from PPUCTRL, written at $3000.
+    bus.write(0x3000, 0x04);
+    bus.write(0x2006, 0x20);
+    bus.write(0x2006, 0x00);
+    bus.write(0x2007, 0x11);
+    bus.write(0x2007, 0x22);
+    assert(nes.ppuInspector().read(PPUInspector::VRAM_ADDRESS) == 0x2040);
+
+    // A status read resets the write latch half way through an address.
+    bus.write(0x2006, 0x3F);
+    assert(nes.ppuInspector().read(PPUInspector::WRITE_LATCH) == 0);
+    bus.read(0x200A);
+    assert(nes.ppuInspector().read(PPUInspector::WRITE_LATCH) == 1);
+
+    // Write-only ports read back the last value read or written.
+    bus.write(0x2003, 0xC3);
+    assert(bus.read(0x2000) == 0xC3);
+    u8_byte sprite = bus.read(0x2004);
+    assert(bus.read(0x2006) == sprite);
+    assert(nes.ppuInspector().read(PPUInspector::OPEN_BUS) == sprite);
+
+    // PPUSTATUS only drives its top three bits; the rest are the open bus.
+    bus.write(0x2003, 0x5F);
+    assert((bus.read(0x2002) & 0x1F) == 0x1F);
+    bus.write(0x2003, 0x40);
+    assert((bus.read(0x2002) & 0x1F) == 0x00);
+
+    // OAMADDR and OAMDATA.
+    bus.write(0x2003, 0x10);
+    bus.write(0x2004, 0x77);
+    bus.write(0x2003, 0x10);
+    assert(bus.read(0x2004) == 0x77);
+}
+
+// The inspector shows and changes registers without side effects.
+static void
+testInspector()
+{
+    NES nes;
+    NES::MainMemory bus(&nes.ppu(), nullptr);
+    PPUInspector inspector(nes.ppu());
+
+    assert(PPUInspector::findField("fine_x") == PPUInspector::FINE_X);
+    assert(PPUInspector::findField("nonsense") == PPUInspector::FIELD_COUNT);
+
+    bus.write(0x2005, 0x12);
+    bus.write(0x2005, 0x34);
+    // Coarse X 2 and fine X 2, then fine Y 4 and coarse Y 6.
+    assert(inspector.read(PPUInspector::TEMP_ADDRESS) == 0x40C2);
+    assert(inspector.read(PPUInspector::FINE_X) == 0x02);
+
+    inspector.write(PPUInspector::STATUS, 0x80);
+    assert(inspector.read(PPUInspector::STATUS) == 0x80);
+    assert(inspector.read(PPUInspector::STATUS) == 0x80);
+    // With the second scroll write, 0x34, still on the bus.
+    assert(bus.read(0x2002) == 0x94);
+    assert(inspector.read(PPUInspector::STATUS) == 0x00);
+
+    CommandInput input;
+    input.m_code = inspector.translate("write");
+    input.m_arguments.push_back("vram_address");
+    input.m_arguments.push_back("2345");
+    assert(inspector.receiveCommand(input).m_code == CommandResult::OK);
+    assert(inspector.read(PPUInspector::VRAM_ADDRESS) == 0x2345);
+
+    input.m_arguments[0] = "nonsense";
+    assert(inspector.receiveCommand(input).m_code == CommandResult::INVALID_ARGUMENT);
+}
+
+// Inspector writes reach the renderer, mid frame, as port writes do.
+static void
+testInspectorRendering()
+{
+    NES nes;
+    PPU &ppu = nes.ppu();
+    ppu.setRenderMode(RenderPipeline::InlineMode);
+    PPUInspector inspector(ppu);
+
+    // To the start of a frame, which is recorded from the top.
+    ppu.advance(1);
+    while (ppu.scanline() != 0 || ppu.dot() != 0) {
+        ppu.advance(1);
+    }
+    ppu.advance(100 * 341);
+    inspector.write(PPUInspector::MASK, 0xE0);
+    while (ppu.phase() == PPU::VisiblePhase) {
+        ppu.advance(1);
+    }
+
+    const IndexedFrame &frame = ppu.displayBuffer();
+    assert(frame.m_emphasis[99] == 0 && frame.m_emphasis[100] == 7);
+}
+
+int main(int argc, char ** argv)
+{
+    testPorts();
+    testInspector();
+    testInspectorRendering();
+    return 0;
+}
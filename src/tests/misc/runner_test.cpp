@@ -0,0 +1,106 @@
+#include "runner/Runner.hpp"
+#include "runner/InputScript.hpp"
+
+#include <cassert>
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+
+// Usage: runner_test <nestest.nes>
+
+int main(int argc, char ** argv) 
+{
+    assert(argc == 2 && "runner_test needs the path to a ROM!");
+    std::string rom(argv[1]);
+
+    InputScript script;
+    std::istringstream scriptText("# frame pad1 pad2\n"
+                                  "0  .\n"
+                                  "10 AS  R\n"
+                                  "20 .   .\n");
+    assert(script.parse(scriptText));
+    assert(script.buttons(5, 0)  == 0x00);
+    assert(script.buttons(10, 0) == 0x09);
+    assert(script.buttons(19, 1) == 0x80);
+    assert(script.buttons(25, 0) == 0x00);
+
+    std::istringstream badScript("5 A\n3 B\n");
+    assert(!script.parse(badScript));
+
+    std::istringstream listText("# rom frames [input] [hash]\n"
+                                + rom + " 20\n"
+                                + rom + " 40 -\n"
+                                "missing.nes 10\n"
+                                + rom + " 20 - 0123456789abcdef\n"
+                                + rom + " 40\n");
+    std::vector<RunnerJob> jobs;
+    std::string error;
+    assert(Runner::parseJobList(listText, "", jobs, error));
+    assert(jobs.size() == 5);
+    assert(jobs[3].m_checkHash && jobs[3].m_expectedHash == 0x0123456789abcdefULL);
+
+    Runner runner(3, false);
+    std::vector<RunnerResult> results = runner.run(jobs);
+    assert(results.size() == jobs.size());
+
+    assert(results[0].m_status == RunnerResult::Passed);
+    assert(results[0].m_frameHashes.size() == 20);
+    assert(results[2].m_status == RunnerResult::Failed);
+    assert(results[3].m_status == RunnerResult::Mismatch);
+
+    // Machines share nothing, so the same job gives the same pictures
+    // whichever thread ran it, alone or alongside others.
+    assert(results[1].m_hash == results[4].m_hash);
+    assert(results[0].m_hash == results[3].m_hash);
+    RunnerResult alone = Runner::runJob(jobs[1]);
+    assert(alone.m_frameHashes == results[1].m_frameHashes);
+    for (unsigned int frame = 0; frame < 20; ++frame) {
+        assert(results[0].m_frameHashes[frame] == results[1].m_frameHashes[frame]);
+    }
+
+    // A run checks clean against its own golden stream, and a changed frame
+    // is caught where it is, with the pictures either side of it dumped.
+    const std::string golden = "runner_test.hashes", dump = "runner_test_";
+    assert(Runner::writeFrameHashes(results[1], golden));
+    std::vector<std::uint64_t> hashes;
+    assert(Runner::readFrameHashes(golden, hashes, error) && hashes == results[1].m_frameHashes);
+
+    RunnerJob checked = jobs[1];
+    checked.m_goldenPath = golden;
+    checked.m_dumpPrefix = dump;
+    RunnerResult clean = Runner::runJob(checked);
+    assert(clean.m_status == RunnerResult::Passed && !clean.m_diverged);
+
+    hashes[25] ^= 1;
+    {
+        std::ofstream tampered(golden.c_str());
+        for (unsigned int frame = 0; frame < hashes.size(); ++frame) {
+            tampered << frame << " " << std::hex << hashes[frame] << std::dec << "\n";
+        }
+    }
+    RunnerResult diverged = Runner::runJob(checked);
+    assert(diverged.m_status == RunnerResult::Mismatch && diverged.m_diverged);
+    assert(diverged.m_divergentFrame == 25 && diverged.m_goldenHash == hashes[25]);
+    assert(diverged.m_frameHashes == results[1].m_frameHashes);
+    assert(std::remove((dump + "000025-actual.ppm").c_str()) == 0);
+    assert(std::remove((dump + "000024-matched.ppm").c_str()) == 0);
+
+    // Running longer or shorter than the golden stream diverges too.
+    checked.m_dumpPrefix.clear();
+    checked.m_frames = 20;
+    hashes[25] ^= 1;
+    assert(Runner::writeFrameHashes(results[1], golden));
+    RunnerResult shorter = Runner::runJob(checked);
+    assert(shorter.m_diverged && shorter.m_divergentFrame == 20 && shorter.m_goldenHash == hashes[20]);
+    checked.m_frames = 41;
+    RunnerResult longer = Runner::runJob(checked);
+    assert(longer.m_diverged && longer.m_divergentFrame == 40 && longer.m_goldenHash == 0);
+
+    std::ofstream(golden.c_str()) << "0 12\n2 34\n";
+    assert(!Runner::readFrameHashes(golden, hashes, error) && !error.empty());
+    checked.m_goldenPath = "missing.hashes";
+    assert(Runner::runJob(checked).m_status == RunnerResult::Failed);
+    std::remove(golden.c_str());
+
+    return 0;
+}
@@ -0,0 +1,361 @@
+#include "PPU/FrameRenderer.hpp"
+#include "PPU/Loopy.hpp"
+#include "PPU/PixelConvert.hpp"
+#include "PPU/PPU.hpp"
+#include "PPU/TileCache.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <cstdlib>
+#include <vector>
+
+// Palette entries used below.
+const u8_byte BACKDROP = 0x0F;
+const u8_byte COLOR_1  = 0x16;
+const u8_byte COLOR_3  = 0x2A;
+const u8_byte COLOR_7  = 0x12;
+
+static bool
+pixelIs(const IndexedFrame &frame, unsigned int x, unsigned int y, u8_byte value)
+{
+    return frame.row(y)[x] == value;
+}
+
+// Every row a tile can have, against the pixel-at-a-time definition.
+static void
+testDecode()
+{
+    u8_byte tile[TileCache::TILE_BYTES] = { 0 };
+    u8_byte pixels[TileCache::TILE_PIXELS];
+    for (unsigned int planes = 0; planes < 0x10000; ++planes) {
+        tile[0] = planes & 0xFF;
+        tile[8] = planes >> 8;
+        TileCache::decodeTile(tile, pixels);
+        for (unsigned int x = 0; x < TileCache::TILE_SIDE; ++x) {
+            unsigned int bit0 = (tile[0] >> (7 - x)) & 0x01;
+            unsigned int bit1 = (tile[8] >> (7 - x)) & 0x01;
+            assert(pixels[x] == ((bit1 << 1) | bit0));
+        }
+    }
+}
+
+static void
+testCache()
+{
+    std::vector<u8_byte> bankA(TileCache::TABLE_BYTES), bankB(TileCache::TABLE_BYTES);
+    std::srand(7);
+    for (unsigned int i = 0; i < TileCache::TABLE_BYTES; ++i) {
+        bankA[i] = std::rand() & 0xFF;
+        bankB[i] = std::rand() & 0xFF;
+    }
+
+    TileCache cache;
+    const TileCache::DecodedTable *a = cache.lookup(&bankA[0]);
+    const TileCache::DecodedTable *b = cache.lookup(&bankB[0], a);
+    assert(a != b);
+    assert(cache.statistics().m_tilesDecoded == 2 * TileCache::TILES_PER_TABLE);
+
+    // Switching back to a bank seen before decodes nothing.
+    assert(cache.lookup(&bankA[0]) == a);
+    assert(cache.statistics().m_hits == 1);
+    assert(cache.statistics().m_tilesDecoded == 2 * TileCache::TILES_PER_TABLE);
+
+    // A CHR RAM write re-decodes one tile, in place.
+    bankA[5 * TileCache::TILE_BYTES + 2] ^= 0xFF;
+    assert(cache.update(a, &bankA[0], 5) == a);
+    assert(cache.statistics().m_tilesDecoded == 2 * TileCache::TILES_PER_TABLE + 1);
+    assert(cache.lookup(&bankA[0]) == a);
+
+    // Both halves showing the same bank: writing one leaves the other alone.
+    const TileCache::DecodedTable *shared = cache.lookup(&bankB[0]);
+    std::vector<u8_byte> written(bankB);
+    written[0] ^= 0x80;
+    const TileCache::DecodedTable *copy = cache.update(shared, &written[0], 0, shared);
+    assert(copy != shared);
+    assert(cache.lookup(&bankB[0]) == shared);
+    assert(copy->row(0, 0)[0] != shared->row(0, 0)[0]);
+}
+
+// A checkerboard of two tiles, scrolled, with a CHR RAM write halfway down.
+static void
+testBackground()
+{
+    RenderJob job;
+    RenderState &state = job.m_start;
+    std::fill(state.m_vram, state.m_vram + RenderState::VRAM_SIZE, 0);
+    std::fill(state.m_oam, state.m_oam + RenderState::OAM_SIZE, 0);
+
+    // Tile 1: left half colour 1, right half colour 3. Tile 2 blank.
+    for (unsigned int y = 0; y < 8; ++y) {
+        state.m_vram[0x10 + y] = 0xFF;
+        state.m_vram[0x18 + y] = 0x0F;
+    }
+    // Nametable 0: tile 1 in every even column. The attribute byte for the
+    // top left 4x4 tiles picks palette 1 for the top left quadrant.
+    for (unsigned int i = 0; i < 32 * 30; ++i) {
+        state.m_vram[0x2000 + i] = (i % 2 == 0) ? 1 : 2;
+    }
+    state.m_vram[0x23C0] = 0x01;
+
+    state.m_vram[0x3F00] = BACKDROP;
+    state.m_vram[0x3F01] = COLOR_1;
+    state.m_vram[0x3F03] = COLOR_3;
+    state.m_vram[0x3F07] = COLOR_7;
+    state.m_control = 0x00;
+    state.m_mask    = 0x0A;     // Background on, including the left 8 pixels.
+    state.m_vramAddress = Loopy::scroll(0, 4, 0);
+    state.m_tempAddress = state.m_vramAddress;
+    state.m_fineX       = 4;
+
+    // Line 120 on: tile 1's right half becomes colour 0 (transparent).
+    for (unsigned int i = 0; i < 16; ++i) {
+        RenderEvent event;
+        event.m_dot     = 119 * PPU::ticksPerScanline + 300;
+        event.m_type    = RenderEvent::VideoWrite;
+        event.m_value   = i < 8 ? 0xF0 : 0x00;
+        event.m_address = 0x10 + i;
+        job.m_events.push_back(event);
+    }
+
+    IndexedFrame frame;
+    FrameRenderer renderer;
+    renderer.render(job, frame);
+
+    // Scrolled 4 left: x 0-3 are the right half of tile 1 (palette 1 in the
+    // top left quadrant, so colour 7), 4-11 tile 2 and 12-19 tile 1 again,
+    // now in the next quadrant with palette 0.
+    assert(pixelIs(frame, 0,  0, COLOR_7));
+    assert(pixelIs(frame, 3,  0, COLOR_7));
+    assert(pixelIs(frame, 4,  0, BACKDROP));
+    assert(pixelIs(frame, 11, 0, BACKDROP));
+    assert(pixelIs(frame, 12, 0, COLOR_1));
+    assert(pixelIs(frame, 16, 0, COLOR_3));
+    // Below the attribute quadrant, palette 0.
+    assert(pixelIs(frame, 0,  40, COLOR_3));
+    // After the CHR write the right half is see-through.
+    assert(pixelIs(frame, 0,  119, COLOR_3));
+    assert(pixelIs(frame, 0,  120, BACKDROP));
+    assert(pixelIs(frame, 12, 120, COLOR_1));
+
+    // Hiding the leftmost 8 pixels.
+    job.m_events.clear();
+    job.m_start.m_mask = 0x08;
+    renderer.render(job, frame);
+    assert(pixelIs(frame, 0,  40, BACKDROP));
+    assert(pixelIs(frame, 16, 40, COLOR_3));
+}
+
+// A renderer that keeps its background lines between frames draws exactly
+// what a fresh one does, while nametables, attributes, tiles and scroll
+// change under it.
+static void
+testIncremental()
+{
+    RenderJob job;
+    RenderState &state = job.m_start;
+    std::srand(11);
+    for (unsigned int i = 0; i < RenderState::VRAM_SIZE; ++i) {
+        state.m_vram[i] = std::rand() & 0xFF;
+    }
+    std::fill(state.m_oam, state.m_oam + RenderState::OAM_SIZE, 0xFF);
+    state.m_control = 0x00;
+    state.m_mask    = 0x0A;
+    state.m_vramAddress = 0x0000;
+    state.m_tempAddress = 0x0000;
+    state.m_fineX       = 0;
+
+    FrameRenderer cached;
+    IndexedFrame  frame, expected;
+    for (unsigned int number = 0; number < 40; ++number) {
+        job.m_events.clear();
+        switch (number % 8) {
+            case 1:     // Nothing changes.
+                break;
+            case 2:
+                state.m_vram[0x2000 + std::rand() % 0x1000] ^= 0x01;
+                break;
+            case 3:
+                state.m_vram[0x23C0 + std::rand() % 0x40] ^= 0x04;
+                break;
+            case 4:
+                state.m_vram[std::rand() % RenderState::PATTERN_TABLES_SIZE] ^= 0x10;
+                break;
+            case 5:
+            {
+                u8_byte scrollX = std::rand() & 0xFF;
+                state.m_control ^= 0x11;
+                state.m_vramAddress = Loopy::scroll(state.m_control & 0x03, scrollX, std::rand() % 240);
+                state.m_tempAddress = state.m_vramAddress;
+                state.m_fineX       = Loopy::fineX(scrollX);
+            }
+            break;
+            case 6:
+            {
+                RenderEvent event;
+                event.m_dot     = (std::rand() % 240) * PPU::ticksPerScanline;
+                event.m_type    = RenderEvent::VideoWrite;
+                event.m_value   = std::rand() & 0xFF;
+                event.m_address = 0x2000 + std::rand() % 0x400;
+                job.m_events.push_back(event);
+            }
+            break;
+            case 7:
+                state.m_mask ^= 0x02;
+                break;
+        }
+
+        FrameRenderer fresh;
+        fresh.render(job, expected);
+        cached.render(job, frame);
+        assert(std::equal(frame.m_pixels, frame.m_pixels + IndexedFrame::PIXELS, expected.m_pixels));
+
+        const BackgroundCache::Statistics &stats = cached.backgroundStatistics();
+        assert(stats.m_linesDrawn + stats.m_linesReused == PPU::height);
+        if (number % 8 == 1 && number > 1) {
+            assert(stats.m_linesDrawn == 0);
+        }
+        if (number % 8 == 2 && number > 2) {
+            // One tile row of one nametable; it may or may not be on screen.
+            assert(stats.m_linesDrawn <= TileCache::TILE_SIDE);
+        }
+    }
+}
+
+// Emphasis is kept per line and only applied when converting to colours.
+static void
+testEmphasis()
+{
+    RenderJob job;
+    std::fill(job.m_start.m_vram, job.m_start.m_vram + RenderState::VRAM_SIZE, 0);
+    std::fill(job.m_start.m_oam, job.m_start.m_oam + RenderState::OAM_SIZE, 0);
+    job.m_start.m_vram[0x3F00] = 0x30;
+    job.m_start.m_mask = 0x00;
+
+    RenderEvent event;
+    event.m_dot     = 100 * PPU::ticksPerScanline;
+    event.m_type    = RenderEvent::MaskWrite;
+    event.m_value   = 0x20;     // Emphasize red.
+    event.m_address = PPU::MASK_ADDRESS;
+    job.m_events.push_back(event);
+
+    IndexedFrame frame;
+    FrameRenderer renderer;
+    renderer.render(job, frame);
+    assert(frame.m_emphasis[99] == 0 && frame.m_emphasis[100] == IndexedFrame::EMPHASIZE_RED);
+    assert(frame.row(99)[0] == 0x30 && frame.row(100)[0] == 0x30);
+
+    std::vector<u8_byte> rgb(IndexedFrame::PIXELS * 3);
+    PixelConvert::toRGB24(frame, &rgb[0]);
+    const u8_byte *plain      = &rgb[99 * IndexedFrame::WIDTH * 3];
+    const u8_byte *emphasized = &rgb[100 * IndexedFrame::WIDTH * 3];
+    assert(plain[0] == emphasized[0]);
+    assert(plain[1] >  emphasized[1]);
+    assert(plain[2] >  emphasized[2]);
+}
+
+// Vertical scroll: into the attribute rows, and moved by a $2006 write.
+static void
+testScroll()
+{
+    RenderJob job;
+    RenderState &state = job.m_start;
+    std::fill(state.m_vram, state.m_vram + RenderState::VRAM_SIZE, 0);
+    std::fill(state.m_oam, state.m_oam + RenderState::OAM_SIZE, 0);
+
+    // Tile 1 solid colour 1, tile 3 solid colour 3. Nametable 0 is all tile
+    // 1 and nametable 2 all tile 3; the attribute bytes are 0, so read as
+    // tiles they're blank.
+    for (unsigned int y = 0; y < 8; ++y) {
+        state.m_vram[0x10 + y] = 0xFF;
+        state.m_vram[0x30 + y] = 0xFF;
+        state.m_vram[0x38 + y] = 0xFF;
+    }
+    for (unsigned int i = 0; i < 32 * 30; ++i) {
+        state.m_vram[0x2000 + i] = 1;
+        state.m_vram[0x2800 + i] = 3;
+    }
+
+    state.m_vram[0x3F00] = BACKDROP;
+    state.m_vram[0x3F01] = COLOR_1;
+    state.m_vram[0x3F03] = COLOR_3;
+    state.m_control = 0x00;
+    state.m_mask    = 0x0A;
+    state.m_vramAddress = Loopy::scroll(0, 0, 240);
+    state.m_tempAddress = state.m_vramAddress;
+    state.m_fineX       = 0;
+
+    IndexedFrame frame;
+    FrameRenderer renderer;
+    renderer.render(job, frame);
+
+    // 240 starts in the attribute rows, then wraps to the top of the same
+    // nametable rather than the one below.
+    assert(pixelIs(frame, 0, 0,  BACKDROP));
+    assert(pixelIs(frame, 0, 15, BACKDROP));
+    assert(pixelIs(frame, 0, 16, COLOR_1));
+    assert(pixelIs(frame, 0, 200, COLOR_1));
+
+    // A $2006 write during line 99's hblank points line 100 at the top of
+    // nametable 2. A $2005 write alone waits for the next frame.
+    state.m_vramAddress = 0x0000;
+    state.m_tempAddress = 0x0000;
+    RenderEvent event;
+    event.m_dot     = 49 * PPU::ticksPerScanline + 300;
+    event.m_type    = RenderEvent::TempAddressWrite;
+    event.m_value   = 0;
+    event.m_address = Loopy::writeScrollY(0x0000, 200);
+    job.m_events.push_back(event);
+    event.m_dot     = 99 * PPU::ticksPerScanline + 300;
+    event.m_type    = RenderEvent::AddressWrite;
+    event.m_value   = 0x00;
+    event.m_address = 0x2800;
+    job.m_events.push_back(event);
+
+    renderer.render(job, frame);
+    assert(pixelIs(frame, 0, 60,  COLOR_1));
+    assert(pixelIs(frame, 0, 99,  COLOR_1));
+    assert(pixelIs(frame, 0, 100, COLOR_3));
+    assert(pixelIs(frame, 0, 239, COLOR_3));
+}
+
+// Palette writes take effect from the next line, through any mirror.
+static void
+testPaletteWrite()
+{
+    RenderJob job;
+    std::fill(job.m_start.m_vram, job.m_start.m_vram + RenderState::VRAM_SIZE, 0);
+    std::fill(job.m_start.m_oam, job.m_start.m_oam + RenderState::OAM_SIZE, 0);
+    job.m_start.m_vram[0x3F00] = 0x21;
+    job.m_start.m_mask = 0x00;
+
+    RenderEvent event;
+    event.m_dot     = 50 * PPU::ticksPerScanline + 100;
+    event.m_type    = RenderEvent::VideoWrite;
+    event.m_value   = 0x16;
+    event.m_address = 0x3FE0;
+    job.m_events.push_back(event);
+    event.m_dot     = 120 * PPU::ticksPerScanline;
+    event.m_type    = RenderEvent::MaskWrite;
+    event.m_value   = 0x01;     // Grayscale.
+    event.m_address = PPU::MASK_ADDRESS;
+    job.m_events.push_back(event);
+
+    IndexedFrame frame;
+    FrameRenderer renderer;
+    renderer.render(job, frame);
+    assert(frame.row(50)[0] == 0x21);
+    assert(frame.row(51)[0] == 0x16 && frame.row(119)[255] == 0x16);
+    assert(frame.row(120)[0] == 0x10);
+}
+
+int main(int argc, char ** argv)
+{
+    testDecode();
+    testCache();
+    testBackground();
+    testIncremental();
+    testEmphasis();
+    testScroll();
+    testPaletteWrite();
+    return 0;
+}
@@ -0,0 +1,127 @@
+#include "PPU/NtscFilter.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+// Rows are padded so writes past the end of one show up.
+const unsigned int PADDING = 16;
+
+static std::vector<u8_byte>
+filter(const NtscFilter& ntsc, const IndexedFrame& frame, unsigned int burstPhase)
+{
+    unsigned int pitch = ntsc.width() * 4 + PADDING;
+    std::vector<u8_byte> pixels(pitch * ntsc.height(), 0xAA);
+    ntsc.filter(frame, burstPhase, &pixels[0], pitch);
+    for (unsigned int y = 0; y < ntsc.height(); ++y) {
+        for (unsigned int i = ntsc.width() * 4; i < pitch; ++i) {
+            assert(pixels[y * pitch + i] == 0xAA);
+        }
+    }
+    return pixels;
+}
+
+static void
+fill(IndexedFrame& frame, u8_byte index)
+{
+    std::memset(frame.m_pixels, index, sizeof(frame.m_pixels));
+    std::memset(frame.m_emphasis, 0, sizeof(frame.m_emphasis));
+}
+
+// Flat colours come out the colour they should, whatever the phase.
+static void
+testColors()
+{
+    NtscFilter ntsc(2, PixelConvert::RGBA8888);
+    unsigned int pitch = ntsc.width() * 4 + PADDING;
+    IndexedFrame frame;
+    for (unsigned int phase = 0; phase < NtscFilter::PHASES; ++phase) {
+        fill(frame, 0x16);
+        std::vector<u8_byte> red = filter(ntsc, frame, phase);
+        fill(frame, 0x1A);
+        std::vector<u8_byte> green = filter(ntsc, frame, phase);
+        fill(frame, 0x12);
+        std::vector<u8_byte> blue = filter(ntsc, frame, phase);
+        fill(frame, 0x30);
+        std::vector<u8_byte> white = filter(ntsc, frame, phase);
+        fill(frame, 0x0F);
+        std::vector<u8_byte> black = filter(ntsc, frame, phase);
+
+        // Away from the edges, which fade into the blanking either side.
+        for (unsigned int y = 0; y < ntsc.height(); y += 7) {
+            for (unsigned int x = 8; x < ntsc.width() - 8; x += 5) {
+                unsigned int at = y * pitch + x * 4;
+                assert(red[at] > 2 * red[at + 1] && red[at] > 2 * red[at + 2]);
+                assert(green[at + 1] > 2 * green[at] && green[at + 1] > 2 * green[at + 2]);
+                assert(blue[at + 2] > 2 * blue[at] && blue[at + 2] > 2 * blue[at + 1]);
+                assert(white[at] > 240 && white[at + 1] > 240 && white[at + 2] > 240);
+                assert(black[at] == 0 && black[at + 1] == 0 && black[at + 2] == 0);
+                assert(red[at + 3] == 0xFF && black[at + 3] == 0xFF);
+            }
+        }
+    }
+
+    // Red emphasis takes the other two down.
+    fill(frame, 0x30);
+    std::vector<u8_byte> white = filter(ntsc, frame, 0);
+    std::memset(frame.m_emphasis, IndexedFrame::EMPHASIZE_RED, sizeof(frame.m_emphasis));
+    std::vector<u8_byte> tinted = filter(ntsc, frame, 0);
+    unsigned int at = 100 * pitch + 200 * 4;
+    assert(tinted[at + 1] < white[at + 1] && tinted[at + 2] < white[at + 2]);
+    assert(tinted[at] > tinted[at + 1]);
+}
+
+// Every kernel against the scalar one, at both scales, in both formats and
+// split across threads; BGRA is RGBA with red and blue swapped.
+static void
+testKernels()
+{
+    IndexedFrame frame;
+    std::srand(11);
+    for (unsigned int i = 0; i < IndexedFrame::PIXELS; ++i) {
+        frame.m_pixels[i] = std::rand() & 0xFF;
+    }
+    for (unsigned int y = 0; y < IndexedFrame::HEIGHT; ++y) {
+        frame.m_emphasis[y] = std::rand() % 8;
+    }
+
+    ThreadPool pool(4);
+    NtscFilter::Kernel original = NtscFilter::kernel();
+    for (unsigned int scale = NtscFilter::MIN_SCALE; scale <= NtscFilter::MAX_SCALE; ++scale) {
+        NtscFilter rgba(scale, PixelConvert::RGBA8888), bgra(scale, PixelConvert::BGRA8888);
+        assert(rgba.width() == 256 * scale);
+        for (unsigned int phase = 0; phase < NtscFilter::PHASES; ++phase) {
+            NtscFilter::setKernel(NtscFilter::SCALAR);
+            std::vector<u8_byte> expected = filter(rgba, frame, phase);
+
+            std::vector<u8_byte> swapped = filter(bgra, frame, phase);
+            for (unsigned int i = 0; i + 4 <= swapped.size(); i += 4) {
+                std::swap(swapped[i], swapped[i + 2]);
+            }
+            assert(swapped == expected);
+
+            for (unsigned int k = 0; k < NtscFilter::KERNEL_COUNT; ++k) {
+                NtscFilter::Kernel kernel = static_cast<NtscFilter::Kernel>(k);
+                if (!NtscFilter::setKernel(kernel)) {
+                    assert(!NtscFilter::supported(kernel));
+                    continue;
+                }
+                assert(filter(rgba, frame, phase) == expected);
+                rgba.setThreadPool(&pool);
+                assert(filter(rgba, frame, phase) == expected);
+                rgba.setThreadPool(nullptr);
+            }
+        }
+    }
+    NtscFilter::setKernel(original);
+}
+
+int main()
+{
+    assert(NtscFilter::supported(NtscFilter::SCALAR));
+    testColors();
+    testKernels();
+    return 0;
+}
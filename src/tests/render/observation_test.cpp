@@ -0,0 +1,205 @@
+#include "PPU/Observation.hpp"
+#include "PPU/PixelConvert.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+static void
+fill(IndexedFrame& frame, u8_byte index)
+{
+    std::memset(frame.m_pixels, index, sizeof(frame.m_pixels));
+    std::memset(frame.m_emphasis, 0, sizeof(frame.m_emphasis));
+}
+
+// index's colour under emphasis, as PixelConvert has it now.
+static std::vector<u8_byte>
+color(u8_byte index, unsigned int emphasis = 0)
+{
+    u8_byte colors[8][64][3];
+    PixelConvert::copyColors(colors[0][0]);
+    const u8_byte *rgb = colors[emphasis][index & IndexedFrame::INDEX_MASK];
+    return std::vector<u8_byte>(rgb, rgb + 3);
+}
+
+static unsigned int
+luma(u8_byte index, unsigned int emphasis = 0)
+{
+    std::vector<u8_byte> rgb = color(index, emphasis);
+    return (77 * rgb[0] + 150 * rgb[1] + 29 * rgb[2] + 128) >> 8;
+}
+
+static std::vector<u8_byte>
+observe(const IndexedFrame& frame, const IndexedFrame* previous,
+        Observation::Size size, Observation::Color color)
+{
+    // One byte over, to catch writes past the end.
+    std::vector<u8_byte> out(Observation::bytes(size, color) + 1, 0xAA);
+    Observation::observe(frame, previous, size, color, &out[0]);
+    assert(out.back() == 0xAA);
+    out.pop_back();
+    return out;
+}
+
+// A flat picture stays flat at any size, and half size is plain 2x2 means.
+static void
+testScaling()
+{
+    IndexedFrame frame;
+    fill(frame, 0x21);
+    for (unsigned int s = 0; s < Observation::SIZE_COUNT; ++s) {
+        Observation::Size size = static_cast<Observation::Size>(s);
+        std::vector<u8_byte> gray = observe(frame, nullptr, size, Observation::GRAYSCALE);
+        assert(gray == std::vector<u8_byte>(gray.size(), luma(0x21)));
+
+        std::vector<u8_byte> expected = color(0x21);
+        std::vector<u8_byte> rgb = observe(frame, nullptr, size, Observation::RGB);
+        for (unsigned int i = 0; i < rgb.size(); ++i) {
+            assert(rgb[i] == expected[i % 3]);
+        }
+    }
+
+    for (unsigned int i = 0; i < IndexedFrame::PIXELS; ++i) {
+        frame.m_pixels[i] = (i * 7 + i / 3) & IndexedFrame::INDEX_MASK;
+    }
+    std::vector<u8_byte> half = observe(frame, nullptr, Observation::SIZE_128X120, Observation::GRAYSCALE);
+    for (unsigned int y = 0; y < 120; ++y) {
+        for (unsigned int x = 0; x < 128; ++x) {
+            unsigned int sum = luma(frame.row(2 * y)[2 * x]) + luma(frame.row(2 * y)[2 * x + 1]) +
+                               luma(frame.row(2 * y + 1)[2 * x]) + luma(frame.row(2 * y + 1)[2 * x + 1]);
+            assert(half[y * 128 + x] == (sum + 2) / 4);
+        }
+    }
+
+    // A bar down the left third lands in the left third.
+    fill(frame, 0x0F);
+    for (unsigned int y = 0; y < IndexedFrame::HEIGHT; ++y) {
+        std::memset(frame.row(y), 0x30, IndexedFrame::WIDTH / 3);
+    }
+    std::vector<u8_byte> small = observe(frame, nullptr, Observation::SIZE_84X84, Observation::GRAYSCALE);
+    assert(small[0] == luma(0x30) && small[26] == luma(0x30) && small[29] == luma(0x0F));
+    assert(small[83 * 84] == luma(0x30) && small[83 * 84 + 83] == luma(0x0F));
+}
+
+// The brighter of the two frames, whichever order they come in, and each
+// with its own line's emphasis.
+static void
+testMaxPool()
+{
+    IndexedFrame dark, light;
+    fill(dark, 0x0F);
+    fill(light, 0x0F);
+    for (unsigned int i = 0; i < IndexedFrame::PIXELS; i += 2) {
+        light.m_pixels[i] = 0x30;
+    }
+    std::vector<u8_byte> pooled = observe(dark, &light, Observation::SIZE_128X120, Observation::RGB);
+    assert(pooled == observe(light, &dark, Observation::SIZE_128X120, Observation::RGB));
+    assert(pooled == observe(light, nullptr, Observation::SIZE_128X120, Observation::RGB));
+
+    light.m_emphasis[0] = IndexedFrame::EMPHASIZE_RED;
+    pooled = observe(dark, &light, Observation::SIZE_128X120, Observation::GRAYSCALE);
+    assert(pooled[0] == (luma(0x30, IndexedFrame::EMPHASIZE_RED) + luma(0x30) + 2 * luma(0x0F) + 2) / 4);
+}
+
+// Every kernel this CPU runs against the scalar one.
+static void
+testKernels()
+{
+    IndexedFrame frame, previous;
+    std::srand(3);
+    for (unsigned int i = 0; i < IndexedFrame::PIXELS; ++i) {
+        frame.m_pixels[i]    = std::rand() & 0xFF;
+        previous.m_pixels[i] = std::rand() & 0xFF;
+    }
+    for (unsigned int y = 0; y < IndexedFrame::HEIGHT; ++y) {
+        frame.m_emphasis[y]    = std::rand() % 8;
+        previous.m_emphasis[y] = std::rand() % 8;
+    }
+
+    Observation::Kernel original = Observation::kernel();
+    for (unsigned int s = 0; s < Observation::SIZE_COUNT; ++s) {
+        for (unsigned int c = 0; c < Observation::COLOR_COUNT; ++c) {
+            Observation::Size  size  = static_cast<Observation::Size>(s);
+            Observation::Color color = static_cast<Observation::Color>(c);
+            Observation::setKernel(Observation::SCALAR);
+            std::vector<u8_byte> expected       = observe(frame, nullptr, size, color);
+            std::vector<u8_byte> expectedPooled = observe(frame, &previous, size, color);
+            for (unsigned int k = 0; k < Observation::KERNEL_COUNT; ++k) {
+                Observation::Kernel kernel = static_cast<Observation::Kernel>(k);
+                if (!Observation::setKernel(kernel)) {
+                    assert(!Observation::supported(kernel));
+                    continue;
+                }
+                assert(observe(frame, nullptr, size, color) == expected);
+                assert(observe(frame, &previous, size, color) == expectedPooled);
+            }
+        }
+    }
+    Observation::setKernel(original);
+}
+
+static void
+testStack()
+{
+    ObservationStack stack(Observation::SIZE_84X84, Observation::GRAYSCALE, 4, true);
+    unsigned int bytes = stack.observationBytes();
+    assert(bytes == 84 * 84 && stack.stackBytes() == 4 * bytes);
+
+    // The first push fills the stack, then each pushes the oldest out, pooled
+    // with the one before.
+    const u8_byte indices[] = { 0x0F, 0x00, 0x10, 0x0F, 0x20 };
+    IndexedFrame frame;
+    std::vector<u8_byte> out(stack.stackBytes());
+    for (unsigned int i = 0; i < 5; ++i) {
+        fill(frame, indices[i]);
+        stack.push(frame);
+        stack.copy(&out[0]);
+        for (unsigned int slot = 0; slot < 4; ++slot) {
+            int pushed = int(i) - 3 + int(slot);
+            unsigned int expected = luma(indices[std::max(pushed, 0)]);
+            if (pushed > 0) {
+                expected = std::max(expected, luma(indices[pushed - 1]));
+            }
+            assert(out[slot * bytes] == expected && out[slot * bytes + bytes - 1] == expected);
+            assert(stack.observation(3 - slot)[bytes / 2] == expected);
+        }
+    }
+
+    stack.clear();
+    assert(stack.pushed() == 0);
+    fill(frame, 0x30);
+    stack.push(frame);
+    stack.copy(&out[0]);
+    assert(out == std::vector<u8_byte>(out.size(), luma(0x30)));
+}
+
+// The cached lookup tables follow palette changes.
+static void
+testPalette()
+{
+    IndexedFrame frame;
+    fill(frame, 0x21);
+    std::vector<u8_byte> before = observe(frame, nullptr, Observation::SIZE_128X120, Observation::RGB);
+    assert(before[0] == color(0x21)[0]);
+
+    assert(PixelConvert::setPalette(std::vector<u8_byte>(64 * 3, 0x40)));
+    std::vector<u8_byte> after = observe(frame, nullptr, Observation::SIZE_128X120, Observation::RGB);
+    assert(std::count(after.begin(), after.end() - 1, 0x40) == int(after.size() - 1));
+    assert(observe(frame, nullptr, Observation::SIZE_84X84, Observation::GRAYSCALE)[0] == 0x40);
+
+    assert(PixelConvert::setPalette(std::vector<u8_byte>()));
+    assert(observe(frame, nullptr, Observation::SIZE_128X120, Observation::RGB) == before);
+}
+
+int main()
+{
+    assert(Observation::supported(Observation::SCALAR));
+    testScaling();
+    testMaxPool();
+    testKernels();
+    testStack();
+    testPalette();
+    return 0;
+}
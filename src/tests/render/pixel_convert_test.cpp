@@ -0,0 +1,186 @@
+#include "PPU/Palette.hpp"
+#include "PPU/PixelConvert.hpp"
+
+#include <atomic>
+#include <cassert>
+#include <cstdio>
+#include <fstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Rows are padded so writes past the end of one show up.
+const unsigned int PADDING = 16;
+
+// Every index (and some with stray top bits) under every emphasis.
+static void
+fill(IndexedFrame& frame)
+{
+    for (unsigned int y = 0; y < IndexedFrame::HEIGHT; ++y) {
+        for (unsigned int x = 0; x < IndexedFrame::WIDTH; ++x) {
+            frame.row(y)[x] = (x * 7 + y) & 0xFF;
+        }
+        frame.m_emphasis[y] = y % 8;
+    }
+}
+
+static std::vector<u8_byte>
+convert(const IndexedFrame& frame, PixelConvert::Format format)
+{
+    unsigned int pitch = IndexedFrame::WIDTH * PixelConvert::bytesPerPixel(format) + PADDING;
+    std::vector<u8_byte> pixels(pitch * IndexedFrame::HEIGHT, 0xAA);
+    PixelConvert::convert(frame, format, &pixels[0], pitch);
+    return pixels;
+}
+
+// The scalar kernel against Palette's colours, on a line without emphasis.
+static void
+testReference()
+{
+    IndexedFrame frame;
+    fill(frame);
+    PixelConvert::Kernel original = PixelConvert::kernel();
+    PixelConvert::setKernel(PixelConvert::SCALAR);
+
+    std::vector<u8_byte> rgba   = convert(frame, PixelConvert::RGBA8888);
+    std::vector<u8_byte> bgra   = convert(frame, PixelConvert::BGRA8888);
+    std::vector<u8_byte> rgb565 = convert(frame, PixelConvert::RGB565);
+    std::vector<u8_byte> rgb24  = convert(frame, PixelConvert::RGB24);
+    for (unsigned int x = 0; x < IndexedFrame::WIDTH; ++x) {
+        Palette::Color color = Palette(frame.row(0)[x] & IndexedFrame::INDEX_MASK).color();
+        const u8_byte *pixel = &rgba[x * 4];
+        assert(pixel[0] == color.red() && pixel[1] == color.green() && pixel[2] == color.blue());
+        assert(pixel[3] == 0xFF);
+        pixel = &bgra[x * 4];
+        assert(pixel[0] == color.blue() && pixel[1] == color.green() && pixel[2] == color.red());
+        pixel = &rgb24[x * 3];
+        assert(pixel[0] == color.red() && pixel[1] == color.green() && pixel[2] == color.blue());
+        unsigned int packed = rgb565[x * 2] | (rgb565[x * 2 + 1] << 8);
+        assert(packed == (((color.red() >> 3u) << 11) | ((color.green() >> 2u) << 5) | (color.blue() >> 3u)));
+    }
+
+    PixelConvert::setKernel(original);
+}
+
+// Every kernel this CPU runs against the scalar one, in every format.
+static void
+testKernels()
+{
+    IndexedFrame frame;
+    fill(frame);
+    PixelConvert::Kernel original = PixelConvert::kernel();
+
+    for (unsigned int f = 0; f < PixelConvert::FORMAT_COUNT; ++f) {
+        PixelConvert::Format format = static_cast<PixelConvert::Format>(f);
+        PixelConvert::setKernel(PixelConvert::SCALAR);
+        std::vector<u8_byte> expected = convert(frame, format);
+
+        unsigned int rowBytes = IndexedFrame::WIDTH * PixelConvert::bytesPerPixel(format);
+        for (unsigned int i = 0; i < expected.size(); ++i) {
+            if (i % (rowBytes + PADDING) >= rowBytes) {
+                assert(expected[i] == 0xAA);
+            }
+        }
+
+        for (unsigned int k = 0; k < PixelConvert::KERNEL_COUNT; ++k) {
+            PixelConvert::Kernel kernel = static_cast<PixelConvert::Kernel>(k);
+            if (!PixelConvert::setKernel(kernel)) {
+                assert(!PixelConvert::supported(kernel));
+                continue;
+            }
+            assert(convert(frame, format) == expected);
+        }
+    }
+    PixelConvert::setKernel(original);
+}
+
+// Loaded palettes: 64 colours get emphasis worked out, 512 are used as is.
+static void
+testPalette()
+{
+    IndexedFrame frame;
+    fill(frame);
+
+    std::vector<u8_byte> colors(64 * 3);
+    for (unsigned int i = 0; i < colors.size(); ++i) {
+        colors[i] = i;
+    }
+    const char *filename = "pixel_convert_test.pal";
+    {
+        std::ofstream output(filename, std::ios::binary);
+        output.write(reinterpret_cast<const char*>(&colors[0]), colors.size());
+    }
+    std::vector<u8_byte> palette;
+    std::string error;
+    assert(PixelConvert::readPalette(filename, palette, error) && palette == colors);
+    std::remove(filename);
+    assert(!PixelConvert::readPalette(filename, palette, error) && !error.empty());
+    assert(!PixelConvert::setPalette(std::vector<u8_byte>(100)));
+
+    assert(PixelConvert::setPalette(palette));
+    std::vector<u8_byte> rgb = convert(frame, PixelConvert::RGB24);
+    for (unsigned int x = 0; x < IndexedFrame::WIDTH; ++x) {
+        unsigned int index = frame.row(0)[x] & IndexedFrame::INDEX_MASK;
+        assert(rgb[x * 3] == index * 3 && rgb[x * 3 + 1] == index * 3 + 1 && rgb[x * 3 + 2] == index * 3 + 2);
+    }
+
+    std::vector<u8_byte> emphasized(512 * 3);
+    for (unsigned int i = 0; i < emphasized.size(); ++i) {
+        emphasized[i] = i / 3 / 64;
+    }
+    assert(PixelConvert::setPalette(emphasized));
+    rgb = convert(frame, PixelConvert::RGB24);
+    unsigned int pitch = IndexedFrame::WIDTH * 3 + PADDING;
+    for (unsigned int y = 0; y < IndexedFrame::HEIGHT; ++y) {
+        assert(rgb[y * pitch] == frame.m_emphasis[y]);
+    }
+
+    assert(PixelConvert::setPalette(std::vector<u8_byte>()));
+    testReference();
+}
+
+// Palette changes while another thread converts: every frame comes out in
+// one palette or the other, never a mix.
+static void
+testPublication()
+{
+    IndexedFrame frame;
+    fill(frame);
+    const std::vector<u8_byte> dark(512 * 3, 0x10), light(512 * 3, 0x20);
+
+    unsigned int version = PixelConvert::paletteVersion();
+    assert(PixelConvert::setPalette(dark));
+    assert(PixelConvert::paletteVersion() != version);
+    std::vector<u8_byte> colors(512 * 3);
+    assert(PixelConvert::copyColors(&colors[0]) == PixelConvert::paletteVersion());
+    assert(colors == dark);
+
+    std::atomic<bool> done(false);
+    std::thread converter([&] {
+            while (!done) {
+                std::vector<u8_byte> rgb(IndexedFrame::PIXELS * 3);
+                PixelConvert::toRGB24(frame, &rgb[0]);
+                for (unsigned int i = 1; i < rgb.size(); ++i) {
+                    assert(rgb[i] == rgb[0]);
+                }
+                assert(rgb[0] == 0x10 || rgb[0] == 0x20);
+            }
+    });
+    for (unsigned int i = 0; i < 200; ++i) {
+        PixelConvert::setPalette(i % 2 ? dark : light);
+    }
+    done = true;
+    converter.join();
+
+    assert(PixelConvert::setPalette(std::vector<u8_byte>()));
+}
+
+int main()
+{
+    assert(PixelConvert::supported(PixelConvert::SCALAR));
+    testReference();
+    testKernels();
+    testPalette();
+    testPublication();
+    return 0;
+}
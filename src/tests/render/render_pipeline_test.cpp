@@ -0,0 +1,116 @@
+#include "PPU/PPU.hpp"
+#include "utility/Clock.hpp"
+#include "utility/Memory.hpp"
+
+#include <cassert>
+#include <iostream>
+#include <map>
+#include <vector>
+
+// Rendering stays off (only the grayscale bit is ever set in the mask), so
+// every frame is the full length.
+const unsigned long DOTS_PER_FRAME  = 341 * 262;
+const unsigned int  FRAMES          = 8;
+
+typedef std::map<unsigned int, std::vector<u8_byte>> FrameMap;
+
+static void
+advanceTo(PPU &ppu, unsigned long &now, unsigned long target)
+{
+    while (now < target) {
+        ppu.tick();
+        ++now;
+    }
+}
+
+static void
+setBackdrop(PPU &ppu, u8_byte color)
+{
+    Memory &registers = ppu.registerBlock();
+    registers.write(PPU::SCROLL_ADDRESS_ADDRESS, 0x3F);
+    registers.write(PPU::SCROLL_ADDRESS_ADDRESS, 0x00);
+    registers.write(PPU::SCROLL_DATA_ADDRESS,    color);
+}
+
+// Runs a PPU through frames with palette and mask changes in the middle of
+// the picture, and returns every picture it produced by frame number.
+static FrameMap
+runFrames(RenderPipeline::Mode mode, unsigned int threads)
+{
+    Clock        clock(21477270);
+    PPU          ppu(clock);
+    ppu.setRenderMode(mode);
+    ppu.setRenderThreads(threads);
+
+    FrameMap      frames;
+    unsigned long now = 0;
+    for (unsigned int frame = 0; frame < FRAMES; ++frame) {
+        unsigned long base = frame * DOTS_PER_FRAME;
+
+        // Halfway along line 100: shows from line 101. Only on even frames,
+        // odd ones have no mid-frame VRAM writes and can be split into strips.
+        advanceTo(ppu, now, base + 100 * 341 + 50);
+        if (frame % 2 == 0) {
+            setBackdrop(ppu, 0x21 + frame);
+        }
+
+        // Before the first pixel of line 180: shows from line 180.
+        advanceTo(ppu, now, base + 180 * 341);
+        ppu.registerBlock().write(PPU::MASK_ADDRESS, frame & 0x01);
+
+        // During vblank: picked up by the next frame's starting state.
+        advanceTo(ppu, now, base + 245 * 341);
+        setBackdrop(ppu, 0x01 + frame);
+        ppu.registerBlock().write(PPU::MASK_ADDRESS, 0x00);
+
+        const IndexedFrame &picture = ppu.displayBuffer();
+        frames[ppu.displayedFrame()].assign(picture.m_pixels, picture.m_pixels + IndexedFrame::PIXELS);
+    }
+
+    return frames;
+}
+
+// Every frame both produced must be identical.
+static unsigned int
+compareFrames(const FrameMap &expected, const FrameMap &actual)
+{
+    unsigned int compared = 0;
+    for (FrameMap::const_iterator it = actual.begin(); it != actual.end(); ++it) {
+        FrameMap::const_iterator match = expected.find(it->first);
+        if (match == expected.end()) {
+            continue;
+        }
+        assert(match->second == it->second);
+        ++compared;
+    }
+    return compared;
+}
+
+static u8_byte
+pixel(const std::vector<u8_byte> &frame, unsigned int x, unsigned int y)
+{
+    return frame[y * PPU::width + x];
+}
+
+int main(int argc, char ** argv)
+{
+    FrameMap inlined   = runFrames(RenderPipeline::InlineMode, 1);
+    FrameMap pipelined = runFrames(RenderPipeline::PipelinedMode, 1);
+    FrameMap strips    = runFrames(RenderPipeline::InlineMode, 4);
+    FrameMap both      = runFrames(RenderPipeline::PipelinedMode, 3);
+
+    // Make sure the mid-frame changes actually show up before comparing.
+    const std::vector<u8_byte> &even = inlined.at(FRAMES - 2);
+    assert(pixel(even, 10, 50)  != pixel(even, 10, 150));
+    assert(pixel(even, 10, 100) == pixel(even, 10, 50));
+    assert(pixel(even, 10, 101) == pixel(even, 10, 150));
+    const std::vector<u8_byte> &odd = inlined.at(FRAMES - 1);
+    assert(pixel(odd, 10, 179) != pixel(odd, 10, 180));
+
+    // Pipelined output runs a frame behind, so it has one frame less.
+    assert(compareFrames(inlined, pipelined) >= FRAMES - 3);
+    assert(compareFrames(inlined, strips)    >= FRAMES - 2);
+    assert(compareFrames(inlined, both)      >= FRAMES - 3);
+
+    return 0;
+}
@@ -0,0 +1,205 @@
+#include "PPU/Scaler.hpp"
+
+#include <cassert>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+// Rows are padded so writes past the end of one show up.
+const unsigned int PADDING = 12;
+
+struct Picture
+{
+    Picture(unsigned int width, unsigned int height)
+        : m_width(width), m_height(height), m_pixels(width * height) {}
+
+    std::uint32_t at(int x, int y) const
+    {
+        // Off the edges the edge pixels are repeated.
+        x = x < 0 ? 0 : (x >= int(m_width) ? m_width - 1 : x);
+        y = y < 0 ? 0 : (y >= int(m_height) ? m_height - 1 : y);
+        return m_pixels[y * m_width + x];
+    }
+
+    unsigned int               m_width;
+    unsigned int               m_height;
+    std::vector<std::uint32_t> m_pixels;
+};
+
+static std::vector<u8_byte>
+scale(const Picture& picture, Scaler::Filter filter, unsigned int factor)
+{
+    unsigned int pitch = picture.m_width * factor * 4 + PADDING;
+    std::vector<u8_byte> pixels(pitch * picture.m_height * factor, 0xAA);
+    Scaler::scale(reinterpret_cast<const u8_byte*>(&picture.m_pixels[0]), picture.m_width, picture.m_height,
+                  picture.m_width * 4, filter, factor, &pixels[0], pitch);
+    for (unsigned int y = 0; y < picture.m_height * factor; ++y) {
+        for (unsigned int i = picture.m_width * factor * 4; i < pitch; ++i) {
+            assert(pixels[y * pitch + i] == 0xAA);
+        }
+    }
+    return pixels;
+}
+
+static std::uint32_t
+pixel(const std::vector<u8_byte>& pixels, unsigned int pitch, unsigned int x, unsigned int y)
+{
+    std::uint32_t value;
+    std::memcpy(&value, &pixels[y * pitch + x * 4], 4);
+    return value;
+}
+
+// What each filter should give for the output pixel (i, j) of the square
+// for source pixel (x, y), written out the long way.
+static std::uint32_t
+expected(const Picture& p, Scaler::Filter filter, unsigned int factor,
+         int x, int y, unsigned int i, unsigned int j)
+{
+    std::uint32_t e = p.at(x, y);
+    if (filter == Scaler::NEAREST) {
+        return e;
+    }
+    if (filter == Scaler::SCANLINES) {
+        if (j + 1 < factor) {
+            return e;
+        }
+        std::uint32_t out = e & 0xFF000000;
+        for (unsigned int shift = 0; shift < 24; shift += 8) {
+            unsigned int channel = (e >> shift) & 0xFF;
+            out |= (channel - channel / 4) << shift;
+        }
+        return out;
+    }
+
+    std::uint32_t a = p.at(x - 1, y - 1), b = p.at(x, y - 1), c = p.at(x + 1, y - 1);
+    std::uint32_t d = p.at(x - 1, y),                         f = p.at(x + 1, y);
+    std::uint32_t g = p.at(x - 1, y + 1), h = p.at(x, y + 1), k = p.at(x + 1, y + 1);
+    if (b == h || d == f) {
+        return e;
+    }
+    if (factor == 2) {
+        std::uint32_t out[2][2] = { { d == b ? d : e, b == f ? f : e },
+                                    { d == h ? d : e, h == f ? f : e } };
+        return out[j][i];
+    }
+    std::uint32_t out[3][3] = {
+        { d == b ? d : e, (d == b && e != c) || (b == f && e != a) ? b : e, b == f ? f : e },
+        { (d == b && e != g) || (d == h && e != a) ? d : e, e, (b == f && e != k) || (h == f && e != c) ? f : e },
+        { d == h ? d : e, (d == h && e != k) || (h == f && e != g) ? h : e, h == f ? f : e },
+    };
+    return out[j][i];
+}
+
+static void
+testReference(const Picture& picture)
+{
+    Scaler::Kernel original = Scaler::kernel();
+    Scaler::setKernel(Scaler::SCALAR);
+    for (unsigned int f = 0; f < Scaler::FILTER_COUNT; ++f) {
+        Scaler::Filter filter = static_cast<Scaler::Filter>(f);
+        for (unsigned int factor = 1; factor <= Scaler::MAX_FACTOR; ++factor) {
+            if (!Scaler::supports(filter, factor)) {
+                continue;
+            }
+            std::vector<u8_byte> pixels = scale(picture, filter, factor);
+            unsigned int pitch = picture.m_width * factor * 4 + PADDING;
+            for (unsigned int y = 0; y < picture.m_height * factor; ++y) {
+                for (unsigned int x = 0; x < picture.m_width * factor; ++x) {
+                    assert(pixel(pixels, pitch, x, y) ==
+                           expected(picture, filter, factor, x / factor, y / factor, x % factor, y % factor));
+                }
+            }
+        }
+    }
+    Scaler::setKernel(original);
+}
+
+// Every kernel against the scalar one, for every filter and factor.
+static void
+testKernels(const Picture& picture)
+{
+    Scaler::Kernel original = Scaler::kernel();
+    for (unsigned int f = 0; f < Scaler::FILTER_COUNT; ++f) {
+        Scaler::Filter filter = static_cast<Scaler::Filter>(f);
+        for (unsigned int factor = 1; factor <= Scaler::MAX_FACTOR; ++factor) {
+            if (!Scaler::supports(filter, factor)) {
+                continue;
+            }
+            Scaler::setKernel(Scaler::SCALAR);
+            std::vector<u8_byte> pixels = scale(picture, filter, factor);
+            for (unsigned int k = 0; k < Scaler::KERNEL_COUNT; ++k) {
+                Scaler::Kernel kernel = static_cast<Scaler::Kernel>(k);
+                if (!Scaler::setKernel(kernel)) {
+                    assert(!Scaler::supported(kernel));
+                    continue;
+                }
+                assert(scale(picture, filter, factor) == pixels);
+            }
+        }
+    }
+    Scaler::setKernel(original);
+}
+
+// Palette indices scale the same as the picture PixelConvert makes of them.
+static void
+testFrame()
+{
+    IndexedFrame frame;
+    std::srand(5);
+    for (unsigned int i = 0; i < IndexedFrame::PIXELS; ++i) {
+        // Runs of a few colours, so EPX has corners to find.
+        frame.m_pixels[i] = (i / 3 + i / IndexedFrame::WIDTH / 2) % 4 == 0 ? std::rand() % 4 : 0x0F;
+    }
+    for (unsigned int y = 0; y < IndexedFrame::HEIGHT; ++y) {
+        frame.m_emphasis[y] = y % 8;
+    }
+
+    Picture picture(IndexedFrame::WIDTH, IndexedFrame::HEIGHT);
+    PixelConvert::convert(frame, PixelConvert::BGRA8888,
+                          reinterpret_cast<u8_byte*>(&picture.m_pixels[0]), IndexedFrame::WIDTH * 4);
+    for (unsigned int f = 0; f < Scaler::FILTER_COUNT; ++f) {
+        Scaler::Filter filter = static_cast<Scaler::Filter>(f);
+        unsigned int factor = filter == Scaler::NEAREST ? 3 : 2;
+        unsigned int pitch = IndexedFrame::WIDTH * factor * 4;
+        std::vector<u8_byte> pixels(pitch * IndexedFrame::HEIGHT * factor);
+        Scaler::scale(frame, PixelConvert::BGRA8888, filter, factor, &pixels[0], pitch);
+        std::vector<u8_byte> reference = scale(picture, filter, factor);
+        for (unsigned int y = 0; y < IndexedFrame::HEIGHT * factor; ++y) {
+            assert(std::memcmp(&pixels[y * pitch], &reference[y * (pitch + PADDING)], pitch) == 0);
+        }
+    }
+}
+
+int main()
+{
+    assert(Scaler::supported(Scaler::SCALAR));
+    assert(Scaler::supports(Scaler::NEAREST, 1) && !Scaler::supports(Scaler::SCANLINES, 1));
+    assert(Scaler::supports(Scaler::EPX, 3) && !Scaler::supports(Scaler::EPX, 4));
+
+    // Odd sizes, so every kernel has some left over after its vectors.
+    std::srand(3);
+    Picture noise(37, 9);
+    for (std::uint32_t& value : noise.m_pixels) {
+        value = std::rand() | 0xFF000000;
+    }
+    // Few colours, so EPX's matches actually happen.
+    Picture blocks(43, 17);
+    for (std::uint32_t& value : blocks.m_pixels) {
+        value = std::rand() % 3 == 0 ? 0xFF2040C0 : (std::rand() % 4 == 0 ? 0x80FFFFFF : 0xFF000000);
+    }
+    // A diagonal line.
+    Picture line(21, 21);
+    for (unsigned int i = 0; i < 21; ++i) {
+        line.m_pixels[i * 21 + i] = 0xFFFFFFFF;
+    }
+
+    testReference(noise);
+    testReference(blocks);
+    testReference(line);
+    testKernels(noise);
+    testKernels(blocks);
+    testKernels(line);
+    testFrame();
+    return 0;
+}
@@ -0,0 +1,231 @@
+#include "PPU/FrameRenderer.hpp"
+#include "PPU/Loopy.hpp"
+#include "PPU/PPU.hpp"
+#include "PPU/PPUInspector.hpp"
+#include "utility/Clock.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <cstdlib>
+#include <cstring>
+
+static void
+testLoopy()
+{
+    // $2000, $2005 twice and $2006 twice, as "The skinny on NES scrolling"
+    // walks through them.
+    u16_word t = Loopy::writeControl(0x7FFF, 0x00);
+    assert(t == 0x73FF);
+    t = Loopy::writeScrollX(0, 0x7D);
+    assert(t == 0x000F && Loopy::fineX(0x7D) == 0x05);
+    t = Loopy::writeScrollY(t, 0x5E);
+    assert(t == 0x616F);
+    t = Loopy::writeAddressHigh(t, 0x3D);
+    assert(t == 0x3D6F);
+    t = Loopy::writeAddressLow(t, 0xF0);
+    assert(t == 0x3DF0);
+
+    // Across into the next nametable and back.
+    assert(Loopy::incrementX(0x001F) == 0x0400);
+    assert(Loopy::addCoarseX(0x041E, 3) == 0x0001);
+    // Down: fine Y, then coarse Y, wrapping at 30 into the nametable below
+    // but at 32 without.
+    assert(Loopy::incrementY(0x0000) == 0x1000);
+    assert(Loopy::incrementY(0x7000) == 0x0020);
+    assert(Loopy::incrementY(0x73A0) == 0x0800);
+    assert(Loopy::incrementY(0x7BE0) == 0x0800);
+    assert(Loopy::copyHorizontal(0x7BE0, 0x041F) == 0x7FFF);
+
+    assert(Loopy::tileAddress(0x7C21) == 0x2C21);
+    assert(Loopy::attributeAddress(Loopy::scroll(1, 8 * 9, 8 * 20)) == 0x27C0 + 5 * 8 + 2);
+}
+
+static void
+randomJob(RenderJob &job)
+{
+    RenderState &state = job.m_start;
+    for (unsigned int i = 0; i < RenderState::VRAM_SIZE; ++i) {
+        state.m_vram[i] = std::rand() & 0xFF;
+    }
+    for (unsigned int i = 0; i < RenderState::OAM_SIZE; ++i) {
+        state.m_oam[i] = std::rand() & 0xFF;
+    }
+    u8_byte scrollX = std::rand() & 0xFF;
+    state.m_control     = std::rand() & 0x3B;
+    state.m_mask        = (std::rand() & 0x07) | 0x18;
+    state.m_tempAddress = Loopy::scroll(std::rand() & 0x03, scrollX, std::rand() % 240);
+    state.m_vramAddress = state.m_tempAddress;
+    state.m_fineX       = Loopy::fineX(scrollX);
+    job.m_events.clear();
+}
+
+static RenderEvent
+event(unsigned int line, unsigned int dot, RenderEvent::Type type, u16_word address, u8_byte value)
+{
+    RenderEvent event;
+    event.m_dot     = line * PPU::ticksPerScanline + dot;
+    event.m_type    = type;
+    event.m_value   = value;
+    event.m_address = address;
+    return event;
+}
+
+// With nothing changing mid-line the dot by dot path has to draw exactly
+// what the fast one does, scrolled anywhere and with raster splits between
+// lines.
+static void
+testSamePicture()
+{
+    std::srand(5);
+    RenderJob job;
+    FrameRenderer fast, dots;
+    dots.setDotsOnly(true);
+    IndexedFrame expected, frame;
+    for (unsigned int i = 0; i < 12; ++i) {
+        randomJob(job);
+        if (i % 2) {
+            // A new fine and coarse X each line, in hblank.
+            for (unsigned int line = 0; line < PPU::height; ++line) {
+                u8_byte scrollX = std::rand() & 0xFF;
+                job.m_events.push_back(event(line, 280, RenderEvent::TempAddressWrite,
+                                             Loopy::writeScrollX(job.m_start.m_tempAddress, scrollX),
+                                             Loopy::fineX(scrollX)));
+            }
+        }
+        fast.render(job, expected);
+        dots.render(job, frame);
+        assert(fast.dotLines() == 0 && dots.dotLines() == PPU::height);
+        assert(std::equal(frame.m_pixels, frame.m_pixels + IndexedFrame::PIXELS, expected.m_pixels));
+    }
+}
+
+// Changes in the middle of a line take effect from the pixel after.
+static void
+testMidLine()
+{
+    std::srand(9);
+    RenderJob job;
+    randomJob(job);
+    job.m_start.m_mask = 0x1E;
+
+    FrameRenderer renderer;
+    IndexedFrame  before, frame;
+    renderer.render(job, before);
+    assert(renderer.dotLines() == 0);
+
+    // Background and sprites off from pixel 100 of line 50: the rest of it
+    // is backdrop, and it stays off.
+    job.m_events.push_back(event(50, 100, RenderEvent::MaskWrite, PPU::MASK_ADDRESS, 0x00));
+    renderer.render(job, frame);
+    assert(renderer.dotLines() == 1);
+    assert(std::equal(frame.row(50), frame.row(50) + 100, before.row(50)));
+    u8_byte backdrop = job.m_start.m_vram[RenderState::PALETTE_ADDRESS] & IndexedFrame::INDEX_MASK;
+    for (unsigned int x = 100; x < PPU::width; ++x) {
+        assert(frame.row(50)[x] == backdrop && frame.row(51)[x] == backdrop);
+    }
+
+    // The same write in hblank touches nothing on line 50.
+    job.m_events[0] = event(50, 258, RenderEvent::MaskWrite, PPU::MASK_ADDRESS, 0x00);
+    renderer.render(job, frame);
+    assert(renderer.dotLines() == 0);
+    assert(std::equal(frame.row(50), frame.row(50) + PPU::width, before.row(50)));
+    assert(frame.row(51)[0] == backdrop);
+
+    // A fine X change mid-line shifts the rest of the line, but with t only
+    // copied at dot 257 the next line starts where it would have.
+    job.m_events[0] = event(80, 128, RenderEvent::TempAddressWrite, job.m_start.m_tempAddress,
+                            (job.m_start.m_fineX + 1) & 0x07);
+    renderer.render(job, frame);
+    assert(renderer.dotLines() == 1);
+    assert(std::equal(frame.row(80), frame.row(80) + 128, before.row(80)));
+    assert(!std::equal(frame.row(80) + 128, frame.row(80) + PPU::width, before.row(80) + 128));
+
+    // Emphasis is one value a line, so a mid-line change takes all of it.
+    job.m_events[0] = event(60, 100, RenderEvent::MaskWrite, PPU::MASK_ADDRESS, 0xBE);
+    renderer.render(job, frame);
+    assert(renderer.dotLines() == 1);
+    assert(frame.m_emphasis[59] == 0 && frame.m_emphasis[60] == 5 && frame.m_emphasis[61] == 5);
+    // Unless it comes after the last pixel.
+    job.m_events[0] = event(60, 256, RenderEvent::MaskWrite, PPU::MASK_ADDRESS, 0xBE);
+    renderer.render(job, frame);
+    assert(frame.m_emphasis[60] == 0 && frame.m_emphasis[61] == 5);
+}
+
+// The $2006 split: v written in hblank moves the next line anywhere, and the
+// lines after carry on down from there.
+static void
+testAddressSplit()
+{
+    std::srand(13);
+    RenderJob job;
+    randomJob(job);
+    job.m_start.m_mask = 0x0A;
+
+    FrameRenderer renderer;
+    IndexedFrame  frame;
+    job.m_events.push_back(event(99, 300, RenderEvent::AddressWrite, job.m_start.m_vramAddress, 0));
+    renderer.render(job, frame);
+    assert(renderer.dotLines() == 0);
+    for (unsigned int line = 0; line < 20; ++line) {
+        assert(std::equal(frame.row(100 + line), frame.row(100 + line) + PPU::width, frame.row(line)));
+    }
+}
+
+static void
+writeRegister(PPU &ppu, u16_word address, u8_byte value)
+{
+    ppu.registerBlock().write(address, value);
+}
+
+// The PPU moves v itself as the lines go by, as the CPU can see.
+static void
+testPPUAddress()
+{
+    Clock        clock(21477270);
+    PPU          ppu(clock);
+    PPUInspector inspector(ppu);
+
+    unsigned long now = 0;
+    auto runTo = [&](unsigned long dot) {
+        for (; now < dot; ++now) {
+            ppu.tick();
+        }
+        ppu.sync();
+    };
+
+    const unsigned long FRAME = 341 * 262;
+    runTo(245 * 341);
+    writeRegister(ppu, PPU::CONTROL_ADDRESS, 0x01);
+    writeRegister(ppu, PPU::SCROLL_ADDRESS, 0x7D);
+    writeRegister(ppu, PPU::SCROLL_ADDRESS, 0x5E);
+    u16_word t = Loopy::scroll(1, 0x7D, 0x5E);
+    assert(inspector.read(PPUInspector::TEMP_ADDRESS) == t);
+
+    // Rendering off: v stays put.
+    runTo(FRAME + 10 * 341);
+    assert(inspector.read(PPUInspector::VRAM_ADDRESS) == 0);
+
+    // On: the pre-render line copies all of t, and each line moves down one.
+    // Checked well away from dot 257, which the odd frame skip may move.
+    writeRegister(ppu, PPU::MASK_ADDRESS, 0x08);
+    runTo(2 * FRAME);
+    assert(inspector.read(PPUInspector::VRAM_ADDRESS) == t);
+    runTo(2 * FRAME + 10 * 341 + 200);
+    u16_word v = t;
+    for (unsigned int line = 0; line < 10; ++line) {
+        v = Loopy::incrementY(v);
+    }
+    assert(inspector.read(PPUInspector::VRAM_ADDRESS) == v);
+    runTo(2 * FRAME + 10 * 341 + 300);
+    assert(inspector.read(PPUInspector::VRAM_ADDRESS) == Loopy::incrementY(v));
+}
+
+int main(int argc, char ** argv)
+{
+    testLoopy();
+    testSamePicture();
+    testMidLine();
+    testAddressSplit();
+    testPPUAddress();
+    return 0;
+}
@@ -0,0 +1,331 @@
+#include "PPU/FrameRenderer.hpp"
+#include "PPU/PPU.hpp"
+#include "PPU/SpriteLine.hpp"
+#include "utility/Clock.hpp"
+#include "utility/Memory.hpp"
+
+#include <cassert>
+#include <cstdlib>
+#include <vector>
+
+// Palette entries used below.
+const u8_byte BACKDROP   = 0x0F;
+const u8_byte BACKGROUND = 0x16;
+const u8_byte SPRITE_A   = 0x2A;
+const u8_byte SPRITE_B   = 0x12;
+
+static bool
+pixelIs(const IndexedFrame &frame, unsigned int x, unsigned int y, u8_byte value)
+{
+    return frame.row(y)[x] == value;
+}
+
+static void
+setSprite(u8_byte *oam, unsigned int index, u8_byte y, u8_byte tile, u8_byte attributes, u8_byte x)
+{
+    oam[index * 4]     = y;
+    oam[index * 4 + 1] = tile;
+    oam[index * 4 + 2] = attributes;
+    oam[index * 4 + 3] = x;
+}
+
+static void
+testEvaluate()
+{
+    u8_byte oam[256];
+    std::fill(oam, oam + 256, 0xFF);
+    SpriteLine sprites;
+
+    // OAM y is the line above the sprite.
+    setSprite(oam, 0, 0, 0x03, 0x00, 10);
+    sprites.evaluate(oam, 0, 0x00);
+    assert(sprites.count() == 0);
+    sprites.evaluate(oam, 1, 0x00);
+    assert(sprites.count() == 1 && sprites.hasSpriteZero());
+    assert(sprites.sprite(0).m_rowAddress == 0x0030);
+    sprites.evaluate(oam, 8, 0x08);
+    assert(sprites.count() == 1 && sprites.sprite(0).m_rowAddress == 0x1037);
+    sprites.evaluate(oam, 9, 0x00);
+    assert(sprites.count() == 0);
+
+    // Nine on a line: the first eight in OAM order, and overflow.
+    for (unsigned int i = 1; i <= 9; ++i) {
+        setSprite(oam, i, 20, i, 0x00, i * 10);
+    }
+    sprites.evaluate(oam, 21, 0x00);
+    assert(sprites.count() == 8 && sprites.overflow() && !sprites.hasSpriteZero());
+    assert(sprites.sprite(0).m_x == 10 && sprites.sprite(7).m_x == 80);
+    sprites.evaluate(oam, 5, 0x00);
+    assert(sprites.count() == 1 && !sprites.overflow());
+
+    // 8x16: bit 0 picks the table, the bottom half is the next tile, and a
+    // vertical flip swaps the halves too.
+    std::fill(oam, oam + 256, 0xFF);
+    setSprite(oam, 0, 40, 0x05, 0x00, 0);
+    setSprite(oam, 1, 40, 0x05, SpriteLine::VERTICAL_FLIP_MASK, 0);
+    sprites.evaluate(oam, 41 + 9, 0x20);
+    assert(sprites.count() == 2);
+    assert(sprites.sprite(0).m_rowAddress == 0x1000 + 0x05 * 16 + 1);
+    assert(sprites.sprite(1).m_rowAddress == 0x1000 + 0x04 * 16 + 6);
+}
+
+// The SIMD compositor against the rules spelled out a pixel at a time.
+static void
+testComposite()
+{
+    std::srand(3);
+    u8_byte background[256], sprites[256], entries[256];
+    for (unsigned int round = 0; round < 2000; ++round) {
+        for (unsigned int x = 0; x < 256; ++x) {
+            background[x] = std::rand() & 0x0F;
+            u8_byte color = std::rand() & 0x03;
+            sprites[x] = color == 0 ? 0 : (0x10 | (std::rand() & 0x0C) | color | (std::rand() & 0x40));
+            if (sprites[x] != 0 && std::rand() % 64 == 0) {
+                sprites[x] |= SpriteLine::SPRITE_ZERO;
+            }
+        }
+        if (round % 2 == 0) {
+            // Leave room for the occasional line with no hit, or one at x 255.
+            std::fill(sprites, sprites + 255, 0);
+            sprites[255] |= SpriteLine::SPRITE_ZERO * (sprites[255] != 0);
+        }
+
+        int hit = SpriteLine::composite(background, sprites, entries);
+
+        int expectedHit = -1;
+        for (unsigned int x = 0; x < 256; ++x) {
+            bool backOpaque = background[x] & 0x03;
+            bool front      = sprites[x] != 0 && !(backOpaque && (sprites[x] & SpriteLine::BEHIND_BACKGROUND));
+            u8_byte expected = front ? (sprites[x] & 0x1F) : (backOpaque ? background[x] : 0);
+            assert(entries[x] == expected);
+            if (expectedHit < 0 && backOpaque && (sprites[x] & SpriteLine::SPRITE_ZERO) && x != 255) {
+                expectedHit = x;
+            }
+        }
+        assert(hit == expectedHit);
+    }
+}
+
+// Priority, flipping and clipping through the renderer.
+static void
+testRender()
+{
+    RenderJob job;
+    RenderState &state = job.m_start;
+    std::fill(state.m_vram, state.m_vram + RenderState::VRAM_SIZE, 0);
+    std::fill(state.m_oam, state.m_oam + RenderState::OAM_SIZE, 0xFF);
+
+    // Tile 1 solid colour 1, the background's left half. Tile 2 has colour 2
+    // in its left four pixels and nothing in the right four.
+    for (unsigned int y = 0; y < 8; ++y) {
+        state.m_vram[0x10 + y] = 0xFF;
+        state.m_vram[0x28 + y] = 0xF0;
+    }
+    for (unsigned int i = 0; i < 32 * 30; ++i) {
+        state.m_vram[0x2000 + i] = (i % 32 < 16) ? 1 : 0;
+    }
+    state.m_vram[0x3F00] = BACKDROP;
+    state.m_vram[0x3F01] = BACKGROUND;
+    state.m_vram[0x3F12] = SPRITE_A;
+    state.m_vram[0x3F16] = SPRITE_B;
+
+    u8_byte *oam = state.m_oam;
+    // Lines 10-17: sprite 0 (palette 1) and, flipped, sprite 1 (palette 0)
+    // at the same spot. Sprite 0 wins where both are opaque.
+    setSprite(oam, 0, 9, 2, 0x01, 200);
+    setSprite(oam, 1, 9, 2, SpriteLine::HORIZONTAL_FLIP_MASK, 200);
+    // Behind the background: hidden over it, shown over the backdrop.
+    setSprite(oam, 2, 29, 2, SpriteLine::BEHIND_BACKGROUND_MASK, 50);
+    setSprite(oam, 3, 29, 2, SpriteLine::BEHIND_BACKGROUND_MASK, 140);
+    // In front, in the leftmost 8 pixels.
+    setSprite(oam, 4, 49, 2, 0x00, 0);
+
+    state.m_control = 0x00;
+    state.m_mask    = 0x1E;
+    state.m_vramAddress = 0x0000;
+    state.m_tempAddress = 0x0000;
+    state.m_fineX       = 0;
+
+    IndexedFrame frame;
+    FrameRenderer renderer;
+    renderer.render(job, frame);
+
+    assert(pixelIs(frame, 200, 10, SPRITE_B));
+    assert(pixelIs(frame, 203, 17, SPRITE_B));
+    assert(pixelIs(frame, 204, 10, SPRITE_A));
+    assert(pixelIs(frame, 207, 10, SPRITE_A));
+    assert(pixelIs(frame, 208, 10, BACKDROP));
+    assert(pixelIs(frame, 200, 18, BACKDROP));
+
+    assert(pixelIs(frame, 50,  30, BACKGROUND));
+    assert(pixelIs(frame, 140, 30, SPRITE_A));
+    assert(pixelIs(frame, 144, 30, BACKDROP));
+
+    assert(pixelIs(frame, 0, 50, SPRITE_A));
+    assert(pixelIs(frame, 4, 50, BACKGROUND));
+
+    // Sprites off in the leftmost 8 pixels.
+    job.m_start.m_mask = 0x1A;
+    renderer.render(job, frame);
+    assert(pixelIs(frame, 0, 50, BACKGROUND));
+    assert(pixelIs(frame, 204, 10, SPRITE_A));
+
+    // Sprites off altogether.
+    job.m_start.m_mask = 0x0E;
+    renderer.render(job, frame);
+    assert(pixelIs(frame, 204, 10, BACKDROP));
+}
+
+static void
+writeVideo(PPU &ppu, u16_word address, u8_byte value)
+{
+    Memory &registers = ppu.registerBlock();
+    registers.write(PPU::SCROLL_ADDRESS_ADDRESS, address >> 8);
+    registers.write(PPU::SCROLL_ADDRESS_ADDRESS, address & 0xFF);
+    registers.write(PPU::SCROLL_DATA_ADDRESS,    value);
+}
+
+static u8_byte
+status(PPU &ppu, unsigned long &now, unsigned long dot)
+{
+    while (now < dot) {
+        ppu.tick();
+        ++now;
+    }
+    return ppu.registerBlock().read(PPU::STATUS_ADDRESS);
+}
+
+// Sprite 0 hit and overflow as the CPU sees them.
+static void
+testStatus()
+{
+    Clock        clock(21477270);
+    PPU          ppu(clock);
+    ppu.setOutputEnabled(false);
+    Memory &registers = ppu.registerBlock();
+
+    // Set up in vblank; the flags are only sure to be clear from the next
+    // pre-render line on.
+    const u8_byte HIT      = 0x40;
+    const u8_byte OVERFLOW = 0x20;
+    const unsigned long FRAME = 341 * 262;
+    unsigned long now = 0;
+    status(ppu, now, 245 * 341);
+
+    // Solid tile 1 over the whole background.
+    for (unsigned int y = 0; y < 8; ++y) {
+        writeVideo(ppu, 0x10 + y, 0xFF);
+    }
+    for (unsigned int i = 0; i < 32 * 30; ++i) {
+        writeVideo(ppu, 0x2000 + i, 1);
+    }
+    // Sprite 0 on lines 50-57 at x 100, nine sprites on lines 120-127.
+    registers.write(PPU::OAM_ADDRESS_ADDRESS, 0x00);
+    for (unsigned int i = 0; i < 64; ++i) {
+        u8_byte y = (i == 0) ? 49 : (i < 10 ? 119 : 0xFF);
+        registers.write(PPU::OAM_DATA_ADDRESS, y);
+        registers.write(PPU::OAM_DATA_ADDRESS, 1);
+        registers.write(PPU::OAM_DATA_ADDRESS, 0);
+        registers.write(PPU::OAM_DATA_ADDRESS, i == 0 ? 100 : i * 8);
+    }
+    registers.write(PPU::SCROLL_ADDRESS, 0);
+    registers.write(PPU::SCROLL_ADDRESS, 0);
+    registers.write(PPU::CONTROL_ADDRESS, 0x00);
+    registers.write(PPU::MASK_ADDRESS, 0x1E);
+
+    unsigned long hitDot = FRAME + 50 * 341 + 100 + 1;
+
+    assert((status(ppu, now, FRAME) & (HIT | OVERFLOW)) == 0);
+    assert(!(status(ppu, now, FRAME + 49 * 341) & HIT));
+    assert(!(status(ppu, now, hitDot) & HIT));
+    assert(status(ppu, now, hitDot + 1) & HIT);
+    assert(!(status(ppu, now, FRAME + 120 * 341) & OVERFLOW));
+    assert(status(ppu, now, FRAME + 121 * 341) & OVERFLOW);
+    // Both are cleared on the pre-render line.
+    assert((status(ppu, now, FRAME + 261 * 341 + 2) & (HIT | OVERFLOW)) == 0);
+
+    // Without the background there's nothing to hit.
+    registers.write(PPU::MASK_ADDRESS, 0x14);
+    assert(!(status(ppu, now, 2 * FRAME + 200 * 341) & HIT));
+    // Nothing is missed by not looking at $2002 until the frame is over.
+    registers.write(PPU::MASK_ADDRESS, 0x1E);
+    assert(status(ppu, now, 3 * FRAME + 245 * 341) & HIT);
+}
+
+// Where sprite 0 hits, from one opaque sprite pixel over a background of
+// tiles opaque on their left half only. Returns the dot the hit shows on, or
+// 0 for no hit.
+static unsigned long
+hitDot(u8_byte spriteX, bool flip, u8_byte scrollX, u8_byte mask)
+{
+    Clock        clock(21477270);
+    PPU          ppu(clock);
+    ppu.setOutputEnabled(false);
+    Memory &registers = ppu.registerBlock();
+
+    const unsigned long FRAME = 341 * 262;
+    unsigned long now = 0;
+    status(ppu, now, 245 * 341);
+
+    // Tile 1 is opaque on the left, tile 2 only in its rightmost column.
+    for (unsigned int y = 0; y < 8; ++y) {
+        writeVideo(ppu, 0x10 + y, 0xF0);
+        writeVideo(ppu, 0x28 + y, 0x01);
+    }
+    for (unsigned int i = 0; i < 2 * 0x400; ++i) {
+        writeVideo(ppu, 0x2000 + i, 1);
+    }
+    registers.write(PPU::OAM_ADDRESS_ADDRESS, 0x00);
+    registers.write(PPU::OAM_DATA_ADDRESS, 49);
+    registers.write(PPU::OAM_DATA_ADDRESS, 2);
+    registers.write(PPU::OAM_DATA_ADDRESS, flip ? 0x60 : 0x00);
+    registers.write(PPU::OAM_DATA_ADDRESS, spriteX);
+    registers.write(PPU::SCROLL_ADDRESS, scrollX);
+    registers.write(PPU::SCROLL_ADDRESS, 0);
+    registers.write(PPU::CONTROL_ADDRESS, 0x00);
+    registers.write(PPU::MASK_ADDRESS, mask);
+
+    for (unsigned long dot = FRAME + 50 * 341; dot < FRAME + 51 * 341; ++dot) {
+        if (status(ppu, now, dot) & 0x40) {
+            return dot - 1;
+        }
+    }
+    return 0;
+}
+
+// Sprite 0 hit is worked out from opaque masks; it has to agree pixel for
+// pixel with the picture's.
+static void
+testHitMasks()
+{
+    const unsigned long LINE = 341 * 262 + 50 * 341;
+    for (unsigned int scroll = 0; scroll < 16; ++scroll) {
+        for (unsigned int flip = 0; flip < 2; ++flip) {
+            unsigned int x = 100 + (flip ? 0 : 7);
+            bool opaque = (x + scroll) % 8 < 4;
+            // Flipped it is also behind the background, which makes no difference.
+            assert(hitDot(100, flip, scroll, 0x1E) == (opaque ? LINE + x + 1 : 0));
+        }
+    }
+
+    // The leftmost pixels hide it if either half is clipped there.
+    assert(hitDot(1, false, 0, 0x1E) == LINE + 8 + 1);
+    assert(hitDot(1, true, 0, 0x1E) == LINE + 1 + 1);
+    assert(hitDot(1, true, 0, 0x1C) == 0);
+    assert(hitDot(1, true, 0, 0x1A) == 0);
+    assert(hitDot(1, false, 0, 0x18) == LINE + 8 + 1);
+    // Never at x 255, and nothing past the edge.
+    assert(hitDot(248, false, 4, 0x1E) == 0);
+    assert(hitDot(254, true, 2, 0x1E) == LINE + 254 + 1);
+    assert(hitDot(255, true, 1, 0x1E) == 0);
+}
+
+int main(int argc, char ** argv)
+{
+    testEvaluate();
+    testComposite();
+    testRender();
+    testStatus();
+    testHitMasks();
+    return 0;
+}
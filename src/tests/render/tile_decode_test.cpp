@@ -0,0 +1,77 @@
+#include "PPU/TileDecode.hpp"
+
+#include <cassert>
+#include <vector>
+
+const unsigned int TILE_BYTES  = 16;
+const unsigned int TILE_PIXELS = 64;
+
+// decodeRow against the bit-at-a-time definition.
+static void
+testReference()
+{
+    u8_byte pixels[8];
+    for (unsigned int planes = 0; planes < 0x10000; ++planes) {
+        u8_byte plane0 = planes & 0xFF;
+        u8_byte plane1 = planes >> 8;
+        for (unsigned int flip = 0; flip < 2; ++flip) {
+            TileDecode::decodeRow(plane0, plane1, pixels, flip);
+            for (unsigned int x = 0; x < 8; ++x) {
+                unsigned int bit  = flip ? x : 7 - x;
+                unsigned int bit0 = (plane0 >> bit) & 0x01;
+                unsigned int bit1 = (plane1 >> bit) & 0x01;
+                assert(pixels[x] == ((bit1 << 1) | bit0));
+            }
+        }
+    }
+}
+
+// Every plane pair, once per row of 8192 tiles, through every kernel this CPU
+// can run, both ways round.
+static void
+testKernels()
+{
+    std::vector<u8_byte> patterns(0x10000 / 8 * TILE_BYTES);
+    for (unsigned int planes = 0; planes < 0x10000; ++planes) {
+        unsigned int tile = planes / 8;
+        unsigned int row  = planes % 8;
+        patterns[tile * TILE_BYTES + row]     = planes & 0xFF;
+        patterns[tile * TILE_BYTES + row + 8] = planes >> 8;
+    }
+    unsigned int tiles = patterns.size() / TILE_BYTES;
+
+    TileDecode::Kernel original = TileDecode::kernel();
+    for (unsigned int k = 0; k < TileDecode::KERNEL_COUNT; ++k) {
+        TileDecode::Kernel kernel = static_cast<TileDecode::Kernel>(k);
+        if (!TileDecode::setKernel(kernel)) {
+            assert(!TileDecode::supported(kernel));
+            continue;
+        }
+        assert(TileDecode::kernel() == kernel);
+
+        for (unsigned int flip = 0; flip < 2; ++flip) {
+            // One spare tile on the end catches writes past the last one.
+            std::vector<u8_byte> pixels((tiles + 1) * TILE_PIXELS, 0xAA);
+            TileDecode::decodeTiles(&patterns[0], tiles, &pixels[0], flip);
+            for (unsigned int planes = 0; planes < 0x10000; ++planes) {
+                u8_byte expected[8];
+                TileDecode::decodeRow(planes & 0xFF, planes >> 8, expected, flip);
+                for (unsigned int x = 0; x < 8; ++x) {
+                    assert(pixels[planes * 8 + x] == expected[x]);
+                }
+            }
+            for (unsigned int i = tiles * TILE_PIXELS; i < pixels.size(); ++i) {
+                assert(pixels[i] == 0xAA);
+            }
+        }
+    }
+    TileDecode::setKernel(original);
+}
+
+int main()
+{
+    assert(TileDecode::supported(TileDecode::SCALAR));
+    testReference();
+    testKernels();
+    return 0;
+}
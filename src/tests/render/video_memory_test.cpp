@@ -0,0 +1,139 @@
+#include "PPU/VideoMemory.hpp"
+#include "PPU/RenderLog.hpp"
+
+#include <cassert>
+#include <vector>
+
+// Which of the four nametables a byte written to each one shows up in.
+static void
+checkMirroring(VideoMemory::Mirroring mirroring, const unsigned int (&pages)[VideoMemory::NAMETABLES])
+{
+    VideoMemory memory;
+    memory.setMirroring(mirroring);
+    for (unsigned int nametable = 0; nametable < VideoMemory::NAMETABLES; ++nametable) {
+        u16_word address = VideoMemory::NAMETABLE_ADDRESS + nametable * VideoMemory::PAGE_SIZE + 0x123;
+        memory.write(address, nametable + 1);
+        for (unsigned int other = 0; other < VideoMemory::NAMETABLES; ++other) {
+            u16_word otherAddress = VideoMemory::NAMETABLE_ADDRESS + other * VideoMemory::PAGE_SIZE + 0x123;
+            bool same = pages[other] == pages[nametable];
+            assert((memory.read(otherAddress) == nametable + 1) == same);
+            // $3000-$3EFF shows the same.
+            assert(memory.read(otherAddress + 0x1000) == memory.read(otherAddress));
+        }
+
+        u16_word aliases[VideoMemory::MAX_ALIASES];
+        unsigned int count = memory.aliases(address + 0x1000, aliases);
+        unsigned int expected = 0;
+        for (unsigned int other = 0; other < VideoMemory::NAMETABLES; ++other) {
+            expected += pages[other] == pages[nametable];
+        }
+        assert(count == expected);
+        for (unsigned int i = 0; i < count; ++i) {
+            assert(memory.read(aliases[i]) == nametable + 1);
+        }
+
+        // Put it back for the next one.
+        memory.write(address, 0);
+    }
+}
+
+static void
+testMirroring()
+{
+    const unsigned int horizontal[] = { 0, 0, 1, 1 };
+    const unsigned int vertical[]   = { 0, 1, 0, 1 };
+    const unsigned int single[]     = { 0, 0, 0, 0 };
+    const unsigned int four[]       = { 0, 1, 2, 3 };
+    checkMirroring(VideoMemory::HorizontalMirroring, horizontal);
+    checkMirroring(VideoMemory::VerticalMirroring, vertical);
+    checkMirroring(VideoMemory::SingleScreenLower, single);
+    checkMirroring(VideoMemory::SingleScreenUpper, single);
+    checkMirroring(VideoMemory::FourScreenMirroring, four);
+
+    // The two single screens are different pages.
+    VideoMemory memory;
+    memory.setMirroring(VideoMemory::SingleScreenLower);
+    memory.write(0x2000, 0x11);
+    memory.setMirroring(VideoMemory::SingleScreenUpper);
+    assert(memory.read(0x2C00) == 0x00);
+    memory.setMirroring(VideoMemory::VerticalMirroring);
+    assert(memory.read(0x2800) == 0x11);
+}
+
+static void
+testPalette()
+{
+    VideoMemory memory;
+    for (unsigned int entry = 0; entry < VideoMemory::PALETTE_SIZE; ++entry) {
+        memory.write(VideoMemory::PALETTE_ADDRESS + entry, entry);
+    }
+    // The sprite palettes' colour 0 entries were written over the background's.
+    for (unsigned int entry = 0; entry < VideoMemory::PALETTE_SIZE; ++entry) {
+        u8_byte expected = (entry % 4 == 0) ? (entry | 0x10) : entry;
+        assert(memory.read(VideoMemory::PALETTE_ADDRESS + entry) == expected);
+        // Repeated up to $3FFF, and $7F00 is $3F00.
+        assert(memory.read(0x3FE0 + entry) == expected);
+        assert(memory.read(0x7F00 + entry) == expected);
+    }
+
+    u16_word aliases[VideoMemory::MAX_ALIASES];
+    assert(memory.aliases(0x3F14, aliases) == 2);
+    assert(aliases[0] == 0x3F04 && aliases[1] == 0x3F14);
+    assert(memory.aliases(0x3FE5, aliases) == 1);
+    assert(aliases[0] == 0x3F05);
+}
+
+static void
+testPatterns()
+{
+    VideoMemory memory;
+    // Our own CHR RAM to start with.
+    memory.write(0x0010, 0x5A);
+    assert(memory.read(0x0010) == 0x5A);
+
+    // Cartridge CHR ROM, banked a page at a time.
+    std::vector<u8_byte> rom(2 * VideoMemory::PAGE_SIZE);
+    for (unsigned int i = 0; i < rom.size(); ++i) {
+        rom[i] = i / VideoMemory::PAGE_SIZE + 1;
+    }
+    memory.mapPatterns(0, &rom[VideoMemory::PAGE_SIZE], false);
+    memory.mapPatterns(7, &rom[0], false);
+    assert(memory.read(0x0010) == 2);
+    assert(memory.read(0x1C00) == 1);
+    assert(!memory.write(0x0010, 0xFF));
+    assert(rom[VideoMemory::PAGE_SIZE + 0x10] == 2);
+
+    // CHR RAM writes go to the cartridge.
+    memory.mapPatterns(1, &rom[0], true);
+    assert(memory.write(0x0401, 0x77));
+    assert(rom[1] == 0x77 && memory.read(0x1C01) == 0x77);
+
+    // And unmapping brings ours back.
+    memory.mapPatterns(0, nullptr, false);
+    assert(memory.read(0x0010) == 0x5A);
+}
+
+static void
+testCopy()
+{
+    VideoMemory memory;
+    memory.setMirroring(VideoMemory::VerticalMirroring);
+    for (unsigned int address = 0; address < VideoMemory::SIZE; address += 7) {
+        memory.write(address, address * 13);
+    }
+
+    std::vector<u8_byte> vram(RenderState::VRAM_SIZE);
+    memory.copyTo(&vram[0]);
+    for (unsigned int address = 0; address < VideoMemory::SIZE; ++address) {
+        assert(vram[address] == memory.read(address));
+    }
+}
+
+int main(int argc, char ** argv)
+{
+    testMirroring();
+    testPalette();
+    testPatterns();
+    testCopy();
+    return 0;
+}
@@ -30,8 +30,8 @@ tick()
             }
     });
 
-    //TODO: Measure time elapsed between ticks, and make sure it matches the specific hertz (if possible).
-    // Though it may be better to do this every so often instead of every tick.
+    // NOTE: Real-time pacing against m_hertz is done once per frame by
+    // FramePacer, checking the time every tick would cost far too much.
 
     m_count++;
 }
@@ -43,6 +43,13 @@ count() const
     return m_count;
 }
 
+unsigned int
+Clock::
+hertz() const
+{
+    return m_hertz;
+}
+
 ClockedDevice::
 ClockedDevice(unsigned int divisor) :
     m_divisor (divisor)
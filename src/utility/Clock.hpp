@@ -23,6 +23,7 @@ public:
 
     void         tick();
     unsigned int count() const;
+    unsigned int hertz() const;
 
     void registerDevice(ClockedDevice *device);
 
@@ -0,0 +1,62 @@
+#include "CommandChannel.hpp"
+
+#include <cassert>
+
+CommandChannel::
+CommandChannel(unsigned int capacity) :
+    m_requests (capacity),
+    m_completions (capacity),
+    m_outstanding (0)
+{
+}
+
+bool
+CommandChannel::
+post(const std::string& input)
+{
+    if (m_outstanding == m_completions.capacity()) {
+        return false;
+    }
+
+    bool pushed = m_requests.push(input);
+    assert(pushed && "CommandChannel::post: request queue out of step with outstanding count!");
+    ++m_outstanding;
+    return pushed;
+}
+
+bool
+CommandChannel::
+poll(Completion& completion)
+{
+    if (!m_completions.pop(completion)) {
+        return false;
+    }
+    --m_outstanding;
+    return true;
+}
+
+unsigned int
+CommandChannel::
+outstanding() const
+{
+    return m_outstanding;
+}
+
+unsigned int
+CommandChannel::
+process(CommandDispatcher& dispatcher)
+{
+    unsigned int processed = 0;
+    Completion completion;
+
+    while (m_requests.pop(completion.m_input)) {
+        completion.m_result = dispatcher.command(completion.m_input);
+
+        bool pushed = m_completions.push(completion);
+        assert(pushed && "CommandChannel::process: completion queue overflowed!");
+        (void)pushed;
+        ++processed;
+    }
+
+    return processed;
+}
@@ -0,0 +1,49 @@
+#ifndef COMMAND_CHANNEL_H
+#define COMMAND_CHANNEL_H
+
+#include "Commandable.hpp"
+#include "SPSCQueue.hpp"
+
+#include <string>
+
+/*
+CommandChannel
+
+Carries console commands from the UI thread to the thread that owns the
+emulated machine, and their results back. Requests and completions each go
+through their own lock-free SPSC queue; the owning thread calls process() at
+points where it's safe to touch the machine (between frames).
+
+The UI side never has more requests in flight than the completion queue can
+hold, so process() can always report back without waiting.
+*/
+
+class CommandChannel
+{
+public:
+    static const unsigned int DEFAULT_CAPACITY = 64;
+
+    CommandChannel(unsigned int capacity = DEFAULT_CAPACITY);
+
+    struct Completion
+    {
+        std::string   m_input;
+        CommandResult m_result;
+    };
+
+    // UI side. post() returns false if too many commands are outstanding.
+    bool post(const std::string& input);
+    bool poll(Completion& completion);
+    unsigned int outstanding() const;
+
+    // Emulation side. Runs every pending command, returns how many ran.
+    unsigned int process(CommandDispatcher& dispatcher);
+
+private:
+    SPSCQueue<std::string> m_requests;
+    SPSCQueue<Completion>  m_completions;
+    // Only touched by the UI side.
+    unsigned int           m_outstanding;
+};
+
+#endif //COMMAND_CHANNEL_H
@@ -5,7 +5,6 @@
 #include <algorithm>
 #include <iterator>
 
-#include <iostream>
 
 Commandable::
 Commandable(std::string name) :
@@ -18,11 +17,16 @@ Commandable(std::string name) :
     help_command.m_keyword  = "help";
     help_command.m_helpText = "List the commands that this object can recieve and how to use them.";
     help_command.m_code     = HELP_COMMAND;
-    std::cout << "Help code is " << HELP_COMMAND << "\n";
     help_command.m_numArguments = 0;
     addCommand(help_command);
 }
 
+Commandable::
+~Commandable()
+{
+    CommandDispatcher::instance()->removeObject(this);
+}
+
 std::string
 Commandable::
 name() const
@@ -109,7 +113,6 @@ handleBuiltInCommand(std::vector<std::string> tokens)
     if (tokens.size() == 0) { return result; }
 
     std::string command = *tokens.begin();
-    std::cout << "Command: \"" << command << "\"\n";
     tokens.erase(tokens.begin());
 
     if (command == std::string("list")) {
@@ -119,6 +122,7 @@ handleBuiltInCommand(std::vector<std::string> tokens)
         }
         std::string name_of_type = *tokens.begin();
 
+        std::lock_guard<std::mutex> lock(m_mutex);
         ObjectTypeNameToVectorType::iterator it = m_typelist.find(name_of_type);
         if (it == m_typelist.end()) {
             std::stringstream output;
@@ -146,9 +150,7 @@ command(const std::string& input)
     CommandResult result;
     result.m_code = CommandResult::NO_RECEIVER;
 
-    if (m_awaitingRegistration.size() > 0) {
-        finishRegistration();
-    }
+    finishRegistration();
 
     // Parse the name from the input.
     // TODO: Strip leading whitespace.
@@ -174,22 +176,25 @@ command(const std::string& input)
     }
 
     // Otherwise, try to find an object to receive the command.
-    ObjectMapType::iterator it = m_objects.find(name);
-
-    if (it != m_objects.end()) {
-        Commandable *receiver = it->second;
+    Commandable *receiver = nullptr;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        ObjectMapType::iterator it = m_objects.find(name);
+        if (it != m_objects.end()) {
+            receiver = it->second;
+        }
+    }
 
+    if (receiver != nullptr) {
         CommandInput comInput;
         comInput.m_keyword     = command;
         comInput.m_code        = receiver->translate(command);
         comInput.m_arguments   = tokens;
-        std::cout << "Got " << comInput.m_keyword << " " << comInput.m_code << "\n";
 
         // First try the built-in commands.
         result = receiver->receiveBuiltInCommand(comInput);
         // Then try the objects self-defined commands.
         if (result.m_code == CommandResult::ResultCode::NO_RECEIVER) {
-            std::cout << comInput.m_keyword << " is not builtin...\n";
             result = receiver->receiveCommand(comInput);
         }
     }
@@ -204,17 +209,26 @@ void
 CommandDispatcher::
 delayedRegister(Commandable *object)
 {
+    std::lock_guard<std::mutex> lock(m_mutex);
     m_awaitingRegistration.push_back(object);
 }
 
 void
 CommandDispatcher::
 finishRegistration()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    registerPending();
+}
+
+void
+CommandDispatcher::
+registerPending()
 {
     std::for_each(m_awaitingRegistration.begin(), 
                   m_awaitingRegistration.end(),
         [this] (Commandable * object) {
-            registerObject(object);
+            registerLocked(object);
     }); 
     m_awaitingRegistration.clear();
 }
@@ -222,6 +236,14 @@ finishRegistration()
 bool
 CommandDispatcher::
 registerObject(Commandable* object)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return registerLocked(object);
+}
+
+bool
+CommandDispatcher::
+registerLocked(Commandable* object)
 {
     std::pair<ObjectMapType::iterator, bool> result;
 
@@ -248,7 +270,23 @@ bool
 CommandDispatcher::
 removeObject(Commandable* object)
 {
-    return m_objects.erase(object->name());
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    // It may never have been registered, or be one of several with its name.
+    m_awaitingRegistration.erase(std::remove(m_awaitingRegistration.begin(),
+                                             m_awaitingRegistration.end(), object),
+                                 m_awaitingRegistration.end());
+    std::for_each(m_typelist.begin(), m_typelist.end(), [object] (ObjectTypeNameToVectorType::value_type &value) {
+            std::vector<Commandable*> &objects = value.second;
+            objects.erase(std::remove(objects.begin(), objects.end(), object), objects.end());
+    });
+
+    ObjectMapType::iterator it = m_objects.find(object->name());
+    if (it == m_objects.end() || it->second != object) {
+        return false;
+    }
+    m_objects.erase(it);
+    return true;
 }
 
 CommandDispatcher*
@@ -4,6 +4,7 @@
 #include <string>
 #include <vector>
 #include <map>
+#include <mutex>
 
 #include <limits.h>
 
@@ -67,6 +68,8 @@ class Commandable
 {
 public:
     Commandable(std::string name);
+    // Leaves the dispatcher, so objects can come and go (e.g. one NES per job).
+    virtual ~Commandable();
 
     typedef std::map<CommandCode, Command>      CommandMapType;
     typedef std::map<std::string, CommandCode>  TranslationMapType;
@@ -90,6 +93,8 @@ private:
     std::string         m_name;
 };
 
+// Objects may register and leave from any thread; commands are dispatched on
+// whichever thread calls command().
 class CommandDispatcher
 {
 public:
@@ -107,6 +112,9 @@ public:
     static CommandDispatcher* instance();
 
 private:
+    void          registerPending();
+    bool          registerLocked(Commandable* object);
+
     std::vector<std::string> parseArguments(std::string input);
     CommandResult handleBuiltInCommand(std::vector<std::string> tokens);
 
@@ -119,6 +127,8 @@ private:
     ObjectMapType               m_objects;
     ObjectTypeNameToVectorType  m_typelist;
     std::vector<Commandable*> m_awaitingRegistration;
+    // Guards the maps and the registration queue, not the commands themselves.
+    std::mutex                m_mutex;
 };
 
 #endif //COMMANDABLE_H
@@ -7,7 +7,8 @@
 Console::
 Console() :
     m_logger (Logger::get_instance()),
-    m_dispatcher (CommandDispatcher::instance())
+    m_dispatcher (CommandDispatcher::instance()),
+    m_channel (nullptr)
 {
     m_logger->setOutStream(m_stream);
 }
@@ -16,9 +17,43 @@ void
 Console::
 receive_input(std::string input)
 {
-    CommandResult result = m_dispatcher->command(input);
-
     *m_logger << "> " << input << "\n";
+
+    if (m_channel) {
+        if (!m_channel->post(input)) {
+            *m_logger << "Too many commands pending, dropped: " << input << "\n";
+        }
+        return;
+    }
+
+    report(m_dispatcher->command(input));
+}
+
+void
+Console::
+setCommandChannel(CommandChannel* channel)
+{
+    m_channel = channel;
+}
+
+void
+Console::
+poll()
+{
+    if (!m_channel) {
+        return;
+    }
+
+    CommandChannel::Completion completion;
+    while (m_channel->poll(completion)) {
+        report(completion.m_result);
+    }
+}
+
+void
+Console::
+report(const CommandResult& result)
+{
     *m_logger << result.m_output << "\n";
     // TODO: More output/handling here.
     if (result.m_code != CommandResult::OK) {
@@ -2,6 +2,7 @@
 #define CONSOLE_H
 
 #include "Commandable.hpp"
+#include "CommandChannel.hpp"
 #include "Logger.hpp"
 
 #include <map>
@@ -12,6 +13,10 @@
 Console
 
 A way to interact with the application.  Outputs the result to the logger.
+
+Without a command channel, commands run immediately on the calling thread.
+With one, they're posted to whichever thread owns the channel's other end and
+their results show up once poll() picks them up.
 */
 
 class Console 
@@ -23,10 +28,17 @@ public:
     void receive_input(std::string input);
     std::string contents();
 
+    void setCommandChannel(CommandChannel* channel);
+    // Logs the results of any commands that have completed since the last poll.
+    void poll();
+
 private:
+    void report(const CommandResult& result);
+
     std::stringstream  m_stream;
     CommandDispatcher  *m_dispatcher;
     Logger             *m_logger;
+    CommandChannel     *m_channel;
 };
 
 #endif //CONSOLE_H
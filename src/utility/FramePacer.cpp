@@ -0,0 +1,273 @@
+#include "FramePacer.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <iomanip>
+#include <sstream>
+#include <thread>
+
+const CommandCode STATS_COMMAND_CODE = 0;
+const CommandCode RESET_COMMAND_CODE = 1;
+
+const double FramePacer::UNTHROTTLED = 0.0;
+const unsigned int FramePacer::SAMPLE_WINDOW;
+const unsigned int FramePacer::MAX_LAG_FRAMES;
+
+// Bounds for the adaptive spin window.
+const FramePacer::Duration MIN_SPIN_WINDOW = std::chrono::microseconds(200);
+const FramePacer::Duration MAX_SPIN_WINDOW = std::chrono::microseconds(4000);
+
+static double
+toMilliseconds(FramePacer::Duration duration)
+{
+    return std::chrono::duration<double, std::milli>(duration).count();
+}
+
+FramePacer::
+FramePacer(double frameHertz) :
+    Commandable("pacer"),
+    m_basePeriod (),
+    m_period (),
+    m_speed (1.0),
+    m_deadline (),
+    m_lastFrame (),
+    m_started (false),
+    m_spinWindow (MIN_SPIN_WINDOW),
+    m_driftMs (0.0),
+    m_resyncs (0),
+    m_frameTimes (SAMPLE_WINDOW, 0.0),
+    m_nextSample (0),
+    m_sampleCount (0)
+{
+    setFrameHertz(frameHertz);
+    registerCommands();
+}
+
+void
+FramePacer::
+setFrameHertz(double hertz)
+{
+    assert(hertz > 0.0 && "FramePacer::setFrameHertz: frame rate must be positive!");
+    m_basePeriod = std::chrono::duration_cast<Duration>(std::chrono::duration<double>(1.0 / hertz));
+    updatePeriod();
+}
+
+double
+FramePacer::
+frameHertz() const
+{
+    return 1.0 / std::chrono::duration<double>(m_basePeriod).count();
+}
+
+void
+FramePacer::
+setSpeed(double multiplier)
+{
+    assert(multiplier >= 0.0 && "FramePacer::setSpeed: speed can't be negative!");
+    m_speed = multiplier;
+    updatePeriod();
+}
+
+double
+FramePacer::
+speed() const
+{
+    return m_speed;
+}
+
+void
+FramePacer::
+updatePeriod()
+{
+    if (m_speed != UNTHROTTLED) {
+        m_period = std::chrono::duration_cast<Duration>(m_basePeriod / m_speed);
+    }
+    // Changing the rate invalidates the old schedule.
+    m_started = false;
+}
+
+void
+FramePacer::
+restart()
+{
+    m_deadline  = ClockType::now();
+    m_lastFrame = m_deadline;
+    m_started   = true;
+}
+
+void
+FramePacer::
+waitForNextFrame()
+{
+    if (!m_started) {
+        restart();
+    }
+
+    if (m_speed == UNTHROTTLED) {
+        recordFrame(ClockType::now());
+        return;
+    }
+
+    m_deadline += m_period;
+
+    TimePoint now = ClockType::now();
+    if (now > m_deadline + m_period * MAX_LAG_FRAMES) {
+        // We're hopelessly behind (debugger, slow host, load). Catching up would
+        // mean running flat out for a while, so start a fresh schedule instead.
+        m_deadline = now;
+        ++m_resyncs;
+    }
+    else if (now < m_deadline) {
+        sleepUntil(m_deadline);
+        now = ClockType::now();
+    }
+
+    // Whatever lateness is left over is carried by the absolute schedule and
+    // taken out of the next frame's wait.
+    m_driftMs = toMilliseconds(now - m_deadline);
+
+    recordFrame(now);
+}
+
+void
+FramePacer::
+sleepUntil(TimePoint deadline)
+{
+    TimePoint wakeTarget = deadline - m_spinWindow;
+    TimePoint now        = ClockType::now();
+
+    if (now < wakeTarget) {
+        std::this_thread::sleep_until(wakeTarget);
+
+        // Size the spin window from how badly the OS overshot the sleep: grow
+        // quickly when we wake up late, shrink slowly when we don't.
+        Duration overshoot = ClockType::now() - wakeTarget;
+        if (overshoot * 2 > m_spinWindow) {
+            m_spinWindow = std::min(MAX_SPIN_WINDOW, m_spinWindow + overshoot);
+        }
+        else {
+            m_spinWindow = std::max(MIN_SPIN_WINDOW, m_spinWindow - m_spinWindow / 16);
+        }
+    }
+
+    // Spin out the remainder. Yielding keeps us from starving other threads
+    // on a loaded machine.
+    while (ClockType::now() < deadline) {
+        std::this_thread::yield();
+    }
+}
+
+void
+FramePacer::
+recordFrame(TimePoint now)
+{
+    m_frameTimes[m_nextSample] = toMilliseconds(now - m_lastFrame);
+    m_nextSample = (m_nextSample + 1) % SAMPLE_WINDOW;
+    m_sampleCount = std::min(m_sampleCount + 1, SAMPLE_WINDOW);
+    m_lastFrame = now;
+}
+
+FramePacer::Statistics
+FramePacer::
+statistics() const
+{
+    Statistics stats;
+    stats.m_driftMs = m_driftMs;
+    stats.m_resyncs = m_resyncs;
+    stats.m_frames  = m_sampleCount;
+
+    if (m_sampleCount == 0) {
+        return stats;
+    }
+
+    std::vector<double> samples(m_frameTimes.begin(), m_frameTimes.begin() + m_sampleCount);
+    double periodMs = toMilliseconds(m_period);
+    double total    = 0.0;
+    double jitter   = 0.0;
+    std::for_each(samples.begin(), samples.end(), [&](double sample) {
+            total  += sample;
+            jitter += std::fabs(sample - periodMs);
+    });
+    stats.m_meanMs   = total  / m_sampleCount;
+    stats.m_jitterMs = jitter / m_sampleCount;
+    stats.m_fps      = total > 0.0 ? (1000.0 * m_sampleCount) / total : 0.0;
+
+    std::sort(samples.begin(), samples.end());
+    stats.m_p99Ms = samples[(m_sampleCount * 99 + 99) / 100 - 1];
+    stats.m_maxMs = samples.back();
+
+    return stats;
+}
+
+void
+FramePacer::
+resetStatistics()
+{
+    m_nextSample  = 0;
+    m_sampleCount = 0;
+    m_resyncs     = 0;
+}
+
+std::string
+FramePacer::
+statisticsReport() const
+{
+    Statistics stats = statistics();
+
+    std::stringstream output;
+    output << std::fixed << std::setprecision(3)
+           << "Target:  " << frameHertz() << " Hz (" << toMilliseconds(m_basePeriod) << " ms)\n";
+    if (m_speed == UNTHROTTLED) {
+        output << "Speed:   unthrottled\n";
+    }
+    else {
+        output << "Speed:   " << m_speed << "x\n";
+    }
+    output << "FPS:     " << stats.m_fps      << "\n"
+           << "Frames:  " << stats.m_frames   << "\n"
+           << "Mean:    " << stats.m_meanMs   << " ms\n"
+           << "p99:     " << stats.m_p99Ms    << " ms\n"
+           << "Max:     " << stats.m_maxMs    << " ms\n"
+           << "Jitter:  " << stats.m_jitterMs << " ms\n"
+           << "Drift:   " << stats.m_driftMs  << " ms\n"
+           << "Resyncs: " << stats.m_resyncs  << "\n";
+    return output.str();
+}
+
+void
+FramePacer::
+registerCommands()
+{
+    std::vector<Command> commands = {
+        { "stats", STATS_COMMAND_CODE, "Print frame time statistics (mean, p99, max, jitter).", 0 },
+        { "reset", RESET_COMMAND_CODE, "Clear the frame time statistics.", 0 }
+    };
+
+    std::for_each(commands.begin(), commands.end(), [&](Command c) { addCommand(c); });
+}
+
+CommandResult
+FramePacer::
+receiveCommand(CommandInput command)
+{
+    CommandResult result;
+    result.m_code = CommandResult::NO_RECEIVER;
+
+    switch (command.m_code) {
+        case STATS_COMMAND_CODE:
+        {
+            result.m_output = statisticsReport();
+            result.m_code   = CommandResult::OK;
+        }
+        break;
+        case RESET_COMMAND_CODE:
+        {
+            resetStatistics();
+            result.m_code = CommandResult::OK;
+        }
+        break;
+    }
+
+    return result;
+}
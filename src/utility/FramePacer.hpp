@@ -0,0 +1,107 @@
+#ifndef FRAME_PACER_H
+#define FRAME_PACER_H
+
+#include "Commandable.hpp"
+
+#include <chrono>
+#include <type_traits>
+#include <vector>
+
+/*
+FramePacer
+
+Keeps emulated frames in step with wall-clock time. Deadlines are kept on an
+absolute schedule (each one is the previous deadline plus one period), so the
+lateness of one frame is paid back on the next instead of accumulating as drift.
+Waiting is a coarse sleep followed by a short spin; the spin window adapts to
+how far the OS overshoots our sleeps.
+*/
+
+class FramePacer : public Commandable
+{
+public:
+    // Prefer the high resolution clock, but only if it is monotonic.
+    typedef std::conditional<std::chrono::high_resolution_clock::is_steady,
+                             std::chrono::high_resolution_clock,
+                             std::chrono::steady_clock>::type ClockType;
+    typedef ClockType::time_point                             TimePoint;
+    typedef ClockType::duration                               Duration;
+
+    FramePacer(double frameHertz);
+
+    struct Statistics
+    {
+        Statistics() :
+            m_frames (0),
+            m_meanMs (0.0),
+            m_p99Ms (0.0),
+            m_maxMs (0.0),
+            m_jitterMs (0.0),
+            m_driftMs (0.0),
+            m_resyncs (0),
+            m_fps (0.0)
+        {}
+
+        unsigned int m_frames;      // Frame times in the sample window.
+        double       m_meanMs;      // Mean frame time.
+        double       m_p99Ms;       // 99th percentile frame time.
+        double       m_maxMs;       // Longest frame time.
+        double       m_jitterMs;    // Mean absolute deviation from the target period.
+        double       m_driftMs;     // How far behind the absolute schedule we are.
+        unsigned int m_resyncs;     // Times we fell too far behind and restarted the schedule.
+        double       m_fps;         // Frames per second actually achieved.
+    };
+
+    // Number of frame times kept for the statistics.
+    static const unsigned int SAMPLE_WINDOW  = 1024;
+    // Fall this many periods behind and we give up catching up.
+    static const unsigned int MAX_LAG_FRAMES = 4;
+
+    void   setFrameHertz(double hertz);
+    double frameHertz() const;
+
+    // Runs frames at a multiple of the frame rate. A speed of 0 (UNTHROTTLED)
+    // turns waiting off entirely, frames are still counted for the statistics.
+    static const double UNTHROTTLED;
+    void   setSpeed(double multiplier);
+    double speed() const;
+
+    // Starts a new schedule from now. Call after any long pause.
+    void restart();
+
+    // Blocks until the deadline of the next frame.
+    void waitForNextFrame();
+
+    Statistics statistics() const;
+    void       resetStatistics();
+    std::string statisticsReport() const;
+
+    // Commandable interface
+    virtual CommandResult receiveCommand(CommandInput command);
+    virtual std::string   typeName() { return std::string("FramePacer"); }
+
+private:
+    void registerCommands();
+    void sleepUntil(TimePoint deadline);
+    void recordFrame(TimePoint now);
+
+    void updatePeriod();
+
+    Duration     m_basePeriod;
+    Duration     m_period;
+    double       m_speed;
+    TimePoint    m_deadline;
+    TimePoint    m_lastFrame;
+    bool         m_started;
+
+    // Time before a deadline at which we stop sleeping and start spinning.
+    Duration     m_spinWindow;
+    double       m_driftMs;
+    unsigned int m_resyncs;
+
+    std::vector<double> m_frameTimes;
+    unsigned int        m_nextSample;
+    unsigned int        m_sampleCount;
+};
+
+#endif //FRAME_PACER_H
@@ -0,0 +1,363 @@
+#include "Hash.hpp"
+
+#include "KernelDispatch.hpp"
+
+#include <cstring>
+
+namespace Hash
+{
+
+static const std::uint32_t PRIME32_1 = 0x9E3779B1U;
+static const std::uint32_t PRIME32_2 = 0x85EBCA77U;
+static const std::uint32_t PRIME32_3 = 0xC2B2AE3DU;
+static const std::uint64_t PRIME64_1 = 0x9E3779B185EBCA87ULL;
+static const std::uint64_t PRIME64_2 = 0xC2B2AE3D27D4EB4FULL;
+static const std::uint64_t PRIME64_3 = 0x165667B19E3779F9ULL;
+static const std::uint64_t PRIME64_4 = 0x85EBCA77C2B2AE63ULL;
+static const std::uint64_t PRIME64_5 = 0x27D4EB2F165667C5ULL;
+
+static const std::size_t ACCUMULATORS   = 8;
+static const std::size_t STRIPE_SIZE    = 64;
+static const std::size_t SECRET_SIZE    = 192;
+// Each stripe of a block uses the secret this much further on.
+static const std::size_t SECRET_STEP    = 8;
+static const std::size_t BLOCK_STRIPES  = (SECRET_SIZE - STRIPE_SIZE) / SECRET_STEP;
+static const std::size_t BLOCK_SIZE     = BLOCK_STRIPES * STRIPE_SIZE;
+// Where in the secret the last stripe's key and the merge's start.
+static const std::size_t LAST_STRIPE_AT = SECRET_SIZE - STRIPE_SIZE - 7;
+static const std::size_t MERGE_AT       = 11;
+static const std::size_t MID_SIZE_MAX   = 240;
+static const std::size_t MID_LAST_AT    = 136 - 17;
+
+static const unsigned char SECRET[SECRET_SIZE] = {
+    0xb8, 0xfe, 0x6c, 0x39, 0x23, 0xa4, 0x4b, 0xbe, 0x7c, 0x01, 0x81, 0x2c, 0xf7, 0x21, 0xad, 0x1c,
+    0xde, 0xd4, 0x6d, 0xe9, 0x83, 0x90, 0x97, 0xdb, 0x72, 0x40, 0xa4, 0xa4, 0xb7, 0xb3, 0x67, 0x1f,
+    0xcb, 0x79, 0xe6, 0x4e, 0xcc, 0xc0, 0xe5, 0x78, 0x82, 0x5a, 0xd0, 0x7d, 0xcc, 0xff, 0x72, 0x21,
+    0xb8, 0x08, 0x46, 0x74, 0xf7, 0x43, 0x24, 0x8e, 0xe0, 0x35, 0x90, 0xe6, 0x81, 0x3a, 0x26, 0x4c,
+    0x3c, 0x28, 0x52, 0xbb, 0x91, 0xc3, 0x00, 0xcb, 0x88, 0xd0, 0x65, 0x8b, 0x1b, 0x53, 0x2e, 0xa3,
+    0x71, 0x64, 0x48, 0x97, 0xa2, 0x0d, 0xf9, 0x4e, 0x38, 0x19, 0xef, 0x46, 0xa9, 0xde, 0xac, 0xd8,
+    0xa8, 0xfa, 0x76, 0x3f, 0xe3, 0x9c, 0x34, 0x3f, 0xf9, 0xdc, 0xbb, 0xc7, 0xc7, 0x0b, 0x4f, 0x1d,
+    0x8a, 0x51, 0xe0, 0x4b, 0xcd, 0xb4, 0x59, 0x31, 0xc8, 0x9f, 0x7e, 0xc9, 0xd9, 0x78, 0x73, 0x64,
+    0xea, 0xc5, 0xac, 0x83, 0x34, 0xd3, 0xeb, 0xc3, 0xc5, 0x81, 0xa0, 0xff, 0xfa, 0x13, 0x63, 0xeb,
+    0x17, 0x0d, 0xdd, 0x51, 0xb7, 0xf0, 0xda, 0x49, 0xd3, 0x16, 0x55, 0x26, 0x29, 0xd4, 0x68, 0x9e,
+    0x2b, 0x16, 0xbe, 0x58, 0x7d, 0x47, 0xa1, 0xfc, 0x8f, 0xf8, 0xb8, 0xd1, 0x7a, 0xd0, 0x31, 0xce,
+    0x45, 0xcb, 0x3a, 0x8f, 0x95, 0x16, 0x04, 0x28, 0xaf, 0xd7, 0xfb, 0xca, 0xbb, 0x4b, 0x40, 0x7e,
+};
+
+__extension__ typedef unsigned __int128 Product;
+
+// Little endian reads; the machines we run on are.
+static inline std::uint32_t
+read32(const unsigned char* p)
+{
+    std::uint32_t value;
+    std::memcpy(&value, p, sizeof(value));
+    return value;
+}
+
+static inline std::uint64_t
+read64(const unsigned char* p)
+{
+    std::uint64_t value;
+    std::memcpy(&value, p, sizeof(value));
+    return value;
+}
+
+// The 128 bit product's halves xored together.
+static inline std::uint64_t
+fold(std::uint64_t a, std::uint64_t b)
+{
+    Product product = Product(a) * b;
+    return std::uint64_t(product) ^ std::uint64_t(product >> 64);
+}
+
+static inline std::uint64_t
+rotate(std::uint64_t value, unsigned int bits)
+{
+    return (value << bits) | (value >> (64 - bits));
+}
+
+static std::uint64_t
+avalanche(std::uint64_t h)
+{
+    h ^= h >> 37;
+    h *= 0x165667919E3779F9ULL;
+    return h ^ (h >> 32);
+}
+
+// XXH64's.
+static std::uint64_t
+avalanche64(std::uint64_t h)
+{
+    h ^= h >> 33;
+    h *= PRIME64_2;
+    h ^= h >> 29;
+    h *= PRIME64_3;
+    return h ^ (h >> 32);
+}
+
+static std::uint64_t
+strongAvalanche(std::uint64_t h, std::uint64_t size)
+{
+    h ^= rotate(h, 49) ^ rotate(h, 24);
+    h *= 0x9FB21C651E98DF25ULL;
+    h ^= (h >> 35) + size;
+    h *= 0x9FB21C651E98DF25ULL;
+    return h ^ (h >> 28);
+}
+
+static inline std::uint64_t
+mix16(const unsigned char* input, const unsigned char* secret)
+{
+    return fold(read64(input) ^ read64(secret), read64(input + 8) ^ read64(secret + 8));
+}
+
+static std::uint64_t
+hashShort(const unsigned char* input, std::size_t size)
+{
+    if (size > 8) {
+        std::uint64_t low  = read64(input) ^ (read64(SECRET + 24) ^ read64(SECRET + 32));
+        std::uint64_t high = read64(input + size - 8) ^ (read64(SECRET + 40) ^ read64(SECRET + 48));
+        return avalanche(size + __builtin_bswap64(low) + high + fold(low, high));
+    }
+    if (size >= 4) {
+        std::uint64_t combined = read32(input + size - 4) + (std::uint64_t(read32(input)) << 32);
+        return strongAvalanche(combined ^ (read64(SECRET + 8) ^ read64(SECRET + 16)), size);
+    }
+    if (size > 0) {
+        std::uint32_t combined = (std::uint32_t(input[0]) << 16) | (std::uint32_t(input[size >> 1]) << 24) |
+                                 input[size - 1] | std::uint32_t(size << 8);
+        return avalanche64(combined ^ std::uint64_t(read32(SECRET) ^ read32(SECRET + 4)));
+    }
+    return avalanche64(read64(SECRET + 56) ^ read64(SECRET + 64));
+}
+
+static std::uint64_t
+hashMedium(const unsigned char* input, std::size_t size)
+{
+    std::uint64_t acc = size * PRIME64_1;
+    if (size <= 128) {
+        // Pairs from both ends, working in.
+        for (std::size_t i = (size - 1) / 32 + 1; i-- > 0; ) {
+            acc += mix16(input + 16 * i, SECRET + 32 * i);
+            acc += mix16(input + size - 16 * (i + 1), SECRET + 32 * i + 16);
+        }
+        return avalanche(acc);
+    }
+
+    for (std::size_t i = 0; i < 8; ++i) {
+        acc += mix16(input + 16 * i, SECRET + 16 * i);
+    }
+    acc = avalanche(acc);
+    for (std::size_t i = 8; i < size / 16; ++i) {
+        acc += mix16(input + 16 * i, SECRET + 16 * (i - 8) + 3);
+    }
+    acc += mix16(input + size - 16, SECRET + MID_LAST_AT);
+    return avalanche(acc);
+}
+
+// What each kernel does to the accumulators: take in stripes 64 byte
+// stripes, the secret moving on SECRET_STEP bytes each, and scramble them
+// at the end of a block.
+struct Functions
+{
+    void (*accumulate)(std::uint64_t* acc, const unsigned char* input, const unsigned char* secret,
+                       std::size_t stripes);
+    void (*scramble)(std::uint64_t* acc, const unsigned char* secret);
+};
+
+static void
+accumulateScalar(std::uint64_t* acc, const unsigned char* input, const unsigned char* secret,
+                 std::size_t stripes)
+{
+    for (std::size_t stripe = 0; stripe < stripes; ++stripe) {
+        for (std::size_t i = 0; i < ACCUMULATORS; ++i) {
+            std::uint64_t value = read64(input + 8 * i);
+            std::uint64_t keyed = value ^ read64(secret + 8 * i);
+            acc[i ^ 1] += value;
+            acc[i]     += (keyed & 0xFFFFFFFF) * (keyed >> 32);
+        }
+        input  += STRIPE_SIZE;
+        secret += SECRET_STEP;
+    }
+}
+
+static void
+scrambleScalar(std::uint64_t* acc, const unsigned char* secret)
+{
+    for (std::size_t i = 0; i < ACCUMULATORS; ++i) {
+        acc[i] = (acc[i] ^ (acc[i] >> 47) ^ read64(secret + 8 * i)) * PRIME32_1;
+    }
+}
+
+static const Functions SCALAR_FUNCTIONS = { accumulateScalar, scrambleScalar };
+
+#ifdef KERNEL_DISPATCH_X86
+
+__attribute__((target("sse2")))
+static void
+accumulateSSE2(std::uint64_t* acc, const unsigned char* input, const unsigned char* secret,
+               std::size_t stripes)
+{
+    __m128i *vectors = reinterpret_cast<__m128i*>(acc);
+    __m128i sums[4];
+    for (unsigned int i = 0; i < 4; ++i) {
+        sums[i] = _mm_loadu_si128(vectors + i);
+    }
+    for (std::size_t stripe = 0; stripe < stripes; ++stripe) {
+        for (unsigned int i = 0; i < 4; ++i) {
+            __m128i value = _mm_loadu_si128(reinterpret_cast<const __m128i*>(input) + i);
+            __m128i keyed = _mm_xor_si128(value, _mm_loadu_si128(reinterpret_cast<const __m128i*>(secret) + i));
+            // Low half of each key times its high half, and the values
+            // added to their neighbours.
+            __m128i product = _mm_mul_epu32(keyed, _mm_shuffle_epi32(keyed, _MM_SHUFFLE(0, 3, 0, 1)));
+            __m128i swapped = _mm_shuffle_epi32(value, _MM_SHUFFLE(1, 0, 3, 2));
+            sums[i] = _mm_add_epi64(sums[i], _mm_add_epi64(product, swapped));
+        }
+        input  += STRIPE_SIZE;
+        secret += SECRET_STEP;
+    }
+    for (unsigned int i = 0; i < 4; ++i) {
+        _mm_storeu_si128(vectors + i, sums[i]);
+    }
+}
+
+__attribute__((target("sse2")))
+static void
+scrambleSSE2(std::uint64_t* acc, const unsigned char* secret)
+{
+    __m128i *vectors = reinterpret_cast<__m128i*>(acc);
+    const __m128i prime = _mm_set1_epi32(PRIME32_1);
+    for (unsigned int i = 0; i < 4; ++i) {
+        __m128i value = _mm_loadu_si128(vectors + i);
+        value = _mm_xor_si128(value, _mm_srli_epi64(value, 47));
+        value = _mm_xor_si128(value, _mm_loadu_si128(reinterpret_cast<const __m128i*>(secret) + i));
+        // A 64 by 32 bit multiply from two 32 by 32 bit ones.
+        __m128i low  = _mm_mul_epu32(value, prime);
+        __m128i high = _mm_mul_epu32(_mm_shuffle_epi32(value, _MM_SHUFFLE(0, 3, 0, 1)), prime);
+        _mm_storeu_si128(vectors + i, _mm_add_epi64(low, _mm_slli_epi64(high, 32)));
+    }
+}
+
+static const Functions SSE2_FUNCTIONS = { accumulateSSE2, scrambleSSE2 };
+
+__attribute__((target("avx2")))
+static void
+accumulateAVX2(std::uint64_t* acc, const unsigned char* input, const unsigned char* secret,
+               std::size_t stripes)
+{
+    __m256i *vectors = reinterpret_cast<__m256i*>(acc);
+    __m256i sums[2] = { _mm256_loadu_si256(vectors), _mm256_loadu_si256(vectors + 1) };
+    for (std::size_t stripe = 0; stripe < stripes; ++stripe) {
+        for (unsigned int i = 0; i < 2; ++i) {
+            __m256i value = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(input) + i);
+            __m256i keyed = _mm256_xor_si256(value, _mm256_loadu_si256(reinterpret_cast<const __m256i*>(secret) + i));
+            __m256i product = _mm256_mul_epu32(keyed, _mm256_srli_epi64(keyed, 32));
+            __m256i swapped = _mm256_shuffle_epi32(value, _MM_SHUFFLE(1, 0, 3, 2));
+            sums[i] = _mm256_add_epi64(sums[i], _mm256_add_epi64(product, swapped));
+        }
+        input  += STRIPE_SIZE;
+        secret += SECRET_STEP;
+    }
+    _mm256_storeu_si256(vectors, sums[0]);
+    _mm256_storeu_si256(vectors + 1, sums[1]);
+}
+
+__attribute__((target("avx2")))
+static void
+scrambleAVX2(std::uint64_t* acc, const unsigned char* secret)
+{
+    __m256i *vectors = reinterpret_cast<__m256i*>(acc);
+    const __m256i prime = _mm256_set1_epi32(PRIME32_1);
+    for (unsigned int i = 0; i < 2; ++i) {
+        __m256i value = _mm256_loadu_si256(vectors + i);
+        value = _mm256_xor_si256(value, _mm256_srli_epi64(value, 47));
+        value = _mm256_xor_si256(value, _mm256_loadu_si256(reinterpret_cast<const __m256i*>(secret) + i));
+        __m256i low  = _mm256_mul_epu32(value, prime);
+        __m256i high = _mm256_mul_epu32(_mm256_srli_epi64(value, 32), prime);
+        _mm256_storeu_si256(vectors + i, _mm256_add_epi64(low, _mm256_slli_epi64(high, 32)));
+    }
+}
+
+static const Functions AVX2_FUNCTIONS = { accumulateAVX2, scrambleAVX2 };
+
+#endif // KERNEL_DISPATCH_X86
+
+static const KernelDispatch::Entry<Functions> KERNELS[KERNEL_COUNT] = {
+    { "scalar", KernelDispatch::NONE, SCALAR_FUNCTIONS },
+    { "sse2",   KernelDispatch::SSE2, KERNEL_DISPATCH_VECTOR(SSE2_FUNCTIONS, SCALAR_FUNCTIONS) },
+    { "avx2",   KernelDispatch::AVX2, KERNEL_DISPATCH_VECTOR(AVX2_FUNCTIONS, SCALAR_FUNCTIONS) }
+};
+
+static KernelDispatch::Dispatcher<Kernel, Functions, KERNEL_COUNT>&
+dispatcher()
+{
+    static KernelDispatch::Dispatcher<Kernel, Functions, KERNEL_COUNT> kernels(KERNELS, { AVX2, SSE2 });
+    return kernels;
+}
+
+static std::uint64_t
+hashLong(const unsigned char* input, std::size_t size)
+{
+    const Functions &kernel = dispatcher().functions();
+    std::uint64_t acc[ACCUMULATORS] = {
+        PRIME32_3, PRIME64_1, PRIME64_2, PRIME64_3, PRIME64_4, PRIME32_2, PRIME64_5, PRIME32_1
+    };
+
+    // Whole blocks, then what's left of the last one, then the last 64
+    // bytes again whether or not that overlaps.
+    std::size_t blocks = (size - 1) / BLOCK_SIZE;
+    for (std::size_t block = 0; block < blocks; ++block) {
+        kernel.accumulate(acc, input + block * BLOCK_SIZE, SECRET, BLOCK_STRIPES);
+        kernel.scramble(acc, SECRET + SECRET_SIZE - STRIPE_SIZE);
+    }
+    std::size_t stripes = (size - 1 - blocks * BLOCK_SIZE) / STRIPE_SIZE;
+    kernel.accumulate(acc, input + blocks * BLOCK_SIZE, SECRET, stripes);
+    kernel.accumulate(acc, input + size - STRIPE_SIZE, SECRET + LAST_STRIPE_AT, 1);
+
+    std::uint64_t result = size * PRIME64_1;
+    for (std::size_t i = 0; i < ACCUMULATORS; i += 2) {
+        const unsigned char *secret = SECRET + MERGE_AT + 8 * i;
+        result += fold(acc[i] ^ read64(secret), acc[i + 1] ^ read64(secret + 8));
+    }
+    return avalanche(result);
+}
+
+std::uint64_t
+xxh3(const void* data, std::size_t size)
+{
+    const unsigned char *input = static_cast<const unsigned char*>(data);
+    if (size <= 16) {
+        return hashShort(input, size);
+    }
+    if (size <= MID_SIZE_MAX) {
+        return hashMedium(input, size);
+    }
+    return hashLong(input, size);
+}
+
+Kernel
+kernel()
+{
+    return dispatcher().current();
+}
+
+bool
+setKernel(Kernel kernel)
+{
+    return dispatcher().select(kernel);
+}
+
+bool
+supported(Kernel kernel)
+{
+    return dispatcher().supported(kernel);
+}
+
+const char*
+kernelName(Kernel kernel)
+{
+    return dispatcher().name(kernel);
+}
+
+}
@@ -0,0 +1,38 @@
+#ifndef HASH_H
+#define HASH_H
+
+#include <cstddef>
+#include <cstdint>
+
+/*
+Hash
+
+XXH3's 64 bit hash (no seed, the default secret), bit for bit: the same
+values the xxHash library and its command line tools give. Anything longer
+than 240 bytes, a frame for instance, goes through eight 64 bit
+accumulators a 64 byte stripe at a time, and that part has vector kernels;
+as with TileDecode the fastest one the CPU supports is used and all give the
+same result. Not for anything that needs to be hard to forge.
+*/
+
+namespace Hash
+{
+
+enum Kernel
+{
+    SCALAR = 0,
+    SSE2,       // Two accumulators a vector.
+    AVX2,       // Four.
+    KERNEL_COUNT
+};
+
+std::uint64_t xxh3(const void* data, std::size_t size);
+
+Kernel kernel();
+bool   setKernel(Kernel kernel);
+bool   supported(Kernel kernel);
+const char* kernelName(Kernel kernel);
+
+}
+
+#endif //HASH_H
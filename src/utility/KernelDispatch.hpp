@@ -0,0 +1,185 @@
+#ifndef KERNEL_DISPATCH_H
+#define KERNEL_DISPATCH_H
+
+#include "DataTypes.hpp"
+
+#include <cassert>
+#include <initializer_list>
+
+/*
+KernelDispatch
+
+The runtime kernel choice every vectorized module makes the same way. A
+module lists its kernels in a table indexed by its own Kernel enum, each
+with a name, the CPU feature it needs and its functions (one pointer or a
+struct of them), and keeps a Dispatcher over the table. The first kernel of
+the module's preference list the CPU supports is picked the first time the
+dispatcher is used; the first entry is the scalar fallback and reference.
+
+Also here is the PSHUFB table lookup PixelConvert and Observation share.
+*/
+
+// The vector kernels are compiled with per-function target attributes so the
+// rest of the build doesn't need -mavx2 and the binary still runs anywhere.
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define KERNEL_DISPATCH_X86
+#include <immintrin.h>
+#endif
+
+// A vector kernel's functions in a table entry, or fallback where this build
+// doesn't have them. cpuSupports() keeps those entries from being picked.
+// The 64 bit one is for kernels using 64 bit only instructions.
+#ifdef KERNEL_DISPATCH_X86
+#define KERNEL_DISPATCH_VECTOR(functions, fallback) functions
+#else
+#define KERNEL_DISPATCH_VECTOR(functions, fallback) fallback
+#endif
+#if defined(KERNEL_DISPATCH_X86) && defined(__x86_64__)
+#define KERNEL_DISPATCH_VECTOR64(functions, fallback) functions
+#else
+#define KERNEL_DISPATCH_VECTOR64(functions, fallback) fallback
+#endif
+
+namespace KernelDispatch
+{
+
+// What a kernel needs from the CPU.
+enum Feature
+{
+    NONE = 0,
+    SSE2,
+    SSSE3,
+    AVX2,
+    BMI2
+};
+
+// Whether this CPU has feature and this build can use it.
+inline bool
+cpuSupports(Feature feature)
+{
+    switch (feature) {
+        case NONE:  return true;
+#ifdef KERNEL_DISPATCH_X86
+        case SSE2:  return __builtin_cpu_supports("sse2");
+        case SSSE3: return __builtin_cpu_supports("ssse3");
+        case AVX2:  return __builtin_cpu_supports("avx2");
+#ifdef __x86_64__
+        case BMI2:  return __builtin_cpu_supports("bmi2");
+#endif
+#endif
+        default:    return false;
+    }
+}
+
+template <typename Functions>
+struct Entry
+{
+    const char *m_name;
+    Feature     m_feature;
+    Functions   m_functions;
+};
+
+// The kernel in use out of COUNT. Don't switch while another thread is
+// using the module.
+template <typename Kernel, typename Functions, unsigned int COUNT>
+class Dispatcher
+{
+public:
+    // entries is in Kernel order and must outlive the dispatcher;
+    // preference is best first.
+    Dispatcher(const Entry<Functions> (&entries)[COUNT], std::initializer_list<Kernel> preference) :
+        m_entries (entries),
+        m_current (static_cast<Kernel>(0))
+    {
+        for (Kernel kernel : preference) {
+            if (supported(kernel)) {
+                m_current = kernel;
+                break;
+            }
+        }
+    }
+
+    bool supported(Kernel kernel) const {
+        return static_cast<unsigned int>(kernel) < COUNT && cpuSupports(m_entries[kernel].m_feature);
+    }
+
+    Kernel current() const { return m_current; }
+
+    // False, and nothing changes, if the CPU can't run kernel.
+    bool select(Kernel kernel) {
+        if (!supported(kernel)) {
+            return false;
+        }
+        m_current = kernel;
+        return true;
+    }
+
+    const Functions& functions() const { return m_entries[m_current].m_functions; }
+
+    const char* name(Kernel kernel) const {
+        assert(static_cast<unsigned int>(kernel) < COUNT && "KernelDispatch::name: no such kernel!");
+        return m_entries[kernel].m_name;
+    }
+
+private:
+    const Entry<Functions> *m_entries;
+    Kernel                  m_current;
+};
+
+// PSHUFB looks up 16 entries of a 64 entry byte table at a time.
+const unsigned int LOOKUP_ENTRIES = 64;
+const unsigned int LOOKUP_SPAN    = 16;
+const unsigned int LOOKUP_STEPS   = LOOKUP_ENTRIES / LOOKUP_SPAN;
+
+// values as the lookups below want them: step n holds entries 16n..
+// xored with the 16 before.
+inline void
+splitSteps(const u8_byte* values, u8_byte* steps)
+{
+    for (unsigned int index = 0; index < LOOKUP_ENTRIES; ++index) {
+        steps[index] = values[index];
+    }
+    for (unsigned int index = LOOKUP_ENTRIES - 1; index >= LOOKUP_SPAN; --index) {
+        steps[index] ^= values[index - LOOKUP_SPAN];
+    }
+}
+
+#ifdef KERNEL_DISPATCH_X86
+
+// Looks up 16 indices (0-63) in a 64 entry byte table. PSHUFB only sees the
+// low 4 bits of an index and gives 0 where the top bit is set, so each step
+// takes the index down by 16: indices still in range pick up the difference
+// between their 16 entries and the previous 16, the rest go negative and add
+// nothing.
+__attribute__((target("ssse3")))
+inline __m128i
+lookupSSSE3(const __m128i steps[LOOKUP_STEPS], __m128i indices)
+{
+    const __m128i span = _mm_set1_epi8(LOOKUP_SPAN);
+    __m128i result = _mm_shuffle_epi8(steps[0], indices);
+    for (unsigned int step = 1; step < LOOKUP_STEPS; ++step) {
+        indices = _mm_sub_epi8(indices, span);
+        result  = _mm_xor_si128(result, _mm_shuffle_epi8(steps[step], indices));
+    }
+    return result;
+}
+
+// The same on 32 indices, with the steps in both lanes.
+__attribute__((target("avx2")))
+inline __m256i
+lookupAVX2(const __m256i steps[LOOKUP_STEPS], __m256i indices)
+{
+    const __m256i span = _mm256_set1_epi8(LOOKUP_SPAN);
+    __m256i result = _mm256_shuffle_epi8(steps[0], indices);
+    for (unsigned int step = 1; step < LOOKUP_STEPS; ++step) {
+        indices = _mm256_sub_epi8(indices, span);
+        result  = _mm256_xor_si256(result, _mm256_shuffle_epi8(steps[step], indices));
+    }
+    return result;
+}
+
+#endif // KERNEL_DISPATCH_X86
+
+}
+
+#endif //KERNEL_DISPATCH_H
@@ -13,8 +13,8 @@ Memory(address_t startAddress,
     m_endAddress(endAddress)
 {
     assert(startAddress < endAddress);
-    m_size = endAddress - startAddress;
-    assert(m_size > 0);
+    // Both ends of the range are addressable.
+    m_size = endAddress - startAddress + 1;
 }
 
 Memory::
@@ -45,6 +45,13 @@ endAddress() const
     return m_endAddress;
 }
 
+Memory::size_t
+Memory::
+size() const
+{
+    return m_size;
+}
+
 void
 Memory::
 setAddressRange(address_t begin, address_t end)
@@ -77,11 +84,20 @@ rawWrite(const address_t address, const data_t data)
     setData(address, data);
 }
 
+void
+Memory::
+readBlock(address_t address, size_t size, data_t* data)
+{
+    for (size_t i = 0; i < size; ++i) {
+        data[i] = getData(address + i);
+    }
+}
+
 BackedMemory::
 BackedMemory(address_t beginAddress, address_t endAddress) :
     Memory(beginAddress, endAddress)
 {
-    m_backing = new data_t[m_size];
+    m_backing = new data_t[m_size]();
     assert(m_backing != nullptr);
 }
 
@@ -113,7 +129,7 @@ BackedMemory::
 BackedMemory(size_t size) :
     Memory(size)
 {
-    m_backing = new data_t[size];
+    m_backing = new data_t[size]();
     assert(m_backing != nullptr);
 }
 
@@ -140,10 +156,26 @@ setAddressRange(address_t begin, address_t end)
 {
     Memory::setAddressRange(begin, end);
 
-    assert((end - begin) == m_size && 
+    assert((end - begin + 1) == m_size && 
            "BackedMemory does not support resizing the address range!");
 }
 
+void
+BackedMemory::
+readBlock(address_t address, size_t size, data_t* data)
+{
+    assert(address >= m_startAddress && address - m_startAddress + size <= m_size);
+    std::copy(m_backing + correctedAddress(address), m_backing + correctedAddress(address) + size, data);
+}
+
+void
+BackedMemory::
+writeBlock(address_t address, size_t size, const data_t* data)
+{
+    assert(address >= m_startAddress && address - m_startAddress + size <= m_size);
+    std::copy(data, data + size, m_backing + correctedAddress(address));
+}
+
 Memory::address_t
 BackedMemory::
 correctedAddress(address_t address) const
@@ -177,8 +209,6 @@ MappedMemory(address_t startAddress,
     Memory(startAddress, endAddress),
     m_segments (segments)
 {
-    assert(segments.size() > 0);
-    std::cout << debugInfo();
 }
 
 MappedMemory::
@@ -203,7 +233,6 @@ MappedMemory::
 addSegment(Memory *segment)
 {
     assert(segment != nullptr);
-    std::cerr << "MappedMemory::addSegment(): Adding segment: " << segmentInfo(segment);
     m_segments.push_back(segment);
 }
 
@@ -213,12 +242,26 @@ removeSegment(address_t address)
 {
     std::vector<Memory*>::iterator it = findMemorySegmentIterator(address);
     if (it != m_segments.end()) {
-        std::cerr << "MappedMemory::removeSegment(): Removing segment: " << segmentInfo(*it);
         m_segments.erase(it);
+        return;
     }
     std::cerr << "MappedMemory::removeSegment(): No segment to remove at address: " << "0x" << std::hex << address << "\n";
 }
 
+void
+MappedMemory::
+readBlock(address_t address, size_t size, data_t* data)
+{
+    while (size > 0) {
+        Memory *segment = findMemorySegment(address);
+        size_t count = std::min<size_t>(size, segment->startAddress() + segment->size() - address);
+        segment->readBlock(address, count, data);
+        address += count;
+        data    += count;
+        size    -= count;
+    }
+}
+
 Memory::data_t  
 MappedMemory::
 getData(address_t address)
@@ -244,12 +287,8 @@ findMemorySegmentIterator(address_t address)
     //TODO: More efficent memory segment find. This is O(n).
     for (iter = m_segments.begin(); iter != m_segments.end(); ++iter) {
         Memory *segment = *iter;
-
-        std::cout << segmentInfo(segment); 
-
         if (address >= segment->startAddress() &&
             address <= segment->endAddress()) {
-            std::cout << "Found segment!\n";
             break;
         }
     }
@@ -30,6 +30,10 @@ public:
     // Raw read/writes aren't checked in any appreciable way.
     void        rawWrite(const address_t address, const data_t data);
 
+    // size bytes from address on in one go, for snapshots. A byte at a time
+    // unless the memory can do better. The range must fit.
+    virtual void readBlock(address_t address, size_t size, data_t* data);
+
     u8_byte rawReadByte(const address_t address) {
         return getData(address);
     }
@@ -68,6 +72,13 @@ public:
 
     virtual Memory* clone();
 
+    virtual void readBlock(address_t address, size_t size, data_t* data);
+    // size bytes to address on in one go, for DMA. The range must fit.
+    void writeBlock(address_t address, size_t size, const data_t* data);
+
+    // The bytes themselves, for page tables that point straight at them.
+    data_t* data() { return m_backing; }
+
 protected:
     virtual data_t  getData(address_t address);
     virtual void    setData(address_t address, data_t data);
@@ -95,6 +106,9 @@ public:
 
     virtual Memory* clone();
 
+    // Segment by segment.
+    virtual void readBlock(address_t address, size_t size, data_t* data);
+
     std::string debugInfo() const;
     std::string segmentInfo(Memory * segment) const;
 
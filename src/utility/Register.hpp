@@ -39,6 +39,10 @@ public:
     virtual u8_byte read();
     virtual void    write(u8_byte data, u8_byte mask = 0xFF);
 
+    // Current contents without any of the side effects of read(), for
+    // debuggers and diagnostics.
+    u8_byte peek() const { return rawRead(); }
+
     // Interface for Commandable.
     virtual CommandResult                  receiveCommand(CommandInput input);
     virtual std::string                    typeName() { return std::string("Register"); }
@@ -0,0 +1,71 @@
+#ifndef SPSC_QUEUE_H
+#define SPSC_QUEUE_H
+
+#include <atomic>
+#include <cassert>
+#include <vector>
+
+/*
+SPSCQueue
+
+Bounded lock-free FIFO between exactly one producer thread and exactly one
+consumer thread. The producer only writes m_tail and the consumer only writes
+m_head, so neither side ever takes a lock or waits; a full queue makes push()
+fail and an empty one makes pop() fail, and the caller decides what to do.
+*/
+
+template <typename T>
+class SPSCQueue
+{
+public:
+    // Capacity must be a power of two.
+    SPSCQueue(unsigned int capacity) :
+        m_slots (capacity),
+        m_mask (capacity - 1),
+        m_head (0),
+        m_tail (0)
+    {
+        assert(capacity > 0 && (capacity & (capacity - 1)) == 0 &&
+               "SPSCQueue: capacity must be a power of two!");
+    }
+
+    unsigned int capacity() const { return m_mask + 1; }
+
+    // Producer side.
+    bool push(const T& value) {
+        unsigned int tail = m_tail.load(std::memory_order_relaxed);
+        if (tail - m_head.load(std::memory_order_acquire) == capacity()) {
+            return false;
+        }
+        m_slots[tail & m_mask] = value;
+        m_tail.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Consumer side.
+    bool pop(T& value) {
+        unsigned int head = m_head.load(std::memory_order_relaxed);
+        if (head == m_tail.load(std::memory_order_acquire)) {
+            return false;
+        }
+        value = m_slots[head & m_mask];
+        m_head.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+    bool empty() const {
+        return m_head.load(std::memory_order_acquire) == m_tail.load(std::memory_order_acquire);
+    }
+
+private:
+    std::vector<T>                        m_slots;
+    unsigned int                          m_mask;
+    // Each index lives on its own cache line so the two sides don't fight over it.
+    alignas(64) std::atomic<unsigned int> m_head;
+    alignas(64) std::atomic<unsigned int> m_tail;
+
+    SPSCQueue(const SPSCQueue&);
+    SPSCQueue& operator=(const SPSCQueue&);
+};
+
+#endif //SPSC_QUEUE_H
@@ -0,0 +1,102 @@
+#include "ThreadPool.hpp"
+
+#include <cassert>
+
+ThreadPool::
+ThreadPool(unsigned int size) :
+    m_threads (),
+    m_mutex (),
+    m_wake (),
+    m_done (),
+    m_task (nullptr),
+    m_count (0),
+    m_next (0),
+    m_busyWorkers (0),
+    m_batch (0),
+    m_quit (false)
+{
+    assert(size > 0 && "ThreadPool: a pool needs at least the calling thread!");
+    for (unsigned int i = 1; i < size; ++i) {
+        m_threads.push_back(std::thread(&ThreadPool::workerLoop, this));
+    }
+}
+
+ThreadPool::
+~ThreadPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_quit = true;
+    }
+    m_wake.notify_all();
+    for (std::thread &thread : m_threads) {
+        thread.join();
+    }
+}
+
+unsigned int
+ThreadPool::
+size() const
+{
+    return m_threads.size() + 1;
+}
+
+void
+ThreadPool::
+run(unsigned int count, const Task& task)
+{
+    if (m_threads.empty() || count < 2) {
+        for (unsigned int i = 0; i < count; ++i) {
+            task(i);
+        }
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_task        = &task;
+        m_count       = count;
+        m_next        = 0;
+        m_busyWorkers = m_threads.size();
+        ++m_batch;
+    }
+    m_wake.notify_all();
+
+    work();
+
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_done.wait(lock, [this] { return m_busyWorkers == 0; });
+    m_task = nullptr;
+}
+
+void
+ThreadPool::
+work()
+{
+    for (unsigned int i = m_next++; i < m_count; i = m_next++) {
+        (*m_task)(i);
+    }
+}
+
+void
+ThreadPool::
+workerLoop()
+{
+    unsigned long lastBatch = 0;
+    std::unique_lock<std::mutex> lock(m_mutex);
+    while (true) {
+        m_wake.wait(lock, [&] { return m_quit || m_batch != lastBatch; });
+        if (m_quit) {
+            return;
+        }
+        lastBatch = m_batch;
+
+        lock.unlock();
+        work();
+        lock.lock();
+
+        if (--m_busyWorkers == 0) {
+            m_done.notify_one();
+        }
+    }
+}
@@ -0,0 +1,55 @@
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/*
+ThreadPool
+
+A small fixed set of threads for splitting one piece of work into
+independent tasks (a parallel for). The calling thread works on the tasks
+too, so a pool of size n has n - 1 threads of its own. Tasks are handed out
+dynamically but must not depend on which thread runs them or in what order.
+*/
+
+class ThreadPool
+{
+public:
+    typedef std::function<void(unsigned int)> Task;
+
+    ThreadPool(unsigned int size);
+    ~ThreadPool();
+
+    // Threads taking part in run(), the caller included.
+    unsigned int size() const;
+
+    // Calls task(i) for every i in [0, count) and returns once all are done.
+    void run(unsigned int count, const Task& task);
+
+private:
+    void workerLoop();
+    void work();
+
+    std::vector<std::thread>  m_threads;
+    std::mutex                m_mutex;
+    std::condition_variable   m_wake;
+    std::condition_variable   m_done;
+
+    // The current batch. Set under m_mutex before workers are woken.
+    const Task               *m_task;
+    unsigned int              m_count;
+    std::atomic<unsigned int> m_next;
+    unsigned int              m_busyWorkers;
+    unsigned long             m_batch;
+    bool                      m_quit;
+
+    ThreadPool(const ThreadPool&);
+    ThreadPool& operator=(const ThreadPool&);
+};
+
+#endif //THREAD_POOL_H
@@ -0,0 +1,65 @@
+#ifndef TRIPLE_BUFFER_H
+#define TRIPLE_BUFFER_H
+
+#include <atomic>
+
+/*
+TripleBuffer
+
+Lock-free hand-off of the latest value from one producer thread to one
+consumer thread. The producer fills back() and publish()es it; the consumer
+calls consume() and reads front(). Neither side ever waits on the other: the
+producer can publish as often as it likes (older unread values are simply
+dropped) and the consumer always gets the most recently published one.
+
+The three buffers rotate through the back (producer owned), middle (shared)
+and front (consumer owned) slots. Only the middle slot index is shared, packed
+together with a flag saying whether it holds something the consumer hasn't
+seen yet.
+*/
+
+template <typename T>
+class TripleBuffer
+{
+public:
+    TripleBuffer() :
+        m_middle (1),
+        m_back (0),
+        m_front (2)
+    {}
+
+    // Producer side.
+    T& back() { return m_buffers[m_back]; }
+
+    void publish() {
+        unsigned int previous = m_middle.exchange(m_back | FRESH_FLAG, std::memory_order_acq_rel);
+        m_back = previous & INDEX_MASK;
+    }
+
+    // Consumer side. Returns true if front() changed.
+    bool consume() {
+        if ((m_middle.load(std::memory_order_relaxed) & FRESH_FLAG) == 0) {
+            return false;
+        }
+        unsigned int previous = m_middle.exchange(m_front, std::memory_order_acq_rel);
+        m_front = previous & INDEX_MASK;
+        return true;
+    }
+
+    const T& front() const { return m_buffers[m_front]; }
+
+private:
+    static const unsigned int INDEX_MASK = 0x03;
+    static const unsigned int FRESH_FLAG = 0x04;
+
+    // Keep the shared index away from the producer and consumer owned ones.
+    T                         m_buffers[3];
+    std::atomic<unsigned int> m_middle;
+    alignas(64) unsigned int  m_back;
+    alignas(64) unsigned int  m_front;
+
+    TripleBuffer(const TripleBuffer&);
+    TripleBuffer& operator=(const TripleBuffer&);
+};
+
+#endif //TRIPLE_BUFFER_H
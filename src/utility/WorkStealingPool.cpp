@@ -0,0 +1,227 @@
+#include "WorkStealingPool.hpp"
+
+#include <cassert>
+
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+// The cores we're allowed on, in order.
+static std::vector<int>
+allowedCores()
+{
+    std::vector<int> cores;
+#ifdef __linux__
+    cpu_set_t allowed;
+    CPU_ZERO(&allowed);
+    if (sched_getaffinity(0, sizeof(allowed), &allowed) == 0) {
+        for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu) {
+            if (CPU_ISSET(cpu, &allowed)) {
+                cores.push_back(cpu);
+            }
+        }
+    }
+#endif
+    return cores;
+}
+
+static bool
+pinThread(std::thread& thread, int core)
+{
+#ifdef __linux__
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(core, &set);
+    return pthread_setaffinity_np(thread.native_handle(), sizeof(set), &set) == 0;
+#else
+    return false;
+#endif
+}
+
+WorkStealingPool::
+WorkStealingPool(unsigned int workers, bool pinned) :
+    m_workers (),
+    m_threads (),
+    m_pinned (false),
+    m_mutex (),
+    m_wake (),
+    m_done (),
+    m_task (nullptr),
+    m_busyWorkers (0),
+    m_batch (0),
+    m_quit (false)
+{
+    assert(workers > 0 && "WorkStealingPool: need at least one worker!");
+    for (unsigned int i = 0; i < workers; ++i) {
+        m_workers.push_back(std::unique_ptr<Worker>(new Worker()));
+        m_workers.back()->m_stats.m_core = -1;
+    }
+    for (unsigned int i = 0; i < workers; ++i) {
+        m_threads.push_back(std::thread(&WorkStealingPool::workerLoop, this, i));
+    }
+
+    if (pinned) {
+        // One worker per core; with more workers than cores they double up.
+        std::vector<int> cores = allowedCores();
+        m_pinned = !cores.empty();
+        for (unsigned int i = 0; i < workers && m_pinned; ++i) {
+            int core = cores[i % cores.size()];
+            m_pinned = pinThread(m_threads[i], core);
+            if (m_pinned) {
+                m_workers[i]->m_stats.m_core = core;
+            }
+        }
+    }
+}
+
+WorkStealingPool::
+~WorkStealingPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_quit = true;
+    }
+    m_wake.notify_all();
+    for (std::thread &thread : m_threads) {
+        thread.join();
+    }
+}
+
+unsigned int
+WorkStealingPool::
+size() const
+{
+    return m_workers.size();
+}
+
+bool
+WorkStealingPool::
+pinned() const
+{
+    return m_pinned;
+}
+
+unsigned int
+WorkStealingPool::
+availableCores()
+{
+    std::vector<int> cores = allowedCores();
+    if (!cores.empty()) {
+        return cores.size();
+    }
+    unsigned int hardware = std::thread::hardware_concurrency();
+    return hardware > 0 ? hardware : 1;
+}
+
+std::vector<WorkStealingPool::WorkerStatistics>
+WorkStealingPool::
+statistics() const
+{
+    std::vector<WorkerStatistics> stats;
+    for (const std::unique_ptr<Worker> &worker : m_workers) {
+        stats.push_back(worker->m_stats);
+    }
+    return stats;
+}
+
+void
+WorkStealingPool::
+run(unsigned int count, const Task& task)
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    for (unsigned int i = 0; i < m_workers.size(); ++i) {
+        std::lock_guard<std::mutex> workerLock(m_workers[i]->m_mutex);
+        m_workers[i]->m_tasks.clear();
+        m_workers[i]->m_stats.m_tasks  = 0;
+        m_workers[i]->m_stats.m_stolen = 0;
+    }
+    for (unsigned int i = 0; i < count; ++i) {
+        Worker &worker = *m_workers[i % m_workers.size()];
+        std::lock_guard<std::mutex> workerLock(worker.m_mutex);
+        worker.m_tasks.push_back(i);
+    }
+    m_task        = &task;
+    m_busyWorkers = m_workers.size();
+    ++m_batch;
+    m_wake.notify_all();
+
+    m_done.wait(lock, [this] { return m_busyWorkers == 0; });
+    m_task = nullptr;
+}
+
+bool
+WorkStealingPool::
+takeOwn(unsigned int index, unsigned int& task)
+{
+    Worker &worker = *m_workers[index];
+    std::lock_guard<std::mutex> lock(worker.m_mutex);
+    if (worker.m_tasks.empty()) {
+        return false;
+    }
+    task = worker.m_tasks.front();
+    worker.m_tasks.pop_front();
+    return true;
+}
+
+bool
+WorkStealingPool::
+steal(unsigned int index, unsigned int& task)
+{
+    // Start with our neighbour so thieves spread out over the victims.
+    for (unsigned int offset = 1; offset < m_workers.size(); ++offset) {
+        Worker &victim = *m_workers[(index + offset) % m_workers.size()];
+        std::lock_guard<std::mutex> lock(victim.m_mutex);
+        if (!victim.m_tasks.empty()) {
+            task = victim.m_tasks.back();
+            victim.m_tasks.pop_back();
+            return true;
+        }
+    }
+    return false;
+}
+
+void
+WorkStealingPool::
+work(unsigned int index)
+{
+    // Nothing is added during a batch, so once every deque is empty we're done.
+    WorkerStatistics &stats = m_workers[index]->m_stats;
+    unsigned int task = 0;
+    while (true) {
+        if (takeOwn(index, task)) {
+            (*m_task)(task, index);
+        }
+        else if (steal(index, task)) {
+            ++stats.m_stolen;
+            (*m_task)(task, index);
+        }
+        else {
+            return;
+        }
+        ++stats.m_tasks;
+    }
+}
+
+void
+WorkStealingPool::
+workerLoop(unsigned int index)
+{
+    unsigned long lastBatch = 0;
+    std::unique_lock<std::mutex> lock(m_mutex);
+    while (true) {
+        m_wake.wait(lock, [&] { return m_quit || m_batch != lastBatch; });
+        if (m_quit) {
+            return;
+        }
+        lastBatch = m_batch;
+
+        lock.unlock();
+        work(index);
+        lock.lock();
+
+        if (--m_busyWorkers == 0) {
+            m_done.notify_one();
+        }
+    }
+}
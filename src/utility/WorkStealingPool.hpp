@@ -0,0 +1,88 @@
+#ifndef WORK_STEALING_POOL_H
+#define WORK_STEALING_POOL_H
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/*
+WorkStealingPool
+
+Runs batches of independent, long and unevenly sized tasks (whole emulator
+runs, say) on a fixed set of worker threads, optionally pinned one per core.
+Each worker has its own deque: tasks are dealt out round robin up front, a
+worker takes from the front of its own deque and, when that runs dry, steals
+from the back of someone else's. Workers only touch each other's deques
+while stealing, so there's no single queue for all of them to fight over.
+
+Unlike ThreadPool the calling thread doesn't take part; it just waits.
+*/
+
+class WorkStealingPool
+{
+public:
+    typedef std::function<void(unsigned int task, unsigned int worker)> Task;
+
+    WorkStealingPool(unsigned int workers, bool pinned);
+    ~WorkStealingPool();
+
+    unsigned int size() const;
+    // Did every worker get pinned to a core? False where pinning isn't supported.
+    bool pinned() const;
+
+    // Calls task(i, worker) for every i in [0, count) and returns once all are
+    // done. Tasks are dealt out in index order, so put the longest ones first.
+    void run(unsigned int count, const Task& task);
+
+    struct WorkerStatistics
+    {
+        unsigned int m_tasks;   // Tasks run in the last batch.
+        unsigned int m_stolen;  // ...of which were taken from another worker.
+        int          m_core;    // Core the worker is pinned to, or -1.
+    };
+    std::vector<WorkerStatistics> statistics() const;
+
+    // Cores this process may run on.
+    static unsigned int availableCores();
+
+private:
+    struct Worker
+    {
+        Worker() :
+            m_mutex (),
+            m_tasks (),
+            m_stats ()
+        {}
+
+        std::mutex               m_mutex;
+        std::deque<unsigned int> m_tasks;
+        WorkerStatistics         m_stats;
+    };
+
+    void workerLoop(unsigned int index);
+    void work(unsigned int index);
+    bool takeOwn(unsigned int index, unsigned int& task);
+    bool steal(unsigned int index, unsigned int& task);
+
+    std::vector<std::unique_ptr<Worker>> m_workers;
+    std::vector<std::thread>             m_threads;
+    bool                                 m_pinned;
+
+    // The current batch. Set under m_mutex before workers are woken.
+    std::mutex               m_mutex;
+    std::condition_variable  m_wake;
+    std::condition_variable  m_done;
+    const Task              *m_task;
+    unsigned int             m_busyWorkers;
+    unsigned long            m_batch;
+    bool                     m_quit;
+
+    WorkStealingPool(const WorkStealingPool&);
+    WorkStealingPool& operator=(const WorkStealingPool&);
+};
+
+#endif //WORK_STEALING_POOL_H